@@ -21,14 +21,18 @@
 *                   is dropped.  Either event leads to the the same 
 *                   outcome - an iteration failure.
 *
-*                numberAlarmTimeouts : counts the number of times the application timeout pops.
+*                numberTimeouts : counts the probes whose reply did not arrive within the timeout.
 *                avgRTT:  sample mean of the RTT samples 
 *                    ( total RTT sample sum /  total number RTT samples)
 *               avgLossRate: sample mean of the loss rate ( number dropped / number sent)
 *        
 *
 * Invocation:
-*        UDPPingClient <server host name> <server port>  <message size> <iteration delay>  <traceLevel>
+*        UDPPingClient <server host name> <server port>  <message size> <iteration delay>  <traceLevel> <mode>
+*        UDPPingClient <message size> <iteration delay>  <traceLevel> <mode> -targets <file>
+*
+*          The second (mesh) form has no server and port params:  the targets
+*          are read from the -targets file.
 *
 *          <server host name> : name (numberic or domain) of server 
 *          <server port> :     port number or service name used by server
@@ -51,20 +55,131 @@
 *                                 0   displays end of program stats and error msgs
 *                                   1   Additionally displays RTT sample each iteration
 *                                   2   displays debug info
+*        <mode>             : optional....0 (echo), 1 (ACK only), 2 (stream, no ACKs)
+*
+*        Optional named params follow the positional params:
+*          -wif <IF name>     : wireless IF sampled for RSSI/SignalQuality (default wlan0)
+*          -wint <seconds>    : interval between wireless samples (default 1.0)
+*          -window <N>        : modes 0,1: allow N probes in flight (pipelined).  Sends follow
+*                               the iteration delay schedule; replies are matched by seq number.
+*                               0 (default) is the original stop-and-wait operation
+*                               (a window of 1).
+*          -timeout <seconds> : modes 0,1: a probe whose reply has not arrived within
+*                               this time is lost (default TIMEOUT, 2 secs).  Any
+*                               value > 0 (e.g., 0.0005) - the timer has nsec resolution.
+*          -rttmult <k>       : modes 0,1: a probe is lost when its reply has not arrived
+*                               within k * the smoothed RTT (at least PROBE_MIN_TIMEOUT,
+*                               at most -timeout, which is also used until the first
+*                               reply).  0 (default): always -timeout.
+*          -batch <N>         : mode 2: send the probes that are due with one sendmmsg,
+*                               up to N (1..MAX_MSG_BATCH) per syscall.  With a 0 delay
+*                               every syscall sends N probes.  The 0.2 second minimum
+*                               mode 2 delay is not applied.
+*          -ts <none|sw|hw>   : modes 0,1: RTT/OWD samples use kernel (sw) or NIC (hw)
+*                               tx/rx timestamps (SO_TIMESTAMPING) rather than clock_gettime
+*                               calls made around the send and the receive
+*          -tsif <IF name>    : -ts hw: the IF whose NIC is set to timestamp
+*          -tracefile <file>  : traceLevel 1: the per reply trace is logged (binary)
+*                               to the file by a background thread rather than
+*                               printed.  traceToCSV converts the file to the CSV lines.
+*          -interval <secs[,secs...]>: e.g. 1,10,60:  a reporter thread displays,
+*                               at the end of each window, the sent/received
+*                               counts and rates, the losses and late replies and
+*                               the RTT and OWD percentiles of that window.  The
+*                               first window is the tick, the others multiples of
+*                               it.  The pacer thread only updates the current
+*                               epoch of the counters.  No -interval (the
+*                               default):  only at the end.
+*          -pacecpu <N>       : pin the pacer thread (the send/receive loop) to CPU N
+*                               (default -1: not pinned)
+*          -fifo <priority>   : run the pacer thread SCHED_FIFO at priority 1..99
+*                               (needs CAP_SYS_NICE; default 0: normal scheduling)
+*          -clock <gettime|tsc>: the send/arrival times (without -ts) and the send
+*                               schedule are read from clock_gettime (default) or
+*                               from the TSC (calibrated at start, x86 with an
+*                               invariant TSC only), which costs much less per probe
+*          -schedule <const|exp|uniform|trace>: the gaps between the sends:
+*                               const (default) the iteration delay, exp exponential
+*                               with the iteration delay as the mean (Poisson probes),
+*                               uniform the iteration delay +- jitter, trace the
+*                               departure times of a file (-schedfile) replayed in a loop
+*          -jitter <fraction> : -schedule uniform: 0.0 .. 1.0 of the iteration delay
+*          -schedfile <file>  : -schedule trace: one departure time (secs) per line
+*          -seed <N>          : -schedule exp/uniform: the random numbers seed
+*                               (default 0: from the clock)
+*          -rate <bits/sec>   : mode 2: send at this rate (e.g. 500k, 20M, 1G) of UDP
+*                               payload.  A token bucket replaces the iteration delay
+*                               (the delay param is not used) and there is no minimum
+*                               delay.  Msgs leave in bursts of up to -burst bytes.
+*          -burst <bytes>     : -rate: the token bucket depth (default: one batch,
+*                               -batch msgs of msgSize bytes)
+*          -kpace <0|1>       : -rate: 1 also sets SO_MAX_PACING_RATE to the rate so
+*                               the kernel spaces the msgs (needs the fq qdisc on the
+*                               IF: tc qdisc replace dev IF root fq)
+*          -gso <0|1>         : mode 2 (-batch or -rate): 1: the msgs of a pass are
+*                               built back to back in one buffer and sent with one
+*                               sendmsg (UDP GSO:  the kernel cuts the datagrams).
+*                               msgSize must fit the path MTU.
+*          -io <socket|uring> : mode 2 -batch/-rate (without -gso): the msgs of a pass
+*                               are sent with io_uring sendmsgs (one io_uring_enter)
+*                               rather than sendmmsg.  Falls back to sendmmsg when
+*                               io_uring is not available.
+*
+*          -targets <file>    : mesh mode:  probe every target of the file (one per line:
+*                               host:port [rate probes/sec] [msgSize]) from one socket and
+*                               one event loop.  The server and port params are omitted:
+*                                 UDPPingClient <msgSize> <iteration delay> <traceLevel> <mode> -targets file
+*                               msgSize and 1/delay are the defaults of the lines without them.
+*                               Modes 0,1 only, -timeout is the loss timeout.  The per target
+*                               stats are displayed at the end.
+*          -shm <name>        : publish the live counters and RTT histogram (per target
+*                               with -targets) in the shared memory segment /dev/shm/name
+*                               while the client runs.  UDPPingStats name reads them.
+*          -wire <full|compact|legacy>: the probe header (messages.h):  full (default)
+*                               the version 1 format, 50 bytes with ns times and the
+*                               RSSI/SignalQuality extension; compact its 16 byte
+*                               variant (seq and send time only, e.g. for 64 byte
+*                               packets at high rates; the server's one way delay is
+*                               not clock offset corrected); legacy the original 60
+*                               byte TGIFHeartbeat struct, for servers that predate
+*                               the version 1 format (replies carry one server time,
+*                               the arrival, and no clock offset is sent).
+*                               msgSize is at least the header.
+*
+*        One way delays (modes 0,1): each reply carries the server's rx and tx
+*          times (a legacy reply its arrival time for both).  With the probe's send time and the reply's arrival time they
+*          feed the clock offset/skew estimator (clockSync) and the OWD of both
+*          directions (fwd: to the server, rev: the reply) are corrected by
+*          the estimate.  The OWD column of the trace is the reply's (rev).
+*          The estimate is also sent to the server in each probe.
 *
 *             ./UDPPingClient  ada8.computing 5000 1472 1000000 1
 *             ./UDPPingClient  ada8.computing 5000   
 *                     uses defaults of  1000, 1000000 1
+*             ./UDPPingClient  1472 1000000 1 0 -targets targets.txt
 *           
 * Note: There are two pairs of timestamps used.
 *
 * Pair 1:   Tstart and Tstop :  set before the sendto and after the recvfrom (to obtain an RTT sample)
 * Pair 2:   TSstartD - is a timestamp  before we enter the loop,
-*           nextWakeUpTimeD=TSstartD; //init
-*           At the end of each loop:
-*           nextWakeUpTimeD+=delay;
-*           busyWait(nextWakeUpTimeD) //busy waits until the specified time.
-*               Todo:  place this on a thread and pin the thread to a specific CPU/Core
+*           nextSendTimeD=TSstartD; //init
+*           After each send:
+*           nextSendTimeD=nextSendDeadline(probeSchedule); //TSstartD + n*delay when const
+*           mode 2:   pacerWaitUntil(&pace, nextSendTimeD) //sleeps, then spins until the specified time.
+*           modes 0,1: the send timer expires at pacerWakeTime(&pace, nextSendTimeD) and
+*                     pacerWokeUp spins until the specified time.
+*
+*   The send loops run on the pacer thread (optionally pinned (-pacecpu)
+*   and SCHED_FIFO (-fifo)).  The main thread only waits for it.
+*   Every thread but main blocks SIGINT:  CNTCHandler clears runFlag and
+*   signals wakeFD (its waits end), main displays the stats and
+*   cleans up once the pacer thread has ended.
+*   Modes 0,1 run an event loop (epoll):  one wait covers the socket,
+*   a send timer and a loss timer (timerfd).  No signal (SIGALRM)
+*   interrupts the receive; each probe has its own deadline.
+*   The mesh (-targets) loop is also an event loop:  the send times
+*   and loss deadlines of all the targets are on timer wheels (1 msec
+*   ticks) and the probes that are due together leave in one sendmmsg.
 *
 *
 * Revisions:
@@ -72,21 +187,65 @@
 *  Last update: 10/21/2019
 *
 *********************************************************/
+#define _GNU_SOURCE /* for struct mmsghdr */
 #include "./commonCode/common.h"
 #include "./commonCode/AddressHelper.h"
 #include "./commonCode/SocketHelper.h"
 #include "./commonCode/messages.h"
 #include "version.h"
 #include "./commonCode/timeHelper.h"
-#include "/usr/include/linux/wireless.h"
+#include "./commonCode/wirelessSampler.h"
+#include "./commonCode/probeWindow.h"
+#include "./commonCode/traceLogger.h"
+#include "./commonCode/latencyHistogram.h"
+#include "./commonCode/clockSync.h"
+#include "./commonCode/sendSchedule.h"
+#include "./commonCode/uringHelper.h"
+#include "./commonCode/eventLoop.h"
+#include "./commonCode/meshTable.h"
+#include "./commonCode/statsExport.h"
+#include "./commonCode/intervalStats.h"
+#include <sys/prctl.h>
 
 //If defined, adds debug printfs
 //#define TRACEME 1
 
+//The event loop tags (modes 0,1)
+#define EVENT_SOCKET 0
+#define EVENT_SEND_TIMER 1
+#define EVENT_LOSS_TIMER 2
+#define EVENT_WAKE 3
+
+//What the pacer thread needs to run a send loop
+typedef struct {
+  probeHeader *header;
+  int msgSize;
+  double delay;
+  struct sockaddr *servAddrPtr;
+  socklen_t servAddrLen;
+  int rc;
+} probeLoopArgs;
+
 //Routines found in this file
-void AlarmHandler(int ignored); // Handler for SIGALRM
 void CNTCHandler();
+void printRunStats();
 void exitProcessing(int errorStatus, double curTime);
+int parseOptions(int argc, char *argv[]);
+void *probeLoop(void *arg);
+int runEventLoop(probeHeader *header, int msgSize, double delay,
+                 struct sockaddr *servAddrPtr, socklen_t servAddrLen);
+void processReply(probeHeader *reply, int bytesRxed, double txTime, double Tstop, int windowRC);
+int runStream(probeHeader *header, int msgSize, double delay,
+              struct sockaddr *servAddrPtr, socklen_t servAddrLen);
+int setupMesh(char *progName, int msgSize, double delay);
+int runMesh(probeHeader *header);
+int sendMeshBatch(msgBatch *txBatch, uint32_t numberMsgs);
+int RxReply(int msgSize, struct sockaddr *fromAddrPtr, socklen_t *fromAddrLenPtr, double *TstopPtr);
+bool readTxTimestamps(uint32_t seq, double *txTimePtr);
+void traceRTTSample(double curTime, double txTime, double Tstop, double OWDSample,
+                    uint32_t RxSeqNumber, int bytesRxed);
+void addLatencySamples(double RTTSample, double fwdOWDSample, double OWDSample);
+double replyOWD(probeHeader *reply, double txTime, double Tstop, double *fwdOWDPtr);
 double gettimestampD(uint32_t sec, uint32_t nsec)
 {
   return (double)sec + (double)nsec / 1000000000;
@@ -95,18 +254,19 @@ double gettimestampD(uint32_t sec, uint32_t nsec)
 uint32_t numberSent = 0;
 uint32_t numberRxed = 0;
 uint32_t numberDropped = 0;
-uint32_t numberAlarmTimeouts = 0;
+uint32_t numberTimeouts = 0;   //probes with no reply within probeTimeout
 char *SendBufPtr = NULL;
 char *RxBufPtr = NULL;
 
 //For RTT sample mean
 double RTTSum = 0.0;
-//For One Way Delay sample mean
+//For One Way Delay sample means (OWD: server to client, fwd: client to server)
 double OWDSum = 0.0;
+double fwdOWDSum = 0.0;
 int numberRTTSamples = 0;
 int numberOWDSamples = 0;
 int sock = -1; //To be used as the client's socket descriptor
-uint32_t totalBytesSent = 0;
+uint64_t totalBytesSent = 0;
 double sessionStartTime = -1;
 double sessionFinishTime = 0.0;
 double clientStartTime = 0.0;
@@ -122,31 +282,108 @@ int mode = 0; //normal ping operation (all data echoed)
 
 bool runFlag = true;
 
+//Wireless IF sampled (in the background) for the RSSI and SignalQuality header fields
+char *wirelessIFName = WIRELESS_DEFAULT_IF;
+double wirelessSampleInterval = WIRELESS_DEFAULT_SAMPLE_INTERVAL;
+
+//Number of probes allowed in flight. 0: stop-and-wait (send, wait for the reply or the timeout)
+uint32_t probeWindowSize = 0;
+probeWindow *window = NULL;
+uint32_t numberReordered = 0;
+//Seconds a probe waits for its reply before it is lost (modes 0,1)
+double probeTimeout = TIMEOUT;
+//> 0: the timeout is this multiple of the smoothed RTT (at most probeTimeout)
+double probeRTTMultiple = 0.0;
+//The modes 0,1 loop waits on the socket and its timers
+eventLoop *probeEvents = NULL;
+//Signaled by CNTCHandler:  the pacer thread's waits end
+int wakeFD = -1;
+
+//mode 2: max probes per sendmmsg. 0: the original one sendto per iteration
+uint32_t streamBatchSize = 0;
+
+//TIMESTAMP_NONE: send/arrival times are clock_gettime calls, else kernel/NIC stamps
+int timestampMode = TIMESTAMP_NONE;
+char *timestampIFName = NULL;
+uint32_t numberTxStamps = 0;
+uint32_t numberRxStamps = 0;
+
+//The pacer thread: its CPU (-1: not pinned), SCHED_FIFO priority (0: none) and pacer
+int paceCPU = -1;
+int paceFIFOPriority = 0;
+pacer pace;
+
+//mode 2 -rate: bits per second (0: the iteration delay), token bucket depth (bytes)
+double streamRate = 0.0;
+uint32_t streamBurst = 0;
+bool kernelPacing = false;
+tokenBucket streamBucket;
+//mode 2: true: each pass is one UDP GSO send rather than a sendmmsg
+bool useGSO = false;
+//mode 2: true (-io uring): the sends are io_uring sendmsgs
+bool useUring = false;
+uringContext *streamUring = NULL;
+
+//The send times: computed ahead by the schedule (NULL when there is no delay)
+int scheduleType = SCHEDULE_CONSTANT;
+double scheduleJitter = 0.0;
+char *scheduleFileName = NULL;
+uint64_t scheduleSeed = 0;
+sendSchedule *probeSchedule = NULL;
+
+//true: the send/arrival times (when not kernel stamps) and the send schedule read the TSC
+bool useTSCClock = false;
+
+//NULL: the traceLevel 1 lines are printed, else logged to this file
+char *traceFileName = NULL;
+
+//RTT/OWD distributions of the run
+latencyHistogram *RTTHist = NULL;
+latencyHistogram *OWDHist = NULL;
+latencyHistogram *fwdOWDHist = NULL;
+
+//-interval: the report windows (seconds, the first is the tick), the pacer's
+//epochs (RTT, OWD fwd, OWD rev) and the reporter.  0 windows: none
+double reportWindows[INTERVAL_MAX_WINDOWS];
+uint32_t numberReportWindows = 0;
+intervalStats *intervalCounts = NULL;
+intervalReporter *reporter = NULL;
+
+//-targets: the mesh's target file and table (NULL: one server)
+char *meshFileName = NULL;
+meshTable *meshTargets = NULL;
+uint32_t numberSendErrors = 0;
+
+//-shm: the live stats segment and (one server) its record
+char *shmName = NULL;
+statsExport *liveStats = NULL;
+statsRecord *liveRecord = NULL;
+
+//The probe header format (PROBE_FORMAT_FULL, _COMPACT or _LEGACY)
+int wireFormat = PROBE_FORMAT_FULL;
+
+//Server clock - client clock, estimated from the replies (modes 0,1)
+clockSync *clockEstimator = NULL;
+int32_t clockOffsetUsecs = 0;   //the estimate sent to the server in each probe
+
 int main(int argc, char *argv[])
 {
 
   int rc = EXIT_SUCCESS;
   char *server = NULL;  //ptr to server name
   char *service = NULL; //sets port number
-  int bytesRxed = -1;
-  double RTTSample = -1;
-  double Tstart = 0;
-  double Tstop = 0;
   int msgSize = -1;
   int hdrSize = -1;
   uint32_t iterationDelay = 0; //specified in units of microseconds
+  int i;
   double delay = 0.0;
-  //Used to track intervals for each Tx
-  struct timespec TSstartTS; //accurate TS clock
-  double TSstartD = 0.0;
-  double nextWakeUpTimeD = 0.0;
+  pthread_t pacerThread;
+  probeLoopArgs probeArgs;
+  sigset_t sigMask;
 
   //Maintains the next seq number to use
   unsigned int seqNumber = 1;
 
-  //Maintains the most recent ACK number that has been received
-  unsigned int RxSeqNumber = 0;
-
   //Set to point to the location in the send buffer to hold seqNumber in the message to be sent
   unsigned int *SeqNumberPtr = NULL;
 
@@ -160,108 +397,112 @@ int main(int argc, char *argv[])
   wallTime = getCurTimeD();
   clientStartTime = wallTime;
 
-  void *message = NULL;
-  TGIFHeartbeat *header = NULL;
+  probeHeader probeTemplate;
+  probeHeader *header = &probeTemplate;
 
-  //allocate memory for the message.
-  //The message will be a TGIFHeader + msgSize bytes
-  message = malloc((size_t)MAX_DATA_BUFFER);
-  if (message == NULL)
-  {
-    printf("perfClient: HARD ERROR malloc of %d bytes failed \n", msgSize);
-    exit(1);
-  }
-  memset(message, 0, MAX_DATA_BUFFER);
-  header = (TGIFHeartbeat *)message;
-  hdrSize = sizeof(TGIFHeartbeat);
-  if ((hdrSize + msgSize) > MAX_DATA_BUFFER)
-  {
-    printf("%s(Version:%s) hdrSize (%d) + msgSize (%d) exceeds max allow msg (%d) \n",
-           argv[0], getVersion(), hdrSize, msgSize, MAX_DATA_BUFFER);
-    rc = EXIT_FAILURE;
-    exit(rc);
-  }
-  //init the header fields
-  header->msgType = 3;
-  header->code = mode;
-  header->msgHdrsize = htons(hdrSize);
-  header->dataSize = htons(msgSize + hdrSize);
-  header->sequenceNum = htonl(seqNumber);
-  header->ts_sec = 0;
-  header->ts_nsec = 0;
+  //The header template:  each send sets the seq, times and wireless
+  //sample and encodes it (encodeProbe) at the front of the msg
+  memset(header, 0, sizeof(probeHeader));
+  header->mode = mode;
+  header->seq = seqNumber;
   header->timeSource = 2;
-  header->latitude = 0; //gps info - for now skip
-  header->longitude = 0;
-  header->elevation = 0;
-  header->velocity = 0;
-  header->latError = 0;
-  header->lonError = 0;
-  header->SignalQuality = 0;
-  header->RSSI = 0;
-//msgType 3
-#if 0
-typedef struct {
-  uint8_t  msgType;     //type of msg
-  uint8_t code;         //further specifies msg:  type:code
-  uint16_t msgHdrsize; //size in bytes of the header
-  uint16_t dataSize;
-  uint32_t nodeID;   //just set to 0
-  uint32_t sequenceNum;
-  uint32_t ts_sec;     //client places current timespec tv_sec
-  uint32_t ts_nsec;    //client places nsec
-  uint16_t timeSoure;  //0:localGPSD;1:remote GPSD; 2:Chrony;3:NTP;4:localClock
-  uint32_t latitude;   //gps info
-  uint32_t longitude;
-  uint32_t elevation;
-  uint32_t velocity;
-  uint32_t latError;
-  uint32_t lonError;
-  int32_t SignalQuality;
-  int32_t RSSI;
-} TGIFHeartbeat;
-#endif
+  //gps info - for now skip
 
   setVersion(VersionLevel);
 
-  if (argc < 3)
+  //The named options are removed - argc is now the number of positional params
+  argc = parseOptions(argc, argv);
+  header->format = wireFormat;
+  header->extensions = (wireFormat == PROBE_FORMAT_COMPACT) ? 0 : PROBE_EXT_WIRELESS;
+  hdrSize = probeHeaderSize(wireFormat, header->extensions);
+  if ((argc < 3) && (meshFileName == NULL))
   {
-    printf("%s(Version:%s) <server> <port>  <msgSize> <iteration delay (useconds)> <traceLevel> \n",
+    printf("%s(Version:%s) <server> <port>  <msgSize> <iteration delay (useconds)> <traceLevel> <mode> [-targets file] [-wif IF] [-wint secs] [-window N] [-timeout secs] [-rttmult k] [-batch N] [-ts none|sw|hw] [-tsif IF] [-tracefile file] [-interval secs[,secs...]] [-pacecpu N] [-fifo priority] [-clock gettime|tsc] [-schedule const|exp|uniform|trace] [-jitter fraction] [-schedfile file] [-seed N] [-rate bits/sec] [-burst bytes] [-kpace 0|1] [-gso 0|1] [-io socket|uring] [-shm name] [-wire full|compact|legacy]\n",
+           argv[0], getVersion());
+    printf("%s(Version:%s) <msgSize> <iteration delay (useconds)> <traceLevel> <mode> -targets file [options as above]\n",
            argv[0], getVersion());
     rc = EXIT_FAILURE;
     exit(rc);
   }
 
-  server = argv[1]; // First arg: server address/name
-  service = argv[2];
-
-  if (argc == 3)
-  {
-    msgSize = 1000;
-    iterationDelay = 1000000;
-  }
-  else if (argc == 4)
+  //-targets: there are no server and port params, msgSize is the first
+  if (meshFileName != NULL)
   {
-    msgSize = atoi(argv[3]);
-    iterationDelay = 1000000;
+    //At most 4 params, all numbers:  a server or port would be misread as msgSize
+    for (i = 1; i < argc; i++)
+      if ((i > 4) || (argv[i][0] == '\0') || (strspn(argv[i], "0123456789") != strlen(argv[i])))
+      {
+        printf("%s(Version:%s) -targets takes <msgSize> <iteration delay> <traceLevel> <mode> (no server or port, the targets are in the file), not %s \n",
+               argv[0], getVersion(), argv[i]);
+        exit(EXIT_FAILURE);
+      }
+    msgSize = (argc > 1) ? atoi(argv[1]) : 1000;
+    iterationDelay = (argc > 2) ? atoi(argv[2]) : 1000000;
+    if (argc > 3)
+      traceLevel = atoi(argv[3]);
+    if (argc > 4)
+    {
+      mode = atoi(argv[4]);
+      header->mode = mode;
+    }
+    server = "mesh";
+    service = meshFileName;
+    if ((mode > 1) || (timestampMode != TIMESTAMP_NONE))
+    {
+      printf("%s(Version:%s) -targets requires mode 0 or 1 (and no -ts) \n", argv[0], getVersion());
+      exit(EXIT_FAILURE);
+    }
   }
-  else if (argc == 5)
+  else
   {
-    msgSize = atoi(argv[3]);
-    iterationDelay = atoi(argv[4]);
+    server = argv[1]; // First arg: server address/name
+    service = argv[2];
+
+    if (argc == 3)
+    {
+      msgSize = 1000;
+      iterationDelay = 1000000;
+    }
+    else if (argc == 4)
+    {
+      msgSize = atoi(argv[3]);
+      iterationDelay = 1000000;
+    }
+    else if (argc == 5)
+    {
+      msgSize = atoi(argv[3]);
+      iterationDelay = atoi(argv[4]);
+    }
+    else if (argc == 6)
+    {
+      msgSize = atoi(argv[3]);
+      iterationDelay = atoi(argv[4]);
+      traceLevel = atoi(argv[5]);
+    }
+    else if (argc == 7)
+    {
+      msgSize = atoi(argv[3]);
+      iterationDelay = atoi(argv[4]);
+      traceLevel = atoi(argv[5]);
+      mode = atoi(argv[6]);
+      header->mode = mode;
+    }
   }
-  else if (argc == 6)
+
+  if (useTSCClock && ((setDefaultWallClockType(CLOCK_RDTSC) == ERROR) ||
+                      (setDefaultTimestampClockType(CLOCK_RDTSC) == ERROR)))
   {
-    msgSize = atoi(argv[3]);
-    iterationDelay = atoi(argv[4]);
-    traceLevel = atoi(argv[5]);
+    printf("%s(Version:%s) -clock tsc: the CPU has no invariant TSC \n", argv[0], getVersion());
+    exit(EXIT_FAILURE);
   }
-  else if (argc == 7)
+
+  //The header is carried at the front of each msgSize byte message
+  if ((msgSize < hdrSize) || (msgSize > MAX_DATA_BUFFER))
   {
-    msgSize = atoi(argv[3]);
-    iterationDelay = atoi(argv[4]);
-    traceLevel = atoi(argv[5]);
-    mode = atoi(argv[6]);
-    header->code = mode;
+    printf("%s(Version:%s) msgSize (%d) must be at least the hdrSize (%d) and at most %d \n",
+           argv[0], getVersion(), msgSize, hdrSize, MAX_DATA_BUFFER);
+    rc = EXIT_FAILURE;
+    exit(rc);
   }
 
   //If we were told a sendRate, this is how to find the delay
@@ -273,9 +514,54 @@ typedef struct {
   else
     delay = (double)iterationDelay / 1000000.0; //convert iterationDelay to units seconds
 
-  if (mode == 2 && delay < 0.2){
+  //A rate stream is paced by the token bucket, not by the delay
+  if (streamRate > 0.0)
+  {
+    if (mode != 2)
+    {
+      printf("%s(Version:%s) -rate requires mode 2 \n", argv[0], getVersion());
+      exit(EXIT_FAILURE);
+    }
+    if (streamBatchSize == 0)
+      streamBatchSize = 1;
+    if (streamBurst < streamBatchSize * msgSize)
+      streamBurst = streamBatchSize * msgSize;
+    delay = 0.0;
+  }
+
+  if (useGSO && ((streamBatchSize == 0) || (streamBatchSize > GSO_MAX_SEGMENTS) ||
+                 ((streamBatchSize * msgSize) > GSO_MAX_BUFFER)))
+  {
+    printf("%s(Version:%s) -gso requires mode 2 with -batch or -rate and at most %d msgs (%d bytes) per batch \n",
+           argv[0], getVersion(), GSO_MAX_SEGMENTS, GSO_MAX_BUFFER);
+    exit(EXIT_FAILURE);
+  }
+
+  if ((streamBatchSize > MAX_MSG_BATCH) || ((streamBatchSize > 0) && (mode != 2)))
+  {
+    printf("%s(Version:%s) -batch (%d) must be 1 .. %d and requires mode 2 \n",
+           argv[0], getVersion(), streamBatchSize, MAX_MSG_BATCH);
+    exit(EXIT_FAILURE);
+  }
+
+  if (mode == 2 && delay < 0.2 && streamBatchSize == 0){
     delay = 0.2; // set minimum delay for mode 2
   }
+  //mode 2 without -batch:  one probe per pass
+  if ((mode == 2) && (streamBatchSize == 0))
+    streamBatchSize = 1;
+
+  //A trace has its own gaps: its mean replaces the delay
+  if ((meshFileName == NULL) && ((delay > 0) || (scheduleType == SCHEDULE_TRACE)))
+  {
+    probeSchedule = createSendSchedule(scheduleType, delay, scheduleJitter, scheduleFileName, scheduleSeed);
+    if (probeSchedule == NULL)
+    {
+      printf("%s(Version:%s) failed to create the send schedule \n", argv[0], getVersion());
+      exit(EXIT_FAILURE);
+    }
+    delay = probeSchedule->meanGap;
+  }
 
   if (traceLevel > 0)
   {
@@ -285,21 +571,14 @@ typedef struct {
            argv[0], getVersion(), hdrSize, msgSize, MAX_DATA_BUFFER);
   }
   //setup to catch CNT-C
+  wakeFD = createEventWake();
+  if (wakeFD == ERROR)
+    exit(EXIT_FAILURE);
   signal(SIGINT, CNTCHandler);
 
-  // Set signal handler for alarm signal
-  struct sigaction handler; // Signal handler
-  handler.sa_handler = AlarmHandler;
-  if (sigfillset(&handler.sa_mask) < 0) // Block everything in handler
-    DieWithSystemMessage("sigfillset() failed");
-
-  handler.sa_flags = 0;
-
-  if (sigaction(SIGALRM, &handler, 0) < 0)
-    DieWithSystemMessage("sigaction() failed for SIGALRM");
-
   SendBufPtr = (char *)malloc(sizeof(char) * (msgSize));
-  RxBufPtr = (char *)malloc(sizeof(char) * (msgSize));
+  //An ACK can be larger than a compact probe
+  RxBufPtr = (char *)malloc(sizeof(char) * ((msgSize > PROBE_ACK_SIZE) ? msgSize : PROBE_ACK_SIZE));
   if ((SendBufPtr == NULL) || (RxBufPtr == NULL))
   {
     printf("%s(Version:%s) pid:%d  Malloc error,  msgSize:%d errno:%d  \n",
@@ -309,7 +588,7 @@ typedef struct {
   }
   //init the buffers to 0's
   bzero(SendBufPtr, (sizeof(char) * (msgSize)));
-  bzero(RxBufPtr, (sizeof(char) * (msgSize)));
+  bzero(RxBufPtr, (sizeof(char) * ((msgSize > PROBE_ACK_SIZE) ? msgSize : PROBE_ACK_SIZE)));
 
   //Init ptrs for sequence number and ack number in the SendBuf and RxBuf
   //Next lines setup both ptrs to same location since we use a single buffer for send and rx
@@ -323,11 +602,10 @@ typedef struct {
   // Set Length of client address structure (in-out parameter)
   socklen_t clntAddrLen = sizeof(clntAddr);
 
-  struct sockaddr_storage fromAddr; // Client address
-  // Set Length of client address structure (in-out parameter)
-  socklen_t fromAddrLen = sizeof(fromAddr);
-
-  sock = SetupUDPClientSocket(server, service, (struct sockaddr *)&clntAddr, &clntAddrLen);
+  if (meshFileName != NULL)
+    sock = setupMesh(argv[0], msgSize, delay);
+  else
+    sock = SetupUDPClientSocket(server, service, (struct sockaddr *)&clntAddr, &clntAddrLen);
   if (sock < 0)
   {
     printf("%s:  failed SetupClientSocket: rc:%d,  name:%s, service:%s,  errno:%d \n",
@@ -345,237 +623,700 @@ typedef struct {
       exit(EXIT_FAILURE);
     }
 
-    sessionStartTime = getCurTimeD();
-    //Must be an accurate timestamp
-    TSstartD = getTimestamp(&TSstartTS);
-    nextWakeUpTimeD = TSstartD;
+    //The helper threads (wireless sampler, TSC recalibration, trace writer,
+    //reporter) and the pacer block SIGINT so CNTCHandler runs on the main thread
+    sigemptyset(&sigMask);
+    sigaddset(&sigMask, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &sigMask, NULL);
 
-    //Main LOOP.....
-    while (runFlag)
+    //RSSI/SignalQuality are sampled on a background thread
+    rc = startWirelessSampler(wirelessIFName, wirelessSampleInterval);
+    if (rc == ERROR)
+      printf("%s: WARNING failed to start the wireless sampler on %s \n", argv[0], wirelessIFName);
+    //-clock tsc:  the calibration is kept current off the pacer's path
+    if (useTSCClock && (startTSCRecalibration() == ERROR))
+      printf("%s: WARNING failed to start the TSC recalibration \n", argv[0]);
+    rc = EXIT_SUCCESS;
+
+    //Tx stamps are only read (and so only requested) when there are replies
+    if (timestampMode != TIMESTAMP_NONE)
     {
-      wallTime = getCurTimeD();
-      system("./test.sh > result.dat");
-      if (runFlag == true)
+      timestampMode = enableTimestamping(sock, timestampMode, (mode < 2), timestampIFName);
+      if (timestampMode == ERROR)
       {
-        FILE *fp = fopen("result.dat", "r");
-        int32_t a, b;
-        if (fp != NULL)
-        {
-          fscanf(fp, "%d", &a);
-          header->RSSI = htonl(a);
-          fscanf(fp, "%d", &b);
-          header->SignalQuality = htonl(b);
-          if (traceLevel == 2)
-            printf("%d %d\n", a, b);
-        }
-        fclose(fp);
-        //set the timeout for the send if modes 0,1
-        if (mode < 2)
-          alarm(TIMEOUT);
-
-        numberSent++;
-
-        //update seq number in the msg in network byte order
-        header->sequenceNum = (unsigned int)htonl(seqNumber++);
-        Tstart = getTimestampD();
-
-        struct timespec *ts;
-        ts = (struct timespec *)malloc(sizeof(struct timespec));
-        clock_gettime(CLOCK_REALTIME, ts);
-        header->ts_sec = htonl(ts->tv_sec);
-        header->ts_nsec = htonl(ts->tv_nsec);
-        TGIFHeartbeat *headerPtr;
-        headerPtr = (TGIFHeartbeat *)SendBufPtr;
-        *headerPtr = *header;
-        rc = sendMsg(sock, (void *)SendBufPtr, header->dataSize, (struct sockaddr *)&clntAddr, clntAddrLen);
-        if (rc == EXIT_FAILURE)
-        {
-          printf("UDPPingClient:  sendMsg failed,  errno:%d \n", errno);
-          break;
-        }
-        else
-        {
-          //Use the fromAddr and compare with our original address of the server...should be the same.
-          totalBytesSent += msgSize;
-          if (mode < 2)
-          {
-            bytesRxed = RxMsg(sock, (void *)RxBufPtr, msgSize, (struct sockaddr *)&fromAddr, &fromAddrLen);
-            struct timespec *ts;
-            ts = (struct timespec *)malloc(sizeof(struct timespec));
-            clock_gettime(CLOCK_REALTIME, ts);
-            Tstop = gettimestampD(ts->tv_sec, ts->tv_nsec);
-#ifdef TRACEME
-            PrintSocketAddress((struct sockaddr *)&fromAddr, stdout);
-            fputc('\n', stdout);
-#endif
-
-            alarm(0);
-            wallTime = getCurTimeD();
-            if (bytesRxed == EXIT_FAILURE)
-            {
-              if (errno == EINTR)
-              { // Alarm went off
-                numberPacketLoss++;
-                if (traceLevel == 2)
-                  printf("%d \n ", numberPacketLoss);
-              }
-              else
-              {
-                rc = EXIT_FAILURE;
-                printf("UDPPingClient:  RxMsg failed,  errno:%d \n", errno);
-                break;
-              }
-            }
-            else
-            {
-              //SHould be what we just sent- remember we've already incremented the seqNumber
-              //mode 0: normal ping operation (all data echoed)
-              if (mode == 0)
-              {
-                if (bytesRxed != msgSize)
-                {
-                  rc = EXIT_FAILURE;
-                  printf("UDPPingClient:  RxMsg failed, unexpected MsgSize:%d, expected:%d \n", bytesRxed, msgSize);
-                  break;
-                }
-                //Get the ACK Number
-                TGIFHeartbeat *rxHeader;
-                rxHeader = (TGIFHeartbeat *)RxBufPtr;
-                RxSeqNumber = (unsigned int)ntohl((unsigned int)(rxHeader->sequenceNum));
-                unsigned int maxAck = RxSeqNumber;
-
-                //Should be what we just sent- remember we've already incremented the seqNumber
-                if (RxSeqNumber != (seqNumber - 1))
-                {
-                  rc = EXIT_FAILURE;
-                  printf("UDPPingClient: Unexpected RxSeqNumber:%d  Expected:%d  \n", RxSeqNumber, (seqNumber - 1));
-                  break;
-                }
-                else
-                {
-                  Tstart = gettimestampD(ntohl(header->ts_sec), ntohl(header->ts_nsec));
-                  RTTSample = Tstop - Tstart;
-                  double OWDSample = Tstop - gettimestampD(ntohl(rxHeader->ts_sec), ntohl(rxHeader->ts_nsec));
-                  RTTSum += RTTSample;
-                  OWDSum += OWDSample;
-                  numberRTTSamples++;
-                  numberOWDSamples++;
-                  numberRxed++;
-                  rc = EXIT_SUCCESS;
-
-                  if (traceLevel == 1)
-                  {
-                    printf("%f,%f,%f,%d,%d,%d,%d\n",
-                           wallTime, RTTSample, OWDSample, totalBytesSent, maxAck, numberSent, numberPacketLoss);
-                  }
-                  if (traceLevel > 1)
-                  {
-                    printf("UDPPingClient: RxSeqNumber:%d,  RTTSample:%1.6f numberRTTSamples:%d  \n",
-                           RxSeqNumber, RTTSample, numberRTTSamples);
-                  }
-                }
-              }
-              else if (mode == 1)
-              {
-                if (bytesRxed != (sizeof(TGIFACK)))
-                {
-                  rc = EXIT_FAILURE;
-                  printf("UDPPingClient:  RxMsg failed, unexpected MsgSize:%d, expected:%d \n", bytesRxed, sizeof(RxSeqNumber));
-                  break;
-                }
-                TGIFACK *rxACK;
-                rxACK = (TGIFACK *)RxBufPtr;
-                RxSeqNumber = (unsigned int)ntohl((unsigned int)(rxACK->sequenceNum));
-                unsigned int maxAck = RxSeqNumber;
-                if (RxSeqNumber != (seqNumber - 1))
-                {
-                  rc = EXIT_FAILURE;
-                  printf("UDPPingClient: Unexpected RxSeqNumber:%d  Expected:%d  \n", RxSeqNumber, (seqNumber - 1));
-                }
-                else
-                {
-                  Tstart = gettimestampD(ntohl(header->ts_sec), ntohl(header->ts_nsec));
-                  RTTSample = Tstop - Tstart;
-                  double OWDSample = Tstop - gettimestampD(ntohl(rxACK->ts_sec), ntohl(rxACK->ts_nsec));
-                  RTTSum += RTTSample;
-                  OWDSum += OWDSample;
-                  numberRTTSamples++;
-                  numberOWDSamples++;
-                  numberRxed++;
-                  rc = EXIT_SUCCESS;
-
-                  if (traceLevel == 1)
-                  {
-                    printf("%f,%f,%f,%d,%d,%d,%d \n",
-                           wallTime, RTTSample, OWDSample, totalBytesSent, maxAck, numberSent, numberPacketLoss);
-                  }
-                  if (traceLevel > 1)
-                  {
-                    printf("UDPPingClient: RxSeqNumber:%d,  RTTSample:%1.6f numberRTTSamples:%d  \n",
-                           RxSeqNumber, RTTSample, numberRTTSamples);
-                  }
-                }
-              }
-            }
-          } //end if mode 0 or 1
-        }
-        //        rc = nanoDelay(iterationDelay*1000);
-        // A more accurate way to send at precise intervals:
-        if (delay > 0)
-        {
-          nextWakeUpTimeD += delay;
-          busyWait(nextWakeUpTimeD);
-        }
+        printf("%s: ERROR enabling timestamps \n", argv[0]);
+        exit(EXIT_FAILURE);
+      }
+    }
+
+    if (kernelPacing && (streamRate > 0.0))
+    {
+      uint64_t pacingRate = (uint64_t)(streamRate / 8.0);
+      if (SetSocketOption(sock, SO_MAX_PACING_RATE, &pacingRate, sizeof(pacingRate)) != NOERROR)
+        printf("%s: WARNING SO_MAX_PACING_RATE failed, only the token bucket paces \n", argv[0]);
+    }
+
+    if (useUring && (streamBatchSize > 0) && !useGSO)
+    {
+      streamUring = createUring(URING_DEFAULT_ENTRIES);
+      if (streamUring == NULL)
+        printf("%s: WARNING io_uring is not available, the stream uses sendmmsg \n", argv[0]);
+    }
+
+    //One record per target (mesh) or one for the server
+    if (shmName != NULL)
+    {
+      liveStats = createStatsExport(shmName, STATS_ROLE_CLIENT,
+                                    (meshTargets != NULL) ? meshTargets->numberTargets : 1);
+      if (liveStats == NULL)
+      {
+        printf("%s: ERROR creating the stats segment %s \n", argv[0], shmName);
+        exit(EXIT_FAILURE);
       }
+      if (meshTargets != NULL)
+        meshTableSetStats(meshTargets, liveStats, getCurTimeD());
       else
       {
-        break;
+        char recordName[STATS_NAME_SIZE];
+        snprintf(recordName, sizeof(recordName), "%s:%s", server, service);
+        liveRecord = statsExportOpenRecord(liveStats, 0, 1, STATS_KIND_TARGET, recordName, getCurTimeD());
       }
     }
+
+    if ((traceFileName != NULL) && (startTraceLogger(traceFileName, 1, 0) == ERROR))
+    {
+      printf("%s: ERROR starting the trace logger (%s) \n", argv[0], traceFileName);
+      exit(EXIT_FAILURE);
+    }
+
+    RTTHist = createLatencyHistogram();
+    OWDHist = createLatencyHistogram();
+    fwdOWDHist = createLatencyHistogram();
+    clockEstimator = createClockSync();
+    if ((RTTHist == NULL) || (OWDHist == NULL) || (fwdOWDHist == NULL) || (clockEstimator == NULL))
+    {
+      printf("%s: ERROR allocating the latency histograms \n", argv[0]);
+      exit(EXIT_FAILURE);
+    }
+
+    //The mesh only has RTTs
+    if (numberReportWindows > 0)
+    {
+      const char *histNames[3] = {"RTT", "OWD fwd", "OWD rev"};
+      intervalCounts = createIntervalStats();
+      if (intervalCounts != NULL)
+        reporter = startIntervalReporter("client", &intervalCounts, 1, histNames,
+                                         (meshTargets != NULL) ? 1 : 3, reportWindows, numberReportWindows, -1);
+      if (reporter == NULL)
+      {
+        printf("%s: ERROR starting the interval reporter \n", argv[0]);
+        exit(EXIT_FAILURE);
+      }
+    }
+
+    sessionStartTime = getCurTimeD();
+
+    //The probes are sent and the replies received by the pacer thread
+    probeArgs.header = header;
+    probeArgs.msgSize = msgSize;
+    probeArgs.delay = delay;
+    probeArgs.servAddrPtr = (struct sockaddr *)&clntAddr;
+    probeArgs.servAddrLen = clntAddrLen;
+    probeArgs.rc = EXIT_SUCCESS;
+    rc = pthread_create(&pacerThread, NULL, probeLoop, &probeArgs);
+    pthread_sigmask(SIG_UNBLOCK, &sigMask, NULL);
+    if (rc != 0)
+    {
+      printf("%s: pthread_create failed for the pacer thread rc:%d \n", argv[0], rc);
+      rc = EXIT_FAILURE;
+    }
+    else
+    {
+      //Ends when CNTCHandler clears runFlag (or on an error)
+      pthread_join(pacerThread, NULL);
+      rc = probeArgs.rc;
+      if (!runFlag)
+        printRunStats();
+    }
   }
 
   //exit...could be succussfully or in error....
   exitProcessing(rc, getCurTimeD());
   if (traceLevel > 1)
   {
-    printf("%s: Exiting : rc:%d,  NumberSent:%d, NumberRxed:%d, numberDropped(alarms:%d):%d )\n",
-           argv[0], rc, numberSent, numberRxed, numberDropped, numberAlarmTimeouts);
+    printf("%s: Exiting : rc:%d,  NumberSent:%d, NumberRxed:%d, numberDropped(timeouts:%d):%d )\n",
+           argv[0], rc, numberSent, numberRxed, numberTimeouts, numberDropped);
   }
   exit(rc);
 }
 
 /***********************************************************
-* Function: void AlarmHandler(int ignored) 
+* Function: void *probeLoop(void *arg)
 *
-* Explanation:  This is called when a SIGALARM signal  is received.
-*               This occurs when the program has used the alarm 
-*               system timer and a timeout has occured.
+* Explanation:  The pacer thread.  Sets up the thread (CPU, SCHED_FIFO,
+*               a 1 nsec timer slack so the pacer's sleeps end on time)
+*               and runs the send loop of the mode.
 *
-* inputs:   
-*        int ignored : 
+* inputs:
+*   void *arg : the probeLoopArgs (its rc is set to the loop's rc)
+*
+**************************************************/
+void *probeLoop(void *arg)
+{
+  probeLoopArgs *args = (probeLoopArgs *)arg;
+
+  pinThreadToCPU(paceCPU);
+  setThreadFIFO(paceFIFOPriority);
+  prctl(PR_SET_TIMERSLACK, 1UL, 0, 0, 0);
+  initPacer(&pace);
+  pace.wakeFD = wakeFD;
+
+  //Many servers (-targets)
+  if (meshTargets != NULL)
+    args->rc = runMesh(args->header);
+  //Probes and replies (stop-and-wait or N in flight)
+  else if (mode < 2)
+    args->rc = runEventLoop(args->header, args->msgSize, args->delay, args->servAddrPtr, args->servAddrLen);
+  //Stream (mode 2)
+  else
+    args->rc = runStream(args->header, args->msgSize, args->delay, args->servAddrPtr, args->servAddrLen);
+  return NULL;
+}
+
+/***********************************************************
+* Function: int runEventLoop(probeHeader *header, int msgSize, double delay,
+*                   struct sockaddr *servAddrPtr, socklen_t servAddrLen)
+*
+* Explanation:  The main loop of modes 0 and 1.  One epoll wait
+*               multiplexes the socket (replies, tx stamps), the send
+*               timer (the next send time of the schedule) and the loss
+*               timer (the earliest deadline of the probes in flight).
+*               Probes are sent on the schedule as long as fewer than
+*               probeWindowSize are in flight (stop-and-wait, the default,
+*               is a window of 1).  Replies are matched to the in flight
+*               probe by seq number so RTT, loss (no reply within
+*               probeTimeout seconds) and reordering are computed as
+*               replies arrive.  Runs until runFlag is cleared or an error.
+*
+* inputs:
+*   probeHeader *header : the header template
+*   int msgSize : size of each probe
+*   double delay : seconds between sends (0: send whenever the window allows)
+*   struct sockaddr *servAddrPtr, socklen_t servAddrLen: the server
 *
 * outputs:
-*        none 
+*        returns EXIT_SUCCESS or EXIT_FAILURE
 *
-* notes: 
+* notes:
+*   The send timer expires the pacer's margin before the send time
+*   and the pacer spins the rest, so the sends are as precise as
+*   with pacerWaitUntil.
 *
-**************************************************************/
-void AlarmHandler(int ignored)
+**************************************************/
+int runEventLoop(probeHeader *header, int msgSize, double delay,
+                 struct sockaddr *servAddrPtr, socklen_t servAddrLen)
 {
+  int rc = EXIT_SUCCESS;
+  int windowRC = PROBE_ACKED;
+  int bytesRxed = 0;
+  int numberExpired = 0;
+  int numberReady = 0;
+  int i;
+  int sendTimer = -1;
+  int lossTimer = -1;
+  int rxSize = (msgSize > PROBE_ACK_SIZE) ? msgSize : PROBE_ACK_SIZE;   //RxBufPtr's size
+  uint32_t seqNumber = 1;
+  uint32_t RxSeqNumber = 0;
+  probeHeader reply;
+  double curTimeD = 0.0;
+  double nextSendTimeD = 0.0;
+  double sendWakeD = 0.0;    //the send timer expires at this time (0: not armed)
+  double lossTimerD = 0.0;   //the loss timer expires at this deadline (0: not armed)
+  double deadlineD = 0.0;
+  double txTime = 0.0;
+  double Tstop = 0.0;
+  bool sendTimerFired = false;
+  struct timespec ts;
+  struct sockaddr_storage fromAddr;
+  socklen_t fromAddrLen = sizeof(fromAddr);
 
-  numberAlarmTimeouts++;
-  if (traceLevel > 1)
+  window = createProbeWindow((probeWindowSize > 0) ? probeWindowSize : 1);
+  if (window != NULL)
+    probeWindowSetTimeout(window, probeRTTMultiple, PROBE_MIN_TIMEOUT, probeTimeout);
+  probeEvents = createEventLoop();
+  sendTimer = createEventTimer();
+  lossTimer = createEventTimer();
+  if ((window == NULL) || (probeEvents == NULL) || (sendTimer == ERROR) || (lossTimer == ERROR) ||
+      (eventLoopAdd(probeEvents, sock, EPOLLIN, EVENT_SOCKET) == ERROR) ||
+      (eventLoopAdd(probeEvents, sendTimer, EPOLLIN, EVENT_SEND_TIMER) == ERROR) ||
+      (eventLoopAdd(probeEvents, lossTimer, EPOLLIN, EVENT_LOSS_TIMER) == ERROR) ||
+      (eventLoopAdd(probeEvents, wakeFD, EPOLLIN, EVENT_WAKE) == ERROR))
   {
-    printf("AlarmHandler: number: %d \n", numberAlarmTimeouts);
+    printf("UDPPingClient:  failed to set up the event loop,  errno:%d \n", errno);
+    return EXIT_FAILURE;
   }
+
+  //Replies are drained without blocking; the waits are done by the event loop
+  sockBlockingOff(sock);
+
+  nextSendTimeD = getTimestampD();
+  if (delay > 0)
+    startSendSchedule(probeSchedule, nextSendTimeD);
+  while (runFlag)
+  {
+    curTimeD = getTimestampD();
+    numberExpired = probeWindowExpire(window, curTimeD);
+    numberPacketLoss += numberExpired;
+    numberDropped += numberExpired;
+    numberTimeouts += numberExpired;
+    intervalLost(intervalCounts, numberExpired);
+    if ((numberExpired > 0) && (liveRecord != NULL))
+      statsRecordLost(liveRecord, numberExpired, statsExportWallTime(liveStats, curTimeD));
+    if ((numberExpired > 0) && (traceLevel > 1))
+      printf("UDPPingClient: %d probes timed out, numberPacketLoss:%d \n", numberExpired, numberPacketLoss);
+
+    if ((sendTimerFired || (curTimeD >= nextSendTimeD)) && !isProbeWindowFull(window, seqNumber))
+    {
+      //The timer woke us the pacer's margin early:  spin to the send time
+      if (sendTimerFired)
+        pacerWokeUp(&pace, sendWakeD, nextSendTimeD);
+      sendWakeD = 0.0;
+
+      int32_t RSSI, SignalQuality;
+      getWirelessSample(&RSSI, &SignalQuality);
+      header->RSSI = RSSI;
+      header->SignalQuality = SignalQuality;
+      header->seq = seqNumber;
+      getCurTimeTS(&ts);
+      header->txTime = timespecToWireNs(&ts);
+      header->clockOffset = clockOffsetUsecs;
+      encodeProbe(SendBufPtr, header);
+
+      rc = sendMsg(sock, (void *)SendBufPtr, msgSize, servAddrPtr, servAddrLen);
+      if (rc == EXIT_FAILURE)
+      {
+        printf("UDPPingClient:  sendMsg failed,  errno:%d \n", errno);
+        break;
+      }
+      curTimeD = getTimestampD();
+      txTime = gettimestampD(ts.tv_sec, ts.tv_nsec);
+      probeWindowSent(window, seqNumber, txTime, curTimeD + probeWindowTimeout(window));
+      seqNumber++;
+      numberSent++;
+      totalBytesSent += msgSize;
+      intervalSent(intervalCounts, 1, msgSize);
+      statsRecordSent(liveRecord, 1, msgSize, statsExportWallTime(liveStats, curTimeD));
+      nextSendTimeD = (delay > 0) ? nextSendDeadline(probeSchedule) : curTimeD;
+    }
+    sendTimerFired = false;
+
+    //The tx stamps of the probes sent so far replace their user space send times
+    readTxTimestamps(0, NULL);
+
+    //Drain every reply that is waiting
+    while (runFlag)
+    {
+      bytesRxed = RxReply(rxSize, (struct sockaddr *)&fromAddr, &fromAddrLen, &Tstop);
+      if (bytesRxed == EXIT_FAILURE)
+        break;
+      if (((mode == 0) && (bytesRxed != msgSize)) ||
+          (decodeProbeReply(RxBufPtr, bytesRxed, mode, &reply) == ERROR))
+      {
+        printf("UDPPingClient:  RxMsg unexpected MsgSize:%d (mode %d) \n", bytesRxed, mode);
+        continue;
+      }
+      RxSeqNumber = reply.seq;
+      windowRC = probeWindowAcked(window, RxSeqNumber, &txTime);
+      if (windowRC == PROBE_UNKNOWN)
+      {
+        intervalLate(intervalCounts);
+        statsRecordLate(liveRecord, Tstop);
+        if (traceLevel > 1)
+          printf("UDPPingClient: late or unknown RxSeqNumber:%d \n", RxSeqNumber);
+        continue;
+      }
+      processReply(&reply, bytesRxed, txTime, Tstop, windowRC);
+    }
+    if ((bytesRxed == EXIT_FAILURE) && (errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))
+    {
+      rc = EXIT_FAILURE;
+      printf("UDPPingClient:  RxMsg failed,  errno:%d \n", errno);
+      break;
+    }
+
+    if (delay > 0)
+      fillSendSchedule(probeSchedule);
+
+    //Arm the timers:  the next send (if the window allows one) and the next loss deadline
+    curTimeD = getTimestampD();
+    if (!isProbeWindowFull(window, seqNumber))
+    {
+      //Due already (e.g., a 0 delay):  no wait
+      if (nextSendTimeD <= curTimeD)
+        continue;
+      if (sendWakeD == 0.0)
+      {
+        sendWakeD = pacerWakeTime(&pace, nextSendTimeD);
+        armEventTimer(sendTimer, sendWakeD - curTimeD);
+      }
+    }
+    deadlineD = probeWindowNextDeadline(window);
+    if ((deadlineD > 0) && (deadlineD != lossTimerD))
+    {
+      armEventTimer(lossTimer, deadlineD - curTimeD);
+      lossTimerD = deadlineD;
+    }
+    else if ((deadlineD <= 0) && (lossTimerD != 0.0))
+    {
+      disarmEventTimer(lossTimer);
+      lossTimerD = 0.0;
+    }
+
+    numberReady = eventLoopWait(probeEvents, -1);
+    if (numberReady == ERROR)
+    {
+      rc = EXIT_FAILURE;
+      break;
+    }
+    for (i = 0; i < numberReady; i++)
+    {
+      switch (eventTag(probeEvents, i))
+      {
+        case EVENT_SEND_TIMER:
+          if (readEventTimer(sendTimer) > 0)
+            sendTimerFired = true;
+          break;
+        case EVENT_LOSS_TIMER:
+          readEventTimer(lossTimer);
+          lossTimerD = 0.0;
+          break;
+        case EVENT_WAKE:
+          //CNT-C:  runFlag is cleared
+          break;
+        default:
+          //The socket:  drained each pass
+          break;
+      }
+    }
+  }
+  close(sendTimer);
+  close(lossTimer);
+  return rc;
+}
+
+/***********************************************************
+* Function: int setupMesh(char *progName, int msgSize, double delay)
+*
+* Explanation:  Creates the mesh socket and reads (and resolves) the
+*               targets of meshFileName into meshTargets.
+*
+* inputs:
+*   char *progName : for the error msgs
+*   int msgSize : the size of the probes of the lines without one
+*   double delay : 1/delay is the rate of the lines without one (0: 1/sec)
+*
+* outputs:
+*        returns the socket or EXIT_FAILURE
+*
+* notes:
+*   The socket is IPv6 dual stack (IPv4 targets are reached at their
+*   v4-mapped addresses) so one socket reaches every target.  If the
+*   host has no IPv6 it is IPv4 (and IPv6 targets are skipped).
+*
+**************************************************/
+int setupMesh(char *progName, int msgSize, double delay)
+{
+  int meshSock = -1;
+  int family = AF_INET6;
+  int v6Only = 0;
+  int numberTargets = 0;
+  int target;
+
+  meshSock = socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+  if ((meshSock >= 0) &&
+      (setsockopt(meshSock, IPPROTO_IPV6, IPV6_V6ONLY, &v6Only, sizeof(v6Only)) < 0))
+  {
+    close(meshSock);
+    meshSock = -1;
+  }
+  if (meshSock < 0)
+  {
+    family = AF_INET;
+    meshSock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (meshSock < 0)
+      return EXIT_FAILURE;
+  }
+
+  meshTargets = createMeshTable(MESH_MAX_TARGETS, family, probeTimeout, getTimestampD());
+  if (meshTargets == NULL)
+  {
+    close(meshSock);
+    return EXIT_FAILURE;
+  }
+  numberTargets = readMeshTargets(meshTargets, meshFileName, (delay > 0) ? 1.0 / delay : 1.0, (uint32_t)msgSize);
+  if (numberTargets <= 0)
+  {
+    printf("%s: no targets in %s \n", progName, meshFileName);
+    close(meshSock);
+    return EXIT_FAILURE;
+  }
+  //A target's probes carry the header of the -wire format
+  for (target = 0; target < numberTargets; target++)
+  {
+    if (meshTargets->msgSizes[target] < (uint32_t)probeHeaderSize(wireFormat, PROBE_EXT_WIRELESS))
+    {
+      printf("%s: %s msgSize %d is less than the -wire header (%d) \n", progName, meshTargets->names[target],
+             meshTargets->msgSizes[target], probeHeaderSize(wireFormat, PROBE_EXT_WIRELESS));
+      close(meshSock);
+      return EXIT_FAILURE;
+    }
+  }
+  if (traceLevel > 0)
+    printf("%s: mesh of %d targets (%s) \n", progName, numberTargets, (family == AF_INET6) ? "IPv6/IPv4" : "IPv4");
+  return meshSock;
+}
+
+/***********************************************************
+* Function: int runMesh(probeHeader *header)
+*
+* Explanation:  The mesh (-targets) main loop.  One epoll wait
+*               multiplexes the socket and one timer, armed at the
+*               table's next timer (a send time or a loss deadline).
+*               Each pass sends the probes that are due (of any
+*               target) in sendmmsgs, declares lost the probes past
+*               their deadline and drains the replies (recvmmsg),
+*               matching each to its target by source address.
+*               Runs until runFlag is cleared or an error.
+*
+* inputs:
+*   probeHeader *header : the header template
+*
+* outputs:
+*        returns EXIT_SUCCESS or EXIT_FAILURE
+*
+* notes:
+*   The probes of a pass share one send time (taken before the
+*   sendmmsg) and the replies of a recvmmsg one arrival time.
+*   A probe's nodeID is its target.
+*
+**************************************************/
+int runMesh(probeHeader *header)
+{
+  int rc = EXIT_SUCCESS;
+  int numberExpired = 0;
+  int numberReady = 0;
+  int numberReplies = 0;
+  int i;
+  int target;
+  int meshTimer = -1;
+  int bytesRxed = 0;
+  uint32_t numberDue = 0;
+  uint32_t maxMsgSize = 0;
+  uint64_t slotReuses = 0;
+  uint32_t passSent = 0;    //numberSent and totalBytesSent before a pass's sends
+  uint64_t passBytes = 0;
+  uint32_t seqNumber = 0;
+  uint32_t RxSeqNumber = 0;
+  probeHeader reply;
+  double curTimeD = 0.0;
+  double timerD = 0.0;      //the timer expires at this time (0: not armed)
+  double nextTimerD = 0.0;
+  double RTTSample = 0.0;
+  struct timespec ts;
+  timerEntry *due = NULL;
+  msgBatch *txBatch = NULL;
+  msgBatch *rxBatch = NULL;
+  char *bufPtr = NULL;
+
+  for (target = 0; target < (int)meshTargets->numberTargets; target++)
+    if (meshTargets->msgSizes[target] > maxMsgSize)
+      maxMsgSize = meshTargets->msgSizes[target];
+
+  txBatch = createMsgBatch(MAX_MSG_BATCH, maxMsgSize);
+  //An ACK can be larger than a compact probe
+  rxBatch = createMsgBatch(MAX_MSG_BATCH, (maxMsgSize > PROBE_ACK_SIZE) ? maxMsgSize : PROBE_ACK_SIZE);
+  probeEvents = createEventLoop();
+  meshTimer = createEventTimer();
+  if ((txBatch == NULL) || (rxBatch == NULL) || (probeEvents == NULL) || (meshTimer == ERROR) ||
+      (eventLoopAdd(probeEvents, sock, EPOLLIN, EVENT_SOCKET) == ERROR) ||
+      (eventLoopAdd(probeEvents, meshTimer, EPOLLIN, EVENT_SEND_TIMER) == ERROR) ||
+      (eventLoopAdd(probeEvents, wakeFD, EPOLLIN, EVENT_WAKE) == ERROR))
+  {
+    printf("UDPPingClient:  failed to set up the mesh event loop,  errno:%d \n", errno);
+    return EXIT_FAILURE;
+  }
+  sockBlockingOff(sock);
+
+  startMeshTable(meshTargets, getTimestampD());
+  while (runFlag)
+  {
+    curTimeD = getTimestampD();
+    numberExpired = meshTableExpire(meshTargets, curTimeD);
+    //and the probes lost when their slot was reused (sends of the last pass)
+    numberExpired += (int)(meshTargets->numberSlotReuses - slotReuses);
+    slotReuses = meshTargets->numberSlotReuses;
+    numberPacketLoss += numberExpired;
+    numberDropped += numberExpired;
+    numberTimeouts += numberExpired;
+    intervalLost(intervalCounts, numberExpired);
+
+    //Every target that is due:  one header each, sendmmsgs of up to MAX_MSG_BATCH
+    due = meshTableDue(meshTargets, curTimeD);
+    if (due != NULL)
+    {
+      getCurTimeTS(&ts);
+      header->txTime = timespecToWireNs(&ts);
+    }
+    numberDue = 0;
+    passSent = numberSent;
+    passBytes = totalBytesSent;
+    while (due != NULL)
+    {
+      target = (int)due->id;
+      due = due->next;
+      seqNumber = meshProbeSent(meshTargets, target, curTimeD);
+      header->nodeID = target;
+      header->seq = seqNumber;
+      bufPtr = getBatchBuffer(txBatch, numberDue);
+      encodeProbe(bufPtr, header);
+      txBatch->iovecs[numberDue].iov_len = meshTargets->msgSizes[target];
+      memcpy(&txBatch->addrs[numberDue], &meshTargets->addrs[target], meshTargets->addrLens[target]);
+      txBatch->msgs[numberDue].msg_hdr.msg_namelen = meshTargets->addrLens[target];
+      numberSent++;
+      totalBytesSent += meshTargets->msgSizes[target];
+      if (++numberDue == MAX_MSG_BATCH)
+      {
+        sendMeshBatch(txBatch, numberDue);
+        numberDue = 0;
+      }
+    }
+    if (numberDue > 0)
+      sendMeshBatch(txBatch, numberDue);
+    if (numberSent != passSent)
+      intervalSent(intervalCounts, numberSent - passSent, (uint32_t)(totalBytesSent - passBytes));
+
+    //Drain every reply that is waiting
+    while (runFlag && ((numberReplies = RxMsgBatch(sock, rxBatch, true)) > 0))
+    {
+      curTimeD = getTimestampD();
+      for (i = 0; i < numberReplies; i++)
+      {
+        target = meshTableLookup(meshTargets, (struct sockaddr *)&rxBatch->addrs[i]);
+        if (target < 0)
+          continue;
+        bytesRxed = (int)rxBatch->msgs[i].msg_len;
+        bufPtr = getBatchBuffer(rxBatch, i);
+        if (((mode == 0) && (bytesRxed != (int)meshTargets->msgSizes[target])) ||
+            (decodeProbeReply(bufPtr, bytesRxed, mode, &reply) == ERROR))
+        {
+          if (traceLevel > 1)
+            printf("UDPPingClient: %s unexpected MsgSize:%d (mode %d) \n",
+                   meshTargets->names[target], bytesRxed, mode);
+          continue;
+        }
+        RxSeqNumber = reply.seq;
+        if (meshProbeReply(meshTargets, target, RxSeqNumber, (uint32_t)bytesRxed, curTimeD, &RTTSample) == ERROR)
+        {
+          intervalLate(intervalCounts);
+          continue;
+        }
+        numberRxed++;
+        intervalReply(intervalCounts, (uint32_t)bytesRxed, &RTTSample, 1);
+        RTTSum += RTTSample;
+        numberRTTSamples++;
+        latencyHistogramAdd(RTTHist, RTTSample);
+        if (traceLevel > 1)
+          printf("%f %s %d %1.9f \n", curTimeD, meshTargets->names[target], RxSeqNumber, RTTSample);
+      }
+    }
+    if ((numberReplies == ERROR) && (errno != EINTR))
+    {
+      rc = EXIT_FAILURE;
+      break;
+    }
+
+    //Arm the timer at the table's next send or loss deadline
+    nextTimerD = meshTableNextTimer(meshTargets);
+    if ((nextTimerD > 0.0) && (nextTimerD != timerD))
+    {
+      armEventTimer(meshTimer, nextTimerD - getTimestampD());
+      timerD = nextTimerD;
+    }
+
+    numberReady = eventLoopWait(probeEvents, -1);
+    if (numberReady == ERROR)
+    {
+      rc = EXIT_FAILURE;
+      break;
+    }
+    for (i = 0; i < numberReady; i++)
+    {
+      if (eventTag(probeEvents, i) == EVENT_SEND_TIMER)
+      {
+        readEventTimer(meshTimer);
+        timerD = 0.0;
+      }
+    }
+  }
+  close(meshTimer);
+  freeMsgBatch(txBatch);
+  freeMsgBatch(rxBatch);
+  return rc;
+}
+
+/***********************************************************
+* Function: int sendMeshBatch(msgBatch *txBatch, uint32_t numberMsgs)
+*
+* Explanation:  Sends the probes of a mesh pass (sendMsgBatchFrom).
+*               When the socket is full (EAGAIN, ENOBUFS) it waits
+*               until it can send and retries.  A probe that can not
+*               be sent for another reason (e.g., no route to its
+*               target) is skipped so the others still leave; it
+*               will be lost.
+*
+* outputs:
+*        returns the number of probes sent
+*
+**************************************************/
+int sendMeshBatch(msgBatch *txBatch, uint32_t numberMsgs)
+{
+  int rc = 0;
+  uint32_t numberDone = 0;
+  uint32_t numberMeshSent = 0;
+
+  while (runFlag && (numberDone < numberMsgs))
+  {
+    rc = sendMsgBatchFrom(sock, txBatch, numberDone, numberMsgs);
+    if (rc == ERROR)
+    {
+      if (errno == EINTR)
+        continue;
+      if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == ENOBUFS))
+      {
+        //The socket's send buffer (or the device queue) is full
+        if (waitSocketWritable(sock, 100) != ERROR)
+          continue;
+      }
+      //The first msg failed:  skip it
+      numberSendErrors++;
+      if (traceLevel > 1)
+        printf("UDPPingClient:  mesh send failed,  errno:%d \n", errno);
+      numberDone++;
+      continue;
+    }
+    numberDone += (uint32_t)rc;
+    numberMeshSent += (uint32_t)rc;
+  }
+  return (int)numberMeshSent;
 }
 
 /***********************************************************
 * Function: void CNTCHandler() 
 *
-* Explanation:  This is called when a SIGTERM is received
+* Explanation:  This is called when a SIGINT is received
 *               This occurs when the program terminates with a CNT-C input.
-*               This code implements a disposition identical to the default...exits.
+*               Clears runFlag and wakes the pacer thread;  main displays
+*               the stats (printRunStats) and exits once it has ended.
 *
 * inputs:   
 *        none
@@ -583,13 +1324,32 @@ void AlarmHandler(int ignored)
 *        none 
 *
 * notes: 
+*   Runs on the main thread (the other threads block SIGINT) and
+*   only does async signal safe work.
 *
 *************************************************/
 void CNTCHandler()
 {
-  int rc = EXIT_SUCCESS;
   runFlag = false;
+  if (wakeFD != -1)
+    signalEventWake(wakeFD);
+}
 
+/***********************************************************
+* Function: void printRunStats() 
+*
+* Explanation:  Displays the stats of a run ended by a CNT-C:
+*               the averages, the latency distributions and the
+*               counters of the mode's loop.
+*
+* inputs:   
+*        none
+* outputs:
+*        none 
+*
+*************************************************/
+void printRunStats()
+{
   time_t rawtime;
   struct tm *timeinfo;
   time(&rawtime);
@@ -601,22 +1361,60 @@ void CNTCHandler()
   printf("\nCurrent time: %s, Duration of the test: %f secs, mode: %d, number messages sent: %d, ",
          asctime(timeinfo), testDuration, mode, numberSent);
 
-  if (mode == 0 || mode == 1)
+  if (meshTargets != NULL)
+  {
+    double avgRTT = (numberRTTSamples > 0) ? RTTSum / numberRTTSamples : 0.0;
+    double avgLossRate = (numberSent > 0) ? (double)numberPacketLoss / (double)numberSent : 0.0;
+    printf("avg RTT: %f, avg loss rate: %f, avg send rate: %f, send errors: %d\n",
+           avgRTT, avgLossRate, totalBytesSent / testDuration, numberSendErrors);
+    printMeshTable(meshTargets, stdout);
+    printLatencyHistogram(RTTHist, "RTT", stdout);
+    printf("send times ");
+    printTimerWheel(meshTargets->sendWheel, stdout);
+    printf("loss deadlines ");
+    printTimerWheel(meshTargets->lossWheel, stdout);
+    printEventLoop(probeEvents, stdout);
+  }
+  else if (mode == 0 || mode == 1)
   {
-    double avgRTT = RTTSum / numberRTTSamples;
-    double avgOWD = OWDSum / numberOWDSamples;
-    double avgLossRate = numberPacketLoss / numberSent;
+    double avgRTT = (numberRTTSamples > 0) ? RTTSum / numberRTTSamples : 0.0;
+    double avgOWD = (numberOWDSamples > 0) ? OWDSum / numberOWDSamples : 0.0;
+    double avgFwdOWD = (numberOWDSamples > 0) ? fwdOWDSum / numberOWDSamples : 0.0;
+    double avgLossRate = (numberSent > 0) ? (double)numberPacketLoss / (double)numberSent : 0.0;
     double avgSendRate = totalBytesSent / testDuration;
-    printf("avg RTT: %f, avg one way delay: %f, avg loss rate: %f, avg send rate: %f\n", avgRTT, avgOWD, avgLossRate, avgSendRate);
+    printf("avg RTT: %f, avg one way delay: %f (to server: %f), avg loss rate: %f, avg send rate: %f\n",
+           avgRTT, avgOWD, avgFwdOWD, avgLossRate, avgSendRate);
+    if (window != NULL)
+      printf("window: %d, in flight: %d, lost: %d, reordered: %d, late or unknown: %d\n",
+             probeWindowSize, window->numberInFlight, window->numberLost, window->numberReordered, window->numberUnknown);
+    if (window != NULL)
+    {
+      printf("loss timeout: %1.9f secs (srtt: %1.9f, rttvar: %1.9f, rttmult: %1.2f) \n",
+             probeWindowTimeout(window), window->srtt, window->rttvar, window->rttMultiple);
+      printTimerWheel(window->deadlines, stdout);
+    }
+    if (timestampMode != TIMESTAMP_NONE)
+      printf("timestamps (%s): tx stamps used: %d, rx stamps used: %d\n",
+             (timestampMode == TIMESTAMP_HW) ? "hw" : "sw", numberTxStamps, numberRxStamps);
+    printLatencyHistogram(RTTHist, "RTT", stdout);
+    printLatencyHistogram(fwdOWDHist, "OWD fwd", stdout);
+    printLatencyHistogram(OWDHist, "OWD rev", stdout);
+    printClockSync(clockEstimator, stdout);
+    printEventLoop(probeEvents, stdout);
   }
   else if (mode == 2)
   {
     double avgSendRate = totalBytesSent / testDuration;
     printf("avg send rate: %f\n", avgSendRate);
+    if (streamRate > 0.0)
+      printf("token bucket: rate:%1.0f bps, depth:%d bytes, sent:%lu bytes (%1.0f bps), waits for tokens:%lu \n",
+             streamRate, streamBurst, (unsigned long)streamBucket.bytesSent,
+             (testDuration > 0.0) ? (double)streamBucket.bytesSent * 8.0 / testDuration : 0.0,
+             (unsigned long)streamBucket.numberStalls);
+    if (streamUring != NULL)
+      printUring(streamUring, stdout);
   }
-
-  exitProcessing(rc, getCurTimeD());
-  exit(0);
+  printPacer(&pace, stdout);
 }
 
 /***********************************************************
@@ -633,6 +1431,7 @@ void CNTCHandler()
 *        none 
 *
 * notes: 
+*   Called once the pacer thread has ended (or when it was not started).
 *
 **************************************************/
 void exitProcessing(int errorStatus, double curTime)
@@ -646,6 +1445,17 @@ void exitProcessing(int errorStatus, double curTime)
   sessionFinishTime = getCurTimeD();
   sessionDuration = sessionFinishTime - sessionStartTime;
 
+  stopWirelessSampler();
+  stopTSCRecalibration();
+  stopIntervalReporter(reporter);
+  reporter = NULL;
+  if (traceFileName != NULL)
+  {
+    stopTraceLogger();
+    if (getTraceDrops() > 0)
+      printf("UDPEchoClient: WARNING %lu trace records dropped (ring full) \n", (unsigned long)getTraceDrops());
+  }
+
   if (sock != -1)
   {
     close(sock);
@@ -667,7 +1477,7 @@ void exitProcessing(int errorStatus, double curTime)
     avgRTT = 0;
 
   if (numberSent > 0)
-    avgLossRate = (double)numberAlarmTimeouts / (double)numberSent;
+    avgLossRate = (double)numberDropped / (double)numberSent;
   else
     avgLossRate = 0;
 
@@ -679,22 +1489,554 @@ void exitProcessing(int errorStatus, double curTime)
   if (errorStatus == EXIT_FAILURE)
   {
     printf("UDPEchoClient: Exit in error ???  \n");
-    printf("Sent/Rxed:%d/%d numberDropped/alarms:%d/%d, avgRTT:%1.9fsecs, lossRate:%1.4f,sendRate:%9.0fMbps \n",
-           numberSent, numberRxed, numberDropped, numberAlarmTimeouts, avgRTT, avgLossRate, sendRate);
+    printf("Sent/Rxed:%d/%d numberDropped/timeouts:%d/%d, avgRTT:%1.9fsecs, lossRate:%1.4f,sendRate:%9.0fMbps \n",
+           numberSent, numberRxed, numberDropped, numberTimeouts, avgRTT, avgLossRate, sendRate);
   }
   else
   {
     if (traceLevel == 0)
     {
       printf("%f %f %d %d %d %d %2.9f %1.4f %9.0f \n",
-             curTime, sessionDuration, numberSent, numberRxed, numberDropped, numberAlarmTimeouts, avgRTT, avgLossRate, sendRate);
+             curTime, sessionDuration, numberSent, numberRxed, numberDropped, numberTimeouts, avgRTT, avgLossRate, sendRate);
     }
     if (traceLevel == 0)
     {
       printf("UDPEchoClient Results(%f): Duration:%f numberSent:%d numberAcks:%d drops:%d TOs:%d \n",
-             curTime, sessionDuration, numberSent, numberRxed, numberDropped, numberAlarmTimeouts);
+             curTime, sessionDuration, numberSent, numberRxed, numberDropped, numberTimeouts);
       printf(" avgRTT:%1.9f secs, lossRate:%1.4f,sendRate:%9.0f bps \n",
              avgRTT, avgLossRate, sendRate);
     }
   }
+
+  //The segment is removed last (the pacer thread that writes the records
+  //has been joined):  the collectors see the client is gone
+  liveRecord = NULL;
+  if (meshTargets != NULL)
+    meshTargets->stats = NULL;
+  freeStatsExport(liveStats);
+  liveStats = NULL;
+}
+
+/***********************************************************
+* Function: int runStream(probeHeader *header, int msgSize, double delay,
+*              struct sockaddr *servAddrPtr, socklen_t servAddrLen)
+*
+* Explanation:  The mode 2 (no ACKs) main loop (without -batch a batch of 1).
+*               Probes are due on the schedule TSstart + n*delay.  Each
+*               pass sends every probe that is due (at most streamBatchSize)
+*               with a single sendmmsg, then waits for the next due time.
+*               With a 0 delay every pass sends a full batch.
+*               With -rate the token bucket decides how many are
+*               due (the delay is not used).  With -gso they go
+*               out in one UDP GSO send, with -io uring as io_uring
+*               sendmsgs.
+*
+* inputs:
+*   probeHeader *header : the header template
+*   int msgSize : size of each probe
+*   double delay : seconds between probes
+*   struct sockaddr *servAddrPtr, socklen_t servAddrLen: the server
+*
+* outputs:
+*        returns EXIT_SUCCESS or EXIT_FAILURE
+*
+**************************************************/
+int runStream(probeHeader *header, int msgSize, double delay,
+              struct sockaddr *servAddrPtr, socklen_t servAddrLen)
+{
+  int rc = EXIT_SUCCESS;
+  uint32_t seqNumber = 1;
+  uint32_t numberDue = 0;
+  uint32_t i;
+  double curTimeD = 0.0;
+  double nextSendTimeD = 0.0;
+  struct timespec ts;
+  msgBatch *txBatch = NULL;
+  char *gsoBuffer = NULL;
+
+  txBatch = createMsgBatch(streamBatchSize, msgSize);
+  if (txBatch == NULL)
+    return EXIT_FAILURE;
+  //A GSO send takes the probes back to back in one buffer
+  if (useGSO)
+  {
+    gsoBuffer = aligned_alloc(CACHE_LINE_SIZE, (((size_t)streamBatchSize * msgSize) + CACHE_LINE_SIZE - 1) & ~((size_t)CACHE_LINE_SIZE - 1));
+    if (gsoBuffer == NULL)
+    {
+      freeMsgBatch(txBatch);
+      return EXIT_FAILURE;
+    }
+    memset(gsoBuffer, 0, (size_t)streamBatchSize * msgSize);
+  }
+  //Every probe goes to the server; the data after the header stays zero
+  for (i = 0; i < streamBatchSize; i++)
+  {
+    memcpy(&txBatch->addrs[i], servAddrPtr, servAddrLen);
+    txBatch->msgs[i].msg_hdr.msg_namelen = servAddrLen;
+  }
+
+  nextSendTimeD = getTimestampD();
+  if (delay > 0)
+    startSendSchedule(probeSchedule, nextSendTimeD);
+  if (streamRate > 0.0)
+    initTokenBucket(&streamBucket, streamRate, (double)streamBurst, nextSendTimeD);
+  while (runFlag)
+  {
+    curTimeD = getTimestampD();
+    if (streamRate > 0.0)
+    {
+      numberDue = tokenBucketAvailable(&streamBucket, curTimeD, msgSize, streamBatchSize);
+      if (numberDue == 0)
+      {
+        pacerWaitUntil(&pace, tokenBucketReadyTime(&streamBucket, msgSize));
+        continue;
+      }
+      tokenBucketConsume(&streamBucket, numberDue * msgSize);
+    }
+    else if (delay > 0)
+    {
+      if (curTimeD < nextSendTimeD)
+      {
+        fillSendSchedule(probeSchedule);
+        //ERROR:  woken by CNT-C
+        if (pacerWaitUntil(&pace, nextSendTimeD) == ERROR)
+          continue;
+        curTimeD = getTimestampD();
+      }
+      numberDue = 0;
+      while ((numberDue < streamBatchSize) && (nextSendTimeD <= curTimeD))
+      {
+        numberDue++;
+        nextSendTimeD = nextSendDeadline(probeSchedule);
+      }
+    }
+    else
+      numberDue = streamBatchSize;
+
+    int32_t RSSI, SignalQuality;
+    getWirelessSample(&RSSI, &SignalQuality);
+    header->RSSI = RSSI;
+    header->SignalQuality = SignalQuality;
+    //The probes of a batch leave in one syscall and share the send timestamp
+    getCurTimeTS(&ts);
+    header->txTime = timespecToWireNs(&ts);
+    for (i = 0; i < numberDue; i++)
+    {
+      header->seq = seqNumber++;
+      if (useGSO)
+        encodeProbe(gsoBuffer + (size_t)i * msgSize, header);
+      else
+        encodeProbe(getBatchBuffer(txBatch, i), header);
+    }
+
+    if (useGSO)
+      rc = sendMsgGSO(sock, gsoBuffer, numberDue * msgSize, msgSize, servAddrPtr, servAddrLen);
+    else if (streamUring != NULL)
+      rc = uringSendBatch(streamUring, sock, txBatch, numberDue);
+    else
+      rc = sendMsgBatch(sock, txBatch, numberDue);
+    if (rc == ERROR)
+    {
+      rc = EXIT_FAILURE;
+      printf("UDPPingClient:  send failed,  errno:%d \n", errno);
+      break;
+    }
+    rc = EXIT_SUCCESS;
+    numberSent += numberDue;
+    totalBytesSent += numberDue * msgSize;
+    intervalSent(intervalCounts, numberDue, numberDue * msgSize);
+    statsRecordSent(liveRecord, numberDue, numberDue * msgSize, statsExportWallTime(liveStats, curTimeD));
+    if (traceLevel > 1)
+      printf("UDPPingClient: sent %d probes, last seq:%d numberSent:%d \n", numberDue, seqNumber - 1, numberSent);
+  }
+  freeMsgBatch(txBatch);
+  free(gsoBuffer);
+  return rc;
+}
+
+/***********************************************************
+* Function: int RxReply(int msgSize, struct sockaddr *fromAddrPtr, socklen_t *fromAddrLenPtr,
+*                       double *TstopPtr)
+*
+* Explanation:  Receives a reply into RxBufPtr and sets its arrival
+*               time:  the kernel/NIC rx stamp if timestamping is on
+*               (and the reply was stamped), else CLOCK_REALTIME now.
+*
+* outputs:
+*        returns EXIT_FAILURE or number of bytes received (as RxMsg)
+*
+**************************************************/
+int RxReply(int msgSize, struct sockaddr *fromAddrPtr, socklen_t *fromAddrLenPtr, double *TstopPtr)
+{
+  int bytesRxed = 0;
+  struct timespec ts = {0, 0};
+
+  if (timestampMode == TIMESTAMP_NONE)
+    bytesRxed = RxMsg(sock, (void *)RxBufPtr, msgSize, fromAddrPtr, fromAddrLenPtr);
+  else
+    bytesRxed = RxMsgTS(sock, (void *)RxBufPtr, msgSize, fromAddrPtr, fromAddrLenPtr, &ts);
+
+  if ((ts.tv_sec != 0) || (ts.tv_nsec != 0))
+    numberRxStamps++;
+  else
+    getCurTimeTS(&ts);
+  *TstopPtr = gettimestampD(ts.tv_sec, ts.tv_nsec);
+  return bytesRxed;
+}
+
+/***********************************************************
+* Function: bool readTxTimestamps(uint32_t seq, double *txTimePtr)
+*
+* Explanation:  Reads every tx stamp queued on the socket.  Probe seq
+*               is the socket's send number seq-1 (the tx stamp ID).
+*               In window mode each stamp replaces the send time of
+*               its probe (if still in flight).
+*
+* inputs:
+*   uint32_t seq : stop-and-wait: the probe whose stamp is wanted (0: none)
+*   double *txTimePtr :  set to the stamp of seq
+*
+* outputs:
+*        returns true if the stamp of seq was read
+*
+**************************************************/
+bool readTxTimestamps(uint32_t seq, double *txTimePtr)
+{
+  bool found = false;
+  uint32_t txID = 0;
+  struct timespec ts;
+
+  if ((timestampMode == TIMESTAMP_NONE) || (mode == 2))
+    return false;
+
+  while (getTxTimestamp(sock, &txID, &ts) == 1)
+  {
+    double stampD = gettimestampD(ts.tv_sec, ts.tv_nsec);
+    if (window != NULL)
+    {
+      if (probeWindowTxTime(window, txID + 1, stampD) == NOERROR)
+        numberTxStamps++;
+    }
+    else if ((seq != 0) && (txID + 1 == seq))
+    {
+      *txTimePtr = stampD;
+      numberTxStamps++;
+      found = true;
+    }
+  }
+  return found;
+}
+
+/***********************************************************
+* Function: void processReply(probeHeader *reply, int bytesRxed, double txTime, double Tstop, int windowRC)
+*
+* Explanation:  Computes the RTT and OWD samples of a reply
+*               that was matched to an in flight probe.
+*
+* inputs:
+*   probeHeader *reply : the reply (decodeProbeReply)
+*   int bytesRxed :  size of the reply
+*   double txTime : when the matching probe was sent
+*   double Tstop : when the reply arrived
+*   int windowRC : PROBE_ACKED or PROBE_REORDERED
+*
+**************************************************/
+void processReply(probeHeader *reply, int bytesRxed, double txTime, double Tstop, int windowRC)
+{
+  uint32_t RxSeqNumber = reply->seq;
+  double RTTSample = 0.0;
+  double OWDSample = 0.0;
+  double fwdOWDSample = 0.0;
+
+  OWDSample = replyOWD(reply, txTime, Tstop, &fwdOWDSample);
+  RTTSample = Tstop - txTime;
+  probeWindowRTTSample(window, RTTSample);
+  RTTSum += RTTSample;
+  OWDSum += OWDSample;
+  fwdOWDSum += fwdOWDSample;
+  numberRTTSamples++;
+  numberOWDSamples++;
+  numberRxed++;
+  addLatencySamples(RTTSample, fwdOWDSample, OWDSample);
+  if (intervalCounts != NULL)
+  {
+    double samples[3] = {RTTSample, fwdOWDSample, OWDSample};
+    intervalReply(intervalCounts, bytesRxed, samples, 3);
+  }
+  statsRecordReply(liveRecord, bytesRxed, RTTSample, Tstop);
+  if (windowRC == PROBE_REORDERED)
+    numberReordered++;
+
+  if (traceLevel == 1)
+    traceRTTSample(getCurTimeD(), txTime, Tstop, OWDSample, RxSeqNumber, bytesRxed);
+  if (traceLevel > 1)
+  {
+    printf("UDPPingClient: RxSeqNumber:%d,  RTTSample:%1.6f numberRTTSamples:%d inFlight:%d %s \n",
+           RxSeqNumber, RTTSample, numberRTTSamples, window->numberInFlight,
+           (windowRC == PROBE_REORDERED) ? "reordered" : "");
+  }
+}
+
+/***********************************************************
+* Function: void traceRTTSample(double curTime, double txTime, double Tstop, double OWDSample,
+*                               uint32_t RxSeqNumber, int bytesRxed)
+*
+* Explanation:  The traceLevel 1 output of a reply: a CSV line on
+*               stdout or, with -tracefile, a record for the logger.
+*
+* inputs:
+*   double curTime : wall time (the CSV line's first column)
+*   double txTime, double Tstop : when the probe was sent and the reply arrived
+*   double OWDSample : one way delay of the reply
+*   uint32_t RxSeqNumber : seq of the reply
+*   int bytesRxed :  size of the reply
+*
+**************************************************/
+void traceRTTSample(double curTime, double txTime, double Tstop, double OWDSample,
+                    uint32_t RxSeqNumber, int bytesRxed)
+{
+  traceRecord r;
+
+  if (traceFileName == NULL)
+  {
+    printf("%f,%f,%f,%lu,%d,%d,%d\n",
+           curTime, Tstop - txTime, OWDSample, (unsigned long)totalBytesSent, RxSeqNumber, numberSent, numberPacketLoss);
+    return;
+  }
+  r.recordType = TRACE_CLIENT_RTT;
+  r.source = 0;
+  r.seq = RxSeqNumber;
+  r.txTime = txTime;
+  r.rxTime = Tstop;
+  r.bytes = (uint32_t)bytesRxed;
+  getWirelessSample(&r.RSSI, &r.u.client.SignalQuality);
+  r.u.client.OWD = OWDSample;
+  r.u.client.totalBytesSent = (double)totalBytesSent;
+  r.u.client.numberSent = numberSent;
+  r.u.client.numberPacketLoss = (uint32_t)numberPacketLoss;
+  r.u.client.unused = 0;
+  traceLog(0, &r);
+}
+
+/***********************************************************
+* Function: double replyOWD(probeHeader *reply, double txTime, double Tstop, double *fwdOWDPtr)
+*
+* Explanation:  Adds the exchange of a reply to the clock
+*               offset estimate and returns its one way delays, each
+*               corrected by the estimate.
+*
+* inputs:
+*   probeHeader *reply : the reply (decodeProbeReply)
+*   double txTime : when the matching probe was sent (T1)
+*   double Tstop : when the reply arrived (T4)
+*   double *fwdOWDPtr : set to the client to server delay
+*
+* outputs:
+*        returns the server to client delay
+*
+* notes:
+*   The server's rx time (T2) and tx time (T3) are in the echoed
+*   header (mode 0) or the ACK (mode 1).  A compact echo's T3 is T2
+*   plus the turnaround (usecs).
+*
+**************************************************/
+double replyOWD(probeHeader *reply, double txTime, double Tstop, double *fwdOWDPtr)
+{
+  double T2 = wireNsToD(reply->srvRxTime);
+  double T3 = wireNsToD(reply->srvTxTime);
+  double offset = 0.0;
+
+  clockSyncUpdate(clockEstimator, txTime, T2, T3, Tstop);
+
+  *fwdOWDPtr = (T2 - clockSyncOffset(clockEstimator, txTime)) - txTime;
+  offset = clockSyncOffset(clockEstimator, Tstop);
+  //The next probes carry the estimate (if it fits in usecs)
+  if (fabs(offset) < 2000.0)
+    clockOffsetUsecs = (int32_t)(offset * 1000000.0);
+  return Tstop - (T3 - offset);
+}
+
+/***********************************************************
+* Function: void addLatencySamples(double RTTSample, double fwdOWDSample, double OWDSample)
+*
+* Explanation:  Counts the samples of a reply in the latency
+*               histograms of the run.  The intervals (-interval)
+*               are counted by intervalReply.
+*
+**************************************************/
+void addLatencySamples(double RTTSample, double fwdOWDSample, double OWDSample)
+{
+  latencyHistogramAdd(RTTHist, RTTSample);
+  latencyHistogramAdd(fwdOWDHist, fwdOWDSample);
+  latencyHistogramAdd(OWDHist, OWDSample);
+}
+
+/***********************************************************
+* Function: int parseOptions(int argc, char *argv[])
+*
+* Explanation:  Handles the optional named params (-name value)
+*               that follow the positional params.  The named
+*               params set the corresponding globals.
+*
+* inputs:
+*     int argc, char *argv[] : as passed to main
+*
+* outputs:
+*        returns the number of positional params (including argv[0]).
+*        Exits on an unknown or incomplete option.
+*
+**************************************************/
+int parseOptions(int argc, char *argv[])
+{
+  int i = 1;
+  int numberPositional = argc;
+
+  //The first named option ends the positional params
+  while (i < argc)
+  {
+    if ((argv[i][0] == '-') && isalpha((unsigned char)argv[i][1]))
+    {
+      if (numberPositional == argc)
+        numberPositional = i;
+      if (i + 1 >= argc)
+      {
+        printf("%s: option %s requires a value \n", argv[0], argv[i]);
+        exit(EXIT_FAILURE);
+      }
+      if (strcmp(argv[i], "-wif") == 0)
+        wirelessIFName = argv[i + 1];
+      else if (strcmp(argv[i], "-targets") == 0)
+        meshFileName = argv[i + 1];
+      else if (strcmp(argv[i], "-wint") == 0)
+        wirelessSampleInterval = atof(argv[i + 1]);
+      else if (strcmp(argv[i], "-window") == 0)
+        probeWindowSize = (uint32_t)atoi(argv[i + 1]);
+      else if (strcmp(argv[i], "-timeout") == 0)
+      {
+        probeTimeout = atof(argv[i + 1]);
+        if (probeTimeout <= 0.0)
+        {
+          printf("%s: -timeout must be > 0 seconds \n", argv[0]);
+          exit(EXIT_FAILURE);
+        }
+      }
+      else if (strcmp(argv[i], "-rttmult") == 0)
+      {
+        probeRTTMultiple = atof(argv[i + 1]);
+        if (probeRTTMultiple < 0.0)
+        {
+          printf("%s: -rttmult must be >= 0 \n", argv[0]);
+          exit(EXIT_FAILURE);
+        }
+      }
+      else if (strcmp(argv[i], "-batch") == 0)
+        streamBatchSize = (uint32_t)atoi(argv[i + 1]);
+      else if (strcmp(argv[i], "-ts") == 0)
+      {
+        timestampMode = parseTimestampMode(argv[i + 1]);
+        if (timestampMode == ERROR)
+        {
+          printf("%s: -ts must be none, sw or hw \n", argv[0]);
+          exit(EXIT_FAILURE);
+        }
+      }
+      else if (strcmp(argv[i], "-tsif") == 0)
+        timestampIFName = argv[i + 1];
+      else if (strcmp(argv[i], "-tracefile") == 0)
+        traceFileName = argv[i + 1];
+      else if (strcmp(argv[i], "-interval") == 0)
+      {
+        int numberWindows = parseIntervalWindows(argv[i + 1], reportWindows, INTERVAL_MAX_WINDOWS);
+        if (numberWindows == ERROR)
+          exit(EXIT_FAILURE);
+        numberReportWindows = (uint32_t)numberWindows;
+      }
+      else if (strcmp(argv[i], "-pacecpu") == 0)
+        paceCPU = atoi(argv[i + 1]);
+      else if (strcmp(argv[i], "-fifo") == 0)
+        paceFIFOPriority = atoi(argv[i + 1]);
+      else if (strcmp(argv[i], "-schedule") == 0)
+      {
+        scheduleType = parseScheduleType(argv[i + 1]);
+        if (scheduleType == ERROR)
+        {
+          printf("%s: -schedule must be const, exp, uniform or trace \n", argv[0]);
+          exit(EXIT_FAILURE);
+        }
+      }
+      else if (strcmp(argv[i], "-jitter") == 0)
+        scheduleJitter = atof(argv[i + 1]);
+      else if (strcmp(argv[i], "-schedfile") == 0)
+        scheduleFileName = argv[i + 1];
+      else if (strcmp(argv[i], "-seed") == 0)
+        scheduleSeed = strtoull(argv[i + 1], NULL, 0);
+      else if (strcmp(argv[i], "-rate") == 0)
+      {
+        streamRate = parseBitRate(argv[i + 1]);
+        if (streamRate <= 0.0)
+        {
+          printf("%s: -rate must be a positive bits/sec (e.g. 500k, 20M, 1G) \n", argv[0]);
+          exit(EXIT_FAILURE);
+        }
+      }
+      else if (strcmp(argv[i], "-burst") == 0)
+        streamBurst = (uint32_t)atoi(argv[i + 1]);
+      else if (strcmp(argv[i], "-shm") == 0)
+        shmName = argv[i + 1];
+      else if (strcmp(argv[i], "-wire") == 0)
+      {
+        if (strcmp(argv[i + 1], "full") == 0)
+          wireFormat = PROBE_FORMAT_FULL;
+        else if (strcmp(argv[i + 1], "compact") == 0)
+          wireFormat = PROBE_FORMAT_COMPACT;
+        else if (strcmp(argv[i + 1], "legacy") == 0)
+          wireFormat = PROBE_FORMAT_LEGACY;
+        else
+        {
+          printf("%s: -wire must be full, compact or legacy \n", argv[0]);
+          exit(EXIT_FAILURE);
+        }
+      }
+      else if (strcmp(argv[i], "-io") == 0)
+      {
+        if (strcmp(argv[i + 1], "uring") == 0)
+          useUring = true;
+        else if (strcmp(argv[i + 1], "socket") != 0)
+        {
+          printf("%s: -io must be socket or uring \n", argv[0]);
+          exit(EXIT_FAILURE);
+        }
+      }
+      else if (strcmp(argv[i], "-gso") == 0)
+        useGSO = (atoi(argv[i + 1]) != 0);
+      else if (strcmp(argv[i], "-kpace") == 0)
+        kernelPacing = (atoi(argv[i + 1]) != 0);
+      else if (strcmp(argv[i], "-clock") == 0)
+      {
+        if (strcmp(argv[i + 1], "tsc") == 0)
+          useTSCClock = true;
+        else if (strcmp(argv[i + 1], "gettime") != 0)
+        {
+          printf("%s: -clock must be gettime or tsc \n", argv[0]);
+          exit(EXIT_FAILURE);
+        }
+      }
+      else
+      {
+        printf("%s: unknown option %s \n", argv[0], argv[i]);
+        exit(EXIT_FAILURE);
+      }
+      i += 2;
+    }
+    else
+    {
+      if (numberPositional != argc)
+      {
+        printf("%s: positional param %s must precede the named options \n", argv[0], argv[i]);
+        exit(EXIT_FAILURE);
+      }
+      i++;
+    }
+  }
+  return numberPositional;
 }
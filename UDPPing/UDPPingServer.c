@@ -27,84 +27,276 @@
 *                                   0   displays end of program stats and error msgs
 *                                   1   Additionally displays RTT sample each iteration
 *                                   2   displays debug info
+*
+*      Optional named params follow the positional params:
+*        -batch <N>         : receive up to N msgs per recvmmsg and send the
+*                             replies with one sendmmsg (1..MAX_MSG_BATCH, default
+*                             MAX_MSG_BATCH).  1 is the original recvfrom/sendto loop.
+*        -ts <none|sw|hw>   : arrival times (the one way delay) come from kernel (sw)
+*                             or NIC (hw) rx timestamps rather than clock_gettime
+*        -tsif <IF name>    : -ts hw: the IF whose NIC is set to timestamp
+*        -threads <N>       : N worker threads, each with its own SO_REUSEPORT
+*                             socket pinned to a CPU (default 1: a single socket
+*                             served by the main thread)
+*        -sessions <N>      : each worker tracks up to N clients (default
+*                             DEFAULT_SESSIONS, at most MAX_SESSIONS)
+*        -tracefile <file>  : traceLevel 1: the per msg trace is logged (binary)
+*                             to the file by a background thread rather than
+*                             printed.  traceToCSV converts the file to the CSV lines.
+*        -interval <secs[,secs...]>: e.g. 1,10,60:  a reporter thread displays,
+*                             at the end of each window, the received rate, the
+*                             losses, reorders and loss runs and the one way delay
+*                             percentiles of the msgs of that window (all the
+*                             workers).  The first window is the tick, the others
+*                             are multiples of it.  The workers only update their
+*                             current epoch of the counters (never a print or a
+*                             lock).  No -interval (the default):  only at the end.
+*                             -interval 1 gives the per second rate of a client
+*                             -rate stream.
+*        -clock <gettime|tsc>: arrival times (without -ts) and the reply send
+*                             times are read from clock_gettime (default) or the
+*                             TSC (x86 with an invariant TSC only)
+*        -gro <0|1>         : 1: UDP GRO - the kernel coalesces the back to back
+*                             msgs of a client (e.g., a -gso or -rate stream) and
+*                             each receive returns up to 64KB of msgs that are
+*                             split here.  Needs -batch > 1.
+*        -io <socket|uring> : the receive/reply path:  socket calls (default) or
+*                             io_uring (one multishot recvmsg into a pool of
+*                             URING_RX_BUFFERS kernel provided buffers, the
+*                             echoes are linked sendmsgs, one io_uring_enter per
+*                             pass).  Falls back to the socket calls when
+*                             io_uring is not available.  Not with -gro.
+*        -shm <name>        : publish each worker's and each session's live
+*                             counters and one way delay histogram in the shared
+*                             memory segment /dev/shm/name (a record per worker,
+*                             then per session slot).  UDPPingStats name reads them.
+*        -metrics <port>    : serve the workers' and sessions' counters and one
+*                             way delay histograms (OpenMetrics text, for
+*                             Prometheus) at http://host:port/metrics.  An HTTP
+*                             thread reads the same seqlocked records as -shm
+*                             (without -shm they are private to the process).
 *                             
 * Design notes;
-*    The server uses a single buffer for both the receive and the send
-*    The server does not yet maintain per session statistics
+*    Each worker uses its rx buffers for both the receive and the send
+*    (mode 0 echoes each msg from the buffer it arrived in)
+*    The reply path is zero copy and allocation free:  the rx buffers
+*    (one cache aligned, pre-faulted pool per worker) are set up in
+*    setupWorker, a mode 0 echo is the rx buffer with its srvRx/srvTx
+*    fields rewritten in place, and a mode 1 ACK is built in the
+*    worker's ackArray entry of the batch slot.  The tx batch entries
+*    only point at them.
+*    With -threads N the kernel spreads the clients over the N sockets
+*    (a client is always served by the same worker).  Each worker keeps
+*    its own counters; they are merged when the server exits.
+*    Each worker also keeps a session table with the loss, one way delay
+*    and jitter of each client (IP:port) it serves.  A client with no
+*    msg for SESSION_IDLE_TIMEOUT seconds is archived.  The sessions
+*    are displayed at exit (traceLevel 0).
+*    Replies (modes 0,1) carry the msg's arrival time and the reply's
+*    send time so the client can estimate the clock offset.  The
+*    client returns its estimate in each msg and the one way delay
+*    is corrected by it.
+*    The probe's wire format (messages.h:  full, compact or a legacy
+*    TGIFHeartbeat) is told by its first byte and the reply uses it.
 *    
 *
 * Revisions:
 *
-*  Last update: 10/18/2019
+*  $A1: batched receive/echo (recvmmsg/sendmmsg)
+*  $A2: SO_TIMESTAMPING rx timestamps
+*  $A3: SO_REUSEPORT worker threads with per worker counters
+*  $A4: per client session tables
+*  $A5: binary trace logger (-tracefile)
+*  $A6: one way delay histograms (percentiles)
+*  $A7: server rx/tx times in the replies, clock offset corrected one way delay
+*  $A8: -clock tsc (TSC clock source)
+*  $A9: interval rate/loss/reorder reports; a seq gap advances lastSeqNumber
+*  $A10: UDP GRO receives (-gro)
+*  $A11: io_uring receive/reply path (-io uring)
+*  $A12: cache aligned, pre-faulted rx buffers and ACKs
+*  $A13: live per session stats in shared memory (-shm)
+*  $A14: OpenMetrics HTTP endpoint (-metrics) and per worker stats records
+*  $A15: per session RFC 3550 jitter, RFC 4737 reordering, duplicates, IPDV;
+*        the worker counts reorders and drops from the sessions' flows
+*  $A16: loss runs (burst lengths, Gilbert-Elliott) in the interval and final reports
+*  $A17: -interval windows (e.g. 1,10,60) reported by a thread from double
+*        buffered worker counters
+*  $A18: version 1 probe wire format (full, compact, ACK; ns times) decoded
+*        and replied to in kind; legacy TGIFHeartbeat probes still served
+*
+*  Last update: 10/17/2026
 *
 *********************************************************/
+#define _GNU_SOURCE /* for struct mmsghdr */
 #include "./commonCode/common.h"
 #include "./commonCode/AddressHelper.h"
 #include "./commonCode/SocketHelper.h"
 #include "./commonCode/messages.h"
+#include "./commonCode/session.h"
+#include "./commonCode/traceLogger.h"
+#include "./commonCode/latencyHistogram.h"
+#include "./commonCode/uringHelper.h"
+#include "./commonCode/statsExport.h"
+#include "./commonCode/metricsServer.h"
+#include "./commonCode/intervalStats.h"
+#include "./commonCode/eventLoop.h"
 #include "version.h"
 
 //#define TRACEME 1
 
+#define MAX_WORKERS 256
+
+//-io uring: receive buffers per worker (a power of 2) and the user_data of the recv
+//and of the wakeFD poll.  The pool is used round robin:  a small one stays in the cache.
+#define URING_RX_BUFFERS 512
+#define URING_RECV_TAG (1ULL << 63)
+#define URING_WAKE_TAG (1ULL << 62)
+
+//io_uring: the reply to the msg in pool buffer i.  It (and the buffer)
+//must stay valid until the send completes.
+typedef struct {
+  struct msghdr msg;
+  struct iovec iov;
+  probeACK ack;
+} uringSendSlot;
+
+//The counters of a worker (and, merged, of the server)
+typedef struct {
+  uint32_t numberIterations;
+  uint32_t numberMessages;
+  uint32_t RxSeqNumber;
+  uint32_t lastSeqNumber;
+  uint32_t dropEstimate;
+  uint32_t outOfOrderArrivals;
+  uint32_t duplicateArrivals;
+  lossRunStats loss;                 //of the sessions' flows (the seqs that left their windows)
+  double totalBytesRxed;
+  double avgQuality;
+  double avgRSSI;
+  double avgOwd;
+  double startTime;
+  double lastRxTime;
+  //  0:  normal ping mode
+  //  1:  ACKs a message that only contains the ACK number - so if the client sends 1472 bytes,
+  //         the server modifies the msgSize on the sendMsg to 4.
+  int mode;
+} serverStats;
+
+//A worker owns a socket, its buffers and its counters.  Only the
+//worker writes them, and each worker starts on its own cache line.
+typedef struct {
+  serverStats stats;
+  int workerID;
+  int sock;
+  int cpu;             //-1: not pinned
+  pthread_t thread;
+  char *RxBufPtr;
+  msgBatch *rxBatch;   //NULL: one recvfrom/sendto per msg
+  msgBatch *txBatch;
+  probeACK ackArray[MAX_MSG_BATCH] __attribute__((aligned(CACHE_LINE_SIZE)));  //mode 1 ACKs, one per batch entry
+  sessionTable *sessions;            //the clients this worker serves
+  latencyHistogram *owdHist;         //one way delays of the run
+  intervalStats *interval;           //-interval: the worker's epochs (NULL: none)
+  uringContext *uring;               //NULL: the socket calls
+  uringSendSlot *sendSlots;          //io_uring: one per pool buffer
+  struct msghdr recvMsg;             //io_uring: the multishot recvmsg
+  statsRecord *liveRecord;           //-shm/-metrics: the worker's record
+} __attribute__((aligned(CACHE_LINE_SIZE))) serverWorker;
+
 //Routines found in this file
 void CNTCHandler();
+void printRunStats();
 void exitProcessing(int errorStatus, double curTime);
 double gettimestampD(uint32_t sec, uint32_t nsec);
+int parseOptions(int argc, char *argv[]);
+int setupWorker(serverWorker *w, const char *service);
+void *workerLoop(void *arg);
+void *workerLoopUring(serverWorker *w);
+void mergeWorkerStats(serverStats *totalPtr);
+int handleMessage(serverWorker *w, char *msgPtr, int bytesRxed, struct sockaddr *clntAddrPtr,
+                  double wallTime, struct timespec *rxTSPtr, probeACK *ackPtr, void **replyPtrPtr);
+void publishStats(serverWorker *w, session *client, double owd, int replySize, double wallTime);
 bool runFlag = true;
-uint32_t numberIterations = 0;
-int sock = -1;
-double totalBytesRxed = 0;
-uint32_t numberMessages = 0;
-uint32_t RxSeqNumber = 0;
-uint32_t lastSeqNumber = 0;
-uint32_t dropEstimate = 0;
-uint32_t outOfOrderArrivals = 0;
-double avgQuality = 0;
-double avgRSSI = 0;
-
-char *RxBufPtr = NULL;
+
 int traceLevel = 1;
-double startTime = -1;
 double finishTime = -1;
-double lastRxTime = -1;
-TGIFHeartbeat *rxHeader;
-TGIFACK *rxACK;
 double servStartTime = -1;
 double servFinishTime = -1;
-double avgOwd = 0;
+int maxMsgSize = -1;
+
+//Number of msgs moved per recvmmsg/sendmmsg (1: one recvfrom/sendto per msg)
+uint32_t batchSize = MAX_MSG_BATCH;
+
+//TIMESTAMP_NONE: arrival time is a clock_gettime, else the kernel/NIC rx stamp
+int timestampMode = TIMESTAMP_NONE;
+char *timestampIFName = NULL;
+
+//Worker threads (1: the main thread serves a single socket)
+uint32_t numberWorkers = 1;
+serverWorker *workers = NULL;
+
+//Size of each worker's session table
+uint32_t maxSessions = DEFAULT_SESSIONS;
 
-//  0:  normal ping mode
-//  1:  ACKs a message that only contains the ACK number - so if the client sends 1472 bytes,
-//         the server modifies the msgSize on the sendMsg to 4.
-int mode = 0;
+//true: the arrival times (when not kernel stamps) and the reply times read the TSC
+bool useTSCClock = false;
+
+//NULL: the traceLevel 1 lines are printed, else logged to this file
+char *traceFileName = NULL;
+
+//-interval: the report windows (seconds), the first is the tick.  0 windows: none
+double reportWindows[INTERVAL_MAX_WINDOWS];
+uint32_t numberReportWindows = 0;
+intervalReporter *reporter = NULL;
+
+//true: UDP GRO, a batch entry can hold several msgs
+bool useGRO = false;
+
+//true: io_uring (-io uring) rather than the socket calls
+bool useUring = false;
+
+//-shm/-metrics: the live stats (NULL: none).  Records:  one per worker, then
+//the session slots, interleaved (numberWorkers + slot * numberWorkers + worker)
+//so the records in use stay at the front of the segment.
+char *shmName = NULL;
+statsExport *liveStats = NULL;
+
+//-metrics: the HTTP port and its listener
+char *metricsService = NULL;
+metricsServer *metrics = NULL;
+//Signaled by CNTCHandler:  ends the io_uring workers' waits (a shut down
+//socket does not end a multishot recv)
+int wakeFD = -1;
 
 int main(int argc, char *argv[])
 {
 
   int rc = NOERROR;
   char *service = NULL;   //sets port number
-  double wallTime = -1.0; //wall clock time
-  int sockOption = 1;
-  int sockOptionSize = sizeof(sockOption);
-
-  int maxMsgSize = -1;
-  //Maintains the most recent ACK number that has been received
-  //Used when we pull the RxSequence Number from a received MSG
-  unsigned int *RxSeqNumberPtr = NULL;
-
-  int bytesRxed = -1;
+  uint32_t i;
+  sigset_t sigMask;
 
-  wallTime = getCurTimeD();
   servStartTime = getCurTimeD();
 
   setVersion(VersionLevel);
+  //The named options are removed - argc is now the number of positional params
+  argc = parseOptions(argc, argv);
   if (argc < 2)
   { // Test for correct number of arguments
-    printf("%s(Version:%s) pid:%d:Usage: <port number>  <max msgSize>  <traceLevel> \n ",
+    printf("%s(Version:%s) pid:%d:Usage: <port number>  <max msgSize>  <traceLevel> [-batch N] [-ts none|sw|hw] [-tsif IF] [-threads N] [-sessions N] [-tracefile file] [-interval secs[,secs...]] [-clock gettime|tsc] [-gro 0|1] [-io socket|uring] [-shm name] [-metrics port] \n ",
            argv[0], getVersion(), getpid());
     rc = EXIT_FAILURE;
     exit(rc);
   }
+  if (useTSCClock)
+  {
+    initClockModule();
+    if (setDefaultWallClockType(CLOCK_RDTSC) == ERROR)
+    {
+      printf("%s(Version:%s) -clock tsc: the CPU has no invariant TSC \n", argv[0], getVersion());
+      exit(EXIT_FAILURE);
+    }
+  }
 
   service = argv[1]; // First arg:  local port
 
@@ -118,181 +310,629 @@ int main(int argc, char *argv[])
     traceLevel = atoi(argv[3]);
   }
 
-  signal(SIGINT, CNTCHandler);
+  if (useGRO && useUring)
+  {
+    printf("%s(Version:%s) -gro and -io uring can not be used together \n", argv[0], getVersion());
+    exit(EXIT_FAILURE);
+  }
+  if (useGRO && (batchSize < 2))
+  {
+    printf("%s(Version:%s) -gro requires -batch > 1 \n", argv[0], getVersion());
+    exit(EXIT_FAILURE);
+  }
+  if ((batchSize == 0) || (batchSize > MAX_MSG_BATCH))
+  {
+    printf("%s(Version:%s) batch (%d) must be 1 .. %d \n", argv[0], getVersion(), batchSize, MAX_MSG_BATCH);
+    exit(EXIT_FAILURE);
+  }
+  if ((numberWorkers == 0) || (numberWorkers > MAX_WORKERS))
+  {
+    printf("%s(Version:%s) threads (%d) must be 1 .. %d \n", argv[0], getVersion(), numberWorkers, MAX_WORKERS);
+    exit(EXIT_FAILURE);
+  }
+  if ((maxSessions == 0) || (maxSessions > MAX_SESSIONS))
+  {
+    printf("%s(Version:%s) sessions (%d) must be 1 .. %d \n", argv[0], getVersion(), maxSessions, MAX_SESSIONS);
+    exit(EXIT_FAILURE);
+  }
 
-  printf("%s(Version:%s) pid:%d Entered with %d arguements, maxMsgSize:%d, service:%s, traceLevel:%d\n",
-         argv[0], getVersion(), getpid(), argc, maxMsgSize, service, traceLevel);
+  printf("%s(Version:%s) pid:%d Entered with %d arguements, maxMsgSize:%d, service:%s, traceLevel:%d batch:%d threads:%d\n",
+         argv[0], getVersion(), getpid(), argc, maxMsgSize, service, traceLevel, batchSize, numberWorkers);
 
-  RxBufPtr = (char *)malloc(sizeof(char) * maxMsgSize);
-  if (RxBufPtr == NULL)
+  workers = aligned_alloc(CACHE_LINE_SIZE, numberWorkers * sizeof(serverWorker));
+  if (workers == NULL)
   {
     printf("%s(Version:%s) pid:%d  Malloc error ,  errno:%d \n",
            argv[0], getVersion(), getpid(), errno);
     return EXIT_FAILURE;
   }
+  memset(workers, 0, numberWorkers * sizeof(serverWorker));
+
+  //One record per session slot of each worker and one per worker
+  if ((shmName != NULL) || (metricsService != NULL))
+  {
+    liveStats = createStatsExport(shmName, STATS_ROLE_SERVER, numberWorkers + numberWorkers * maxSessions);
+    if (liveStats == NULL)
+    {
+      printf("%s(Version:%s): ERROR creating the stats segment %s \n", argv[0], getVersion(),
+             (shmName != NULL) ? shmName : "(private)");
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  //The helper threads (TSC recalibration, trace writer, workers, HTTP,
+  //reporter) block SIGINT so CNTCHandler runs on the main thread
+  sigemptyset(&sigMask);
+  sigaddset(&sigMask, SIGINT);
+  pthread_sigmask(SIG_BLOCK, &sigMask, NULL);
+  //-clock tsc:  the calibration is kept current off the workers' path
+  if (useTSCClock && (startTSCRecalibration() == ERROR))
+    printf("%s(Version:%s): WARNING failed to start the TSC recalibration \n", argv[0], getVersion());
+  wakeFD = createEventWake();
+  if (wakeFD == ERROR)
+    exit(EXIT_FAILURE);
+
+  //One trace ring per worker
+  if ((traceFileName != NULL) && (startTraceLogger(traceFileName, numberWorkers, 0) == ERROR))
+  {
+    printf("%s(Version:%s): ERROR starting the trace logger (%s) \n", argv[0], getVersion(), traceFileName);
+    exit(EXIT_FAILURE);
+  }
+
+  for (i = 0; i < numberWorkers; i++)
+  {
+    workers[i].workerID = i;
+    //A single worker runs on the main thread, unpinned (the original server)
+    workers[i].cpu = (numberWorkers > 1) ? (int)(i % getNumberCPUs()) : -1;
+    if (setupWorker(&workers[i], service) == ERROR)
+    {
+      printf("%s(Version:%s):  worker %d setup error.....errno:%d \n",
+             argv[0], getVersion(), i, errno);
+      exit(EXIT_FAILURE);
+    }
+    if (liveStats != NULL)
+    {
+      char recordName[STATS_NAME_SIZE];
+      snprintf(recordName, sizeof(recordName), "worker %d", i);
+      workers[i].liveRecord = statsExportOpenRecord(liveStats, i, i,
+                                                    STATS_KIND_WORKER, recordName, getCurTimeD());
+    }
+  }
+
+  for (i = 1; i < numberWorkers; i++)
+  {
+    rc = pthread_create(&workers[i].thread, NULL, workerLoop, &workers[i]);
+    if (rc != 0)
+    {
+      printf("%s(Version:%s): pthread_create failed for worker %d rc:%d \n", argv[0], getVersion(), i, rc);
+      exit(EXIT_FAILURE);
+    }
+  }
+  //The HTTP thread runs on a CPU the workers do not use (if there is one)
+  if (metricsService != NULL)
+  {
+    metrics = startMetricsServer(metricsService, liveStats,
+                                 ((numberWorkers > 1) && (numberWorkers < (uint32_t)getNumberCPUs())) ? (int)numberWorkers : -1);
+    if (metrics == NULL)
+    {
+      printf("%s(Version:%s): ERROR starting the metrics server on %s \n", argv[0], getVersion(), metricsService);
+      exit(EXIT_FAILURE);
+    }
+  }
+  if (numberReportWindows > 0)
+  {
+    intervalStats *sources[MAX_WORKERS];
+    const char *histNames[1] = {"OWD"};
+    for (i = 0; i < numberWorkers; i++)
+      sources[i] = workers[i].interval;
+    reporter = startIntervalReporter("server", sources, numberWorkers, histNames, 1,
+                                     reportWindows, numberReportWindows,
+                                     ((numberWorkers > 1) && (numberWorkers < (uint32_t)getNumberCPUs())) ? (int)numberWorkers : -1);
+    if (reporter == NULL)
+    {
+      printf("%s(Version:%s): ERROR starting the interval reporter \n", argv[0], getVersion());
+      exit(EXIT_FAILURE);
+    }
+  }
+  pthread_sigmask(SIG_UNBLOCK, &sigMask, NULL);
+  signal(SIGINT, CNTCHandler);
 
-  //This points to rx buffer so client can obtain the RxSeqNumber
-  RxSeqNumberPtr = (unsigned int *)RxBufPtr;
+  //The main thread is worker 0:  the loops end when CNTCHandler clears runFlag
+  workerLoop(&workers[0]);
+  for (i = 1; i < numberWorkers; i++)
+    pthread_join(workers[i].thread, NULL);
+  printRunStats();
+
+  rc = NOERROR;
+  exitProcessing(rc, getCurTimeD());
+  if (traceLevel > 1)
+  {
+    printf("%s(Version:%s): Exiting rc: %d  \n", argv[0], getVersion(), rc);
+  }
+  exit(rc);
+}
+
+/***********************************************************
+* Function: int setupWorker(serverWorker *w, const char *service)
+*
+* Explanation:  Creates the worker's socket and buffers.  With more
+*               than one worker the sockets share the port (SO_REUSEPORT).
+*
+* inputs:
+*    serverWorker *w : the worker (workerID and cpu set)
+*    const char *service : the port
+*
+* outputs:
+*        returns ERROR or NOERROR
+*
+**************************************************/
+int setupWorker(serverWorker *w, const char *service)
+{
+  int rc = NOERROR;
+  int sockOption = 1;
+  int sockOptionSize = sizeof(sockOption);
+
+  w->stats.startTime = -1.0;
+  w->stats.lastRxTime = -1.0;
+
+  //Touched now so the first msgs do not page fault
+  w->RxBufPtr = aligned_alloc(CACHE_LINE_SIZE, (maxMsgSize + CACHE_LINE_SIZE - 1) & ~(CACHE_LINE_SIZE - 1));
+  if (w->RxBufPtr == NULL)
+    return ERROR;
+  memset(w->RxBufPtr, 0, maxMsgSize);
+
+  w->sessions = createSessionTable(maxSessions);
+  if (w->sessions == NULL)
+  {
+    printf("setupWorker: createSessionTable error,  sessions:%d \n", maxSessions);
+    return ERROR;
+  }
+  w->owdHist = createLatencyHistogram();
+  if (w->owdHist == NULL)
+    return ERROR;
+  if (numberReportWindows > 0)
+  {
+    w->interval = createIntervalStats();
+    if (w->interval == NULL)
+      return ERROR;
+  }
+
+  if (batchSize > 1)
+  {
+    //The tx batch has no buffers - its entries point at the rx buffers or ackArray
+    //A GRO rx buffer holds a coalesced msg
+    w->rxBatch = createMsgBatch(batchSize, (useGRO && (maxMsgSize < GRO_BUFFER_SIZE)) ? GRO_BUFFER_SIZE : maxMsgSize);
+    w->txBatch = createMsgBatch(batchSize, 0);
+    if ((w->rxBatch == NULL) || (w->txBatch == NULL))
+    {
+      printf("setupWorker: createMsgBatch error,  batch:%d maxMsgSize:%d \n", batchSize, maxMsgSize);
+      return ERROR;
+    }
+  }
 
   // Create socket for incoming connections
-  sock = SetupUDPServerSocket(service);
-  if (sock < 0)
+  w->sock = SetupUDPServerSocketOpts(service, (numberWorkers > 1));
+  if (w->sock < 0)
   {
-    printf("%s(Version:%s):  SetupUDPServiceSocket error.....errno:%d \n",
-           argv[0], getVersion(), errno);
-    return EXIT_FAILURE;
+    printf("setupWorker:  SetupUDPServiceSocket error.....errno:%d \n", errno);
+    return ERROR;
   }
   //Allow multiple sockets to use the same port
   //We might want have > 1 instances running all using the same port
   // one might use unicast another broadcast
-  sockOption = 1;
-  rc = SetSocketOption(sock, SO_REUSEADDR, &sockOption, sockOptionSize);
+  rc = SetSocketOption(w->sock, SO_REUSEADDR, &sockOption, sockOptionSize);
   if (rc == ERROR)
   {
     perror("perfServer: ERROR enabling REUSEADDR  ");
-    exit(EXIT_FAILURE);
+    return ERROR;
   }
 
   /* setup broadcast even if specifiied UNICAST.... */
-  rc = SetSocketOption(sock, SO_BROADCAST, &sockOption, sockOptionSize);
+  rc = SetSocketOption(w->sock, SO_BROADCAST, &sockOption, sockOptionSize);
   if (rc == ERROR)
   {
-    printf("perfServer(%f) ERROR:  setsockopt error when enabling broadcast,  errno: %d  \n", wallTime, errno);
+    printf("perfServer(%f) ERROR:  setsockopt error when enabling broadcast,  errno: %d  \n", getCurTimeD(), errno);
     perror("perfServer: ERROR enabling broadcast ");
-    exit(EXIT_FAILURE);
+    return ERROR;
   }
 
-  rc = NOERROR;
+  if (timestampMode != TIMESTAMP_NONE)
+  {
+    rc = enableTimestamping(w->sock, timestampMode, false, timestampIFName);
+    if (rc == ERROR)
+    {
+      printf("setupWorker: ERROR enabling rx timestamps \n");
+      return ERROR;
+    }
+  }
+  if (useGRO && (enableUDPGRO(w->sock) == ERROR))
+    return ERROR;
+
+  if (useUring)
+  {
+    //Each buffer:  the recvmsg_out, the source address, the control data and the msg
+    uint32_t bufferSize = sizeof(struct io_uring_recvmsg_out) + sizeof(struct sockaddr_storage) +
+                          TIMESTAMP_CONTROL_SIZE + maxMsgSize;
+    bufferSize = (bufferSize + CACHE_LINE_SIZE - 1) & ~(CACHE_LINE_SIZE - 1);
+    w->uring = createUring(URING_DEFAULT_ENTRIES);
+    if ((w->uring != NULL) && (uringRegisterBufferPool(w->uring, URING_RX_BUFFERS, bufferSize) == ERROR))
+    {
+      freeUring(w->uring);
+      w->uring = NULL;
+    }
+    if (w->uring != NULL)
+    {
+      w->sendSlots = aligned_alloc(CACHE_LINE_SIZE, URING_RX_BUFFERS * sizeof(uringSendSlot));
+      if (w->sendSlots != NULL)
+        memset(w->sendSlots, 0, URING_RX_BUFFERS * sizeof(uringSendSlot));
+    }
+    if (w->sendSlots == NULL)
+    {
+      freeUring(w->uring);
+      w->uring = NULL;
+      printf("setupWorker: WARNING io_uring is not available, worker %d uses the socket calls \n", w->workerID);
+    }
+  }
+  return NOERROR;
+}
+
+/***********************************************************
+* Function: void *workerLoop(void *arg)
+*
+* Explanation:  The receive/reply loop of a worker.  Runs until
+*               runFlag is cleared.  Exits the process on a socket error
+*               (a failure once runFlag is cleared ends the loop:  CNTCHandler
+*               shut the socket down).
+*
+* inputs:
+*    void *arg : the serverWorker
+*
+**************************************************/
+void *workerLoop(void *arg)
+{
+  serverWorker *w = (serverWorker *)arg;
+  serverStats *s = &w->stats;
+  msgBatch *rxBatch = w->rxBatch;
+  msgBatch *txBatch = w->txBatch;
+  int sock = w->sock;
+  int bytesRxed = -1;
+  double wallTime = -1.0; //wall clock time
+  int rc = NOERROR;
+
+  pinThreadToCPU(w->cpu);
+  if (traceLevel > 1)
+    printf("workerLoop: worker %d started on sock %d, cpu %d \n", w->workerID, sock, w->cpu);
+  if (w->uring != NULL)
+    return workerLoopUring(w);
+
   // Begin LOOP
-  wallTime = getCurTimeD();
-  //startTime=getTimestampD();
   for (;;)
   {
     struct sockaddr_storage clntAddr; // Client address
     // Set Length of client address structure (in-out parameter)
     socklen_t clntAddrLen = sizeof(clntAddr);
+    struct timespec rxTS = {0, 0};
+    void *replyPtr = NULL;
+    int replySize = 0;
+    int numberRxed = 0;
+    int numberReplies = 0;
+    int i;
+
+    if (runFlag == false)
+    {
+      printf("workerLoop(%d): Loop should break....numberIterations:%d  \n",
+             w->workerID, s->numberIterations);
+      break;
+    }
 
-    if (runFlag == true)
+    if (rxBatch == NULL)
     {
-      numberIterations++;
-      bytesRxed = RxMsg(sock, (void *)RxBufPtr, maxMsgSize, (struct sockaddr *)&clntAddr, &clntAddrLen);
-      lastRxTime = getTimestampD();
-      if (startTime == -1.0)
-        startTime = lastRxTime;
+      //One msg per recvfrom/sendto
+      s->numberIterations++;
+      if (timestampMode == TIMESTAMP_NONE)
+        bytesRxed = RxMsg(sock, (void *)w->RxBufPtr, maxMsgSize, (struct sockaddr *)&clntAddr, &clntAddrLen);
+      else
+        bytesRxed = RxMsgTS(sock, (void *)w->RxBufPtr, maxMsgSize, (struct sockaddr *)&clntAddr, &clntAddrLen, &rxTS);
+      s->lastRxTime = getTimestampD();
+      if (s->startTime == -1.0)
+        s->startTime = s->lastRxTime;
       wallTime = getCurTimeD();
+      archiveIdleSessions(w->sessions, wallTime, SESSION_IDLE_TIMEOUT);
       if (bytesRxed == EXIT_FAILURE)
       {
+        if (runFlag == false)
+          break;
         rc = ERROR;
         printf("UDPPingServer:  RxMsg failed  \n");
         close(sock);
         exit(EXIT_FAILURE);
       }
-      else
+      replySize = handleMessage(w, w->RxBufPtr, bytesRxed, (struct sockaddr *)&clntAddr,
+                                wallTime, &rxTS, &w->ackArray[0], &replyPtr);
+      if (replySize > 0)
       {
-
-        if (numberIterations > 0)
+        rc = sendMsg(sock, replyPtr, replySize, (struct sockaddr *)&clntAddr, clntAddrLen);
+        if (rc == EXIT_FAILURE)
         {
-          totalBytesRxed += bytesRxed;
-          numberMessages += 1;
-          rc = NOERROR;
-          rxHeader = (TGIFHeartbeat *)RxBufPtr;
-          int32_t quality = ntohl(rxHeader->SignalQuality);
-          int32_t RSSI = ntohl(rxHeader->RSSI);
-          avgQuality += (quality - avgQuality) / numberMessages;
-          avgRSSI += (RSSI - avgRSSI) / numberMessages;
-          mode = rxHeader->code;
-          RxSeqNumber = (unsigned int)ntohl((unsigned int)(rxHeader->sequenceNum));
-          // struct timespec ts;
-          // ts.tv_nsec = ntohl(rxHeader->ts_nsec);
-          if (traceLevel == 2)
-            printf("#TRACE nsec %ld\n", rxHeader->ts_nsec);
-          if (RxSeqNumber <= lastSeqNumber)
-            outOfOrderArrivals++;
-          else if (RxSeqNumber == (lastSeqNumber + 1))
-          {
-            lastSeqNumber = RxSeqNumber;
-          }
-          else
-          {
-            dropEstimate += (RxSeqNumber - lastSeqNumber - 1);
-          }
-          if (traceLevel >= 1)
-          {
-            printf("%f,%d,%d,%d,%d,%d,%9.0f,%d,",
-                   wallTime, RxSeqNumber, lastSeqNumber,
-                   numberMessages, outOfOrderArrivals, dropEstimate,
-                   totalBytesRxed, numberIterations);
-          }
-#ifdef TRACEME
-          PrintSocketAddress((struct sockaddr *)&clntAddr, stdout);
-          fputc('\n', stdout);
-#endif
-          if (traceLevel > 1)
-          {
-            printf("UDPPingServer: RxSeqNumber:%d,  %d bytes, client: ", RxSeqNumber, bytesRxed);
-            PrintSocketAddress((struct sockaddr *)&clntAddr, stdout);
-            fputc('\n', stdout);
-          }
-          struct timespec *ts;
-          ts = (struct timespec *)malloc(sizeof(struct timespec));
-          clock_gettime(CLOCK_REALTIME, ts);
-          double owd = gettimestampD(ts->tv_sec, ts->tv_nsec) - gettimestampD(ntohl(rxHeader->ts_sec), ntohl(rxHeader->ts_nsec));
-          avgOwd += (owd - avgOwd) / RxSeqNumber;
-          if (traceLevel == 2)
-            printf("#TRACE owd : %f", owd);
-          if (traceLevel >= 1)
-            printf("%f\n", owd);
-          if (mode == 0)
-          {
-            //while(1){;}
-            rxHeader->ts_nsec = htonl(ts->tv_nsec);
-            rxHeader->ts_sec = htonl(ts->tv_sec);
-            rc = sendMsg(sock, (void *)RxBufPtr, bytesRxed, (struct sockaddr *)&clntAddr, clntAddrLen);
-          }
-          else if (mode == 1)
-          {
-            //while(1){;}
-            rxACK = (TGIFACK *)malloc(sizeof(TGIFACK));
-            rxACK->sequenceNum = htonl(RxSeqNumber);
-            rxACK->ts_nsec = htonl(ts->tv_nsec);
-            rxACK->ts_sec = htonl(ts->tv_sec);
-            rc = sendMsg(sock, (void *)rxACK, sizeof(TGIFACK), (struct sockaddr *)&clntAddr, clntAddrLen);
-          }
-          else if (mode == 2)
+          if (runFlag == false)
+            break;
+          printf("UDPPingServer:  sendMsg failed \n");
+          close(sock);
+          exit(EXIT_FAILURE);
+        }
+      }
+      rc = NOERROR;
+    }
+    else
+    {
+      //Up to batchSize msgs per recvmmsg, the replies go out in one sendmmsg
+      numberRxed = RxMsgBatch(sock, rxBatch, false);
+      s->lastRxTime = getTimestampD();
+      if (s->startTime == -1.0)
+        s->startTime = s->lastRxTime;
+      wallTime = getCurTimeD();
+      archiveIdleSessions(w->sessions, wallTime, SESSION_IDLE_TIMEOUT);
+      if (numberRxed == ERROR)
+      {
+        if (runFlag == false)
+          break;
+        rc = ERROR;
+        printf("UDPPingServer:  RxMsgBatch failed  \n");
+        close(sock);
+        exit(EXIT_FAILURE);
+      }
+      for (i = 0; i < numberRxed; i++)
+      {
+        //A GRO entry holds back to back msgs of segmentSizes[i] bytes (the last may be shorter)
+        char *msgPtr = (char *)getBatchBuffer(rxBatch, i);
+        int remaining = (int)rxBatch->msgs[i].msg_len;
+        int segmentSize = (rxBatch->segmentSizes[i] > 0) ? (int)rxBatch->segmentSizes[i] : remaining;
+        do
+        {
+          int msgSize = (remaining < segmentSize) ? remaining : segmentSize;
+          //More msgs than tx entries: send the replies so far
+          if (numberReplies == (int)txBatch->batchSize)
           {
-            if (traceLevel == 2)
-              printf("#TRACE mode2 seq %ld:\n", rxHeader->sequenceNum);
+            if ((sendMsgBatch(sock, txBatch, numberReplies) == ERROR) && runFlag)
+            {
+              printf("UDPPingServer:  sendMsgBatch failed \n");
+              close(sock);
+              exit(EXIT_FAILURE);
+            }
+            numberReplies = 0;
           }
-          if (rc == ERROR)
+          s->numberIterations++;
+          replySize = handleMessage(w, msgPtr, msgSize, (struct sockaddr *)&rxBatch->addrs[i], wallTime,
+                                    &rxBatch->rxTimes[i], &w->ackArray[numberReplies], &replyPtr);
+          if (replySize > 0)
           {
-            printf("UDPPingServer:  sendMsg failed \n");
-            close(sock);
-            exit(EXIT_FAILURE);
+            txBatch->iovecs[numberReplies].iov_base = replyPtr;
+            txBatch->iovecs[numberReplies].iov_len = (size_t)replySize;
+            txBatch->msgs[numberReplies].msg_hdr.msg_name = &rxBatch->addrs[i];
+            txBatch->msgs[numberReplies].msg_hdr.msg_namelen = rxBatch->msgs[i].msg_hdr.msg_namelen;
+            numberReplies++;
           }
+          msgPtr += msgSize;
+          remaining -= msgSize;
+        } while (remaining > 0);
+      }
+      if (numberReplies > 0)
+      {
+        if ((sendMsgBatch(sock, txBatch, numberReplies) == ERROR) && runFlag)
+        {
+          printf("UDPPingServer:  sendMsgBatch failed \n");
+          close(sock);
+          exit(EXIT_FAILURE);
         }
       }
+      rc = NOERROR;
     }
-    else
+  }
+  return NULL;
+}
+
+/***********************************************************
+* Function: void *workerLoopUring(serverWorker *w)
+*
+* Explanation:  The receive/reply loop of a worker with io_uring.
+*               One multishot recvmsg fills the buffers of the pool;
+*               the reply to the msg in buffer i is a sendmsg from
+*               sendSlots[i] (mode 0: from the buffer itself) and the
+*               buffer goes back to the pool when the send completes.
+*               Each pass submits the replies and waits for the next
+*               completions with one io_uring_enter.
+*
+* inputs:
+*    serverWorker *w
+*
+* notes:
+*    The replies of a pass are hard linked so they leave in arrival
+*    order (a failed send does not cancel the rest).
+*
+**************************************************/
+void *workerLoopUring(serverWorker *w)
+{
+  serverStats *s = &w->stats;
+  uringContext *u = w->uring;
+  struct io_uring_cqe *cqe = NULL;
+  struct io_uring_sqe *lastSend = NULL;
+  struct io_uring_recvmsg_out *out = NULL;
+  struct msghdr controlMsg;
+  struct timespec rxTS;
+  uringSendSlot *slot = NULL;
+  void *replyPtr = NULL;
+  char *bufPtr = NULL;
+  char *msgPtr = NULL;
+  int replySize = 0;
+  uint32_t bufferID = 0;
+  double wallTime = -1.0;
+  bool recvArmed = false;
+
+  memset(&w->recvMsg, 0, sizeof(w->recvMsg));
+  w->recvMsg.msg_namelen = sizeof(struct sockaddr_storage);
+  w->recvMsg.msg_controllen = TIMESTAMP_CONTROL_SIZE;
+  memset(&controlMsg, 0, sizeof(controlMsg));
+  //Completes on CNT-C (submitted with the first recv)
+  uringPrepPoll(u, wakeFD, EPOLLIN, URING_WAKE_TAG);
+
+  while (runFlag)
+  {
+    //The recv ends when the pool is empty (or an error):  it is armed again
+    if (!recvArmed)
     {
-      printf("%s(Version:%s): Loop should break....numberIterations:%d  \n",
-             argv[0], getVersion(), numberIterations);
-      break;
+      if (uringPrepRecvMsgMultishot(u, w->sock, &w->recvMsg, URING_RECV_TAG) == ERROR)
+        uringSubmit(u, 0);
+      else
+        recvArmed = true;
+    }
+    //The last reply ends the chain
+    if (lastSend != NULL)
+      lastSend->flags &= ~IOSQE_IO_HARDLINK;
+    lastSend = NULL;
+    if ((uringSubmit(u, 1) == ERROR) && runFlag)
+    {
+      printf("UDPPingServer:  worker %d io_uring_enter failed \n", w->workerID);
+      close(w->sock);
+      exit(EXIT_FAILURE);
+    }
+    s->lastRxTime = getTimestampD();
+    if (s->startTime == -1.0)
+      s->startTime = s->lastRxTime;
+    wallTime = getCurTimeD();
+    archiveIdleSessions(w->sessions, wallTime, SESSION_IDLE_TIMEOUT);
+
+    while ((cqe = uringPeekCQE(u)) != NULL)
+    {
+      //CNT-C:  runFlag is cleared
+      if (cqe->user_data == URING_WAKE_TAG)
+      {
+        uringCQESeen(u);
+        continue;
+      }
+      if (cqe->user_data != URING_RECV_TAG)
+      {
+        //A reply was sent:  its buffer goes back to the pool
+        if ((cqe->res < 0) && (traceLevel > 1))
+          printf("UDPPingServer:  worker %d reply send failed,  errno:%d \n", w->workerID, -cqe->res);
+        uringRecycleBuffer(u, (uint32_t)cqe->user_data);
+        uringCQESeen(u);
+        continue;
+      }
+      if (!(cqe->flags & IORING_CQE_F_MORE))
+        recvArmed = false;
+      //0:  the socket was shut down (CNTCHandler)
+      if (cqe->res <= 0)
+      {
+        if (cqe->res == -ENOBUFS)
+          u->numberNoBuffers++;
+        else if (cqe->res < 0)
+          printf("UDPPingServer:  worker %d recvmsg failed,  errno:%d \n", w->workerID, -cqe->res);
+        uringCQESeen(u);
+        continue;
+      }
+      bufferID = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+      bufPtr = uringGetBuffer(u, bufferID);
+      out = (struct io_uring_recvmsg_out *)bufPtr;
+      controlMsg.msg_control = bufPtr + sizeof(*out) + w->recvMsg.msg_namelen;
+      controlMsg.msg_controllen = out->controllen;
+      msgPtr = (char *)controlMsg.msg_control + w->recvMsg.msg_controllen;
+      getCmsgTimestamp(&controlMsg, &rxTS);
+      uringCQESeen(u);
+
+      s->numberIterations++;
+      slot = &w->sendSlots[bufferID];
+      replySize = handleMessage(w, msgPtr, (int)out->payloadlen, (struct sockaddr *)(bufPtr + sizeof(*out)),
+                                wallTime, &rxTS, &slot->ack, &replyPtr);
+      if (replySize <= 0)
+      {
+        uringRecycleBuffer(u, bufferID);
+        continue;
+      }
+      slot->iov.iov_base = replyPtr;
+      slot->iov.iov_len = (size_t)replySize;
+      slot->msg.msg_name = bufPtr + sizeof(*out);
+      slot->msg.msg_namelen = out->namelen;
+      slot->msg.msg_iov = &slot->iov;
+      slot->msg.msg_iovlen = 1;
+      //The submission queue is full:  submit what is queued (ending the chain)
+      while (uringPrepSendMsg(u, w->sock, &slot->msg, bufferID, true) == ERROR)
+      {
+        if (lastSend != NULL)
+          lastSend->flags &= ~IOSQE_IO_HARDLINK;
+        uringSubmit(u, 0);
+      }
+      lastSend = &u->sqes[(u->sqLocalTail - 1) & u->sqMask];
     }
+    uringPublishBuffers(u);
   }
-  exitProcessing(rc, getCurTimeD());
-  if (traceLevel > 1)
+  return NULL;
+}
+
+/***********************************************************
+* Function: void mergeWorkerStats(serverStats *totalPtr)
+*
+* Explanation:  Combines the counters of all workers.  Sums are
+*               added, the averages are weighted by each worker's
+*               number of msgs.  The workers may still be running,
+*               so the result is a snapshot.
+*
+* inputs:
+*    serverStats *totalPtr : filled in with the merged counters
+*
+**************************************************/
+void mergeWorkerStats(serverStats *totalPtr)
+{
+  uint32_t i;
+
+  memset(totalPtr, 0, sizeof(serverStats));
+  totalPtr->startTime = -1.0;
+  totalPtr->lastRxTime = -1.0;
+  if (workers == NULL)
+    return;
+
+  for (i = 0; i < numberWorkers; i++)
   {
-    printf("%s(Version:%s): Exiting rc: %d, numberIterations:%d  \n",
-           argv[0], getVersion(), rc, numberIterations);
+    serverStats *s = &workers[i].stats;
+    double weight = (double)s->numberMessages;
+
+    totalPtr->numberIterations += s->numberIterations;
+    totalPtr->numberMessages += s->numberMessages;
+    totalPtr->dropEstimate += s->dropEstimate;
+    totalPtr->outOfOrderArrivals += s->outOfOrderArrivals;
+    totalPtr->duplicateArrivals += s->duplicateArrivals;
+    addLossRunStats(&totalPtr->loss, &s->loss);
+    totalPtr->totalBytesRxed += s->totalBytesRxed;
+    totalPtr->avgQuality += s->avgQuality * weight;
+    totalPtr->avgRSSI += s->avgRSSI * weight;
+    totalPtr->avgOwd += s->avgOwd * weight;
+    if ((s->startTime != -1.0) && ((totalPtr->startTime == -1.0) || (s->startTime < totalPtr->startTime)))
+      totalPtr->startTime = s->startTime;
+    if (s->lastRxTime > totalPtr->lastRxTime)
+    {
+      //The most recent msg gives the mode and the last seq numbers
+      totalPtr->lastRxTime = s->lastRxTime;
+      totalPtr->mode = s->mode;
+      totalPtr->RxSeqNumber = s->RxSeqNumber;
+      totalPtr->lastSeqNumber = s->lastSeqNumber;
+    }
+  }
+  if (totalPtr->numberMessages > 0)
+  {
+    totalPtr->avgQuality /= totalPtr->numberMessages;
+    totalPtr->avgRSSI /= totalPtr->numberMessages;
+    totalPtr->avgOwd /= totalPtr->numberMessages;
   }
-  exit(rc);
 }
 
 /***********************************************************
 * Function: void CNTCHandler() 
 *
-* Explanation:  This is called when a SIGTERM is received
+* Explanation:  This is called when a SIGINT is received
 *               This occurs when the program terminates with a CNT-C input.
+*               Clears runFlag, shuts down the workers' sockets so their
+*               receives return and signals wakeFD (io_uring workers);
+*               main joins the workers, displays
+*               the stats (printRunStats) and exits.
 *
 * inputs:   
 *        none
@@ -300,15 +940,45 @@ int main(int argc, char *argv[])
 *        none 
 *
 * notes: 
+*   Runs on the main thread (the other threads block SIGINT) and
+*   only does async signal safe work.  SHUT_RD:  a reply still being
+*   sent does not raise SIGPIPE.
 *
 *************************************************/
 void CNTCHandler()
 {
-  int rc = NOERROR;
+  uint32_t i;
+
   runFlag = false;
+  for (i = 0; (workers != NULL) && (i < numberWorkers); i++)
+  {
+    if (workers[i].sock != -1)
+      shutdown(workers[i].sock, SHUT_RD);
+  }
+  if (wakeFD != -1)
+    signalEventWake(wakeFD);
+}
+
+/***********************************************************
+* Function: void printRunStats() 
+*
+* Explanation:  Displays the merged stats of the workers (once
+*               they have ended):  the averages and the OWD histogram.
+*
+* inputs:   
+*        none
+* outputs:
+*        none 
+*
+*************************************************/
+void printRunStats()
+{
+  serverStats total;
+
+  mergeWorkerStats(&total);
   if (traceLevel > 1)
   {
-    printf("CNTCHandler: numberIterations:%d  \n", numberIterations);
+    printf("printRunStats: numberIterations:%d  \n", total.numberIterations);
   }
 
   time_t rawtime;
@@ -319,10 +989,22 @@ void CNTCHandler()
   double testDuration = servFinishTime - servStartTime;
 
   printf("\nCurrent time %s, Duration of the test %f secs, mode %d, number of samples %d, avg One way delay %f, estimate of number lost %d,throughput %f, avg Quality Level %f, avg RSSI %f \n",
-   asctime(timeinfo), testDuration, mode, numberMessages, avgOwd, dropEstimate, totalBytesRxed / testDuration,avgQuality,avgRSSI);
+   asctime(timeinfo), testDuration, total.mode, total.numberMessages, total.avgOwd, total.dropEstimate,
+   total.totalBytesRxed / testDuration, total.avgQuality, total.avgRSSI);
 
-  exitProcessing(rc, getCurTimeD());
-  exit(0);
+  //The workers' histograms merged
+  latencyHistogram *owdHist = createLatencyHistogram();
+  uint32_t i;
+  if ((owdHist != NULL) && (workers != NULL))
+  {
+    for (i = 0; i < numberWorkers; i++)
+    {
+      if (workers[i].owdHist != NULL)
+        latencyHistogramMerge(owdHist, workers[i].owdHist);
+    }
+    printLatencyHistogram(owdHist, "OWD", stdout);
+  }
+  freeLatencyHistogram(owdHist);
 }
 
 /***********************************************************
@@ -339,6 +1021,7 @@ void CNTCHandler()
 *        none 
 *
 * notes: 
+*   Called once every worker has ended (main joins them).
 *
 **************************************************/
 void exitProcessing(int errorStatus, double curTime)
@@ -346,20 +1029,38 @@ void exitProcessing(int errorStatus, double curTime)
   double sessionDuration = 0.0;
   double avgRxRate = 0.0;
   double avgLossRate = 0.0;
+  serverStats total;
+  uint32_t i;
 
-  finishTime = lastRxTime;
-  sessionDuration = finishTime - startTime;
-  avgRxRate = totalBytesRxed * 8 / sessionDuration;
-  avgLossRate = dropEstimate / (numberIterations);
+  mergeWorkerStats(&total);
+  finishTime = total.lastRxTime;
+  sessionDuration = finishTime - total.startTime;
+  avgRxRate = total.totalBytesRxed * 8 / sessionDuration;
+  if (total.numberIterations > 0)
+    avgLossRate = (double)total.dropEstimate / (double)total.numberIterations;
 
-  if (sock != -1)
+  for (i = 0; (workers != NULL) && (i < numberWorkers); i++)
   {
-    close(sock);
+    if (workers[i].sock != -1)
+      close(workers[i].sock);
   }
-
-  if (RxBufPtr != NULL)
+  stopTSCRecalibration();
+  //The reporter reads the workers' epochs
+  stopIntervalReporter(reporter);
+  reporter = NULL;
+  //The listener goes first:  it reads the records
+  if (metrics != NULL)
+  {
+    if (traceLevel == 0)
+      printMetricsServer(metrics, stdout);
+    stopMetricsServer(metrics);
+    metrics = NULL;
+  }
+  if (traceFileName != NULL)
   {
-    free(RxBufPtr);
+    stopTraceLogger();
+    if (getTraceDrops() > 0)
+      printf("UDPEchoServer: WARNING %lu trace records dropped (ring full) \n", (unsigned long)getTraceDrops());
   }
 
   if (errorStatus == ERROR)
@@ -370,19 +1071,421 @@ void exitProcessing(int errorStatus, double curTime)
     {
       printf("%f %f %9.0f %1.4f %d %d %d %d \n",
              curTime, sessionDuration, avgRxRate, avgLossRate,
-             numberMessages, RxSeqNumber, outOfOrderArrivals, dropEstimate);
+             total.numberMessages, total.RxSeqNumber, total.outOfOrderArrivals, total.dropEstimate);
     }
     if (traceLevel == 0)
     {
       printf("UDPEchoServer Results(%f): duration:%f avgRxRate:%9.0f bps avgLossRate:%1.4f \n",
              curTime, sessionDuration, avgRxRate, avgLossRate);
-      printf("totalArrivals:%d, last RxSeqNumber:%d, outOfOrders:%d, drops:%d \n",
-             numberMessages, RxSeqNumber, outOfOrderArrivals, dropEstimate);
+      printf("totalArrivals:%d, last RxSeqNumber:%d, outOfOrders:%d, duplicates:%d, drops:%d \n",
+             total.numberMessages, total.RxSeqNumber, total.outOfOrderArrivals, total.duplicateArrivals,
+             total.dropEstimate);
+      //The sessions' lines (printSession) include the runs still in their windows
+      printLossRunStats(&total.loss, sessionDuration, stdout);
+      if (numberWorkers > 1)
+      {
+        for (i = 0; i < numberWorkers; i++)
+          printf("worker %d (cpu %d): arrivals:%d, outOfOrders:%d, drops:%d, avgOwd:%f \n",
+                 i, workers[i].cpu, workers[i].stats.numberMessages, workers[i].stats.outOfOrderArrivals,
+                 workers[i].stats.dropEstimate, workers[i].stats.avgOwd);
+      }
+      //One line per client: see printSession
+      for (i = 0; i < numberWorkers; i++)
+      {
+        printf("worker %d sessions: active:%d archived:%d \n", i,
+               getNumberActiveSessions(workers[i].sessions),
+               getNumberSessions(workers[i].sessions) - getNumberActiveSessions(workers[i].sessions));
+        printAllSessions(workers[i].sessions, curTime, stdout);
+        if (workers[i].uring != NULL)
+          printUring(workers[i].uring, stdout);
+      }
     }
   }
+
+  //The segment is removed last:  the workers that write its records have
+  //been joined and the HTTP thread that reads them stopped.  The collectors
+  //see the server is gone.
+  if (liveStats != NULL)
+  {
+    statsExport *e = liveStats;
+    liveStats = NULL;
+    freeStatsExport(e);
+  }
 }
 
 double gettimestampD(uint32_t sec, uint32_t nsec)
 {
   return (double)sec + (double)nsec / 1000000000;
 }
+
+/***********************************************************
+* Function: int handleMessage(serverWorker *w, char *msgPtr, int bytesRxed, struct sockaddr *clntAddrPtr,
+*                  double wallTime, struct timespec *rxTSPtr, probeACK *ackPtr, void **replyPtrPtr)
+*
+* Explanation:  Updates the worker's counters with a msg that just
+*               arrived and builds the reply the msg's mode asks for.
+*               Used by both the single msg and the batched loop.
+*
+* inputs:
+*    serverWorker *w : the worker that received the msg
+*    char *msgPtr : the msg (a probe header (decodeProbe) followed by data)
+*    int bytesRxed : its size
+*    struct sockaddr *clntAddrPtr : the sender
+*    double wallTime : the arrival time (trace output)
+*    struct timespec *rxTSPtr : kernel/NIC rx stamp.  0,0: none, the one way
+*                               delay uses the current CLOCK_REALTIME
+*    probeACK *ackPtr : storage for a mode 1 ACK
+*    void **replyPtrPtr : set to the reply (msgPtr itself in mode 0, ackPtr in mode 1)
+*
+* outputs:
+*        returns the size of the reply, 0 if no reply is to be sent
+*
+* notes:
+*    In mode 0 the msg is rewritten in place (the server rx/tx times)
+*    so it must not be reused before the reply is sent.
+*    The reply is in the probe's wire format (a legacy probe gets a
+*    TGIFHeartbeat echo or a TGIFACK).  Msgs that are not a probe (or
+*    are smaller than their header) are ignored.
+*
+**************************************************/
+int handleMessage(serverWorker *w, char *msgPtr, int bytesRxed, struct sockaddr *clntAddrPtr,
+                  double wallTime, struct timespec *rxTSPtr, probeACK *ackPtr, void **replyPtrPtr)
+{
+  serverStats *s = &w->stats;
+  probeHeader rxHeader;
+  int format;
+  int replySize = 0;
+  struct timespec ts;
+  double rxTime = 0.0;
+  double clientOffset = 0.0;
+  struct in_addr clientIP;
+  uint16_t clientPort = 0;
+  session *client = NULL;
+  int rxClass;
+  intervalCounters *counts = NULL;
+  uint32_t gap = 0;
+  bool late = false;
+
+  *replyPtrPtr = NULL;
+  //The reply timestamps are placed in the header
+  format = decodeProbe(msgPtr, bytesRxed, &rxHeader);
+  if (format == ERROR)
+  {
+    if (traceLevel > 1)
+      printf("UDPPingServer: ignored a %d byte msg (not a probe or less than its header) \n", bytesRxed);
+    return 0;
+  }
+  s->totalBytesRxed += bytesRxed;
+  s->numberMessages += 1;
+  int32_t quality = rxHeader.SignalQuality;
+  int32_t RSSI = rxHeader.RSSI;
+  s->avgQuality += (quality - s->avgQuality) / s->numberMessages;
+  s->avgRSSI += (RSSI - s->avgRSSI) / s->numberMessages;
+  s->mode = rxHeader.mode;
+  s->RxSeqNumber = rxHeader.seq;
+  if (traceLevel == 2)
+    printf("#TRACE nsec %lu\n", (unsigned long)(rxHeader.txTime % 1000000000ULL));
+#ifdef TRACEME
+  PrintSocketAddress(clntAddrPtr, stdout);
+  fputc('\n', stdout);
+#endif
+  if (traceLevel > 1)
+  {
+    printf("UDPPingServer: RxSeqNumber:%d,  %d bytes, client: ", s->RxSeqNumber, bytesRxed);
+    PrintSocketAddress(clntAddrPtr, stdout);
+    fputc('\n', stdout);
+  }
+  getCurTimeTS(&ts);
+  if ((rxTSPtr->tv_sec != 0) || (rxTSPtr->tv_nsec != 0))
+    rxTime = gettimestampD(rxTSPtr->tv_sec, rxTSPtr->tv_nsec);
+  else
+    rxTime = gettimestampD(ts.tv_sec, ts.tv_nsec);
+  //The client's clock offset estimate (modes 0,1) moves its send time to our clock
+  clientOffset = (double)rxHeader.clockOffset / 1000000.0;
+  double owd = rxTime - (wireNsToD(rxHeader.txTime) + clientOffset);
+  s->avgOwd += (owd - s->avgOwd) / s->numberMessages;
+  latencyHistogramAdd(w->owdHist, owd);
+  //-interval:  the msg is counted in the worker's current epoch
+  if (w->interval != NULL)
+  {
+    counts = intervalBegin(w->interval);
+    counts->numberReceived++;
+    counts->bytesReceived += bytesRxed;
+    latencyHistogramAdd(&counts->hists[0], owd);
+  }
+
+  //Native IPv6 clients are keyed by a fold of their address
+  GetIPv4AddrPort(clntAddrPtr, &clientIP, &clientPort);
+  client = getActive(w->sessions, clientIP, clientPort);
+  if (client != NULL)
+  {
+    //The client's flow classifies the seq (its gap, a reorder or a duplicate)
+    client->mode = rxHeader.mode;
+    client->flow.lossTotals = &s->loss;
+    client->flow.lossInterval = (counts != NULL) ? &counts->loss : NULL;
+    rxClass = updateSessionRx(client, s->RxSeqNumber, (uint32_t)bytesRxed, rxTime, owd);
+    if (rxClass == FLOW_IN_ORDER)
+    {
+      s->dropEstimate += client->flow.lastGap;
+      s->lastSeqNumber = s->RxSeqNumber;
+      gap = client->flow.lastGap;
+    }
+    else if (rxClass == FLOW_DUPLICATE)
+      s->duplicateArrivals++;
+    else
+    {
+      //A late msg was counted as a drop when its gap was seen
+      s->outOfOrderArrivals++;
+      if (s->dropEstimate > 0)
+        s->dropEstimate--;
+      late = true;
+    }
+  }
+  //No session:  only the worker's last seq
+  else if (s->RxSeqNumber <= s->lastSeqNumber)
+  {
+    s->outOfOrderArrivals++;
+    if (s->dropEstimate > 0)
+      s->dropEstimate--;
+    late = true;
+  }
+  else
+  {
+    gap = s->RxSeqNumber - s->lastSeqNumber - 1;
+    s->dropEstimate += gap;
+    s->lastSeqNumber = s->RxSeqNumber;
+  }
+  if (counts != NULL)
+  {
+    counts->numberLost += gap;
+    if (late)
+      counts->numberLate++;
+    intervalEnd(w->interval);
+  }
+  if (traceLevel == 2)
+    printf("#TRACE owd : %f", owd);
+  //One printf per line so the lines of different workers do not mix
+  if ((traceLevel >= 1) && (traceFileName == NULL))
+  {
+    printf("%f,%d,%d,%d,%d,%d,%9.0f,%d,%f\n",
+           wallTime, s->RxSeqNumber, s->lastSeqNumber,
+           s->numberMessages, s->outOfOrderArrivals, s->dropEstimate,
+           s->totalBytesRxed, s->numberIterations, owd);
+  }
+  else if (traceLevel >= 1)
+  {
+    traceRecord r;
+    r.recordType = TRACE_SERVER_RX;
+    r.source = (uint16_t)w->workerID;
+    r.seq = s->RxSeqNumber;
+    r.txTime = rxTime - owd;
+    r.rxTime = rxTime;
+    r.bytes = (uint32_t)bytesRxed;
+    r.RSSI = RSSI;
+    r.u.server.totalBytesRxed = s->totalBytesRxed;
+    r.u.server.lastSeqNumber = s->lastSeqNumber;
+    r.u.server.numberMessages = s->numberMessages;
+    r.u.server.outOfOrderArrivals = s->outOfOrderArrivals;
+    r.u.server.dropEstimate = s->dropEstimate;
+    r.u.server.numberIterations = s->numberIterations;
+    r.u.server.SignalQuality = quality;
+    traceLog(w->workerID, &r);
+  }
+  //The reply carries the arrival time (T2) and the send time (T3) of the exchange
+  if ((rxTSPtr->tv_sec != 0) || (rxTSPtr->tv_nsec != 0))
+    ts = *rxTSPtr;
+  if (s->mode == 0)
+  {
+    struct timespec txTS;
+    getCurTimeTS(&txTS);
+    encodeProbeEcho(msgPtr, format, timespecToWireNs(&ts), timespecToWireNs(&txTS));
+    *replyPtrPtr = msgPtr;
+    replySize = bytesRxed;
+  }
+  else if (s->mode == 1)
+  {
+    struct timespec txTS;
+    getCurTimeTS(&txTS);
+    replySize = encodeProbeACK(ackPtr, &rxHeader, timespecToWireNs(&ts), timespecToWireNs(&txTS));
+    *replyPtrPtr = ackPtr;
+  }
+  else if (s->mode == 2)
+  {
+    if (traceLevel == 2)
+      printf("#TRACE mode2 seq %u:\n", rxHeader.seq);
+  }
+  if (replySize > 0)
+    intervalSent(w->interval, 1, (uint32_t)replySize);
+  if (liveStats != NULL)
+    publishStats(w, client, owd, replySize, wallTime);
+  return replySize;
+}
+
+/***********************************************************
+* Function: void publishStats(serverWorker *w, session *client, double owd,
+*                             int replySize, double wallTime)
+*
+* Explanation:  Publishes the worker's and the session's counters
+*               (-shm, -metrics) after a msg.  The record of the
+*               session's slab entry is (re)opened when the entry
+*               holds a new client.
+*
+* inputs:
+*    serverWorker *w : the worker (the records' only writer)
+*    session *client : the msg's session (NULL: none)
+*    double owd : the msg's one way delay
+*    int replySize : the reply's size (0: none)
+*    double wallTime : the arrival time
+*
+**************************************************/
+void publishStats(serverWorker *w, session *client, double owd, int replySize, double wallTime)
+{
+  serverStats *s = &w->stats;
+  uint32_t index = 0;
+  statsRecord *r = w->liveRecord;
+  char recordName[STATS_NAME_SIZE];
+
+  if (r != NULL)
+  {
+    statsRecordBegin(r);
+    r->numberRxed = s->numberMessages;
+    r->bytesRxed = (uint64_t)s->totalBytesRxed;
+    r->numberLost = s->dropEstimate;
+    r->numberLate = s->outOfOrderArrivals;
+    if (replySize > 0)
+    {
+      r->numberSent++;
+      r->bytesSent += replySize;
+    }
+    statsRecordAddLatency(r, owd);
+    statsRecordEnd(r, wallTime);
+  }
+
+  if (client == NULL)
+    return;
+  index = numberWorkers + (uint32_t)(client - w->sessions->slab) * numberWorkers + w->workerID;
+  r = statsExportRecord(liveStats, index);
+  if (r == NULL)
+    return;
+  if ((r->state != STATS_RECORD_ACTIVE) || (r->id != client->sessionID))
+  {
+    snprintf(recordName, sizeof(recordName), "%s:%d", inet_ntoa(client->clientIP), ntohs(client->clientPort));
+    r = statsExportOpenRecord(liveStats, index, client->sessionID, STATS_KIND_SESSION, recordName, wallTime);
+  }
+  statsRecordBegin(r);
+  r->numberRxed = client->messagesReceived;
+  r->bytesRxed = (uint64_t)client->bytesReceived;
+  r->numberLost = client->messagesLost;
+  r->numberLate = client->outOfOrderArrival;
+  if (replySize > 0)
+  {
+    r->numberSent++;
+    r->bytesSent += replySize;
+  }
+  statsRecordAddLatency(r, owd);
+  statsRecordEnd(r, wallTime);
+}
+
+/***********************************************************
+* Function: int parseOptions(int argc, char *argv[])
+*
+* Explanation:  Handles the optional named params (-name value)
+*               that follow the positional params.  The named
+*               params set the corresponding globals.
+*
+* inputs:
+*     int argc, char *argv[] : as passed to main
+*
+* outputs:
+*        returns the number of positional params (including argv[0]).
+*        Exits on an unknown or incomplete option.
+*
+**************************************************/
+int parseOptions(int argc, char *argv[])
+{
+  int i = 1;
+  int numberPositional = argc;
+
+  //The first named option ends the positional params
+  while (i < argc)
+  {
+    if ((argv[i][0] == '-') && isalpha((unsigned char)argv[i][1]))
+    {
+      if (numberPositional == argc)
+        numberPositional = i;
+      if (i + 1 >= argc)
+      {
+        printf("%s: option %s requires a value \n", argv[0], argv[i]);
+        exit(EXIT_FAILURE);
+      }
+      if (strcmp(argv[i], "-batch") == 0)
+        batchSize = (uint32_t)atoi(argv[i + 1]);
+      else if (strcmp(argv[i], "-ts") == 0)
+      {
+        timestampMode = parseTimestampMode(argv[i + 1]);
+        if (timestampMode == ERROR)
+        {
+          printf("%s: -ts must be none, sw or hw \n", argv[0]);
+          exit(EXIT_FAILURE);
+        }
+      }
+      else if (strcmp(argv[i], "-tsif") == 0)
+        timestampIFName = argv[i + 1];
+      else if (strcmp(argv[i], "-threads") == 0)
+        numberWorkers = (uint32_t)atoi(argv[i + 1]);
+      else if (strcmp(argv[i], "-sessions") == 0)
+        maxSessions = (uint32_t)atoi(argv[i + 1]);
+      else if (strcmp(argv[i], "-tracefile") == 0)
+        traceFileName = argv[i + 1];
+      else if (strcmp(argv[i], "-interval") == 0)
+      {
+        int numberWindows = parseIntervalWindows(argv[i + 1], reportWindows, INTERVAL_MAX_WINDOWS);
+        if (numberWindows == ERROR)
+          exit(EXIT_FAILURE);
+        numberReportWindows = (uint32_t)numberWindows;
+      }
+      else if (strcmp(argv[i], "-shm") == 0)
+        shmName = argv[i + 1];
+      else if (strcmp(argv[i], "-metrics") == 0)
+        metricsService = argv[i + 1];
+      else if (strcmp(argv[i], "-io") == 0)
+      {
+        if (strcmp(argv[i + 1], "uring") == 0)
+          useUring = true;
+        else if (strcmp(argv[i + 1], "socket") != 0)
+        {
+          printf("%s: -io must be socket or uring \n", argv[0]);
+          exit(EXIT_FAILURE);
+        }
+      }
+      else if (strcmp(argv[i], "-gro") == 0)
+        useGRO = (atoi(argv[i + 1]) != 0);
+      else if (strcmp(argv[i], "-clock") == 0)
+      {
+        if (strcmp(argv[i + 1], "tsc") == 0)
+          useTSCClock = true;
+        else if (strcmp(argv[i + 1], "gettime") != 0)
+        {
+          printf("%s: -clock must be gettime or tsc \n", argv[0]);
+          exit(EXIT_FAILURE);
+        }
+      }
+      else
+      {
+        printf("%s: unknown option %s \n", argv[0], argv[i]);
+        exit(EXIT_FAILURE);
+      }
+      i += 2;
+    }
+    else
+    {
+      if (numberPositional != argc)
+      {
+        printf("%s: positional param %s must precede the named options \n", argv[0], argv[i]);
+        exit(EXIT_FAILURE);
+      }
+      i++;
+    }
+  }
+  return numberPositional;
+}
@@ -0,0 +1,97 @@
+/*********************************************************
+*
+* Module Name: UDPPingStats
+*
+* File Name:  UDPPingStats.c
+*
+* Params:
+*       shm name   :  the -shm name of a running UDPPingClient or UDPPingServer
+*       interval   :  optional....seconds between samples (default 1.0)
+*       count      :  optional....number of samples (default 1, 0: until the
+*                     writer exits)
+*
+* Summary:  Samples the live stats a client or server publishes in
+*           shared memory (-shm) and prints one line per active
+*           record (target or session) each sample:
+*
+*   name,sent,rxed,lost,late,lossRate,avg,min,max,p50,p99,age
+*
+*   The latencies (seconds) are the client's RTTs or the server's
+*   one way delays.  p50/p99 are the upper edges of their histogram
+*   bins.  age is the seconds since the record's last update.
+*
+* Notes:
+*   The reader only maps the segment read only and copies the
+*   records (seqlock):  the writer does no extra work when it is
+*   sampled.  A sample line starts with '#'.
+*
+* Invocation example:
+*   ./UDPPingClient host 5000 1000 10000 0 0 -shm udpping &
+*   ./UDPPingStats udpping 1 10
+*
+* Last update: 10/17/2026
+*
+*********************************************************/
+#include "./commonCode/common.h"
+#include "./commonCode/statsExport.h"
+#include "./commonCode/delayHelper.h"
+
+int main(int argc, char *argv[])
+{
+  statsExport *e = NULL;
+  statsRecord r;
+  double interval = 1.0;
+  double now = 0.0;
+  int count = 1;
+  int sample;
+  uint32_t i;
+  uint32_t numberRecords = 0;
+  uint32_t numberActive = 0;
+
+  if ((argc < 2) || (argc > 4)) {
+    printf("%s: Usage: <shm name> [interval secs] [count] \n", argv[0]);
+    exit(EXIT_FAILURE);
+  }
+  if (argc > 2)
+    interval = atof(argv[2]);
+  if (argc > 3)
+    count = atoi(argv[3]);
+
+  e = openStatsExport(argv[1]);
+  if (e == NULL)
+    exit(EXIT_FAILURE);
+
+  for (sample = 0; (count == 0) || (sample < count); sample++) {
+    if (sample > 0)
+      myDelayD(interval);
+    //The writer removed the segment (it exited):  our mapping stays valid
+    if ((e->header->pid > 0) && (kill(e->header->pid, 0) < 0) && (errno == ESRCH)) {
+      printf("#%s: pid %d exited \n", argv[1], e->header->pid);
+      break;
+    }
+    now = getCurTimeD();
+    numberRecords = __atomic_load_n(&e->header->numberRecords, __ATOMIC_ACQUIRE);
+    if (numberRecords > e->header->maxRecords)
+      numberRecords = e->header->maxRecords;
+    numberActive = 0;
+    for (i = 0; i < numberRecords; i++) {
+      if (statsReadRecord(e, i, &r) == ERROR)
+        continue;
+      numberActive++;
+      printf("%s,%lu,%lu,%lu,%lu,%1.4f,%1.9f,%1.9f,%1.9f,%1.9f,%1.9f,%1.3f\n",
+             r.name, (unsigned long)r.numberSent, (unsigned long)r.numberRxed,
+             (unsigned long)r.numberLost, (unsigned long)r.numberLate,
+             ((r.numberRxed + r.numberLost) > 0) ? (double)r.numberLost / (double)(r.numberRxed + r.numberLost) : 0.0,
+             (r.latencyCount > 0) ? r.latencySum / (double)r.latencyCount : 0.0,
+             r.latencyMin, r.latencyMax,
+             statsRecordPercentile(&r, 50.0), statsRecordPercentile(&r, 99.0),
+             now - r.updateTime);
+    }
+    printf("#%f %s %s pid:%d records:%d active:%d \n", now, argv[1],
+           (e->header->role == STATS_ROLE_SERVER) ? "server" : "client",
+           e->header->pid, numberRecords, numberActive);
+    fflush(stdout);
+  }
+  freeStatsExport(e);
+  exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,95 @@
+/*********************************************************
+*
+* Module Name: traceToCSV
+*
+* File Name:  traceToCSV.c
+*
+* Params:
+*       trace file:  written by UDPPingClient or UDPPingServer (-tracefile)
+*
+* Summary:  Converts a binary trace file to the CSV lines the
+*           programs print at traceLevel 1 (to stdout).
+*
+*   client: wallTime,RTTSample,OWDSample,totalBytesSent,RxSeqNumber,numberSent,numberPacketLoss
+*   server: wallTime,RxSeqNumber,lastSeqNumber,numberMessages,outOfOrderArrivals,
+*           dropEstimate,totalBytesRxed,numberIterations,owd
+*
+* Notes:
+*   The wallTime column is the record's rxTime.
+*
+* Invocation example:
+*   ./traceToCSV client.trc > client.csv
+*
+* Last update: 10/17/2026
+*
+*********************************************************/
+#include "./commonCode/common.h"
+#include "./commonCode/traceLogger.h"
+
+//Records read per fread
+#define RECORDS_PER_READ 4096
+
+int main(int argc, char *argv[])
+{
+  FILE *traceFID = NULL;
+  traceFileHeader header;
+  traceRecord *records = NULL;
+  size_t numberRead = 0;
+  size_t i;
+  uint64_t numberRecords = 0;
+  uint64_t numberUnknown = 0;
+
+  if (argc != 2) {
+    printf("%s: Usage: <trace file> \n", argv[0]);
+    exit(EXIT_FAILURE);
+  }
+
+  traceFID = fopen(argv[1], "rb");
+  if (traceFID == NULL) {
+    printf("%s: failed to open %s, errno:%d \n", argv[0], argv[1], errno);
+    exit(EXIT_FAILURE);
+  }
+  if ((fread(&header, sizeof(header), 1, traceFID) != 1) ||
+      (memcmp(header.magic, TRACE_FILE_MAGIC, sizeof(header.magic)) != 0)) {
+    printf("%s: %s is not a trace file \n", argv[0], argv[1]);
+    exit(EXIT_FAILURE);
+  }
+  if ((header.version != TRACE_FILE_VERSION) || (header.recordSize != sizeof(traceRecord))) {
+    printf("%s: %s: unsupported version %d (record size %d) \n",
+           argv[0], argv[1], header.version, header.recordSize);
+    exit(EXIT_FAILURE);
+  }
+
+  records = malloc(RECORDS_PER_READ * sizeof(traceRecord));
+  if (records == NULL) {
+    printf("%s: malloc error \n", argv[0]);
+    exit(EXIT_FAILURE);
+  }
+
+  while ((numberRead = fread(records, sizeof(traceRecord), RECORDS_PER_READ, traceFID)) > 0) {
+    for (i = 0; i < numberRead; i++) {
+      traceRecord *r = &records[i];
+      if (r->recordType == TRACE_CLIENT_RTT)
+        printf("%f,%f,%f,%.0f,%d,%d,%d\n",
+               r->rxTime, r->rxTime - r->txTime, r->u.client.OWD,
+               r->u.client.totalBytesSent, r->seq, r->u.client.numberSent,
+               r->u.client.numberPacketLoss);
+      else if (r->recordType == TRACE_SERVER_RX)
+        printf("%f,%d,%d,%d,%d,%d,%9.0f,%d,%f\n",
+               r->rxTime, r->seq, r->u.server.lastSeqNumber,
+               r->u.server.numberMessages, r->u.server.outOfOrderArrivals,
+               r->u.server.dropEstimate, r->u.server.totalBytesRxed,
+               r->u.server.numberIterations, r->rxTime - r->txTime);
+      else
+        numberUnknown++;
+    }
+    numberRecords += numberRead;
+  }
+
+  if (numberUnknown > 0)
+    fprintf(stderr, "%s: %lu of %lu records have an unknown type \n",
+            argv[0], (unsigned long)numberUnknown, (unsigned long)numberRecords);
+  free(records);
+  fclose(traceFID);
+  exit(EXIT_SUCCESS);
+}
@@ -111,3 +111,45 @@ bool SockAddrsEqual(const struct sockaddr *addr1, const struct sockaddr *addr2)
   } else
     return false;
 }
+
+/***********************************************************
+* Function: bool GetIPv4AddrPort(const struct sockaddr *address,
+*                     struct in_addr *IPPtr, uint16_t *portPtr)
+*
+* Explanation:  Returns the IPv4 address and port (both in network
+*               byte order) of an AF_INET or a v4-mapped AF_INET6
+*               address (an IPv6 socket sees its IPv4 peers as
+*               ::ffff:a.b.c.d).
+*
+* inputs:
+*   const struct sockaddr *address
+*   struct in_addr *IPPtr, uint16_t *portPtr : callers vars to fill in
+*
+* outputs: returns true if the address is IPv4.  For a native
+*          IPv6 address, false is returned and the IP is the XOR of
+*          the four 32 bit words of the address (not unique).
+*
+**************************************************/
+bool GetIPv4AddrPort(const struct sockaddr *address, struct in_addr *IPPtr, uint16_t *portPtr)
+{
+  if (address->sa_family == AF_INET) {
+    const struct sockaddr_in *ipv4Addr = (const struct sockaddr_in *) address;
+    *IPPtr = ipv4Addr->sin_addr;
+    *portPtr = ipv4Addr->sin_port;
+    return true;
+  } else if (address->sa_family == AF_INET6) {
+    const struct sockaddr_in6 *ipv6Addr = (const struct sockaddr_in6 *) address;
+    uint32_t words[4];
+    memcpy(words, &ipv6Addr->sin6_addr, sizeof(words));
+    *portPtr = ipv6Addr->sin6_port;
+    if (IN6_IS_ADDR_V4MAPPED(&ipv6Addr->sin6_addr)) {
+      IPPtr->s_addr = words[3];
+      return true;
+    }
+    IPPtr->s_addr = words[0] ^ words[1] ^ words[2] ^ words[3];
+    return false;
+  }
+  IPPtr->s_addr = 0;
+  *portPtr = 0;
+  return false;
+}
@@ -27,6 +27,8 @@ int NumberOfAddresses(struct addrinfo *addrList);
 void PrintSocketAddress(const struct sockaddr *address, FILE *stream);
 // Test socket address equality
 bool SockAddrsEqual(const struct sockaddr *addr1, const struct sockaddr *addr2);
+// IPv4 address and port (network byte order) of a socket address
+bool GetIPv4AddrPort(const struct sockaddr *address, struct in_addr *IPPtr, uint16_t *portPtr);
 
 #ifndef LINUX
 #define INADDR_NONE 0xffffffff
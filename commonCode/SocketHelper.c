@@ -11,14 +11,29 @@
 * Revisions:
 *
 *  $A1: added support for get/set IP_TOS 
+*  $A2: added batched send/receive (sendmmsg/recvmmsg)
+*  $A3: added SO_TIMESTAMPING (kernel and NIC rx/tx timestamps)
+*  $A4: added SetupUDPServerSocketOpts (SO_REUSEPORT sharding)
+*  $A5: added UDP GSO sends (sendMsgGSO) and UDP GRO receives (enableUDPGRO)
+*  $A6: batch buffers are cache line aligned and pre-faulted
+*  $A7: added sendMsgBatchFrom (one partial batch send) and waitSocketWritable
 *  
-* Last update: 10/6/2019
+* Last update: 10/17/2026
 *
 *********************************************************/
+#define _GNU_SOURCE /* for sendmmsg/recvmmsg */
 #include "common.h"
 #include "utils.h"
 #include "AddressHelper.h"
 #include "SocketHelper.h"
+#include <poll.h>
+#ifdef LINUX
+#include <net/if.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#include <linux/sockios.h>
+#include <netinet/udp.h>
+#endif
 
 
 //#define TRACE 1
@@ -43,6 +58,8 @@
 *
 * outputs:
 *      returns EXIT_FAILURE or number of bytes received
+*      If the socket is non-blocking and no msg is waiting,
+*      EXIT_FAILURE is returned with errno EAGAIN.
 *      
 *    The caller's RxBuffer is filled in (pointed to by RxBufPtr) -up to msgSize bytes.
 *    The caller's client address and address len is filled in (pointed to by clntAddrPtr and clntAddrLenPtr )
@@ -64,7 +81,9 @@ int rc = EXIT_SUCCESS;
  rc  = (ssize_t) recvfrom(sock, RxBufPtr,msgSize, 0,srcAddrPtr, srcAddrLenPtr);
  if (rc < 0)
  {
-  printf("RxMsg:  recvfrom failed,  msgSize:%d,  errno:%d \n", msgSize, errno);
+  //Nothing waiting on a non-blocking socket is not an error worth reporting
+  if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+    printf("RxMsg:  recvfrom failed,  msgSize:%d,  errno:%d \n", msgSize, errno);
   rc = EXIT_FAILURE;
  } else {
 #ifdef TRACE 
@@ -124,6 +143,447 @@ int rc = EXIT_SUCCESS;
 
 
 
+/***********************************************************
+* Function: msgBatch *createMsgBatch(uint32_t batchSize, int msgSize)
+*
+* Explanation:  Creates the mmsghdr/iovec/address arrays used by
+*               RxMsgBatch and sendMsgBatch.  Entry i is preset to
+*               use buffer i and address i so nothing is set up
+*               per syscall.
+*
+* inputs:
+*   uint32_t batchSize : 1 .. MAX_MSG_BATCH
+*   int msgSize : size of each buffer.  If 0, no buffers are
+*                 allocated - the caller sets iovecs[i].iov_base
+*                 (e.g., a batch of replies that point into another batch)
+*
+* outputs:
+*      returns the batch (caller owns it) or NULL on error
+*
+* notes:
+*   The buffers are one allocation made (and touched) here:  the
+*   receive path never allocates or page faults.  Each buffer starts
+*   on a cache line, so the buffers are not back to back unless
+*   msgSize is a multiple of CACHE_LINE_SIZE (a GSO send needs its
+*   own contiguous buffer).
+*
+***************************************************/
+msgBatch *createMsgBatch(uint32_t batchSize, int msgSize)
+{
+  msgBatch *b = NULL;
+  uint32_t i;
+
+  if ((batchSize == 0) || (batchSize > MAX_MSG_BATCH) || (msgSize < 0)) {
+    printf("createMsgBatch: bad params batchSize:%d msgSize:%d \n", batchSize, msgSize);
+    return NULL;
+  }
+
+  b = calloc(1, sizeof(msgBatch));
+  if (b == NULL)
+    return NULL;
+  b->batchSize = batchSize;
+  b->msgSize = msgSize;
+  b->msgs = calloc(batchSize, sizeof(struct mmsghdr));
+  b->iovecs = calloc(batchSize, sizeof(struct iovec));
+  b->addrs = calloc(batchSize, sizeof(struct sockaddr_storage));
+  b->controls = calloc(batchSize, TIMESTAMP_CONTROL_SIZE);
+  b->rxTimes = calloc(batchSize, sizeof(struct timespec));
+  b->segmentSizes = calloc(batchSize, sizeof(uint16_t));
+  if (msgSize > 0) {
+    b->bufferStride = ((size_t)msgSize + CACHE_LINE_SIZE - 1) & ~((size_t)CACHE_LINE_SIZE - 1);
+    b->buffers = aligned_alloc(CACHE_LINE_SIZE, batchSize * b->bufferStride);
+    if (b->buffers != NULL)
+      memset(b->buffers, 0, batchSize * b->bufferStride);
+  }
+  if ((b->msgs == NULL) || (b->iovecs == NULL) || (b->addrs == NULL) ||
+      (b->controls == NULL) || (b->rxTimes == NULL) || (b->segmentSizes == NULL) ||
+      ((msgSize > 0) && (b->buffers == NULL))) {
+    printf("createMsgBatch: malloc failed batchSize:%d msgSize:%d \n", batchSize, msgSize);
+    freeMsgBatch(b);
+    return NULL;
+  }
+
+  for (i = 0; i < batchSize; i++) {
+    b->iovecs[i].iov_base = (msgSize > 0) ? (void *)(b->buffers + i * b->bufferStride) : NULL;
+    b->iovecs[i].iov_len = (size_t)msgSize;
+    b->msgs[i].msg_hdr.msg_iov = &b->iovecs[i];
+    b->msgs[i].msg_hdr.msg_iovlen = 1;
+    b->msgs[i].msg_hdr.msg_name = &b->addrs[i];
+    b->msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+  }
+  return b;
+}
+
+/***********************************************************
+* Function: void freeMsgBatch(msgBatch *batchPtr)
+*
+* Explanation:  frees the batch created by createMsgBatch
+*
+***************************************************/
+void freeMsgBatch(msgBatch *batchPtr)
+{
+  if (batchPtr != NULL) {
+    free(batchPtr->msgs);
+    free(batchPtr->iovecs);
+    free(batchPtr->addrs);
+    free(batchPtr->buffers);
+    free(batchPtr->controls);
+    free(batchPtr->rxTimes);
+    free(batchPtr->segmentSizes);
+    free(batchPtr);
+  }
+}
+
+/***********************************************************
+* Function: void *getBatchBuffer(msgBatch *batchPtr, uint32_t index)
+*
+* Explanation:  returns the buffer of entry index
+*
+***************************************************/
+void *getBatchBuffer(msgBatch *batchPtr, uint32_t index)
+{
+  return batchPtr->iovecs[index].iov_base;
+}
+
+/***********************************************************
+* Function: void getCmsgTimestamp(struct msghdr *msgPtr, struct timespec *tsPtr)
+*
+* Explanation:  pulls the SCM_TIMESTAMPING stamp out of a received
+*               msg's control data.  The NIC (raw hardware) stamp
+*               is used if present, else the kernel software stamp.
+*               Sets 0,0 if the msg carries no stamp.
+*
+***************************************************/
+void getCmsgTimestamp(struct msghdr *msgPtr, struct timespec *tsPtr)
+{
+  tsPtr->tv_sec = 0;
+  tsPtr->tv_nsec = 0;
+#ifdef LINUX
+  struct cmsghdr *cmsg;
+
+  if (msgPtr->msg_controllen == 0)
+    return;
+  for (cmsg = CMSG_FIRSTHDR(msgPtr); cmsg != NULL; cmsg = CMSG_NXTHDR(msgPtr, cmsg)) {
+    if ((cmsg->cmsg_level == SOL_SOCKET) && (cmsg->cmsg_type == SCM_TIMESTAMPING)) {
+      struct scm_timestamping stamps;
+      memcpy(&stamps, CMSG_DATA(cmsg), sizeof(stamps));
+      if ((stamps.ts[2].tv_sec != 0) || (stamps.ts[2].tv_nsec != 0))
+        *tsPtr = stamps.ts[2];
+      else
+        *tsPtr = stamps.ts[0];
+    }
+  }
+#endif
+}
+
+/***********************************************************
+* Function: static uint16_t getCmsgSegmentSize(struct msghdr *msgPtr)
+*
+* Explanation:  returns the UDP_GRO segment size of a received
+*               msg:  the size of each of the datagrams the kernel
+*               coalesced into it (the last may be shorter).
+*               0 if the msg is a single datagram.
+*
+***************************************************/
+static uint16_t getCmsgSegmentSize(struct msghdr *msgPtr)
+{
+#if defined(LINUX) && defined(UDP_GRO)
+  struct cmsghdr *cmsg;
+  int segmentSize = 0;
+
+  if (msgPtr->msg_controllen == 0)
+    return 0;
+  for (cmsg = CMSG_FIRSTHDR(msgPtr); cmsg != NULL; cmsg = CMSG_NXTHDR(msgPtr, cmsg)) {
+    if ((cmsg->cmsg_level == SOL_UDP) && (cmsg->cmsg_type == UDP_GRO)) {
+      memcpy(&segmentSize, CMSG_DATA(cmsg), sizeof(segmentSize));
+      return (uint16_t)segmentSize;
+    }
+  }
+#endif
+  return 0;
+}
+
+/***********************************************************
+* Function: int RxMsgBatch(int sock, msgBatch *batchPtr, bool noWait)
+*
+* Explanation:  Receives up to batchSize msgs in one syscall.
+*               Blocks until at least one msg arrives (unless noWait)
+*               then returns whatever else is already queued.
+*
+* inputs:
+*   int sock : socket descriptor
+*   msgBatch *batchPtr : batch created with a msgSize > 0
+*   bool noWait : if true, returns 0 when nothing is waiting
+*
+* outputs:
+*      returns ERROR or the number of msgs received.
+*      For msg i:  batchPtr->msgs[i].msg_len is the size,
+*                  getBatchBuffer(batchPtr,i) the data,
+*                  batchPtr->addrs[i] / msgs[i].msg_hdr.msg_namelen the source,
+*                  batchPtr->rxTimes[i] the kernel rx timestamp (0,0 unless
+*                  timestamping was enabled on the socket),
+*                  batchPtr->segmentSizes[i] the size of each datagram
+*                  when UDP GRO coalesced several into the msg (else 0).
+*
+* notes:
+*   The entries' msg_control is pointed at the batch's control space,
+*   so a batch used for receives should not also be used for sends.
+*
+***************************************************/
+int RxMsgBatch(int sock, msgBatch *batchPtr, bool noWait)
+{
+  int rc = 0;
+  uint32_t i;
+
+  //The kernel updates msg_namelen/msg_controllen - and a reply may have changed iov_len
+  for (i = 0; i < batchPtr->batchSize; i++) {
+    batchPtr->msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+    batchPtr->msgs[i].msg_hdr.msg_control = batchPtr->controls + (size_t)i * TIMESTAMP_CONTROL_SIZE;
+    batchPtr->msgs[i].msg_hdr.msg_controllen = TIMESTAMP_CONTROL_SIZE;
+    batchPtr->iovecs[i].iov_len = (size_t)batchPtr->msgSize;
+  }
+
+#ifdef LINUX
+  rc = recvmmsg(sock, batchPtr->msgs, batchPtr->batchSize,
+                noWait ? MSG_DONTWAIT : MSG_WAITFORONE, NULL);
+#else
+  //One at a time; only the first can block
+  for (i = 0; i < batchPtr->batchSize; i++) {
+    ssize_t n = recvfrom(sock, batchPtr->iovecs[i].iov_base, (size_t)batchPtr->msgSize,
+                         ((i == 0) && !noWait) ? 0 : MSG_DONTWAIT,
+                         (struct sockaddr *)&batchPtr->addrs[i], &batchPtr->msgs[i].msg_hdr.msg_namelen);
+    if (n < 0)
+      break;
+    batchPtr->msgs[i].msg_len = (unsigned int)n;
+    batchPtr->msgs[i].msg_hdr.msg_controllen = 0;
+  }
+  rc = (i > 0) ? (int)i : -1;
+#endif
+
+  for (i = 0; (int)i < rc; i++) {
+    getCmsgTimestamp(&batchPtr->msgs[i].msg_hdr, &batchPtr->rxTimes[i]);
+    batchPtr->segmentSizes[i] = getCmsgSegmentSize(&batchPtr->msgs[i].msg_hdr);
+  }
+
+  if (rc < 0) {
+    if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+      rc = 0;
+    } else {
+      if (errno != EINTR)
+        printf("RxMsgBatch:  recvmmsg failed,  errno:%d \n", errno);
+      rc = ERROR;
+    }
+  }
+#ifdef TRACE
+  else
+    printf("RxMsgBatch: Rxed %d msgs \n", rc);
+#endif
+  return rc;
+}
+
+/***********************************************************
+* Function: int sendMsgBatchFrom(int sock, msgBatch *batchPtr, uint32_t first, uint32_t numberMsgs)
+*
+* Explanation:  One send of entries first..numberMsgs-1 of the batch
+*               (sendmmsg, elsewhere a sendto of entry first).
+*               It may send fewer than asked.
+*
+* inputs:
+*   int sock : socket descriptor
+*   msgBatch *batchPtr : the batch (set up as for sendMsgBatch)
+*   uint32_t first : the first entry to send
+*   uint32_t numberMsgs : entries first..numberMsgs-1 are sent
+*
+* outputs:
+*      returns ERROR (errno set, entry first was not sent) or
+*      the number of msgs sent from entry first on
+*
+***************************************************/
+int sendMsgBatchFrom(int sock, msgBatch *batchPtr, uint32_t first, uint32_t numberMsgs)
+{
+  int rc = 0;
+
+  if ((numberMsgs > batchPtr->batchSize) || (first >= numberMsgs))
+    return ERROR;
+#ifdef LINUX
+  rc = sendmmsg(sock, &batchPtr->msgs[first], numberMsgs - first, 0);
+#else
+  ssize_t n = sendto(sock, batchPtr->iovecs[first].iov_base, batchPtr->iovecs[first].iov_len, 0,
+                     (struct sockaddr *)batchPtr->msgs[first].msg_hdr.msg_name,
+                     batchPtr->msgs[first].msg_hdr.msg_namelen);
+  rc = (n < 0) ? -1 : 1;
+#endif
+  return (rc < 0) ? ERROR : rc;
+}
+
+/***********************************************************
+* Function: int sendMsgBatch(int sock, msgBatch *batchPtr, uint32_t numberMsgs)
+*
+* Explanation:  Sends entries 0..numberMsgs-1 of the batch.
+*               The caller sets for each entry iovecs[i].iov_len
+*               (and iov_base if the batch has no buffers) and the
+*               destination: msgs[i].msg_hdr.msg_name/msg_namelen.
+*               Retries until all are sent (sendmmsg can send fewer).
+*
+* inputs:
+*   int sock : socket descriptor
+*   msgBatch *batchPtr : the batch
+*   uint32_t numberMsgs : number of entries to send
+*
+* outputs:
+*      returns ERROR or the number of msgs sent (== numberMsgs)
+*
+***************************************************/
+int sendMsgBatch(int sock, msgBatch *batchPtr, uint32_t numberMsgs)
+{
+  int rc = 0;
+  uint32_t numberSent = 0;
+
+  if (numberMsgs > batchPtr->batchSize)
+    return ERROR;
+
+  while (numberSent < numberMsgs) {
+    rc = sendMsgBatchFrom(sock, batchPtr, numberSent, numberMsgs);
+    if (rc == ERROR) {
+      if (errno == EINTR)
+        continue;
+      printf("sendMsgBatch:  sendmmsg failed, sent %d of %d,  errno:%d \n", numberSent, numberMsgs, errno);
+      return ERROR;
+    }
+    numberSent += (uint32_t)rc;
+  }
+#ifdef TRACE
+  printf("sendMsgBatch: sent %d msgs \n", numberSent);
+#endif
+  return (int)numberSent;
+}
+
+/***********************************************************
+* Function: int waitSocketWritable(int sock, int timeoutMsecs)
+*
+* Explanation:  Waits until the socket can take a send (POLLOUT),
+*               e.g. after a non-blocking send failed with EAGAIN
+*               or ENOBUFS.
+*
+* inputs:
+*   int sock : socket descriptor
+*   int timeoutMsecs : the longest wait (-1: no limit)
+*
+* outputs:
+*      returns ERROR, 0 (timed out) or 1 (writable)
+*
+***************************************************/
+int waitSocketWritable(int sock, int timeoutMsecs)
+{
+  struct pollfd pfd;
+  int rc = 0;
+
+  pfd.fd = sock;
+  pfd.events = POLLOUT;
+  pfd.revents = 0;
+  rc = poll(&pfd, 1, timeoutMsecs);
+  if (rc < 0)
+    return (errno == EINTR) ? 0 : ERROR;
+  return (rc > 0) ? 1 : 0;
+}
+
+/***********************************************************
+* Function: int sendMsgGSO(int sock, void *bufPtr, int bufSize, int segmentSize,
+*                          struct sockaddr *dstAddrPtr, socklen_t dstAddrLen)
+*
+* Explanation:  Sends a buffer of back to back msgs with one
+*               sendmsg:  the kernel (UDP_SEGMENT) cuts it into
+*               datagrams of segmentSize bytes (the last may be
+*               shorter).  The stack is traversed once per buffer
+*               rather than once per datagram.
+*
+* inputs:
+*   int sock : socket descriptor
+*   void *bufPtr, int bufSize : the msgs
+*   int segmentSize : the size of each datagram
+*   struct sockaddr *dstAddrPtr, socklen_t dstAddrLen : the destination
+*
+* outputs:
+*      returns ERROR or the number of datagrams sent
+*
+* notes:
+*   At most GSO_MAX_SEGMENTS datagrams and GSO_MAX_BUFFER bytes.
+*   Each datagram must fit the path MTU (no IP fragments).
+*
+***************************************************/
+int sendMsgGSO(int sock, void *bufPtr, int bufSize, int segmentSize,
+               struct sockaddr *dstAddrPtr, socklen_t dstAddrLen)
+{
+#if defined(LINUX) && defined(UDP_SEGMENT)
+  struct msghdr msg;
+  struct iovec iov;
+  struct cmsghdr *cmsg;
+  char control[CMSG_SPACE(sizeof(uint16_t))];
+  uint16_t gsoSize = (uint16_t)segmentSize;
+  ssize_t rc = 0;
+
+  if ((segmentSize <= 0) || (bufSize <= 0) || (bufSize > GSO_MAX_BUFFER) ||
+      (((bufSize + segmentSize - 1) / segmentSize) > GSO_MAX_SEGMENTS))
+    return ERROR;
+
+  memset(&msg, 0, sizeof(msg));
+  memset(control, 0, sizeof(control));
+  iov.iov_base = bufPtr;
+  iov.iov_len = (size_t)bufSize;
+  msg.msg_name = dstAddrPtr;
+  msg.msg_namelen = dstAddrLen;
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_UDP;
+  cmsg->cmsg_type = UDP_SEGMENT;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+  memcpy(CMSG_DATA(cmsg), &gsoSize, sizeof(gsoSize));
+
+  do {
+    rc = sendmsg(sock, &msg, 0);
+  } while ((rc < 0) && (errno == EINTR));
+  if (rc < 0) {
+    printf("sendMsgGSO:  sendmsg failed, %d bytes in %d byte segments,  errno:%d \n", bufSize, segmentSize, errno);
+    return ERROR;
+  }
+  return (bufSize + segmentSize - 1) / segmentSize;
+#else
+  printf("sendMsgGSO:  UDP GSO is not supported on this platform \n");
+  return ERROR;
+#endif
+}
+
+/***********************************************************
+* Function: int enableUDPGRO(int sock)
+*
+* Explanation:  Lets the kernel coalesce the back to back
+*               datagrams of a flow into one msg (UDP_GRO).  The
+*               receive buffers must hold GRO_BUFFER_SIZE bytes;
+*               RxMsgBatch returns each msg's segment size.
+*
+* outputs:
+*      returns ERROR or NOERROR
+*
+***************************************************/
+int enableUDPGRO(int sock)
+{
+#if defined(LINUX) && defined(UDP_GRO)
+  int enable = 1;
+
+  if (setsockopt(sock, SOL_UDP, UDP_GRO, &enable, sizeof(enable)) < 0) {
+    printf("enableUDPGRO:  setsockopt UDP_GRO failed,  errno:%d \n", errno);
+    return ERROR;
+  }
+  return NOERROR;
+#else
+  printf("enableUDPGRO:  UDP GRO is not supported on this platform \n");
+  return ERROR;
+#endif
+}
+
 /***********************************************************
 * Function: int SetSocketOptions( int sock, int option, void *optionData, int sizeData)
 *
@@ -249,6 +709,18 @@ static unsigned char ttl = 32; //Used only for multicast
       }
       break;
 
+#ifdef SO_MAX_PACING_RATE
+    //Bytes per second.  UDP msgs are paced by the fq qdisc (tc qdisc add dev IF root fq)
+    case SO_MAX_PACING_RATE:
+      rc = setsockopt(sock, SOL_SOCKET, SO_MAX_PACING_RATE, optionData, sizeData);
+      if (rc < 0)
+      {
+        printf("SetSocketOptions:  failed SO_MAX_PACING_RATE  errno:%d \n", errno);
+        rc = EXIT_FAILURE;
+      }
+      break;
+#endif
+
     default:
       printf("SetSocketOptions:  failed  Unknown option :%d  \n", option);
       rc = EXIT_FAILURE;
@@ -739,6 +1211,27 @@ ssize_t numBytesSent = 0;
 *
 **************************************************/
 int SetupUDPServerSocket(const char *service) 
+{
+  return SetupUDPServerSocketOpts(service, false);
+}
+
+/***********************************************************
+* Function: int SetupUDPServerSocketOpts(const char *service, bool reusePort)
+*
+* Explanation:  SetupUDPServerSocket with options that must be
+*               set before the bind
+*
+* inputs:   
+*     const char *service  : the service name or port number
+*     bool reusePort : set SO_REUSEPORT.  Every socket bound to the port
+*                  with SO_REUSEPORT gets a share of the arriving
+*                  datagrams (the kernel hashes the 4 tuple, so a given
+*                  client is always served by the same socket).
+*
+* outputs: returns a EXIT_FAILURE (-1) or valid sock descriptor
+*
+**************************************************/
+int SetupUDPServerSocketOpts(const char *service, bool reusePort) 
 {
 
 int rc = EXIT_SUCCESS;
@@ -790,6 +1283,11 @@ struct addrinfo *addr;
     //int enable = 1;
     //if (setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(int)) < 0)
     //   DieWithUserMessage("setsockopt(SO_REUSEADDR)", "failed");
+    if (reusePort) {
+      int enable = 1;
+      if (setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(int)) < 0)
+        perror("SetupUDPServerSocketOpts: setsockopt(SO_REUSEPORT) failed ");
+    }
 
     // Bind to the local address , returns -1 on error else 0
     rc = bind(sock, selectedAddr->ai_addr, selectedAddr->ai_addrlen);
@@ -823,3 +1321,201 @@ struct addrinfo *addr;
   return rc;
 }
 
+/***********************************************************
+* Function: int parseTimestampMode(const char *modeString)
+*
+* Explanation:  maps "none", "sw" or "hw" to a TIMESTAMP_ mode
+*
+* outputs:
+*      returns the mode or ERROR
+*
+***************************************************/
+int parseTimestampMode(const char *modeString)
+{
+  if (strcmp(modeString, "none") == 0)
+    return TIMESTAMP_NONE;
+  else if (strcmp(modeString, "sw") == 0)
+    return TIMESTAMP_SW;
+  else if (strcmp(modeString, "hw") == 0)
+    return TIMESTAMP_HW;
+  return ERROR;
+}
+
+/***********************************************************
+* Function: int enableTimestamping(int sock, int tsMode, bool enableTx, const char *IFName)
+*
+* Explanation:  enables SO_TIMESTAMPING on the socket.  Rx stamps
+*               are then returned by RxMsgTS/RxMsgBatch.  If enableTx,
+*               each send also queues a tx stamp on the socket's
+*               error queue (read with getTxTimestamp).  Tx stamps
+*               carry an ID:  the number of sends done on the socket
+*               before this one (the first send after this call is ID 0).
+*
+* inputs:
+*   int sock : socket descriptor
+*   int tsMode : TIMESTAMP_SW or TIMESTAMP_HW
+*   bool enableTx : also stamp sends (do not set unless the error
+*                   queue is read, e.g., a reflector should not)
+*   const char *IFName : TIMESTAMP_HW: the IF whose NIC is told to
+*                   stamp (SIOCSHWTSTAMP).  NULL: assume it already is.
+*
+* outputs:
+*      returns the mode enabled (TIMESTAMP_HW becomes TIMESTAMP_SW
+*      if the NIC can not stamp) or ERROR
+*
+* notes:
+*   NIC stamps are in the NIC's clock (PTP hardware clock).  They are
+*   only comparable with CLOCK_REALTIME if that clock is synced to the
+*   system clock (e.g., phc2sys).  Software stamps are always used for
+*   packets the NIC did not stamp.
+*
+***************************************************/
+int enableTimestamping(int sock, int tsMode, bool enableTx, const char *IFName)
+{
+#ifdef LINUX
+  int flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+
+  if ((tsMode != TIMESTAMP_SW) && (tsMode != TIMESTAMP_HW))
+    return ERROR;
+
+  if (enableTx)
+    flags |= SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY;
+
+  if (tsMode == TIMESTAMP_HW) {
+    if (IFName != NULL) {
+      struct ifreq ifr;
+      struct hwtstamp_config config;
+
+      memset(&ifr, 0, sizeof(ifr));
+      memset(&config, 0, sizeof(config));
+      strncpy(ifr.ifr_name, IFName, IFNAMSIZ-1);
+      config.tx_type = enableTx ? HWTSTAMP_TX_ON : HWTSTAMP_TX_OFF;
+      config.rx_filter = HWTSTAMP_FILTER_ALL;
+      ifr.ifr_data = (char *)&config;
+      if (ioctl(sock, SIOCSHWTSTAMP, &ifr) < 0) {
+        printf("enableTimestamping: %s can not do NIC timestamps (errno:%d), using software stamps \n",
+               IFName, errno);
+        tsMode = TIMESTAMP_SW;
+      }
+    }
+    if (tsMode == TIMESTAMP_HW) {
+      flags |= SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE;
+      if (enableTx)
+        flags |= SOF_TIMESTAMPING_TX_HARDWARE;
+    }
+  }
+
+  if (setsockopt(sock, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) < 0) {
+    printf("enableTimestamping: setsockopt SO_TIMESTAMPING failed flags:0x%x errno:%d \n", flags, errno);
+    return ERROR;
+  }
+#ifdef TRACE
+  printf("enableTimestamping: sock:%d mode:%d flags:0x%x \n", sock, tsMode, flags);
+#endif
+  return tsMode;
+#else
+  return ERROR;
+#endif
+}
+
+/***********************************************************
+* Function: int RxMsgTS(int sock, void *RxBufPtr, int msgSize, struct sockaddr *srcAddrPtr,
+*                       socklen_t *srcAddrLenPtr, struct timespec *rxTSPtr)
+*
+* Explanation:  RxMsg that also returns the rx timestamp
+*
+* inputs:
+*   as RxMsg, plus
+*   struct timespec *rxTSPtr : set to the kernel/NIC rx stamp, 0,0 if none
+*
+* outputs:
+*      returns EXIT_FAILURE or number of bytes received (as RxMsg)
+*
+***************************************************/
+int RxMsgTS(int sock, void *RxBufPtr, int msgSize, struct sockaddr *srcAddrPtr, socklen_t *srcAddrLenPtr,
+            struct timespec *rxTSPtr)
+{
+  int rc = EXIT_SUCCESS;
+  struct msghdr msg;
+  struct iovec iov;
+  char control[TIMESTAMP_CONTROL_SIZE];
+
+  iov.iov_base = RxBufPtr;
+  iov.iov_len = (size_t)msgSize;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_name = srcAddrPtr;
+  msg.msg_namelen = *srcAddrLenPtr;
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  rc = (int)recvmsg(sock, &msg, 0);
+  if (rc < 0) {
+    if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+      printf("RxMsgTS:  recvmsg failed,  msgSize:%d,  errno:%d \n", msgSize, errno);
+    rxTSPtr->tv_sec = 0;
+    rxTSPtr->tv_nsec = 0;
+    return EXIT_FAILURE;
+  }
+  *srcAddrLenPtr = msg.msg_namelen;
+  getCmsgTimestamp(&msg, rxTSPtr);
+  return rc;
+}
+
+/***********************************************************
+* Function: int getTxTimestamp(int sock, uint32_t *txIDPtr, struct timespec *txTSPtr)
+*
+* Explanation:  reads one tx stamp from the socket's error queue
+*               (never blocks).  Entries that are not tx stamps
+*               (e.g., an ICMP error) are discarded.
+*
+* inputs:
+*   int sock : socket descriptor (enableTimestamping with enableTx)
+*   uint32_t *txIDPtr : set to the ID of the send that was stamped
+*   struct timespec *txTSPtr : set to the stamp
+*
+* outputs:
+*      returns 1 if a stamp was read, 0 if none is queued, or ERROR
+*
+***************************************************/
+int getTxTimestamp(int sock, uint32_t *txIDPtr, struct timespec *txTSPtr)
+{
+#ifdef LINUX
+  int rc = 0;
+  struct msghdr msg;
+  struct cmsghdr *cmsg;
+  char control[TIMESTAMP_CONTROL_SIZE];
+  bool haveID = false;
+
+  while (!haveID) {
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    rc = (int)recvmsg(sock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT);
+    if (rc < 0) {
+      if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+        return 0;
+      printf("getTxTimestamp:  recvmsg(MSG_ERRQUEUE) failed,  errno:%d \n", errno);
+      return ERROR;
+    }
+
+    getCmsgTimestamp(&msg, txTSPtr);
+    for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if (((cmsg->cmsg_level == SOL_IP) && (cmsg->cmsg_type == IP_RECVERR)) ||
+          ((cmsg->cmsg_level == SOL_IPV6) && (cmsg->cmsg_type == IPV6_RECVERR))) {
+        struct sock_extended_err serr;
+        memcpy(&serr, CMSG_DATA(cmsg), sizeof(serr));
+        if ((serr.ee_errno == ENOMSG) && (serr.ee_origin == SO_EE_ORIGIN_TIMESTAMPING)) {
+          *txIDPtr = serr.ee_data;
+          haveID = ((txTSPtr->tv_sec != 0) || (txTSPtr->tv_nsec != 0));
+        }
+      }
+    }
+  }
+  return 1;
+#else
+  return 0;
+#endif
+}
@@ -7,7 +7,7 @@
 * Notes:
 *   Code should always exit using Unix convention:  exit(EXIT_SUCCESS) or exit(EXIT_FAILURE)
 *
-* Last update: 4/30/2019
+* Last update: 10/17/2026
 *************************************************************************/
 #ifndef	__SocketHelper_h
 #define	__SocketHelper_h
@@ -15,11 +15,70 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/ip.h>
+#include <sys/uio.h>
+#include <stdbool.h>
+#include <stdint.h>
 
 
 int sendMsg(int sock, void *SendBufPtr, int msgSize, struct sockaddr *dstAddrPtr, socklen_t dstAddrLen);
 int RxMsg(int sock, void *RxBufPtr, int msgSize, struct sockaddr *srcAddrPtr, socklen_t *srcAddrLenPtr);
 
+//Batched send/receive: one syscall moves up to batchSize datagrams (sendmmsg/recvmmsg)
+#define MAX_MSG_BATCH 64
+
+#ifndef LINUX
+struct mmsghdr {
+  struct msghdr msg_hdr;
+  unsigned int msg_len;
+};
+#endif
+
+typedef struct {
+  uint32_t batchSize;
+  int msgSize;                    //size of each buffer (0: caller supplies the iov_base ptrs)
+  struct mmsghdr *msgs;
+  struct iovec *iovecs;
+  struct sockaddr_storage *addrs;
+  char *buffers;                  //batchSize buffers of msgSize bytes, each on a cache line
+  size_t bufferStride;            //bytes from one buffer to the next (msgSize rounded up to a cache line)
+  char *controls;                 //cmsg space of each entry (rx timestamps)
+  struct timespec *rxTimes;       //kernel rx timestamp of each entry (0,0 if none)
+  uint16_t *segmentSizes;         //UDP GRO: size of the datagrams coalesced into each entry (0: one)
+} msgBatch;
+
+msgBatch *createMsgBatch(uint32_t batchSize, int msgSize);
+void freeMsgBatch(msgBatch *batchPtr);
+void *getBatchBuffer(msgBatch *batchPtr, uint32_t index);
+int RxMsgBatch(int sock, msgBatch *batchPtr, bool noWait);
+int sendMsgBatch(int sock, msgBatch *batchPtr, uint32_t numberMsgs);
+int sendMsgBatchFrom(int sock, msgBatch *batchPtr, uint32_t first, uint32_t numberMsgs);
+int waitSocketWritable(int sock, int timeoutMsecs);
+
+//UDP GSO/GRO: one syscall (and one stack traversal) moves a buffer of
+//back to back datagrams.  A GRO receive buffer holds a coalesced msg.
+#define GSO_MAX_SEGMENTS 64
+#define GSO_MAX_BUFFER 65507
+#define GRO_BUFFER_SIZE 65535
+
+int sendMsgGSO(int sock, void *bufPtr, int bufSize, int segmentSize,
+               struct sockaddr *dstAddrPtr, socklen_t dstAddrLen);
+int enableUDPGRO(int sock);
+
+//Kernel/NIC timestamping (SO_TIMESTAMPING).  Stamps are returned as CLOCK_REALTIME
+//timespecs.  A stamp of 0,0 means none was available (use a user space time).
+#define TIMESTAMP_NONE  0   //user space clock_gettime (the original behavior)
+#define TIMESTAMP_SW    1   //kernel software stamps
+#define TIMESTAMP_HW    2   //NIC stamps (falls back to TIMESTAMP_SW if the NIC can not)
+#define TIMESTAMP_CONTROL_SIZE  256
+
+int parseTimestampMode(const char *modeString);
+int enableTimestamping(int sock, int tsMode, bool enableTx, const char *IFName);
+int RxMsgTS(int sock, void *RxBufPtr, int msgSize, struct sockaddr *srcAddrPtr, socklen_t *srcAddrLenPtr,
+            struct timespec *rxTSPtr);
+int getTxTimestamp(int sock, uint32_t *txIDPtr, struct timespec *txTSPtr);
+//The rx stamp in a received msg's control data (0,0: none)
+void getCmsgTimestamp(struct msghdr *msgPtr, struct timespec *tsPtr);
+
 // Create, bind, and listen a new TCP server socket
 int SetupTCPServerSocket(const char *service);
 // Accept a new TCP connection on a server socket
@@ -36,6 +95,7 @@ int SetupTCPServerSocket(const char *service);
 //int SetupUDPClientSocket(const char *server, const char *service);
 int SetupUDPClientSocket(const char *server, const char *servPort,struct sockaddr *clntAddrPtr, socklen_t *clntAddrLenPtr);
 int SetupUDPServerSocket(const char *service);
+int SetupUDPServerSocketOpts(const char *service, bool reusePort);
 
 int SetSocketOption( int sock, int option, void *optionData, int sizeData);
 int GetSocketOption(int sock, int option);
@@ -0,0 +1,187 @@
+/*********************************************************
+*
+* Module Name: clock offset/skew estimator
+*
+* File Name:  clockSync.c
+*
+* Summary:  Estimates the offset and skew of the server clock
+*           from the four timestamps of each echo/ACK exchange.
+*           NTP style offsets, minimum delay filtering and a
+*           least squares skew over a sliding window.
+*
+*  The methods include:
+*   clockSync *createClockSync();
+*   void freeClockSync(clockSync *c);
+*   int clockSyncUpdate(clockSync *c, double T1, double T2, double T3, double T4);
+*   double clockSyncOffset(clockSync *c, double t);
+*   int printClockSync(clockSync *c, FILE *fileFID);
+*
+* Notes:
+*   A caller converts a server time Ts taken at (about) local time t
+*   to the local clock with Ts - clockSyncOffset(c, t).
+*
+* Last update: 10/17/2026
+*
+*********************************************************/
+#include "common.h"
+#include "clockSync.h"
+
+//#define TRACEME 0
+
+/***********************************************************
+* Function: static void fitClockSync(clockSync *c)
+*
+* Explanation:  updates the estimate from the kept samples
+*
+***********************************************************/
+static void fitClockSync(clockSync *c)
+{
+  uint32_t i;
+  uint32_t n = c->numberPoints;
+  double sumT = 0.0;
+  double sumO = 0.0;
+  double sxx = 0.0;
+  double sxy = 0.0;
+  clockSyncSample *best = &c->points[0];
+
+  if (n < CLOCK_SYNC_MIN_FIT_POINTS) {
+    for (i = 1; i < n; i++) {
+      if (c->points[i].delay < best->delay)
+        best = &c->points[i];
+    }
+    c->tMean = best->t;
+    c->offset = best->offset;
+    c->skew = 0.0;
+    return;
+  }
+
+  for (i = 0; i < n; i++) {
+    sumT += c->points[i].t;
+    sumO += c->points[i].offset;
+  }
+  c->tMean = sumT / n;
+  c->offset = sumO / n;
+  for (i = 0; i < n; i++) {
+    double dt = c->points[i].t - c->tMean;
+    sxx += dt * dt;
+    sxy += dt * (c->points[i].offset - c->offset);
+  }
+  c->skew = (sxx > 0.0) ? (sxy / sxx) : 0.0;
+}
+
+/***********************************************************
+* Function: clockSync *createClockSync()
+*
+* Explanation:  creates an estimator with no samples.  The
+*               caller owns the memory.
+*
+* outputs:
+*    returns the estimator or NULL on error
+*
+***********************************************************/
+clockSync *createClockSync()
+{
+  clockSync *c = malloc(sizeof(clockSync));
+
+  if (c != NULL)
+    memset(c, 0, sizeof(clockSync));
+  return c;
+}
+
+/***********************************************************
+* Function: void freeClockSync(clockSync *c)
+*
+* Explanation:  frees the estimator
+*
+***********************************************************/
+void freeClockSync(clockSync *c)
+{
+  free(c);
+}
+
+/***********************************************************
+* Function: int clockSyncUpdate(clockSync *c, double T1, double T2, double T3, double T4)
+*
+* Explanation:  adds the sample of an exchange
+*
+* inputs:
+*   clockSync *c
+*   double T1, T4 : local send time of the request, arrival time of the reply
+*   double T2, T3 : remote arrival time of the request, send time of the reply
+*
+* outputs:
+*    returns ERROR (the sample is rejected) or NOERROR
+*
+***********************************************************/
+int clockSyncUpdate(clockSync *c, double T1, double T2, double T3, double T4)
+{
+  clockSyncSample s;
+
+  s.t = T4;
+  s.offset = ((T2 - T1) + (T3 - T4)) / 2.0;
+  s.delay = (T4 - T1) - (T3 - T2);
+  if (s.delay < 0.0) {
+    c->numberRejected++;
+    return ERROR;
+  }
+  c->numberSamples++;
+  if ((c->numberSamples == 1) || (s.delay < c->minDelay))
+    c->minDelay = s.delay;
+
+  if ((c->blockCount == 0) || (s.delay < c->blockBest.delay))
+    c->blockBest = s;
+  if (c->blockCount == 0)
+    c->blockStart = T4;
+  c->blockCount++;
+
+  if ((c->blockCount >= CLOCK_SYNC_BLOCK_SAMPLES) && ((T4 - c->blockStart) >= CLOCK_SYNC_BLOCK_TIME)) {
+    c->points[c->nextPoint] = c->blockBest;
+    c->nextPoint = (c->nextPoint + 1) % CLOCK_SYNC_MAX_POINTS;
+    if (c->numberPoints < CLOCK_SYNC_MAX_POINTS)
+      c->numberPoints++;
+    c->blockCount = 0;
+    fitClockSync(c);
+#ifdef TRACEME
+    printf("clockSyncUpdate: point t:%f offset:%f delay:%f  fit offset:%f skew:%e \n",
+           c->blockBest.t, c->blockBest.offset, c->blockBest.delay, c->offset, c->skew);
+#endif
+  } else if (c->numberPoints == 0) {
+    //Until the first block is complete, its best sample is the estimate
+    c->tMean = c->blockBest.t;
+    c->offset = c->blockBest.offset;
+  }
+  return NOERROR;
+}
+
+/***********************************************************
+* Function: double clockSyncOffset(clockSync *c, double t)
+*
+* Explanation:  returns the estimated offset (remote - local)
+*               at local time t
+*
+* outputs:
+*    returns the offset in seconds, 0.0 if there are no samples yet
+*
+***********************************************************/
+double clockSyncOffset(clockSync *c, double t)
+{
+  return c->offset + c->skew * (t - c->tMean);
+}
+
+/***********************************************************
+* Function: int printClockSync(clockSync *c, FILE *fileFID)
+*
+* Explanation:  prints the estimate (one line)
+*
+* outputs :
+*    returns ERROR or NOERROR
+*
+***********************************************************/
+int printClockSync(clockSync *c, FILE *fileFID)
+{
+  if ((c == NULL) || (fileFID == NULL))
+    return ERROR;
+  fprintf(fileFID, "clock offset (server - client): %1.9f secs, skew: %3.3f ppm, min delay: %1.9f, samples: %d (kept %d, rejected %d) \n",
+          c->offset, c->skew * 1000000.0, c->minDelay, c->numberSamples, c->numberPoints, c->numberRejected);
+  return NOERROR;
+}
@@ -0,0 +1,75 @@
+/************************************************************************
+* File:  clockSync.h
+*
+* Purpose:
+*   This include file is for the clockSync module.  It estimates the
+*   offset and skew of a remote (server) clock relative to the local
+*   (client) clock from the four timestamps of request/reply exchanges:
+*     T1 client tx, T2 server rx, T3 server tx, T4 client rx
+*   so one way delays can be reported without synchronized clocks.
+*
+*   clockSync *createClockSync();
+*   void freeClockSync(clockSync *c);
+*   int clockSyncUpdate(clockSync *c, double T1, double T2, double T3, double T4);
+*   double clockSyncOffset(clockSync *c, double t);
+*   int printClockSync(clockSync *c, FILE *fileFID);
+*
+* Notes:
+*   Each exchange gives (NTP):
+*     offset = ((T2 - T1) + (T3 - T4)) / 2     (server - client)
+*     delay  = (T4 - T1) - (T3 - T2)
+*   The offset is exact when the path is symmetric.  Queueing makes
+*   a sample's error up to delay/2, so only the minimum delay sample
+*   of each block of samples is kept (a block is at least
+*   CLOCK_SYNC_BLOCK_SAMPLES samples and CLOCK_SYNC_BLOCK_TIME seconds).
+*   The skew is the slope of a least squares line through the last
+*   CLOCK_SYNC_MAX_POINTS kept samples.
+*
+* Last update: 10/17/2026
+*
+*************************************************************************/
+#ifndef	__clockSync_h
+#define	__clockSync_h
+
+#include "common.h"
+
+#define CLOCK_SYNC_BLOCK_SAMPLES 8
+#define CLOCK_SYNC_BLOCK_TIME 0.5
+#define CLOCK_SYNC_MAX_POINTS 64
+//Fewer kept samples than this: no skew, the offset is the best sample's
+#define CLOCK_SYNC_MIN_FIT_POINTS 4
+
+typedef struct {
+  double t;        //local time of the sample (T4)
+  double offset;
+  double delay;
+} clockSyncSample;
+
+typedef struct {
+  uint32_t numberSamples;
+  uint32_t numberRejected;         //negative delay (a bad timestamp)
+
+  //The block being filled
+  clockSyncSample blockBest;       //its minimum delay sample
+  uint32_t blockCount;
+  double blockStart;
+
+  //The kept (filtered) samples, a ring
+  clockSyncSample points[CLOCK_SYNC_MAX_POINTS];
+  uint32_t numberPoints;
+  uint32_t nextPoint;
+
+  //The estimate: offset(t) = offset + skew * (t - tMean)
+  double tMean;
+  double offset;
+  double skew;
+  double minDelay;
+} clockSync;
+
+clockSync *createClockSync();
+void freeClockSync(clockSync *c);
+int clockSyncUpdate(clockSync *c, double T1, double T2, double T3, double T4);
+double clockSyncOffset(clockSync *c, double t);
+int printClockSync(clockSync *c, FILE *fileFID);
+
+#endif
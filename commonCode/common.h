@@ -16,6 +16,7 @@
 #include <stdint.h>  /*brings in C99 types of uint32_t uint64_t  ...*/
 #include <stdbool.h>
 #include <string.h>     
+#include <ctype.h>
 #include  <stdarg.h>		/* ANSI C header file */
 #include <errno.h>
 #include <sys/file.h>
@@ -120,6 +121,9 @@ typedef uint32_t mySize_t;
 //#define MAX_LINE_SIZE  128
 //#define MAX_BUFFER    1024
 
+//Data written by different threads is kept on different cache lines
+#define CACHE_LINE_SIZE 64
+
 
 #endif
 
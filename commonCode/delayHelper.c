@@ -17,6 +17,17 @@
 *   The most accurate way to delay is for the caller to:
 *            call busyWait with the corrected time to 
 *           wait to meet the interval.  See testTime2.c.
+*   The pacer gets (nearly) the same accuracy without spinning
+*   over the whole wait:
+*       int pacerWaitUntil(pacer *p, double deadline)
+*   or, when the caller sleeps (e.g., an event loop timer):
+*       double pacerWakeTime(pacer *p, double deadline)
+*       int pacerWokeUp(pacer *p, double wakeTime, double deadline)
+*   A token bucket paces a stream at a bit rate:
+*       void initTokenBucket(tokenBucket *b, double bitRate, double depth, double now)
+*       uint32_t tokenBucketAvailable(tokenBucket *b, double now, uint32_t size, uint32_t max)
+*       void tokenBucketConsume(tokenBucket *b, uint32_t bytes)
+*       double tokenBucketReadyTime(tokenBucket *b, uint32_t bytes)
 *
 * These  Delay Routines invoke system delay calls 
 *       int myDelayTS(struct timespec *ts)
@@ -31,7 +42,7 @@
 *         int microDelay(int32_t delayUseconds)
 *
 * 
-*  Last update: 10/14/2019
+*  Last update: 10/17/2026
 *
 *********************************************************/
  #define _GNU_SOURCE         /* See feature_test_macros(7) */
@@ -744,19 +755,6 @@ void timespec_add_ulong (struct timespec *tv0, unsigned long value) {
     }
 }
 
-// Kalman versions attempt to support delay request
-// accuracy over a minimum guaranteed delay by
-// prediciting the delay error. This is
-// the basic recursive algorithm.
-void kalman_update (kalman_state *state, double measurement) {
-    //prediction update
-    state->p = state->p + state->q;
-    //measurement update
-    state->k = state->p / (state->p + state->r);
-    state->x = state->x + (state->k * (measurement - state->x));
-    state->p = (1 - state->k) * state->p;
-}
-
 // Delay calls for systems with clock_gettime
 // Working units are nanoseconds and structures are timespec
 void timespec_add_double (struct timespec *tv0, double value) {
@@ -901,48 +899,6 @@ int delay_busyloop2 (unsigned long usec)
   return rc;
 }
 
-// Kalman routines for systems with clock_gettime
-// Request units is microseconds
-// Adjust units is nanoseconds
-void delay_kalman1 (unsigned long usec) {
-    struct timespec t1, t2, finishtime, requested={0,0}, remaining;
-    double nsec_adjusted, err;
-    static kalman_state kalmanerr={
-	0.00001, //q process noise covariance
-	0.1, //r measurement noise covariance
-	0.0, //x value, error predictio (units nanoseconds)
-	1, //p estimation error covariance
-	0.75 //k kalman gain
-    };
-    // Get the current clock
-    clock_gettime(CLOCK_REALTIME, &t1);
-    // Perform the kalman adjust per the predicted delay error
-    nsec_adjusted = (usec * 1000.0) - kalmanerr.x;
-    // Set a timespec to be used by the nanosleep
-    // as well as for the finished time calculation
-    timespec_add_double(&requested, nsec_adjusted);
-    // Set the finish time in timespec format
-    finishtime = t1;
-    timespec_add(&finishtime, &requested);
-    // Don't call nanosleep for values less than 10 microseconds
-    // as the syscall is too expensive.  Let the busy loop
-    // provide the delay for times under that.
-    if (nsec_adjusted > 10000) {
-	nanosleep(&requested, &remaining);
-    }
-    while (1) {
-	clock_gettime(CLOCK_REALTIME, &t2);
-	if (timespec_greaterthan(t2, finishtime))
-	    break;
-    }
-    // Compute the delay error in units of nanoseconds
-    // and cast to type double
-    err = (double) (timespec_diff(t2, t1) - (usec * 1000));
-    // printf("req: %ld adj: %f err: %.5f (ns)\n", usec, nsec_adjusted, kalmanerr.x);
-    kalman_update(&kalmanerr, err);
-}
-
-
 // Sadly, these systems must use the not so efficient gettimeofday()
 // and working units are microseconds, struct is timeval
 void timeval_add_ulong (struct timeval *tv0, unsigned long value) {
@@ -974,53 +930,234 @@ double timeval_diff (struct timeval tv1, struct timeval tv0) {
 
 
 
-// Request units is microseconds
-// Adjust units is microseconds
-void delay_kalman2 (unsigned long usec) {
-    struct timeval t1, t2, finishtime;
-    long usec_adjusted;
-    double err;
-    static kalman_state kalmanerr={
-	0.00001, //q process noise covariance
-	0.1, //r measurement noise covariance
-	0.0, //x value, error predictio (units nanoseconds)
-	1, //p estimation error covariance
-	0.25 //k kalman gain
-    };
-    // Get the current clock
-    gettimeofday( &t1, NULL );
-    // Perform the kalman adjust per the predicted delay error
-    if (kalmanerr.x > 0) {
-	usec_adjusted = usec - (long) floor(kalmanerr.x);
-	if (usec_adjusted < 0)
-	    usec_adjusted = 0;
-    }
-    else
-	usec_adjusted = usec + (long) floor(kalmanerr.x);
-    // Set the finishtime
-    finishtime = t1;
-    timeval_add_ulong(&finishtime, usec_adjusted);
-
-    // Don't call nanosleep for values less than 10 microseconds
-    // as the syscall is too expensive.  Let the busy loop
-    // provide the delay for times under that.
-    if (usec_adjusted > 10) {
-	struct timespec requested={0,0}, remaining;
-	timespec_add_ulong(&requested, (usec_adjusted * 1000));
-	nanosleep(&requested, &remaining);
-    }
-    //busy loop....
-    while (1) {
-	gettimeofday(&t2, NULL );
-	if (timeval_greaterthan(t2, finishtime))
-	    break;
+/*************************************************************
+* Function: void initPacer(pacer *p)
+* 
+* Summary: inits a pacer (no waits yet, PACER_INITIAL_MARGIN)
+*
+************************************************/
+void initPacer(pacer *p)
+{
+  memset(p, 0, sizeof(pacer));
+  p->margin = PACER_INITIAL_MARGIN;
+  p->meanOversleep = PACER_INITIAL_MARGIN / 2.0;
+  p->devOversleep = PACER_INITIAL_MARGIN / (2.0 * PACER_MARGIN_DEVS);
+  p->wakeFD = -1;
+}
+
+/*************************************************************
+* Function: static int pacerSpinUntil(pacer *p, double now, double deadline)
+* 
+* Summary: sets the margin from the oversleep estimate, spins
+*          until the deadline and counts how late it is reached
+*
+************************************************/
+static int pacerSpinUntil(pacer *p, double now, double deadline)
+{
+  double lateness = 0.0;
+
+  p->margin = p->meanOversleep + PACER_MARGIN_DEVS * p->devOversleep;
+  if (p->margin < PACER_MIN_MARGIN)
+    p->margin = PACER_MIN_MARGIN;
+  if (p->margin > PACER_MAX_MARGIN)
+    p->margin = PACER_MAX_MARGIN;
+  while (now < deadline)
+    now = getTimestampD();
+
+  lateness = now - deadline;
+  p->sumLateness += lateness;
+  if (lateness > p->maxLateness)
+    p->maxLateness = lateness;
+  if (lateness > PACER_LATE)
+    p->numberLate++;
+  return NOERROR;
+}
+
+/*************************************************************
+* Function: int pacerWaitUntil(pacer *p, double deadline)
+* 
+* Summary: Delays until the deadline:  sleeps until p->margin
+*          before it, then spins.  How late each sleep ends
+*          tunes the margin so the sleep (almost) never ends
+*          after the deadline while little time is spun.
+*
+* Inputs: 
+*    pacer *p : the caller's pacer
+*    double deadline: a timestamp (getTimestampD) 
+*
+* outputs:  
+*   returns  ERROR (p->wakeFD became readable) or  NOERROR;
+*
+* notes:
+*   Replaces the busyWait over the whole gap and the
+*   experimental delay_kalman1/2.  The sleep has a timer slack
+*   (50 usecs by default):  the pacer thread should lower it
+*   (PR_SET_TIMERSLACK) so the margin can be small.
+*
+************************************************/
+int pacerWaitUntil(pacer *p, double deadline)
+{
+  struct timespec wakeTS;
+  double wakeTime = pacerWakeTime(p, deadline);
+  double now = getTimestampD();
+
+  if ((now < wakeTime) && (p->wakeFD != -1)) {
+    //ppoll's timeout is relative:  polled again until the wake time
+    struct pollfd wakePoll = {.fd = p->wakeFD, .events = POLLIN};
+    double gap;
+    while (now < wakeTime) {
+      gap = wakeTime - now;
+      convertD2TS(&gap, &wakeTS);
+      if (ppoll(&wakePoll, 1, &wakeTS, NULL) > 0)
+        return ERROR;
+      now = getTimestampD();
     }
-    // Compute the delay error in units of microseconds
-    // and cast to type double
-    err = (double)(timeval_diff(t2, t1)  - usec);
-    // printf("req: %ld adj: %ld err: %.5f (us)\n", usec, usec_adjusted, kalmanerr.x);
-    kalman_update(&kalmanerr, err);
+    return pacerWokeUp(p, wakeTime, deadline);
+  }
+  if (now < wakeTime) {
+    convertD2TS(&wakeTime, &wakeTS);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeTS, NULL) == EINTR)
+      ;
+    return pacerWokeUp(p, wakeTime, deadline);
+  }
+
+  p->numberWaits++;
+  if (now < deadline) {
+    //All spin:  decay the estimate so a margin that grew past the
+    //gap between deadlines (no more sleeps to measure) comes back down
+    p->meanOversleep -= p->meanOversleep / 16.0;
+    p->devOversleep -= p->devOversleep / 16.0;
+  }
+  return pacerSpinUntil(p, now, deadline);
 }
 
+/*************************************************************
+* Function: double pacerWakeTime(pacer *p, double deadline)
+* 
+* Summary: returns when a caller that does its own sleep
+*          (e.g., on an event loop timer) should wake up to
+*          reach the deadline:  p->margin before it
+*
+************************************************/
+double pacerWakeTime(pacer *p, double deadline)
+{
+  return deadline - p->margin;
+}
 
+/*************************************************************
+* Function: int pacerWokeUp(pacer *p, double wakeTime, double deadline)
+* 
+* Summary: The caller's sleep until wakeTime (pacerWakeTime) has
+*          ended:  counts how late it ended (this tunes the margin)
+*          and spins until the deadline
+*
+* outputs:  
+*   returns  ERROR or  NOERROR;
+*
+************************************************/
+int pacerWokeUp(pacer *p, double wakeTime, double deadline)
+{
+  double now = getTimestampD();
+  double oversleep = now - wakeTime;
+
+  p->numberWaits++;
+  p->numberSleeps++;
+  //mean and mean deviation of the oversleep (gains 1/8, 1/4)
+  p->devOversleep += (fabs(oversleep - p->meanOversleep) - p->devOversleep) / 4.0;
+  p->meanOversleep += (oversleep - p->meanOversleep) / 8.0;
+  return pacerSpinUntil(p, now, deadline);
+}
+
+/*************************************************************
+* Function: int printPacer(pacer *p, FILE *fileFID)
+* 
+* Summary: prints the pacer's counters (one line)
+*
+* outputs:  
+*   returns  ERROR or  NOERROR;
+*
+************************************************/
+int printPacer(pacer *p, FILE *fileFID)
+{
+  if ((p == NULL) || (fileFID == NULL))
+    return ERROR;
+  fprintf(fileFID, "pacer: waits:%lu sleeps:%lu late:%lu avg lateness:%1.9f max lateness:%1.9f margin:%1.9f \n",
+          (unsigned long)p->numberWaits, (unsigned long)p->numberSleeps, (unsigned long)p->numberLate,
+          (p->numberWaits > 0) ? p->sumLateness / (double)p->numberWaits : 0.0,
+          p->maxLateness, p->margin);
+  return NOERROR;
+}
+
+/*************************************************************
+* Function: void initTokenBucket(tokenBucket *b, double bitRate,
+*                                double depth, double now)
+* 
+* Summary: inits a full token bucket
+*
+* Inputs: 
+*    tokenBucket *b
+*    double bitRate : the fill rate (bits per second)
+*    double depth : the most bytes that may be sent at once
+*    double now : a timestamp (getTimestampD)
+*
+************************************************/
+void initTokenBucket(tokenBucket *b, double bitRate, double depth, double now)
+{
+  memset(b, 0, sizeof(tokenBucket));
+  b->rate = bitRate / 8.0;
+  b->depth = depth;
+  b->tokens = depth;
+  b->lastFill = now;
+}
 
+/*************************************************************
+* Function: uint32_t tokenBucketAvailable(tokenBucket *b, double now,
+*                                         uint32_t size, uint32_t max)
+* 
+* Summary: adds the tokens earned since the last call and
+*          returns how many size byte msgs they allow (at most max)
+*
+* outputs:  
+*   returns  the number of msgs that may be sent now
+*
+************************************************/
+uint32_t tokenBucketAvailable(tokenBucket *b, double now, uint32_t size, uint32_t max)
+{
+  double n = 0.0;
+
+  if (now > b->lastFill) {
+    b->tokens += (now - b->lastFill) * b->rate;
+    if (b->tokens > b->depth)
+      b->tokens = b->depth;
+    b->lastFill = now;
+  }
+  n = floor(b->tokens / (double)size);
+  return (n < (double)max) ? (uint32_t)n : max;
+}
+
+/*************************************************************
+* Function: void tokenBucketConsume(tokenBucket *b, uint32_t bytes)
+* 
+* Summary: takes the tokens of bytes that were sent
+*
+************************************************/
+void tokenBucketConsume(tokenBucket *b, uint32_t bytes)
+{
+  b->tokens -= (double)bytes;
+  b->bytesSent += bytes;
+}
+
+/*************************************************************
+* Function: double tokenBucketReadyTime(tokenBucket *b, uint32_t bytes)
+* 
+* Summary: returns the time (getTimestampD) the bucket will
+*          hold the tokens of bytes
+*
+************************************************/
+double tokenBucketReadyTime(tokenBucket *b, uint32_t bytes)
+{
+  if (b->tokens >= (double)bytes)
+    return b->lastFill;
+  b->numberStalls++;
+  return b->lastFill + ((double)bytes - b->tokens) / b->rate;
+}
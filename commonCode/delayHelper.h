@@ -16,9 +16,22 @@
 *    void delay_busyloop1 (unsigned long usec) {
 *    void delay_busyloop2 (unsigned long usec) {
 *
+*   The pacer (sleep then spin until a deadline):
+*       void initPacer(pacer *p)
+*       int pacerWaitUntil(pacer *p, double deadline)
+*       double pacerWakeTime(pacer *p, double deadline)
+*       int pacerWokeUp(pacer *p, double wakeTime, double deadline)
+*       int printPacer(pacer *p, FILE *fileFID)
+*
+*   The token bucket (a rate limit with bursts of up to depth bytes):
+*       void initTokenBucket(tokenBucket *b, double bitRate, double depth, double now)
+*       uint32_t tokenBucketAvailable(tokenBucket *b, double now, uint32_t size, uint32_t max)
+*       void tokenBucketConsume(tokenBucket *b, uint32_t bytes)
+*       double tokenBucketReadyTime(tokenBucket *b, uint32_t bytes)
+*
 * Notes:
 *
-* Last update: 4/17/2019
+* Last update: 10/17/2026
 *
 ************************************************************************/
 #ifndef	__delayHelper_h
@@ -130,22 +143,52 @@ int delay_busyloop2 (unsigned long usec);
 
 
 
-//This attempts to adjust to converge on an accurate delay
-//But...seems to need the right type of randomness to 
-// work properly
-// A much simpler algorithm would be better, safer.
-void delay_kalman1(unsigned long usecs);
-void delay_kalman2(unsigned long usecs);
-
-// Kalman filter states
-typedef struct kalman_state {
-    double q; //process noise covariance
-    double r; //measurement noise covariance
-    double x; //value
-    double p; //estimation error covariance
-    double k; //kalman gain
-} kalman_state;
-void delay_kalman(unsigned long usecs);
+//The pacer:  waits until a deadline by sleeping (clock_nanosleep TIMER_ABSTIME)
+//until margin seconds before it and then spinning.  The margin follows
+//how late the sleeps end (mean + PACER_MARGIN_DEVS * mean deviation).
+//With a wake fd (e.g., an eventfd) the sleep is a ppoll on it so the
+//waits can be ended (pacerWaitUntil returns ERROR).
+#define PACER_INITIAL_MARGIN 0.0001
+#define PACER_MIN_MARGIN 0.000002
+#define PACER_MAX_MARGIN 0.002
+#define PACER_MARGIN_DEVS 4.0
+//A wait that returns this long after its deadline is counted late
+#define PACER_LATE 0.000005
+
+typedef struct {
+  double margin;           //seconds
+  double meanOversleep;    //how long after the requested time the sleeps end
+  double devOversleep;
+  double maxLateness;      //of the waits (return time - deadline)
+  double sumLateness;
+  uint64_t numberWaits;
+  uint64_t numberSleeps;
+  uint64_t numberLate;
+  int wakeFD;              //readable: the sleeps end early (-1: none)
+} pacer;
+
+void initPacer(pacer *p);
+int pacerWaitUntil(pacer *p, double deadline);
+double pacerWakeTime(pacer *p, double deadline);
+int pacerWokeUp(pacer *p, double wakeTime, double deadline);
+int printPacer(pacer *p, FILE *fileFID);
+
+//The token bucket:  tokens (bytes) are added at rate up to depth.
+//A msg is sent when the bucket holds its size.  Times are timestamps
+//(getTimestampD).
+typedef struct {
+  double rate;             //bytes per second
+  double depth;            //bytes
+  double tokens;           //bytes
+  double lastFill;
+  uint64_t bytesSent;
+  uint64_t numberStalls;   //waits for tokens
+} tokenBucket;
+
+void initTokenBucket(tokenBucket *b, double bitRate, double depth, double now);
+uint32_t tokenBucketAvailable(tokenBucket *b, double now, uint32_t size, uint32_t max);
+void tokenBucketConsume(tokenBucket *b, uint32_t bytes);
+double tokenBucketReadyTime(tokenBucket *b, uint32_t bytes);
 
 #ifdef __cplusplus
 } /* end extern "C" */
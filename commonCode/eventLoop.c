@@ -0,0 +1,333 @@
+/*********************************************************
+*
+* Module Name: event loop
+*
+* File Name:  eventLoop.c
+*
+* Summary:  An epoll set of sockets and timerfd timers.  A loop
+*           waits in eventLoopWait for a socket to be readable or
+*           a timer (e.g., the next send time or the next probe
+*           loss deadline) to expire, with nsec timer resolution
+*           and no signals.
+*
+*  The methods include:
+*   eventLoop *createEventLoop();
+*   void freeEventLoop(eventLoop *l);
+*   int eventLoopAdd(eventLoop *l, int fd, uint32_t events, uint64_t tag);
+*   int eventLoopModify(eventLoop *l, int fd, uint32_t events, uint64_t tag);
+*   int eventLoopRemove(eventLoop *l, int fd);
+*   int eventLoopWait(eventLoop *l, int timeoutMsecs);
+*   int createEventTimer();
+*   int armEventTimer(int timerFD, double delay);
+*   int disarmEventTimer(int timerFD);
+*   uint64_t readEventTimer(int timerFD);
+*   int createEventWake();
+*   void signalEventWake(int wakeFD);
+*   int printEventLoop(eventLoop *l, FILE *fileFID);
+*
+* Notes:
+*   A loop is not thread safe:  one per thread.
+*
+* Last update: 10/17/2026
+*
+*********************************************************/
+#include "common.h"
+#include "eventLoop.h"
+
+//#define TRACEME 0
+
+/***********************************************************
+* Function: eventLoop *createEventLoop()
+*
+* Explanation:  creates an (empty) event loop.  The caller owns it.
+*
+* outputs:
+*    returns the loop or NULL on error
+*
+***********************************************************/
+eventLoop *createEventLoop()
+{
+  eventLoop *l = NULL;
+
+  l = calloc(1, sizeof(eventLoop));
+  if (l == NULL)
+    return NULL;
+  l->epollFD = epoll_create1(EPOLL_CLOEXEC);
+  if (l->epollFD < 0) {
+    printf("createEventLoop: epoll_create1 failed, errno:%d \n", errno);
+    free(l);
+    return NULL;
+  }
+  return l;
+}
+
+/***********************************************************
+* Function: void freeEventLoop(eventLoop *l)
+*
+* Explanation:  frees the loop.  The fds that were added are
+*               not closed.
+*
+***********************************************************/
+void freeEventLoop(eventLoop *l)
+{
+  if (l == NULL)
+    return;
+  close(l->epollFD);
+  free(l);
+}
+
+/***********************************************************
+* Function: int eventLoopAdd(eventLoop *l, int fd, uint32_t events, uint64_t tag)
+*
+* Explanation:  adds an fd to the loop
+*
+* inputs:
+*   int fd : a socket, timer (createEventTimer) ...
+*   uint32_t events : EPOLLIN, EPOLLOUT ... (EPOLLERR is always reported)
+*   uint64_t tag : returned (eventTag) with the fd's events
+*
+* outputs:
+*    returns ERROR or NOERROR
+*
+***********************************************************/
+int eventLoopAdd(eventLoop *l, int fd, uint32_t events, uint64_t tag)
+{
+  struct epoll_event ev;
+
+  memset(&ev, 0, sizeof(ev));
+  ev.events = events;
+  ev.data.u64 = tag;
+  if (epoll_ctl(l->epollFD, EPOLL_CTL_ADD, fd, &ev) < 0) {
+    printf("eventLoopAdd: epoll_ctl failed fd:%d, errno:%d \n", fd, errno);
+    return ERROR;
+  }
+  l->numberFDs++;
+  return NOERROR;
+}
+
+/***********************************************************
+* Function: int eventLoopModify(eventLoop *l, int fd, uint32_t events, uint64_t tag)
+*
+* Explanation:  changes the events (e.g., EPOLLIN to EPOLLOUT) and
+*               the tag of an fd in the loop
+*
+* outputs:
+*    returns ERROR or NOERROR
+*
+***********************************************************/
+int eventLoopModify(eventLoop *l, int fd, uint32_t events, uint64_t tag)
+{
+  struct epoll_event ev;
+
+  memset(&ev, 0, sizeof(ev));
+  ev.events = events;
+  ev.data.u64 = tag;
+  if (epoll_ctl(l->epollFD, EPOLL_CTL_MOD, fd, &ev) < 0) {
+    printf("eventLoopModify: epoll_ctl failed fd:%d, errno:%d \n", fd, errno);
+    return ERROR;
+  }
+  return NOERROR;
+}
+
+/***********************************************************
+* Function: int eventLoopRemove(eventLoop *l, int fd)
+*
+* Explanation:  removes an fd from the loop (before it is closed)
+*
+* outputs:
+*    returns ERROR or NOERROR
+*
+***********************************************************/
+int eventLoopRemove(eventLoop *l, int fd)
+{
+  if (epoll_ctl(l->epollFD, EPOLL_CTL_DEL, fd, NULL) < 0) {
+    printf("eventLoopRemove: epoll_ctl failed fd:%d, errno:%d \n", fd, errno);
+    return ERROR;
+  }
+  l->numberFDs--;
+  return NOERROR;
+}
+
+/***********************************************************
+* Function: int eventLoopWait(eventLoop *l, int timeoutMsecs)
+*
+* Explanation:  waits until an fd is ready (or the timeout).  The
+*               ready events are read with eventTag/eventFlags.
+*
+* inputs:
+*   int timeoutMsecs : -1: no timeout (a timer bounds the wait), 0: no wait
+*
+* outputs:
+*    returns the number of ready events (0: the timeout or a
+*    signal) or ERROR
+*
+***********************************************************/
+int eventLoopWait(eventLoop *l, int timeoutMsecs)
+{
+  int rc;
+
+  l->numberWaits++;
+  rc = epoll_wait(l->epollFD, l->events, EVENT_LOOP_MAX_EVENTS, timeoutMsecs);
+  if (rc < 0) {
+    l->numberReady = 0;
+    if (errno == EINTR)
+      return 0;
+    printf("eventLoopWait: epoll_wait failed, errno:%d \n", errno);
+    return ERROR;
+  }
+  l->numberReady = rc;
+  l->numberEvents += rc;
+  return rc;
+}
+
+/***********************************************************
+* Function: int createEventTimer()
+*
+* Explanation:  creates a (disarmed, non blocking) one shot timer
+*               to add to an event loop
+*
+* outputs:
+*    returns the timer's fd or ERROR
+*
+***********************************************************/
+int createEventTimer()
+{
+  int timerFD;
+
+  timerFD = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (timerFD < 0) {
+    printf("createEventTimer: timerfd_create failed, errno:%d \n", errno);
+    return ERROR;
+  }
+  return timerFD;
+}
+
+/***********************************************************
+* Function: int armEventTimer(int timerFD, double delay)
+*
+* Explanation:  (re)arms the timer to expire in delay seconds
+*
+* inputs:
+*   double delay : seconds.  0 or less expires at once.
+*
+* outputs:
+*    returns ERROR or NOERROR
+*
+***********************************************************/
+int armEventTimer(int timerFD, double delay)
+{
+  struct itimerspec its;
+
+  memset(&its, 0, sizeof(its));
+  //An all 0 it_value disarms:  1 nsec is "now"
+  if (delay < 0.000000001)
+    its.it_value.tv_nsec = 1;
+  else {
+    its.it_value.tv_sec = (time_t)delay;
+    its.it_value.tv_nsec = (long)((delay - (double)its.it_value.tv_sec) * 1000000000.0);
+    if (its.it_value.tv_nsec >= 1000000000L)
+      its.it_value.tv_nsec = 999999999L;
+    if ((its.it_value.tv_sec == 0) && (its.it_value.tv_nsec == 0))
+      its.it_value.tv_nsec = 1;
+  }
+  if (timerfd_settime(timerFD, 0, &its, NULL) < 0)
+    return ERROR;
+  return NOERROR;
+}
+
+/***********************************************************
+* Function: int disarmEventTimer(int timerFD)
+*
+* Explanation:  stops the timer (a pending expiration stays
+*               until it is read)
+*
+* outputs:
+*    returns ERROR or NOERROR
+*
+***********************************************************/
+int disarmEventTimer(int timerFD)
+{
+  struct itimerspec its;
+
+  memset(&its, 0, sizeof(its));
+  if (timerfd_settime(timerFD, 0, &its, NULL) < 0)
+    return ERROR;
+  return NOERROR;
+}
+
+/***********************************************************
+* Function: uint64_t readEventTimer(int timerFD)
+*
+* Explanation:  clears the timer's expiration so the loop stops
+*               reporting it
+*
+* outputs:
+*    returns the number of expirations since the last read (0: none)
+*
+***********************************************************/
+uint64_t readEventTimer(int timerFD)
+{
+  uint64_t numberExpirations = 0;
+
+  if (read(timerFD, &numberExpirations, sizeof(numberExpirations)) != sizeof(numberExpirations))
+    return 0;
+  return numberExpirations;
+}
+
+/***********************************************************
+* Function: int createEventWake()
+*
+* Explanation:  creates a (non blocking) wake fd to add to an event
+*               loop (or poll):  signalEventWake makes it readable
+*
+* outputs:
+*    returns the fd or ERROR
+*
+***********************************************************/
+int createEventWake()
+{
+  int wakeFD;
+
+  wakeFD = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wakeFD < 0) {
+    printf("createEventWake: eventfd failed, errno:%d \n", errno);
+    return ERROR;
+  }
+  return wakeFD;
+}
+
+/***********************************************************
+* Function: void signalEventWake(int wakeFD)
+*
+* Explanation:  makes the wake fd readable:  the waits on it return
+*
+* notes:
+*   Only a write(): safe in a signal handler.  The fd is not read
+*   so it stays readable (every later wait returns at once).
+*
+***********************************************************/
+void signalEventWake(int wakeFD)
+{
+  uint64_t one = 1;
+
+  if (write(wakeFD, &one, sizeof(one)) != sizeof(one))
+    return;
+}
+
+/***********************************************************
+* Function: int printEventLoop(eventLoop *l, FILE *fileFID)
+*
+* Explanation:  prints the loop's counters (one line)
+*
+* outputs:
+*    returns ERROR or NOERROR
+*
+***********************************************************/
+int printEventLoop(eventLoop *l, FILE *fileFID)
+{
+  if ((l == NULL) || (fileFID == NULL))
+    return ERROR;
+  fprintf(fileFID, "event loop: fds:%d waits:%lu events:%lu \n",
+          l->numberFDs, (unsigned long)l->numberWaits, (unsigned long)l->numberEvents);
+  return NOERROR;
+}
@@ -0,0 +1,96 @@
+/************************************************************************
+* File:  eventLoop.h
+*
+* Purpose:
+*   This include file is for the eventLoop module:  an epoll set that
+*   multiplexes sockets and timers (timerfd) so one thread waits for
+*   whichever comes first without signals (SIGALRM) or polling.
+*
+*   eventLoop *createEventLoop();
+*   void freeEventLoop(eventLoop *l);
+*   int eventLoopAdd(eventLoop *l, int fd, uint32_t events, uint64_t tag);
+*   int eventLoopModify(eventLoop *l, int fd, uint32_t events, uint64_t tag);
+*   int eventLoopRemove(eventLoop *l, int fd);
+*   int eventLoopWait(eventLoop *l, int timeoutMsecs);
+*   int createEventTimer();
+*   int armEventTimer(int timerFD, double delay);
+*   int disarmEventTimer(int timerFD);
+*   uint64_t readEventTimer(int timerFD);
+*   int createEventWake();
+*   void signalEventWake(int wakeFD);
+*   int printEventLoop(eventLoop *l, FILE *fileFID);
+*   static inline: eventTag, eventFlags
+*
+* Notes:
+*   Each fd is added with a tag (e.g., an index or a ptr) that the
+*   wait returns with its events.  The fds are level triggered:  a
+*   socket is reported until it is drained, a timer until it is read.
+*   Timers are one shot, armed with a delay in seconds (nsec
+*   resolution, CLOCK_MONOTONIC) so a deadline on any of the
+*   timestamp clocks (e.g., the TSC) is armed as deadline - now.
+*   A wake fd (eventfd) lets another thread or a signal handler end
+*   a wait:  once signaled it stays readable.
+*   Linux only (epoll, timerfd).
+*
+* Last update: 10/17/2026
+*
+*************************************************************************/
+#ifndef	__eventLoop_h
+#define	__eventLoop_h
+
+#include "common.h"
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+
+//Events returned by one wait
+#define EVENT_LOOP_MAX_EVENTS 64
+
+typedef struct {
+  int epollFD;
+  uint32_t numberFDs;
+  int numberReady;                 //of the last wait
+  struct epoll_event events[EVENT_LOOP_MAX_EVENTS];
+  uint64_t numberWaits;
+  uint64_t numberEvents;
+} eventLoop;
+
+eventLoop *createEventLoop();
+void freeEventLoop(eventLoop *l);
+int eventLoopAdd(eventLoop *l, int fd, uint32_t events, uint64_t tag);
+int eventLoopModify(eventLoop *l, int fd, uint32_t events, uint64_t tag);
+int eventLoopRemove(eventLoop *l, int fd);
+int eventLoopWait(eventLoop *l, int timeoutMsecs);
+int createEventTimer();
+int armEventTimer(int timerFD, double delay);
+int disarmEventTimer(int timerFD);
+uint64_t readEventTimer(int timerFD);
+int createEventWake();
+void signalEventWake(int wakeFD);
+int printEventLoop(eventLoop *l, FILE *fileFID);
+
+/***********************************************************
+* Function: static inline uint64_t eventTag(eventLoop *l, int index)
+*
+* Explanation:  returns the tag of ready event index (0 .. the
+*               wait's return - 1)
+*
+***********************************************************/
+static inline uint64_t eventTag(eventLoop *l, int index)
+{
+  return l->events[index].data.u64;
+}
+
+/***********************************************************
+* Function: static inline uint32_t eventFlags(eventLoop *l, int index)
+*
+* Explanation:  returns the EPOLLIN/EPOLLOUT/EPOLLERR.. of ready
+*               event index
+*
+***********************************************************/
+static inline uint32_t eventFlags(eventLoop *l, int index)
+{
+  return l->events[index].events;
+}
+
+#endif
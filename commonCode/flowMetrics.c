@@ -0,0 +1,403 @@
+/*********************************************************
+*
+* Module Name: flow metrics
+*
+* File Name:  flowMetrics.c
+*
+* Summary:  The per flow delay variation (RFC 3550 jitter, IPDV),
+*           sequence (RFC 4737 reordering, duplicates) and loss run
+*           (burst lengths, Gilbert-Elliott) metrics.
+*
+*  The methods include:
+*   void initFlowMetrics(flowMetrics *f);
+*   int flowMetricsRx(flowMetrics *f, uint32_t seq, double OWD);
+*   void flushFlowMetrics(flowMetrics *f);
+*   double flowReorderRatio(flowMetrics *f);
+*   int printFlowMetrics(flowMetrics *f, FILE *fileFID);
+*   void addLossRunStats(lossRunStats *totalPtr, lossRunStats *l);
+*   void diffLossRunStats(lossRunStats *diffPtr, lossRunStats *cur, lossRunStats *start);
+*   void getGilbertElliott(lossRunStats *l, double *pPtr, double *rPtr);
+*   int printLossRunStats(lossRunStats *l, double duration, FILE *fileFID);
+*
+* Notes:
+*   Seq numbers start at 1 (NextExp starts at 1) and may wrap:  they
+*   are compared as serial numbers (SEQ_LT, as in probeWindow.c).
+*
+* Last update: 10/17/2026
+*
+*********************************************************/
+#include "common.h"
+#include "flowMetrics.h"
+
+//#define TRACEME 0
+
+//Serial number order (RFC 1982):  correct across the 32 bit wrap
+#define SEQ_LT(a,b) ((int32_t)((uint32_t)(a) - (uint32_t)(b)) < 0)
+
+/***********************************************************
+* Function: static inline bool testSeqBit(flowMetrics *f, uint32_t seq)
+*
+* Explanation:  true if seq (in the window) was received
+*
+***********************************************************/
+static inline bool testSeqBit(flowMetrics *f, uint32_t seq)
+{
+  uint32_t bit = seq & (FLOW_SEQ_WINDOW - 1);
+
+  return (f->seqBits[bit >> 6] & (1ULL << (bit & 63))) != 0;
+}
+
+/***********************************************************
+* Function: static inline void setSeqBit(flowMetrics *f, uint32_t seq, bool received)
+*
+* Explanation:  marks seq received (or, when the window slides over
+*               it, not received)
+*
+***********************************************************/
+static inline void setSeqBit(flowMetrics *f, uint32_t seq, bool received)
+{
+  uint32_t bit = seq & (FLOW_SEQ_WINDOW - 1);
+
+  if (received)
+    f->seqBits[bit >> 6] |= (1ULL << (bit & 63));
+  else
+    f->seqBits[bit >> 6] &= ~(1ULL << (bit & 63));
+}
+
+/***********************************************************
+* Function: static inline void countFinalSeqs(lossRunStats *l, bool first, bool lastLost,
+*                                             bool lost, uint32_t count, uint32_t endedRun)
+*
+* Explanation:  counts count seqs (lost or received) that left the
+*               window and the loss run (endedRun lost seqs, 0: none)
+*               the first of them ended
+*
+***********************************************************/
+static inline void countFinalSeqs(lossRunStats *l, bool first, bool lastLost,
+                                  bool lost, uint32_t count, uint32_t endedRun)
+{
+  if (count > 0) {
+    if (!first)
+      l->transitions[lastLost][lost]++;
+    l->transitions[lost][lost] += count - 1;
+    l->numberFinal += count;
+    if (lost)
+      l->numberLost += count;
+  }
+  if (endedRun > 0) {
+    l->numberRuns++;
+    l->runSeqs += endedRun;
+    if (endedRun > l->maxRun)
+      l->maxRun = endedRun;
+    l->runBins[((endedRun < FLOW_LOSS_RUN_BINS) ? endedRun : FLOW_LOSS_RUN_BINS) - 1]++;
+  }
+}
+
+/***********************************************************
+* Function: static void finalizeSeqs(flowMetrics *f, bool lost, uint32_t count)
+*
+* Explanation:  count seqs (the oldest first) left the window,
+*               all of them lost or all received
+*
+***********************************************************/
+static void finalizeSeqs(flowMetrics *f, bool lost, uint32_t count)
+{
+  bool first = (f->loss.numberFinal == 0);
+  uint32_t endedRun = 0;
+
+  if (lost)
+    f->lossRun += count;
+  else if (f->lossRun > 0) {
+    endedRun = f->lossRun;
+    f->lossRun = 0;
+  }
+  countFinalSeqs(&f->loss, first, f->lastLost, lost, count, endedRun);
+  if (f->lossTotals != NULL)
+    countFinalSeqs(f->lossTotals, first, f->lastLost, lost, count, endedRun);
+  if (f->lossInterval != NULL)
+    countFinalSeqs(f->lossInterval, first, f->lastLost, lost, count, endedRun);
+  f->lastLost = lost;
+}
+
+/***********************************************************
+* Function: void initFlowMetrics(flowMetrics *f)
+*
+* Explanation:  starts a flow (no arrivals, NextExp 1)
+*
+***********************************************************/
+void initFlowMetrics(flowMetrics *f)
+{
+  memset(f, 0, sizeof(flowMetrics));
+  f->nextExp = 1;
+}
+
+/***********************************************************
+* Function: int flowMetricsRx(flowMetrics *f, uint32_t seq, double OWD)
+*
+* Explanation:  updates the flow's metrics with an arrival
+*
+* inputs:
+*   flowMetrics *f : the flow
+*   uint32_t seq : the arrival's seq number
+*   double OWD : its one way delay (arrival - send time, any offset)
+*
+* outputs:
+*    returns FLOW_IN_ORDER (f->lastGap: the seqs it skipped),
+*    FLOW_REORDERED, FLOW_DUPLICATE or FLOW_TOO_OLD
+*
+* notes:
+*   The duplicates and too old arrivals do not update the jitter
+*   or the IPDV.
+*
+***********************************************************/
+int flowMetricsRx(flowMetrics *f, uint32_t seq, double OWD)
+{
+  uint32_t index = ++f->numberArrivals;
+  uint32_t numberPassed;
+  uint32_t numberLeaving;
+  uint32_t oldestSeq;
+  uint32_t extent;
+  uint32_t i;
+  int rxClass;
+  double D;
+
+  if (!SEQ_LT(seq, f->nextExp)) {
+    //The seqs nextExp .. seq enter the window:  the oldest ones leave it so it
+    //holds at most FLOW_SEQ_WINDOW (the ones in it first, oldest first)
+    numberPassed = seq - f->nextExp + 1;
+    numberLeaving = 0;
+    if (numberPassed > FLOW_SEQ_WINDOW - f->windowSeqs)
+      numberLeaving = numberPassed - (FLOW_SEQ_WINDOW - f->windowSeqs);
+    oldestSeq = f->nextExp - f->windowSeqs;
+    for (i = 0; (i < numberLeaving) && (i < f->windowSeqs); i++)
+      finalizeSeqs(f, !testSeqBit(f, oldestSeq + i), 1);
+    //A jump over more than the window:  the seqs that never entered it are lost
+    if (numberLeaving > f->windowSeqs)
+      finalizeSeqs(f, true, numberLeaving - f->windowSeqs);
+    f->windowSeqs += numberPassed - numberLeaving;
+
+    //this arrival is the first above each of the skipped ones
+    if (numberPassed > FLOW_SEQ_WINDOW)
+      numberPassed = FLOW_SEQ_WINDOW;
+    for (i = 0; i < numberPassed; i++) {
+      setSeqBit(f, seq - i, false);
+      f->passedIndex[(seq - i) & (FLOW_SEQ_WINDOW - 1)] = (uint16_t)index;
+    }
+    setSeqBit(f, seq, true);
+    f->lastGap = seq - f->nextExp;
+    f->nextExp = seq + 1;
+    f->numberUnique++;
+    rxClass = FLOW_IN_ORDER;
+  } else if ((int32_t)(f->nextExp - seq) > FLOW_SEQ_WINDOW) {
+    f->numberTooOld++;
+    return FLOW_TOO_OLD;
+  } else if (testSeqBit(f, seq)) {
+    f->numberDuplicates++;
+    return FLOW_DUPLICATE;
+  } else {
+    setSeqBit(f, seq, true);
+    extent = (uint16_t)((uint16_t)index - f->passedIndex[seq & (FLOW_SEQ_WINDOW - 1)]);
+    f->numberReordered++;
+    f->numberUnique++;
+    f->extentSum += extent;
+    if (extent > f->maxExtent)
+      f->maxExtent = extent;
+    f->extentBins[((extent < FLOW_EXTENT_BINS) ? extent : FLOW_EXTENT_BINS) - 1]++;
+    rxClass = FLOW_REORDERED;
+  }
+
+  //RFC 3550 6.4.1:  D is the transit time change between successive arrivals
+  if (f->numberUnique > 1) {
+    D = OWD - f->lastTransit;
+    f->jitter += (fabs(D) - f->jitter) * FLOW_JITTER_GAIN;
+  }
+  f->lastTransit = OWD;
+
+  if ((f->numberUnique > 1) && (seq == f->lastSeq + 1)) {
+    f->ipdv = OWD - f->lastOWD;
+    if ((f->ipdvCount == 0) || (f->ipdv < f->ipdvMin))
+      f->ipdvMin = f->ipdv;
+    if ((f->ipdvCount == 0) || (f->ipdv > f->ipdvMax))
+      f->ipdvMax = f->ipdv;
+    f->ipdvSum += f->ipdv;
+    f->ipdvAbsSum += fabs(f->ipdv);
+    f->ipdvCount++;
+  }
+  f->lastSeq = seq;
+  f->lastOWD = OWD;
+  return rxClass;
+}
+
+/***********************************************************
+* Function: void flushFlowMetrics(flowMetrics *f)
+*
+* Explanation:  the seqs in the window leave it (the ones not
+*               received are lost) and a loss run at the end is
+*               ended:  the loss run stats then cover all the seqs
+*               up to the largest one received
+*
+* notes:
+*   The flow is done:  later arrivals are not counted right.  A
+*   report flushes a copy (with lossTotals and lossInterval NULL).
+*
+***********************************************************/
+void flushFlowMetrics(flowMetrics *f)
+{
+  uint32_t finalSeq = f->nextExp - f->windowSeqs;
+
+  for (; f->windowSeqs > 0; f->windowSeqs--, finalSeq++)
+    finalizeSeqs(f, !testSeqBit(f, finalSeq), 1);
+  if (f->lossRun > 0) {
+    countFinalSeqs(&f->loss, false, true, true, 0, f->lossRun);
+    if (f->lossTotals != NULL)
+      countFinalSeqs(f->lossTotals, false, true, true, 0, f->lossRun);
+    if (f->lossInterval != NULL)
+      countFinalSeqs(f->lossInterval, false, true, true, 0, f->lossRun);
+    f->lossRun = 0;
+  }
+}
+
+/***********************************************************
+* Function: double flowReorderRatio(flowMetrics *f)
+*
+* Explanation:  returns the RFC 4737 reordered ratio:  the reordered
+*               packets / the (unique) packets received
+*
+***********************************************************/
+double flowReorderRatio(flowMetrics *f)
+{
+  return (f->numberUnique > 0) ? (double)f->numberReordered / (double)f->numberUnique : 0.0;
+}
+
+/***********************************************************
+* Function: int printFlowMetrics(flowMetrics *f, FILE *fileFID)
+*
+* Explanation:  displays the flow's metrics on one line:
+*   jitter avgIPDV avg|IPDV| minIPDV maxIPDV reordered ratio
+*   avgExtent maxExtent duplicates tooOld, then the extent bins
+*
+* outputs:
+*    returns ERROR or NOERROR
+*
+***********************************************************/
+int printFlowMetrics(flowMetrics *f, FILE *fileFID)
+{
+  int i;
+
+  if ((f == NULL) || (fileFID == NULL))
+    return ERROR;
+  fprintf(fileFID, "%2.9f %2.9f %2.9f %2.9f %2.9f %d %1.6f %2.2f %d %d %d ",
+          f->jitter,
+          (f->ipdvCount > 0) ? f->ipdvSum / f->ipdvCount : 0.0,
+          (f->ipdvCount > 0) ? f->ipdvAbsSum / f->ipdvCount : 0.0,
+          f->ipdvMin, f->ipdvMax,
+          f->numberReordered, flowReorderRatio(f),
+          (f->numberReordered > 0) ? (double)f->extentSum / f->numberReordered : 0.0,
+          f->maxExtent, f->numberDuplicates, f->numberTooOld);
+  for (i = 0; i < FLOW_EXTENT_BINS; i++)
+    fprintf(fileFID, "%d ", f->extentBins[i]);
+  fprintf(fileFID, "\n");
+  return NOERROR;
+}
+
+/***********************************************************
+* Function: void addLossRunStats(lossRunStats *totalPtr, lossRunStats *l)
+*
+* Explanation:  adds the loss run stats l to the totals
+*
+***********************************************************/
+void addLossRunStats(lossRunStats *totalPtr, lossRunStats *l)
+{
+  int i;
+
+  totalPtr->numberFinal += l->numberFinal;
+  totalPtr->numberLost += l->numberLost;
+  totalPtr->numberRuns += l->numberRuns;
+  totalPtr->runSeqs += l->runSeqs;
+  if (l->maxRun > totalPtr->maxRun)
+    totalPtr->maxRun = l->maxRun;
+  for (i = 0; i < 2; i++) {
+    totalPtr->transitions[i][0] += l->transitions[i][0];
+    totalPtr->transitions[i][1] += l->transitions[i][1];
+  }
+  for (i = 0; i < FLOW_LOSS_RUN_BINS; i++)
+    totalPtr->runBins[i] += l->runBins[i];
+}
+
+/***********************************************************
+* Function: void diffLossRunStats(lossRunStats *diffPtr, lossRunStats *cur, lossRunStats *start)
+*
+* Explanation:  the loss run stats of an interval:  cur - start
+*
+* notes:
+*   maxRun is not an interval one:  it is cur's
+*
+***********************************************************/
+void diffLossRunStats(lossRunStats *diffPtr, lossRunStats *cur, lossRunStats *start)
+{
+  int i;
+
+  diffPtr->numberFinal = cur->numberFinal - start->numberFinal;
+  diffPtr->numberLost = cur->numberLost - start->numberLost;
+  diffPtr->numberRuns = cur->numberRuns - start->numberRuns;
+  diffPtr->runSeqs = cur->runSeqs - start->runSeqs;
+  diffPtr->maxRun = cur->maxRun;
+  for (i = 0; i < 2; i++) {
+    diffPtr->transitions[i][0] = cur->transitions[i][0] - start->transitions[i][0];
+    diffPtr->transitions[i][1] = cur->transitions[i][1] - start->transitions[i][1];
+  }
+  for (i = 0; i < FLOW_LOSS_RUN_BINS; i++)
+    diffPtr->runBins[i] = cur->runBins[i] - start->runBins[i];
+}
+
+/***********************************************************
+* Function: void getGilbertElliott(lossRunStats *l, double *pPtr, double *rPtr)
+*
+* Explanation:  the Gilbert-Elliott model (h = 1, k = 0) of the losses:
+*   p = P(good->bad) = received->lost / received->any
+*   r = P(bad->good) = lost->received / lost->any
+*
+* outputs:
+*    *pPtr, *rPtr (0.0 when the state was never seen)
+*
+***********************************************************/
+void getGilbertElliott(lossRunStats *l, double *pPtr, double *rPtr)
+{
+  uint32_t fromGood = l->transitions[0][0] + l->transitions[0][1];
+  uint32_t fromBad = l->transitions[1][0] + l->transitions[1][1];
+
+  *pPtr = (fromGood > 0) ? (double)l->transitions[0][1] / (double)fromGood : 0.0;
+  *rPtr = (fromBad > 0) ? (double)l->transitions[1][0] / (double)fromBad : 0.0;
+}
+
+/***********************************************************
+* Function: int printLossRunStats(lossRunStats *l, double duration, FILE *fileFID)
+*
+* Explanation:  displays the loss runs on one line:  the loss events
+*   (per seq and, when duration > 0, per second), the mean and
+*   largest run, the Gilbert-Elliott p, r and its loss rate and the
+*   run length bins (1 .. FLOW_LOSS_RUN_BINS, the last:  larger)
+*
+* outputs:
+*    returns ERROR or NOERROR
+*
+***********************************************************/
+int printLossRunStats(lossRunStats *l, double duration, FILE *fileFID)
+{
+  double p, r;
+  int i;
+
+  if ((l == NULL) || (fileFID == NULL))
+    return ERROR;
+  getGilbertElliott(l, &p, &r);
+  fprintf(fileFID, "lossRuns:%d, lossEventRate:%1.6f (%2.2f/sec), avgRun:%2.2f, maxRun:%d, GE p:%1.6f r:%1.6f loss:%1.6f, runs: ",
+          l->numberRuns,
+          (l->numberFinal > 0) ? (double)l->numberRuns / l->numberFinal : 0.0,
+          (duration > 0.0) ? l->numberRuns / duration : 0.0,
+          (l->numberRuns > 0) ? (double)l->runSeqs / l->numberRuns : 0.0,
+          l->maxRun, p, r, ((p + r) > 0.0) ? p / (p + r) : 0.0);
+  for (i = 0; i < FLOW_LOSS_RUN_BINS; i++)
+    fprintf(fileFID, "%d ", l->runBins[i]);
+  fprintf(fileFID, "\n");
+  return NOERROR;
+}
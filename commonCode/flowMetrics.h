@@ -0,0 +1,136 @@
+/************************************************************************
+* File:  flowMetrics.h
+*
+* Purpose:
+*   This include file is for the flowMetrics module:  the delay
+*   variation and sequence metrics of one flow (e.g., a server
+*   session), updated with each arrival:
+*     RFC 3550 interarrival jitter,
+*     IPDV (RFC 3393) of consecutive seq numbers,
+*     RFC 4737 reordering (ratio, extent and its distribution),
+*     duplicates (a sliding bitmap of the seq numbers received),
+*     loss runs (bursts):  their lengths, the loss event rate and
+*     the Gilbert-Elliott model of the losses.
+*
+*   void initFlowMetrics(flowMetrics *f);
+*   int flowMetricsRx(flowMetrics *f, uint32_t seq, double OWD);
+*   void flushFlowMetrics(flowMetrics *f);
+*   double flowReorderRatio(flowMetrics *f);
+*   int printFlowMetrics(flowMetrics *f, FILE *fileFID);
+*   void addLossRunStats(lossRunStats *totalPtr, lossRunStats *l);
+*   void diffLossRunStats(lossRunStats *diffPtr, lossRunStats *cur, lossRunStats *start);
+*   void getGilbertElliott(lossRunStats *l, double *pPtr, double *rPtr);
+*   int printLossRunStats(lossRunStats *l, double duration, FILE *fileFID);
+*
+* Notes:
+*   An arrival is O(1) (a gap costs one step per skipped seq, at most
+*   FLOW_SEQ_WINDOW) and nothing is allocated:  the struct is
+*   embedded in its flow.
+*   The window covers the FLOW_SEQ_WINDOW seq numbers below NextExp
+*   (the largest seq + 1).  An arrival below it can not be told from
+*   a duplicate:  it is counted as too old.  Seqs are compared in
+*   serial number space (RFC 1982), so the 32 bit seq may wrap.
+*   The jitter is the RFC 3550 estimate J += (|D| - J)/16 with D the
+*   change of the transit time (the one way delay:  the clock offset
+*   cancels) between successive arrivals.  The IPDV is the one way
+*   delay change of a packet and the one with the previous seq when
+*   that one was the previous arrival.
+*   A reordered packet's extent (RFC 4737 4.2) is the number of
+*   arrivals since the first one with a larger seq.
+*   A seq is lost when it leaves the window without being received
+*   (a late arrival inside the window is not a loss):  the loss runs
+*   lag the arrivals by FLOW_SEQ_WINDOW seqs, flushFlowMetrics ends
+*   them (e.g., on a copy, for a report).  The Gilbert-Elliott model
+*   is the two state one with no loss in the good state and only
+*   losses in the bad state (h = 1):  p = P(good->bad) and
+*   r = P(bad->good) are counted from the transitions of the seqs,
+*   the mean burst is 1/r and the loss rate p/(p+r).
+*
+* Last update: 10/17/2026
+*
+*************************************************************************/
+#ifndef	__flowMetrics_h
+#define	__flowMetrics_h
+
+#include "common.h"
+
+//Seq numbers tracked below NextExp (a power of 2, a multiple of 64)
+#define FLOW_SEQ_WINDOW 128
+//Reorder extents 1 .. FLOW_EXTENT_BINS - 1, the last bin:  larger
+#define FLOW_EXTENT_BINS 16
+//RFC 3550:  the jitter estimate's gain is 1/16
+#define FLOW_JITTER_GAIN (1.0 / 16.0)
+
+//Loss run (burst) lengths 1 .. FLOW_LOSS_RUN_BINS - 1, the last bin:  larger
+#define FLOW_LOSS_RUN_BINS 12
+
+//Arrival classes
+#define FLOW_IN_ORDER  0      //seq >= NextExp (it may skip seqs:  lastGap)
+#define FLOW_REORDERED 1      //seq < NextExp, the first copy
+#define FLOW_DUPLICATE 2      //seq received before
+#define FLOW_TOO_OLD   3      //below the window:  reordered or a duplicate
+
+//The seqs that left the window:  lost or received, the loss runs
+typedef struct {
+  uint32_t numberFinal;
+  uint32_t numberLost;
+  uint32_t numberRuns;             //loss events
+  uint32_t runSeqs;                //the lost seqs of the (ended) runs
+  uint32_t maxRun;
+  uint32_t transitions[2][2];      //[previous seq lost][this seq lost]
+  uint32_t runBins[FLOW_LOSS_RUN_BINS];
+} lossRunStats;
+
+typedef struct {
+  uint32_t nextExp;                //RFC 4737 NextExp
+  uint32_t lastGap;                //seqs the last in order arrival skipped
+  uint32_t numberArrivals;         //all of them (the arrival index)
+  uint32_t numberUnique;           //in order + reordered
+  uint32_t numberReordered;
+  uint32_t numberDuplicates;
+  uint32_t numberTooOld;
+  uint32_t maxExtent;
+  uint64_t extentSum;
+  uint32_t extentBins[FLOW_EXTENT_BINS];
+
+  //RFC 3550 jitter (seconds)
+  double jitter;
+  double lastTransit;
+
+  //IPDV (seconds) of consecutive seqs
+  uint32_t lastSeq;                //of the last (not duplicate) arrival
+  double lastOWD;
+  double ipdv;
+  double ipdvSum;
+  double ipdvAbsSum;
+  double ipdvMin;
+  double ipdvMax;
+  uint32_t ipdvCount;
+
+  //The seqs nextExp - FLOW_SEQ_WINDOW .. nextExp - 1, by seq % FLOW_SEQ_WINDOW:
+  //received, and the (low 16 bits of the) index of the first arrival above the seq
+  uint64_t seqBits[FLOW_SEQ_WINDOW / 64];
+  uint16_t passedIndex[FLOW_SEQ_WINDOW];
+  uint32_t windowSeqs;             //seqs in the window (fewer than FLOW_SEQ_WINDOW at the start)
+
+  //Loss runs:  the current one (lost seqs) and the totals.  When set,
+  //lossTotals (e.g., of the flows of a worker) and lossInterval (of
+  //the current interval) are updated too
+  uint32_t lossRun;
+  bool lastLost;
+  lossRunStats loss;
+  lossRunStats *lossTotals;
+  lossRunStats *lossInterval;
+} flowMetrics;
+
+void initFlowMetrics(flowMetrics *f);
+int flowMetricsRx(flowMetrics *f, uint32_t seq, double OWD);
+void flushFlowMetrics(flowMetrics *f);
+double flowReorderRatio(flowMetrics *f);
+int printFlowMetrics(flowMetrics *f, FILE *fileFID);
+void addLossRunStats(lossRunStats *totalPtr, lossRunStats *l);
+void diffLossRunStats(lossRunStats *diffPtr, lossRunStats *cur, lossRunStats *start);
+void getGilbertElliott(lossRunStats *l, double *pPtr, double *rPtr);
+int printLossRunStats(lossRunStats *l, double duration, FILE *fileFID);
+
+#endif
@@ -0,0 +1,357 @@
+/*********************************************************
+*
+* Module Name: interval stats
+*
+* File Name:  intervalStats.c
+*
+* Summary:  Double buffered (two epoch) interval counters and the
+*           reporter thread that swaps the epochs and reports the
+*           1/10/60 ... second windows.
+*
+*  The methods include:
+*   intervalStats *createIntervalStats();
+*   void freeIntervalStats(intervalStats *s);
+*   int parseIntervalWindows(const char *list, double *windowSecs, uint32_t maxWindows);
+*   intervalReporter *startIntervalReporter(const char *name, intervalStats **sources,
+*                        uint32_t numberSources, const char **histNames, uint32_t numberHists,
+*                        double *windowSecs, uint32_t numberWindows, int cpu);
+*   void stopIntervalReporter(intervalReporter *r);
+*   int printIntervalCounters(intervalCounters *c, uint32_t numberHists, const char **histNames,
+*                             const char *name, double duration, FILE *fileFID);
+*
+* Notes:
+*   The reports go to stdout.  Each line starts with the wall time
+*   and "interval <secs>s".
+*
+* Last update: 10/17/2026
+*
+*********************************************************/
+#include "common.h"
+#include "utils.h"
+#include "intervalStats.h"
+#include <stddef.h>
+
+//#define TRACEME 0
+
+static void *reporterLoop(void *arg);
+static void reportTick(intervalReporter *r, double curTime);
+static void addIntervalCounters(intervalCounters *totalPtr, intervalCounters *c, uint32_t numberHists);
+static void resetIntervalCounters(intervalCounters *c, uint32_t numberHists);
+
+/***********************************************************
+* Function: intervalStats *createIntervalStats()
+*
+* Explanation:  creates the (cleared) epochs of a writer
+*
+* outputs:
+*    returns the stats or NULL on error
+*
+***********************************************************/
+intervalStats *createIntervalStats()
+{
+  intervalStats *s = aligned_alloc(CACHE_LINE_SIZE, sizeof(intervalStats));
+
+  if (s == NULL) {
+    printf("createIntervalStats: failed to allocate %lu bytes \n", (unsigned long)sizeof(intervalStats));
+    return NULL;
+  }
+  memset(s, 0, sizeof(intervalStats));
+  return s;
+}
+
+/***********************************************************
+* Function: void freeIntervalStats(intervalStats *s)
+*
+* Explanation:  frees the stats (the reporter must be stopped)
+*
+***********************************************************/
+void freeIntervalStats(intervalStats *s)
+{
+  free(s);
+}
+
+/***********************************************************
+* Function: int parseIntervalWindows(const char *list, double *windowSecs, uint32_t maxWindows)
+*
+* Explanation:  parses a list of window lengths (seconds, comma
+*               separated, e.g. 1,10,60).  The first is the tick:
+*               it must be the shortest.  0 is no windows.
+*
+* outputs:
+*    returns the number of windows or ERROR
+*
+***********************************************************/
+int parseIntervalWindows(const char *list, double *windowSecs, uint32_t maxWindows)
+{
+  uint32_t numberWindows = 0;
+  const char *p = list;
+  char *end = NULL;
+
+  while ((p != NULL) && (*p != '\0')) {
+    if (numberWindows == maxWindows) {
+      printf("parseIntervalWindows: at most %d windows (%s) \n", maxWindows, list);
+      return ERROR;
+    }
+    windowSecs[numberWindows] = strtod(p, &end);
+    if ((numberWindows == 0) && (end != p) && (*end == '\0') && (windowSecs[0] == 0.0))
+      return 0;
+    if ((end == p) || (windowSecs[numberWindows] <= 0.0) ||
+        (windowSecs[numberWindows] < windowSecs[0])) {
+      printf("parseIntervalWindows: bad window list %s \n", list);
+      return ERROR;
+    }
+    numberWindows++;
+    p = (*end == ',') ? end + 1 : NULL;
+    if ((p == NULL) && (*end != '\0')) {
+      printf("parseIntervalWindows: bad window list %s \n", list);
+      return ERROR;
+    }
+  }
+  return (int)numberWindows;
+}
+
+/***********************************************************
+* Function: intervalReporter *startIntervalReporter(const char *name, intervalStats **sources,
+*                        uint32_t numberSources, const char **histNames, uint32_t numberHists,
+*                        double *windowSecs, uint32_t numberWindows, int cpu)
+*
+* Explanation:  starts the thread that swaps the sources' epochs
+*               every windowSecs[0] and reports the windows.  The
+*               caller owns the reporter.
+*
+* inputs:
+*   const char *name : of the reports (e.g. client)
+*   intervalStats **sources : one per writer (the array is copied,
+*                             the stats are not owned)
+*   const char **histNames : of the latency histograms (e.g. RTT)
+*   double *windowSecs : the window lengths, the first is the tick
+*   int cpu : pin the thread to this CPU (-1: not pinned)
+*
+* outputs:
+*    returns the reporter or NULL on error
+*
+***********************************************************/
+intervalReporter *startIntervalReporter(const char *name, intervalStats **sources,
+                                        uint32_t numberSources, const char **histNames, uint32_t numberHists,
+                                        double *windowSecs, uint32_t numberWindows, int cpu)
+{
+  intervalReporter *r = NULL;
+  double curTime = getCurTimeD();
+  uint32_t i;
+  int rc;
+
+  if ((numberWindows == 0) || (numberWindows > INTERVAL_MAX_WINDOWS) ||
+      (numberHists > INTERVAL_MAX_HISTS) || (windowSecs[0] <= 0.0)) {
+    printf("startIntervalReporter: bad params windows:%d hists:%d \n", numberWindows, numberHists);
+    return NULL;
+  }
+  r = calloc(1, sizeof(intervalReporter));
+  if (r != NULL)
+    r->sources = calloc(numberSources, sizeof(intervalStats *));
+  if ((r == NULL) || (r->sources == NULL)) {
+    printf("startIntervalReporter: failed to allocate the reporter \n");
+    free(r);
+    return NULL;
+  }
+  snprintf(r->name, sizeof(r->name), "%s", name);
+  memcpy(r->sources, sources, numberSources * sizeof(intervalStats *));
+  r->numberSources = numberSources;
+  for (i = 0; i < numberHists; i++)
+    r->histNames[i] = histNames[i];
+  r->numberHists = numberHists;
+  r->tickSecs = windowSecs[0];
+  r->numberWindows = numberWindows;
+  for (i = 0; i < numberWindows; i++) {
+    r->windows[i].numberTicks = (uint32_t)(windowSecs[i] / r->tickSecs + 0.5);
+    if (r->windows[i].numberTicks == 0)
+      r->windows[i].numberTicks = 1;
+    r->windows[i].secs = r->windows[i].numberTicks * r->tickSecs;
+    r->windows[i].startTime = curTime;
+  }
+  r->cpu = cpu;
+
+  r->running = true;
+  rc = pthread_create(&r->thread, NULL, reporterLoop, r);
+  if (rc != 0) {
+    printf("startIntervalReporter: pthread_create failed rc:%d \n", rc);
+    free(r->sources);
+    free(r);
+    return NULL;
+  }
+  return r;
+}
+
+/***********************************************************
+* Function: void stopIntervalReporter(intervalReporter *r)
+*
+* Explanation:  stops the thread (within INTERVAL_WAIT_MSECS) and
+*               frees the reporter.  The windows that have not
+*               ended are not reported.
+*
+***********************************************************/
+void stopIntervalReporter(intervalReporter *r)
+{
+  if (r == NULL)
+    return;
+  __atomic_store_n(&r->running, false, __ATOMIC_RELEASE);
+  pthread_join(r->thread, NULL);
+  free(r->sources);
+  free(r);
+}
+
+/***********************************************************
+* Function: int printIntervalCounters(intervalCounters *c, uint32_t numberHists, const char **histNames,
+*                                     const char *name, double duration, FILE *fileFID)
+*
+* Explanation:  displays the counts and rates of a window, its loss
+*               runs (if any seqs left a flow's window) and its
+*               latency histograms (min/avg/percentiles/max), each
+*               line starting with name
+*
+* outputs:
+*    returns ERROR or NOERROR
+*
+***********************************************************/
+int printIntervalCounters(intervalCounters *c, uint32_t numberHists, const char **histNames,
+                          const char *name, double duration, FILE *fileFID)
+{
+  char histName[96];
+  uint32_t i;
+
+  if ((c == NULL) || (fileFID == NULL))
+    return ERROR;
+  fprintf(fileFID, "%s: sent:%lu, rx:%lu, lost:%lu, late:%lu, lossRate:%1.6f, txRate:%1.0f bps, rxRate:%1.0f bps \n",
+          name, (unsigned long)c->numberSent, (unsigned long)c->numberReceived,
+          (unsigned long)c->numberLost, (unsigned long)c->numberLate,
+          ((c->numberReceived + c->numberLost) > 0) ?
+            (double)c->numberLost / (double)(c->numberReceived + c->numberLost) : 0.0,
+          (duration > 0.0) ? c->bytesSent * 8.0 / duration : 0.0,
+          (duration > 0.0) ? c->bytesReceived * 8.0 / duration : 0.0);
+  if (c->loss.numberFinal > 0) {
+    fprintf(fileFID, "%s ", name);
+    printLossRunStats(&c->loss, duration, fileFID);
+  }
+  for (i = 0; i < numberHists; i++) {
+    snprintf(histName, sizeof(histName), "%s %s", name, histNames[i]);
+    printLatencyHistogram(&c->hists[i], histName, fileFID);
+  }
+  return NOERROR;
+}
+
+/***********************************************************
+* Function: static void *reporterLoop(void *arg)
+*
+* Explanation:  The reporter thread:  a tick every tickSecs.  A
+*               late tick (e.g., the thread was not scheduled)
+*               is not repeated.
+*
+***********************************************************/
+static void *reporterLoop(void *arg)
+{
+  intervalReporter *r = (intervalReporter *)arg;
+  double nextTick = getTimestampD() + r->tickSecs;
+  double curTime;
+  double waitSecs;
+  struct timespec waitTS;
+
+  if (r->cpu >= 0)
+    pinThreadToCPU(r->cpu);
+  while (__atomic_load_n(&r->running, __ATOMIC_ACQUIRE)) {
+    curTime = getTimestampD();
+    if (curTime < nextTick) {
+      waitSecs = nextTick - curTime;
+      if (waitSecs > INTERVAL_WAIT_MSECS / 1000.0)
+        waitSecs = INTERVAL_WAIT_MSECS / 1000.0;
+      waitTS.tv_sec = (time_t)waitSecs;
+      waitTS.tv_nsec = (long)((waitSecs - waitTS.tv_sec) * BILLION);
+      nanosleep(&waitTS, NULL);
+      continue;
+    }
+    reportTick(r, getCurTimeD());
+    while (nextTick <= curTime)
+      nextTick += r->tickSecs;
+  }
+  return NULL;
+}
+
+/***********************************************************
+* Function: static void reportTick(intervalReporter *r, double curTime)
+*
+* Explanation:  swaps the epochs of each source, adds the old ones
+*               to the windows and reports the windows that end
+*
+* inputs:
+*   double curTime : the wall time
+*
+***********************************************************/
+static void reportTick(intervalReporter *r, double curTime)
+{
+  intervalWindow *w;
+  intervalCounters *old;
+  uint32_t epoch;
+  uint32_t i;
+  char name[96];
+
+  resetIntervalCounters(&r->tick, r->numberHists);
+  for (i = 0; i < r->numberSources; i++) {
+    //After the swap the writer only starts updates of the new epoch
+    epoch = r->sources[i]->active;
+    __atomic_store_n(&r->sources[i]->active, epoch ^ 1, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&r->sources[i]->writing, __ATOMIC_SEQ_CST) == epoch + 1)
+      sched_yield();
+    old = &r->sources[i]->epochs[epoch];
+    addIntervalCounters(&r->tick, old, r->numberHists);
+    resetIntervalCounters(old, r->numberHists);
+  }
+  r->numberTicks++;
+
+  for (i = 0; i < r->numberWindows; i++) {
+    w = &r->windows[i];
+    addIntervalCounters(&w->counters, &r->tick, r->numberHists);
+    if (++w->ticks < w->numberTicks)
+      continue;
+    snprintf(name, sizeof(name), "%f interval %gs %s", curTime, w->secs, r->name);
+    printIntervalCounters(&w->counters, r->numberHists, r->histNames, name, curTime - w->startTime, stdout);
+    resetIntervalCounters(&w->counters, r->numberHists);
+    w->ticks = 0;
+    w->startTime = curTime;
+  }
+  fflush(stdout);
+}
+
+/***********************************************************
+* Function: static void addIntervalCounters(intervalCounters *totalPtr, intervalCounters *c,
+*                                           uint32_t numberHists)
+*
+* Explanation:  adds the counters c to the totals
+*
+***********************************************************/
+static void addIntervalCounters(intervalCounters *totalPtr, intervalCounters *c, uint32_t numberHists)
+{
+  uint32_t i;
+
+  totalPtr->numberSent += c->numberSent;
+  totalPtr->numberReceived += c->numberReceived;
+  totalPtr->numberLost += c->numberLost;
+  totalPtr->numberLate += c->numberLate;
+  totalPtr->bytesSent += c->bytesSent;
+  totalPtr->bytesReceived += c->bytesReceived;
+  addLossRunStats(&totalPtr->loss, &c->loss);
+  for (i = 0; i < numberHists; i++)
+    latencyHistogramMerge(&totalPtr->hists[i], &c->hists[i]);
+}
+
+/***********************************************************
+* Function: static void resetIntervalCounters(intervalCounters *c, uint32_t numberHists)
+*
+* Explanation:  clears the counters (and the histograms in use)
+*
+***********************************************************/
+static void resetIntervalCounters(intervalCounters *c, uint32_t numberHists)
+{
+  uint32_t i;
+
+  memset(c, 0, offsetof(intervalCounters, hists));
+  for (i = 0; i < numberHists; i++)
+    resetLatencyHistogram(&c->hists[i]);
+}
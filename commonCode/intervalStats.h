@@ -0,0 +1,206 @@
+/************************************************************************
+* File:  intervalStats.h
+*
+* Purpose:
+*   This include file is for the intervalStats module:  the counters
+*   and latency histograms of the recent intervals (e.g., the last
+*   1, 10 and 60 seconds) rather than of the whole run, so a long
+*   running client or server is a continuous monitor.
+*
+*   intervalStats *createIntervalStats();
+*   void freeIntervalStats(intervalStats *s);
+*   static inline: intervalBegin, intervalEnd, intervalSent,
+*                  intervalReply, intervalLost, intervalLate
+*   int parseIntervalWindows(const char *list, double *windowSecs, uint32_t maxWindows);
+*   intervalReporter *startIntervalReporter(const char *name, intervalStats **sources,
+*                        uint32_t numberSources, const char **histNames, uint32_t numberHists,
+*                        double *windowSecs, uint32_t numberWindows, int cpu);
+*   void stopIntervalReporter(intervalReporter *r);
+*   int printIntervalCounters(intervalCounters *c, uint32_t numberHists, const char **histNames,
+*                             const char *name, double duration, FILE *fileFID);
+*
+* Notes:
+*   An intervalStats has one writer (e.g., the pacer thread, a server
+*   worker) and two epochs of counters.  The writer updates the
+*   active one between intervalBegin and intervalEnd.  The reporter
+*   thread swaps the epochs each tick (the first window) and only
+*   waits for an update of the old epoch that is under way (a few
+*   stores):  the writer never waits for the reporter.  The reporter
+*   adds the old epoch to each window and clears it for the next swap.
+*   The writer marks the epoch it updates (writing) and reads active
+*   again:  a swap between the two is seen and the update goes to the
+*   new epoch.  Both are seq_cst (a store then a load on each side).
+*   The windows are multiples of the tick (rounded) and are reported
+*   (printIntervalCounters) when they end:  they do not overlap.
+*   The reporter merges the sources (e.g., all the workers of a
+*   server) in one report.
+*
+* Last update: 10/17/2026
+*
+*************************************************************************/
+#ifndef	__intervalStats_h
+#define	__intervalStats_h
+
+#include "common.h"
+#include "latencyHistogram.h"
+#include "flowMetrics.h"
+
+#define INTERVAL_MAX_HISTS 3
+#define INTERVAL_MAX_WINDOWS 4
+//The reporter checks for a stop this often (msecs)
+#define INTERVAL_WAIT_MSECS 200
+
+//The counts of an epoch (or a window).  The client's lost are its
+//timeouts, the server's the seq gaps (loss:  the loss runs of its flows)
+typedef struct {
+  uint64_t numberSent;
+  uint64_t numberReceived;
+  uint64_t numberLost;
+  uint64_t numberLate;
+  uint64_t bytesSent;
+  uint64_t bytesReceived;
+  lossRunStats loss;
+  latencyHistogram hists[INTERVAL_MAX_HISTS];
+} intervalCounters;
+
+//The writer and the reporter share active and writing (one cache line)
+typedef struct {
+  uint32_t active;                 //the epoch the writer updates
+  uint32_t writing;                //0, else the epoch being updated + 1
+  char pad[CACHE_LINE_SIZE - 2 * sizeof(uint32_t)];
+  intervalCounters epochs[2];
+} __attribute__((aligned(CACHE_LINE_SIZE))) intervalStats;
+
+typedef struct {
+  double secs;
+  uint32_t numberTicks;            //ticks per window
+  uint32_t ticks;                  //of the current one
+  double startTime;                //wall time
+  intervalCounters counters;
+} intervalWindow;
+
+typedef struct {
+  char name[32];
+  intervalStats **sources;
+  uint32_t numberSources;
+  const char *histNames[INTERVAL_MAX_HISTS];
+  uint32_t numberHists;
+  double tickSecs;
+  uint32_t numberWindows;
+  intervalWindow windows[INTERVAL_MAX_WINDOWS];
+  intervalCounters tick;           //the epochs of the last swap
+  int cpu;                         //of the thread, -1: not pinned
+  pthread_t thread;
+  bool running;
+  uint64_t numberTicks;
+} intervalReporter;
+
+intervalStats *createIntervalStats();
+void freeIntervalStats(intervalStats *s);
+int parseIntervalWindows(const char *list, double *windowSecs, uint32_t maxWindows);
+intervalReporter *startIntervalReporter(const char *name, intervalStats **sources,
+                                        uint32_t numberSources, const char **histNames, uint32_t numberHists,
+                                        double *windowSecs, uint32_t numberWindows, int cpu);
+void stopIntervalReporter(intervalReporter *r);
+int printIntervalCounters(intervalCounters *c, uint32_t numberHists, const char **histNames,
+                          const char *name, double duration, FILE *fileFID);
+
+/***********************************************************
+* Function: static inline intervalCounters *intervalBegin(intervalStats *s)
+*
+* Explanation:  starts an update:  returns the active epoch's counters
+*               (valid until intervalEnd)
+*
+***********************************************************/
+static inline intervalCounters *intervalBegin(intervalStats *s)
+{
+  uint32_t epoch;
+
+  do {
+    epoch = __atomic_load_n(&s->active, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&s->writing, epoch + 1, __ATOMIC_SEQ_CST);
+  } while (__atomic_load_n(&s->active, __ATOMIC_SEQ_CST) != epoch);
+  return &s->epochs[epoch];
+}
+
+/***********************************************************
+* Function: static inline void intervalEnd(intervalStats *s)
+*
+* Explanation:  ends an update
+*
+***********************************************************/
+static inline void intervalEnd(intervalStats *s)
+{
+  __atomic_store_n(&s->writing, 0, __ATOMIC_RELEASE);
+}
+
+/***********************************************************
+* Function: static inline void intervalSent(intervalStats *s, uint32_t count, uint32_t bytes)
+*
+* Explanation:  counts count msgs (bytes in all) sent.  s NULL:  no interval stats.
+*
+***********************************************************/
+static inline void intervalSent(intervalStats *s, uint32_t count, uint32_t bytes)
+{
+  intervalCounters *c;
+
+  if (s == NULL)
+    return;
+  c = intervalBegin(s);
+  c->numberSent += count;
+  c->bytesSent += bytes;
+  intervalEnd(s);
+}
+
+/***********************************************************
+* Function: static inline void intervalReply(intervalStats *s, uint32_t bytes,
+*                                            double *samples, uint32_t numberSamples)
+*
+* Explanation:  counts a msg received and its latency samples (seconds,
+*               one per histogram).  s NULL:  no interval stats.
+*
+***********************************************************/
+static inline void intervalReply(intervalStats *s, uint32_t bytes, double *samples, uint32_t numberSamples)
+{
+  intervalCounters *c;
+  uint32_t i;
+
+  if (s == NULL)
+    return;
+  c = intervalBegin(s);
+  c->numberReceived++;
+  c->bytesReceived += bytes;
+  for (i = 0; (i < numberSamples) && (i < INTERVAL_MAX_HISTS); i++)
+    latencyHistogramAdd(&c->hists[i], samples[i]);
+  intervalEnd(s);
+}
+
+/***********************************************************
+* Function: static inline void intervalLost(intervalStats *s, uint32_t count)
+*
+* Explanation:  counts count msgs lost.  s NULL:  no interval stats.
+*
+***********************************************************/
+static inline void intervalLost(intervalStats *s, uint32_t count)
+{
+  if ((s == NULL) || (count == 0))
+    return;
+  intervalBegin(s)->numberLost += count;
+  intervalEnd(s);
+}
+
+/***********************************************************
+* Function: static inline void intervalLate(intervalStats *s)
+*
+* Explanation:  counts a late msg.  s NULL:  no interval stats.
+*
+***********************************************************/
+static inline void intervalLate(intervalStats *s)
+{
+  if (s == NULL)
+    return;
+  intervalBegin(s)->numberLate++;
+  intervalEnd(s);
+}
+
+#endif
@@ -0,0 +1,254 @@
+/*********************************************************
+*
+* Module Name: latency histogram
+*
+* File Name:  latencyHistogram.c
+*
+* Summary:  Log-linear (HDR style) histogram of latency samples
+*           with percentile reporting.
+*
+*  The methods include:
+*   latencyHistogram *createLatencyHistogram();
+*   void freeLatencyHistogram(latencyHistogram *h);
+*   void resetLatencyHistogram(latencyHistogram *h);
+*   void latencyHistogramAdd(latencyHistogram *h, double sample);
+*   void latencyHistogramMerge(latencyHistogram *dst, const latencyHistogram *src);
+*   double latencyHistogramPercentile(const latencyHistogram *h, double percentile);
+*   int printLatencyHistogram(const latencyHistogram *h, const char *name, FILE *fileFID);
+*
+* Notes:
+*   Bucket layout (v is the magnitude in ns):
+*     v < SUB_BUCKETS:  bucket v (exact)
+*     else, with e = msb(v) - SUB_BITS: bucket (e * SUB_BUCKETS) + (v >> e)
+*           which covers [ (v >> e) << e, ((v >> e) + 1) << e )
+*
+* Last update: 10/17/2026
+*
+*********************************************************/
+#include "common.h"
+#include "latencyHistogram.h"
+
+//#define TRACEME 0
+
+/***********************************************************
+* Function: static inline uint32_t bucketIndex(uint64_t v)
+*
+* Explanation:  returns the bucket of a magnitude (ns)
+*
+***********************************************************/
+static inline uint32_t bucketIndex(uint64_t v)
+{
+  uint32_t e = 0;
+
+  if (v < LATENCY_HIST_SUB_BUCKETS)
+    return (uint32_t)v;
+  if (v >= (1ULL << LATENCY_HIST_MAX_BITS))
+    return LATENCY_HIST_NUMBER_BUCKETS - 1;
+  e = (63 - __builtin_clzll(v)) - LATENCY_HIST_SUB_BITS;
+  return (e * LATENCY_HIST_SUB_BUCKETS) + (uint32_t)(v >> e);
+}
+
+/***********************************************************
+* Function: static double bucketValue(uint32_t idx)
+*
+* Explanation:  returns the middle of a bucket in seconds
+*
+***********************************************************/
+static double bucketValue(uint32_t idx)
+{
+  uint32_t e = 0;
+  uint64_t low = 0;
+
+  if (idx < LATENCY_HIST_SUB_BUCKETS)
+    return (double)idx / BILLION;
+  e = (idx / LATENCY_HIST_SUB_BUCKETS) - 1;
+  low = (uint64_t)(idx - (e * LATENCY_HIST_SUB_BUCKETS)) << e;
+  return ((double)low + (double)(1ULL << e) / 2.0) / BILLION;
+}
+
+/***********************************************************
+* Function: latencyHistogram *createLatencyHistogram()
+*
+* Explanation:  creates an empty histogram.  The caller owns the memory.
+*
+* outputs:
+*    returns the histogram or NULL on error
+*
+***********************************************************/
+latencyHistogram *createLatencyHistogram()
+{
+  latencyHistogram *h = malloc(sizeof(latencyHistogram));
+
+  if (h != NULL)
+    resetLatencyHistogram(h);
+  return h;
+}
+
+/***********************************************************
+* Function: void freeLatencyHistogram(latencyHistogram *h)
+*
+* Explanation:  frees the histogram
+*
+***********************************************************/
+void freeLatencyHistogram(latencyHistogram *h)
+{
+  free(h);
+}
+
+/***********************************************************
+* Function: void resetLatencyHistogram(latencyHistogram *h)
+*
+* Explanation:  removes all samples
+*
+***********************************************************/
+void resetLatencyHistogram(latencyHistogram *h)
+{
+  memset(h, 0, sizeof(latencyHistogram));
+  h->min = 0.0;
+  h->max = 0.0;
+}
+
+/***********************************************************
+* Function: void latencyHistogramAdd(latencyHistogram *h, double sample)
+*
+* Explanation:  counts a sample.  O(1), no allocation.
+*
+* inputs:
+*   latencyHistogram *h
+*   double sample : seconds
+*
+***********************************************************/
+void latencyHistogramAdd(latencyHistogram *h, double sample)
+{
+  double ns = sample * BILLION;
+
+  if (h->totalCount == 0) {
+    h->min = sample;
+    h->max = sample;
+  } else if (sample < h->min)
+    h->min = sample;
+  else if (sample > h->max)
+    h->max = sample;
+  h->totalCount++;
+  h->sum += sample;
+
+  if (ns >= 0.0)
+    h->counts[bucketIndex((uint64_t)(ns + 0.5))]++;
+  else {
+    h->negCounts[bucketIndex((uint64_t)(-ns + 0.5))]++;
+    h->numberNegative++;
+  }
+}
+
+/***********************************************************
+* Function: void latencyHistogramMerge(latencyHistogram *dst, const latencyHistogram *src)
+*
+* Explanation:  adds the samples of src to dst
+*
+***********************************************************/
+void latencyHistogramMerge(latencyHistogram *dst, const latencyHistogram *src)
+{
+  uint32_t i;
+
+  if (src->totalCount == 0)
+    return;
+  if ((dst->totalCount == 0) || (src->min < dst->min))
+    dst->min = src->min;
+  if ((dst->totalCount == 0) || (src->max > dst->max))
+    dst->max = src->max;
+  dst->totalCount += src->totalCount;
+  dst->numberNegative += src->numberNegative;
+  dst->sum += src->sum;
+  for (i = 0; i < LATENCY_HIST_NUMBER_BUCKETS; i++) {
+    dst->counts[i] += src->counts[i];
+    dst->negCounts[i] += src->negCounts[i];
+  }
+}
+
+/***********************************************************
+* Function: double latencyHistogramPercentile(const latencyHistogram *h, double percentile)
+*
+* Explanation:  returns the sample value at the percentile
+*
+* inputs:
+*   const latencyHistogram *h
+*   double percentile : 0.0 .. 100.0
+*
+* outputs:
+*    returns the value (seconds) or 0.0 if the histogram is empty.
+*    The value is the middle of the bucket holding the percentile,
+*    limited to [min, max].
+*
+***********************************************************/
+double latencyHistogramPercentile(const latencyHistogram *h, double percentile)
+{
+  uint64_t rank = 0;
+  uint64_t count = 0;
+  double value = 0.0;
+  int i;
+
+  if (h->totalCount == 0)
+    return 0.0;
+  if (percentile <= 0.0)
+    return h->min;
+  if (percentile >= 100.0)
+    return h->max;
+
+  //The rank (1 .. totalCount) of the sample at the percentile
+  rank = (uint64_t)ceil((percentile / 100.0) * (double)h->totalCount);
+  if (rank == 0)
+    rank = 1;
+
+  //Ascending order: the negative samples (largest magnitude first), then the others
+  value = h->max;
+  for (i = LATENCY_HIST_NUMBER_BUCKETS - 1; (i >= 0) && (count < rank); i--) {
+    count += h->negCounts[i];
+    if (count >= rank)
+      value = -bucketValue(i);
+  }
+  for (i = 0; (i < LATENCY_HIST_NUMBER_BUCKETS) && (count < rank); i++) {
+    count += h->counts[i];
+    if (count >= rank)
+      value = bucketValue(i);
+  }
+
+  if (value < h->min)
+    value = h->min;
+  if (value > h->max)
+    value = h->max;
+  return value;
+}
+
+/***********************************************************
+* Function: int printLatencyHistogram(const latencyHistogram *h, const char *name, FILE *fileFID)
+*
+* Explanation:  prints one line:  the sample count, mean, p50, p90,
+*               p99, p99.9 and max (seconds)
+*
+* inputs:
+*   const latencyHistogram *h
+*   const char *name : labels the line (e.g., RTT)
+*   FILE *fileFID:  specifies output file descriptor
+*
+* outputs :
+*    returns ERROR or NOERROR
+*
+***********************************************************/
+int printLatencyHistogram(const latencyHistogram *h, const char *name, FILE *fileFID)
+{
+  double mean = 0.0;
+
+  if ((h == NULL) || (fileFID == NULL))
+    return ERROR;
+  if (h->totalCount > 0)
+    mean = h->sum / (double)h->totalCount;
+
+  fprintf(fileFID, "%s: samples:%lu min:%1.9f avg:%1.9f p50:%1.9f p90:%1.9f p99:%1.9f p99.9:%1.9f max:%1.9f \n",
+          name, (unsigned long)h->totalCount, h->min, mean,
+          latencyHistogramPercentile(h, 50.0),
+          latencyHistogramPercentile(h, 90.0),
+          latencyHistogramPercentile(h, 99.0),
+          latencyHistogramPercentile(h, 99.9),
+          h->max);
+  return NOERROR;
+}
@@ -0,0 +1,59 @@
+/************************************************************************
+* File:  latencyHistogram.h
+*
+* Purpose:
+*   This include file is for the latencyHistogram module.  A latency
+*   histogram counts samples (seconds) in log-linear buckets (the HDR
+*   histogram layout): each power of 2 of nanoseconds is split into
+*   LATENCY_HIST_SUB_BUCKETS linear buckets.  The memory is fixed and
+*   a sample is added in O(1) without allocation, so the tail
+*   (p99, p99.9, max) can be reported, not just the mean.
+*
+*   latencyHistogram *createLatencyHistogram();
+*   void freeLatencyHistogram(latencyHistogram *h);
+*   void resetLatencyHistogram(latencyHistogram *h);
+*   void latencyHistogramAdd(latencyHistogram *h, double sample);
+*   void latencyHistogramMerge(latencyHistogram *dst, const latencyHistogram *src);
+*   double latencyHistogramPercentile(const latencyHistogram *h, double percentile);
+*   int printLatencyHistogram(const latencyHistogram *h, const char *name, FILE *fileFID);
+*
+* Notes:
+*   The relative error of a percentile is at most 1/LATENCY_HIST_SUB_BUCKETS
+*   (< 0.8%).  min, max and the mean are exact.  Negative samples (a one
+*   way delay between clocks that are not synchronized) are counted in
+*   a mirror set of buckets.  Magnitudes >= 2^LATENCY_HIST_MAX_BITS ns
+*   (~137 seconds) are counted in the last bucket.
+*   A histogram is not thread safe.
+*
+* Last update: 10/17/2026
+*
+*************************************************************************/
+#ifndef	__latencyHistogram_h
+#define	__latencyHistogram_h
+
+#include "common.h"
+
+#define LATENCY_HIST_SUB_BITS 7
+#define LATENCY_HIST_SUB_BUCKETS (1 << LATENCY_HIST_SUB_BITS)
+#define LATENCY_HIST_MAX_BITS 37
+#define LATENCY_HIST_NUMBER_BUCKETS ((LATENCY_HIST_MAX_BITS - LATENCY_HIST_SUB_BITS + 1) * LATENCY_HIST_SUB_BUCKETS)
+
+typedef struct {
+  uint64_t totalCount;
+  uint64_t numberNegative;
+  double   min;
+  double   max;
+  double   sum;
+  uint64_t counts[LATENCY_HIST_NUMBER_BUCKETS];     //samples >= 0
+  uint64_t negCounts[LATENCY_HIST_NUMBER_BUCKETS];  //samples < 0, by magnitude
+} latencyHistogram;
+
+latencyHistogram *createLatencyHistogram();
+void freeLatencyHistogram(latencyHistogram *h);
+void resetLatencyHistogram(latencyHistogram *h);
+void latencyHistogramAdd(latencyHistogram *h, double sample);
+void latencyHistogramMerge(latencyHistogram *dst, const latencyHistogram *src);
+double latencyHistogramPercentile(const latencyHistogram *h, double percentile);
+int printLatencyHistogram(const latencyHistogram *h, const char *name, FILE *fileFID);
+
+#endif
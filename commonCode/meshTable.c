@@ -0,0 +1,604 @@
+/*********************************************************
+*
+* Module Name: mesh table
+*
+* File Name:  meshTable.c
+*
+* Summary:  The targets of a mesh run (one client, one socket, many
+*           servers):  their addresses (resolved once), send
+*           schedules, probes in flight and stats, kept as a struct
+*           of arrays.
+*
+*  The methods include:
+*   meshTable *createMeshTable(uint32_t maxTargets, int family, double timeout, double now);
+*   void freeMeshTable(meshTable *t);
+*   int meshTableAdd(meshTable *t, const char *host, const char *port, double rate, uint32_t msgSize);
+*   int readMeshTargets(meshTable *t, const char *fileName, double defaultRate, uint32_t defaultMsgSize);
+*   int meshTableLookup(meshTable *t, const struct sockaddr *addrPtr);
+*   void startMeshTable(meshTable *t, double startTime);
+*   timerEntry *meshTableDue(meshTable *t, double now);
+*   uint32_t meshProbeSent(meshTable *t, uint32_t target, double txTime);
+*   int meshProbeReply(meshTable *t, uint32_t target, uint32_t seq, uint32_t bytes,
+*                      double rxTime, double *RTTPtr);
+*   int meshTableExpire(meshTable *t, double now);
+*   double meshTableNextTimer(meshTable *t);
+*   int printMeshTable(meshTable *t, FILE *fileFID);
+*   void meshTableSetStats(meshTable *t, statsExport *e, double now);
+*
+* Notes:
+*   The per target arrays are allocated for maxTargets when the
+*   table is created:  nothing is allocated while probing.
+*
+* Last update: 10/17/2026
+*
+*********************************************************/
+#include "common.h"
+#include "AddressHelper.h"
+#include "messages.h"
+#include "meshTable.h"
+
+//#define TRACEME 0
+
+/***********************************************************
+* Function: static uint32_t hashAddress(const struct sockaddr *addrPtr)
+*
+* Explanation:  returns a hash (FNV-1a) of an address's IP and port
+*
+***********************************************************/
+static uint32_t hashAddress(const struct sockaddr *addrPtr)
+{
+  const uint8_t *bytes = NULL;
+  size_t size = 0;
+  size_t i;
+  uint32_t hash = 2166136261U;
+  uint16_t port = 0;
+
+  if (addrPtr->sa_family == AF_INET) {
+    bytes = (const uint8_t *)&((const struct sockaddr_in *)addrPtr)->sin_addr;
+    size = sizeof(struct in_addr);
+    port = ((const struct sockaddr_in *)addrPtr)->sin_port;
+  } else if (addrPtr->sa_family == AF_INET6) {
+    bytes = (const uint8_t *)&((const struct sockaddr_in6 *)addrPtr)->sin6_addr;
+    size = sizeof(struct in6_addr);
+    port = ((const struct sockaddr_in6 *)addrPtr)->sin6_port;
+  }
+  for (i = 0; i < size; i++)
+    hash = (hash ^ bytes[i]) * 16777619U;
+  hash = (hash ^ (port & 0xff)) * 16777619U;
+  hash = (hash ^ (port >> 8)) * 16777619U;
+  return hash;
+}
+
+/***********************************************************
+* Function: meshTable *createMeshTable(uint32_t maxTargets, int family,
+*                                      double timeout, double now)
+*
+* Explanation:  creates an empty table.  The caller owns it.
+*
+* inputs:
+*   uint32_t maxTargets : 1 .. MESH_MAX_TARGETS
+*   int family : the socket's, AF_INET6 (dual stack:  IPv4 targets are
+*                stored v4-mapped) or AF_INET (IPv6 targets are refused)
+*   double timeout : seconds a probe waits for its reply
+*   double now : the current timestamp (the timer wheels' origin)
+*
+* outputs:
+*    returns the table or NULL on error
+*
+***********************************************************/
+meshTable *createMeshTable(uint32_t maxTargets, int family, double timeout, double now)
+{
+  meshTable *t = NULL;
+  uint32_t hashSize = 1;
+  size_t numberProbes = (size_t)maxTargets * MESH_PENDING;
+
+  if ((maxTargets == 0) || (maxTargets > MESH_MAX_TARGETS) || (timeout <= 0.0) ||
+      ((family != AF_INET) && (family != AF_INET6))) {
+    printf("createMeshTable: bad params maxTargets:%d family:%d timeout:%f \n", maxTargets, family, timeout);
+    return NULL;
+  }
+
+  t = calloc(1, sizeof(meshTable));
+  if (t == NULL)
+    return NULL;
+  t->maxTargets = maxTargets;
+  t->family = family;
+  t->timeout = timeout;
+
+  //At most half full so the probes of a lookup stay short
+  while (hashSize < 2 * maxTargets)
+    hashSize <<= 1;
+  t->addrHashMask = hashSize - 1;
+
+  t->names = calloc(maxTargets, sizeof(char *));
+  t->addrs = calloc(maxTargets, sizeof(struct sockaddr_storage));
+  t->addrLens = calloc(maxTargets, sizeof(socklen_t));
+  t->msgSizes = calloc(maxTargets, sizeof(uint32_t));
+  t->intervals = calloc(maxTargets, sizeof(double));
+  t->nextSendTimes = calloc(maxTargets, sizeof(double));
+  t->nextSeqs = calloc(maxTargets, sizeof(uint32_t));
+  t->sendTimers = calloc(maxTargets, sizeof(timerEntry));
+  t->numberSent = calloc(maxTargets, sizeof(uint32_t));
+  t->numberRxed = calloc(maxTargets, sizeof(uint32_t));
+  t->numberLost = calloc(maxTargets, sizeof(uint32_t));
+  t->numberLate = calloc(maxTargets, sizeof(uint32_t));
+  t->RTTSums = calloc(maxTargets, sizeof(double));
+  t->RTTMins = calloc(maxTargets, sizeof(double));
+  t->RTTMaxs = calloc(maxTargets, sizeof(double));
+  t->lastRTTs = calloc(maxTargets, sizeof(double));
+  t->pendingSeqs = calloc(numberProbes, sizeof(uint32_t));
+  t->pendingTxTimes = calloc(numberProbes, sizeof(double));
+  t->lossTimers = calloc(numberProbes, sizeof(timerEntry));
+  t->addrHash = malloc(hashSize * sizeof(int32_t));
+  t->sendWheel = createTimerWheel(MESH_TIMER_TICK, now);
+  t->lossWheel = createTimerWheel(MESH_TIMER_TICK, now);
+  if ((t->names == NULL) || (t->addrs == NULL) || (t->addrLens == NULL) || (t->msgSizes == NULL) ||
+      (t->intervals == NULL) || (t->nextSendTimes == NULL) || (t->nextSeqs == NULL) ||
+      (t->sendTimers == NULL) || (t->numberSent == NULL) || (t->numberRxed == NULL) ||
+      (t->numberLost == NULL) || (t->numberLate == NULL) || (t->RTTSums == NULL) ||
+      (t->RTTMins == NULL) || (t->RTTMaxs == NULL) || (t->lastRTTs == NULL) ||
+      (t->pendingSeqs == NULL) || (t->pendingTxTimes == NULL) || (t->lossTimers == NULL) ||
+      (t->addrHash == NULL) || (t->sendWheel == NULL) || (t->lossWheel == NULL)) {
+    printf("createMeshTable: malloc failed maxTargets:%d \n", maxTargets);
+    freeMeshTable(t);
+    return NULL;
+  }
+  memset(t->addrHash, 0xff, hashSize * sizeof(int32_t));
+  return t;
+}
+
+/***********************************************************
+* Function: void freeMeshTable(meshTable *t)
+*
+* Explanation:  frees the table
+*
+***********************************************************/
+void freeMeshTable(meshTable *t)
+{
+  uint32_t i;
+
+  if (t == NULL)
+    return;
+  if (t->names != NULL)
+    for (i = 0; i < t->numberTargets; i++)
+      free(t->names[i]);
+  free(t->names);
+  free(t->addrs);
+  free(t->addrLens);
+  free(t->msgSizes);
+  free(t->intervals);
+  free(t->nextSendTimes);
+  free(t->nextSeqs);
+  free(t->sendTimers);
+  free(t->numberSent);
+  free(t->numberRxed);
+  free(t->numberLost);
+  free(t->numberLate);
+  free(t->RTTSums);
+  free(t->RTTMins);
+  free(t->RTTMaxs);
+  free(t->lastRTTs);
+  free(t->pendingSeqs);
+  free(t->pendingTxTimes);
+  free(t->lossTimers);
+  free(t->addrHash);
+  freeTimerWheel(t->sendWheel);
+  freeTimerWheel(t->lossWheel);
+  free(t);
+}
+
+/***********************************************************
+* Function: int meshTableAdd(meshTable *t, const char *host, const char *port,
+*                            double rate, uint32_t msgSize)
+*
+* Explanation:  resolves a target (getaddrinfo, the first address
+*               that the socket's family can reach) and adds it
+*
+* inputs:
+*   const char *host, *port : name or numeric address, service or port
+*   double rate : probes per second
+*   uint32_t msgSize : size of its probes (a compact probe header at least;
+*                      the caller checks its -wire header)
+*
+* outputs:
+*    returns the target's index or ERROR (not resolved, a duplicate
+*    address, bad params or the table is full)
+*
+***********************************************************/
+int meshTableAdd(meshTable *t, const char *host, const char *port, double rate, uint32_t msgSize)
+{
+  int rc;
+  uint32_t target = t->numberTargets;
+  uint32_t h;
+  struct addrinfo addrCriteria;
+  struct addrinfo *addrList = NULL;
+  struct addrinfo *addr = NULL;
+  struct sockaddr_in6 *mappedPtr = NULL;
+  struct sockaddr_in *IPv4Ptr = NULL;
+
+  if (target >= t->maxTargets) {
+    printf("meshTableAdd: the table is full (%d targets), %s:%s not added \n", t->maxTargets, host, port);
+    return ERROR;
+  }
+  if ((rate <= 0.0) || (msgSize < PROBE_COMPACT_SIZE) || (msgSize > MAX_DATA_BUFFER)) {
+    printf("meshTableAdd: %s:%s bad rate (%f) or msgSize (%d must be %d .. %d) \n",
+           host, port, rate, msgSize, PROBE_COMPACT_SIZE, MAX_DATA_BUFFER);
+    return ERROR;
+  }
+
+  memset(&addrCriteria, 0, sizeof(addrCriteria));
+  addrCriteria.ai_family = (t->family == AF_INET) ? AF_INET : AF_UNSPEC;
+  addrCriteria.ai_socktype = SOCK_DGRAM;
+  addrCriteria.ai_protocol = IPPROTO_UDP;
+  rc = getaddrinfo(host, port, &addrCriteria, &addrList);
+  if (rc != 0) {
+    printf("meshTableAdd: getaddrinfo(%s:%s) failed: %s \n", host, port, gai_strerror(rc));
+    return ERROR;
+  }
+  addr = addrList;
+
+  //An IPv6 socket reaches an IPv4 target at its v4-mapped address (::ffff:a.b.c.d)
+  if ((t->family == AF_INET6) && (addr->ai_family == AF_INET)) {
+    IPv4Ptr = (struct sockaddr_in *)addr->ai_addr;
+    mappedPtr = (struct sockaddr_in6 *)&t->addrs[target];
+    memset(mappedPtr, 0, sizeof(struct sockaddr_in6));
+    mappedPtr->sin6_family = AF_INET6;
+    mappedPtr->sin6_port = IPv4Ptr->sin_port;
+    mappedPtr->sin6_addr.s6_addr[10] = 0xff;
+    mappedPtr->sin6_addr.s6_addr[11] = 0xff;
+    memcpy(&mappedPtr->sin6_addr.s6_addr[12], &IPv4Ptr->sin_addr, sizeof(struct in_addr));
+    t->addrLens[target] = sizeof(struct sockaddr_in6);
+  } else {
+    memcpy(&t->addrs[target], addr->ai_addr, addr->ai_addrlen);
+    t->addrLens[target] = addr->ai_addrlen;
+  }
+  freeaddrinfo(addrList);
+
+  //The replies are matched to the target by address:  it must be unique
+  if (meshTableLookup(t, (struct sockaddr *)&t->addrs[target]) >= 0) {
+    printf("meshTableAdd: %s:%s is a duplicate target, not added \n", host, port);
+    return ERROR;
+  }
+  h = hashAddress((struct sockaddr *)&t->addrs[target]) & t->addrHashMask;
+  while (t->addrHash[h] >= 0)
+    h = (h + 1) & t->addrHashMask;
+  t->addrHash[h] = (int32_t)target;
+
+  t->names[target] = malloc(strlen(host) + strlen(port) + 4);
+  if (t->names[target] != NULL)
+    sprintf(t->names[target], (strchr(host, ':') != NULL) ? "[%s]:%s" : "%s:%s", host, port);
+  t->msgSizes[target] = msgSize;
+  t->intervals[target] = 1.0 / rate;
+  t->nextSeqs[target] = 1;
+  t->RTTMins[target] = 0.0;
+  initTimerEntry(&t->sendTimers[target], target);
+  for (h = 0; h < MESH_PENDING; h++)
+    initTimerEntry(&t->lossTimers[target * MESH_PENDING + h], target * MESH_PENDING + h);
+  t->numberTargets++;
+  return (int)target;
+}
+
+/***********************************************************
+* Function: int readMeshTargets(meshTable *t, const char *fileName,
+*                               double defaultRate, uint32_t defaultMsgSize)
+*
+* Explanation:  adds the targets of a file, one per line:
+*                   host:port [rate] [msgSize]
+*               ('#' lines are comments, [IPv6 host]:port)
+*
+* inputs:
+*   double defaultRate, uint32_t defaultMsgSize : of the lines that omit them
+*
+* outputs:
+*    returns the number of targets added or ERROR (the file could not
+*    be read).  A line that fails (bad format, not resolved ...) is
+*    reported and skipped.
+*
+***********************************************************/
+int readMeshTargets(meshTable *t, const char *fileName, double defaultRate, uint32_t defaultMsgSize)
+{
+  FILE *targetFID = NULL;
+  char line[MESH_MAX_LINE];
+  char target[MESH_MAX_LINE];
+  char *host = NULL;
+  char *port = NULL;
+  char *end = NULL;
+  double rate;
+  unsigned int msgSize;
+  int numberFields;
+  int lineNumber = 0;
+  int numberAdded = 0;
+
+  targetFID = fopen(fileName, "r");
+  if (targetFID == NULL) {
+    printf("readMeshTargets: failed to open %s, errno:%d \n", fileName, errno);
+    return ERROR;
+  }
+  while (fgets(line, sizeof(line), targetFID) != NULL) {
+    lineNumber++;
+    rate = defaultRate;
+    msgSize = defaultMsgSize;
+    numberFields = sscanf(line, "%255s %lf %u", target, &rate, &msgSize);
+    if ((numberFields < 1) || (target[0] == '#'))
+      continue;
+
+    //host:port, the port after the last ':' (or after the ']' of an IPv6 host)
+    host = target;
+    if (target[0] == '[') {
+      host = target + 1;
+      end = strchr(host, ']');
+      port = ((end != NULL) && (end[1] == ':')) ? end + 2 : NULL;
+      if (end != NULL)
+        *end = '\0';
+    } else {
+      end = strrchr(target, ':');
+      port = ((end != NULL) && (strchr(target, ':') == end)) ? end + 1 : NULL;
+      if (end != NULL)
+        *end = '\0';
+    }
+    if ((port == NULL) || (*port == '\0') || (*host == '\0')) {
+      printf("readMeshTargets: %s line %d: expected host:port [rate] [msgSize] \n", fileName, lineNumber);
+      continue;
+    }
+    if (meshTableAdd(t, host, port, rate, (uint32_t)msgSize) >= 0)
+      numberAdded++;
+  }
+  fclose(targetFID);
+  return numberAdded;
+}
+
+/***********************************************************
+* Function: int meshTableLookup(meshTable *t, const struct sockaddr *addrPtr)
+*
+* Explanation:  finds the target of an address (e.g., a reply's source)
+*
+* outputs:
+*    returns the target's index or ERROR (not a target)
+*
+***********************************************************/
+int meshTableLookup(meshTable *t, const struct sockaddr *addrPtr)
+{
+  uint32_t h = hashAddress(addrPtr) & t->addrHashMask;
+  int32_t target;
+
+  while ((target = t->addrHash[h]) >= 0) {
+    if (SockAddrsEqual(addrPtr, (struct sockaddr *)&t->addrs[target]))
+      return target;
+    h = (h + 1) & t->addrHashMask;
+  }
+  return ERROR;
+}
+
+/***********************************************************
+* Function: void startMeshTable(meshTable *t, double startTime)
+*
+* Explanation:  schedules the first probe of each target.  Target
+*               i of N first sends at startTime + (i / N) * its interval
+*               so the sends of equal rate targets are evenly spaced.
+*
+***********************************************************/
+void startMeshTable(meshTable *t, double startTime)
+{
+  uint32_t target;
+
+  for (target = 0; target < t->numberTargets; target++) {
+    t->nextSendTimes[target] = startTime +
+      t->intervals[target] * ((double)target / (double)t->numberTargets);
+    timerWheelAdd(t->sendWheel, &t->sendTimers[target], t->nextSendTimes[target]);
+  }
+}
+
+/***********************************************************
+* Function: timerEntry *meshTableDue(meshTable *t, double now)
+*
+* Explanation:  returns the targets whose send time has come, a
+*               list (linked by next) of their send timers:  the
+*               timer's id is the target.  Each is re-armed by
+*               meshProbeSent.
+*
+***********************************************************/
+timerEntry *meshTableDue(meshTable *t, double now)
+{
+  return timerWheelExpire(t->sendWheel, now);
+}
+
+/***********************************************************
+* Function: uint32_t meshProbeSent(meshTable *t, uint32_t target, double txTime)
+*
+* Explanation:  records a probe to the target (its loss deadline is
+*               txTime + the timeout) and schedules the next one
+*
+* inputs:
+*   double txTime : the probe's send time (timestamp)
+*
+* outputs:
+*    returns the probe's seq number
+*
+* notes:
+*   The next send time keeps the target's phase:  send times missed
+*   (the loop fell behind) are skipped, not sent in a burst.
+*
+***********************************************************/
+uint32_t meshProbeSent(meshTable *t, uint32_t target, double txTime)
+{
+  uint32_t seq = t->nextSeqs[target]++;
+  uint32_t probe = target * MESH_PENDING + (seq & (MESH_PENDING - 1));
+  double interval = t->intervals[target];
+
+  if (t->nextSeqs[target] == 0)
+    t->nextSeqs[target] = 1;
+
+  //The probe that had the slot is still waiting:  it is lost
+  if (t->pendingSeqs[probe] != 0) {
+    timerWheelCancel(t->lossWheel, &t->lossTimers[probe]);
+    t->numberLost[target]++;
+    t->numberSlotReuses++;
+    statsRecordLost(statsExportRecord(t->stats, target), 1, statsExportWallTime(t->stats, txTime));
+  }
+  t->pendingSeqs[probe] = seq;
+  t->pendingTxTimes[probe] = txTime;
+  timerWheelAdd(t->lossWheel, &t->lossTimers[probe], txTime + t->timeout);
+  t->numberSent[target]++;
+  statsRecordSent(statsExportRecord(t->stats, target), 1, t->msgSizes[target],
+                  statsExportWallTime(t->stats, txTime));
+
+  t->nextSendTimes[target] += interval;
+  if (t->nextSendTimes[target] <= txTime)
+    t->nextSendTimes[target] += ceil((txTime - t->nextSendTimes[target]) / interval) * interval;
+  timerWheelAdd(t->sendWheel, &t->sendTimers[target], t->nextSendTimes[target]);
+  return seq;
+}
+
+/***********************************************************
+* Function: int meshProbeReply(meshTable *t, uint32_t target, uint32_t seq,
+*                              uint32_t bytes, double rxTime, double *RTTPtr)
+*
+* Explanation:  matches a reply of the target to its probe and adds
+*               the RTT sample to the target's stats
+*
+* inputs:
+*   uint32_t seq : the reply's seq number
+*   uint32_t bytes : its size
+*   double rxTime : its arrival time (timestamp)
+*   double *RTTPtr : set to the RTT sample
+*
+* outputs:
+*    returns NOERROR or ERROR (late:  the probe was lost, a
+*    duplicate or a bogus seq)
+*
+***********************************************************/
+int meshProbeReply(meshTable *t, uint32_t target, uint32_t seq, uint32_t bytes,
+                   double rxTime, double *RTTPtr)
+{
+  uint32_t probe = target * MESH_PENDING + (seq & (MESH_PENDING - 1));
+  double RTTSample;
+
+  if ((seq == 0) || (t->pendingSeqs[probe] != seq)) {
+    t->numberLate[target]++;
+    statsRecordLate(statsExportRecord(t->stats, target), statsExportWallTime(t->stats, rxTime));
+    return ERROR;
+  }
+  timerWheelCancel(t->lossWheel, &t->lossTimers[probe]);
+  t->pendingSeqs[probe] = 0;
+
+  RTTSample = rxTime - t->pendingTxTimes[probe];
+  if ((t->numberRxed[target] == 0) || (RTTSample < t->RTTMins[target]))
+    t->RTTMins[target] = RTTSample;
+  if (RTTSample > t->RTTMaxs[target])
+    t->RTTMaxs[target] = RTTSample;
+  t->RTTSums[target] += RTTSample;
+  t->lastRTTs[target] = RTTSample;
+  t->numberRxed[target]++;
+  statsRecordReply(statsExportRecord(t->stats, target), bytes, RTTSample,
+                   statsExportWallTime(t->stats, rxTime));
+  *RTTPtr = RTTSample;
+  return NOERROR;
+}
+
+/***********************************************************
+* Function: int meshTableExpire(meshTable *t, double now)
+*
+* Explanation:  declares lost the probes whose deadline has passed
+*
+* outputs:
+*    returns the number of probes lost
+*
+***********************************************************/
+int meshTableExpire(meshTable *t, double now)
+{
+  timerEntry *timer = timerWheelExpire(t->lossWheel, now);
+  uint32_t probe;
+  int numberExpired = 0;
+
+  while (timer != NULL) {
+    probe = (uint32_t)timer->id;
+    timer = timer->next;
+    t->pendingSeqs[probe] = 0;
+    t->numberLost[probe / MESH_PENDING]++;
+    statsRecordLost(statsExportRecord(t->stats, probe / MESH_PENDING), 1, statsExportWallTime(t->stats, now));
+    numberExpired++;
+  }
+  return numberExpired;
+}
+
+/***********************************************************
+* Function: double meshTableNextTimer(meshTable *t)
+*
+* Explanation:  returns when the table's timers (sends, loss
+*               deadlines) need service next:  the time to call
+*               meshTableDue/meshTableExpire.  -1.0:  no timers.
+*
+***********************************************************/
+double meshTableNextTimer(meshTable *t)
+{
+  double nextSend = timerWheelNextExpiry(t->sendWheel);
+  double nextLoss = timerWheelNextExpiry(t->lossWheel);
+
+  if (nextSend < 0.0)
+    return nextLoss;
+  if ((nextLoss < 0.0) || (nextSend < nextLoss))
+    return nextSend;
+  return nextLoss;
+}
+
+/***********************************************************
+* Function: int printMeshTable(meshTable *t, FILE *fileFID)
+*
+* Explanation:  prints a line of stats per target and the totals
+*
+* outputs:
+*    returns ERROR or NOERROR
+*
+***********************************************************/
+int printMeshTable(meshTable *t, FILE *fileFID)
+{
+  uint32_t target;
+  uint64_t totalSent = 0;
+  uint64_t totalRxed = 0;
+  uint64_t totalLost = 0;
+  uint64_t totalLate = 0;
+  uint32_t numberSilent = 0;
+
+  if ((t == NULL) || (fileFID == NULL))
+    return ERROR;
+
+  fprintf(fileFID, "target sent rxed lost late lossRate avgRTT minRTT maxRTT lastRTT \n");
+  for (target = 0; target < t->numberTargets; target++) {
+    fprintf(fileFID, "%s %u %u %u %u %1.4f %1.9f %1.9f %1.9f %1.9f \n",
+            (t->names[target] != NULL) ? t->names[target] : "?",
+            t->numberSent[target], t->numberRxed[target], t->numberLost[target], t->numberLate[target],
+            (t->numberSent[target] > 0) ? (double)t->numberLost[target] / (double)t->numberSent[target] : 0.0,
+            (t->numberRxed[target] > 0) ? t->RTTSums[target] / (double)t->numberRxed[target] : 0.0,
+            t->RTTMins[target], t->RTTMaxs[target], t->lastRTTs[target]);
+    totalSent += t->numberSent[target];
+    totalRxed += t->numberRxed[target];
+    totalLost += t->numberLost[target];
+    totalLate += t->numberLate[target];
+    if ((t->numberSent[target] > 0) && (t->numberRxed[target] == 0))
+      numberSilent++;
+  }
+  fprintf(fileFID, "mesh: targets:%u (no reply:%u) sent:%lu rxed:%lu lost:%lu (slot reuses:%lu) late:%lu timeout:%f \n",
+          t->numberTargets, numberSilent, (unsigned long)totalSent, (unsigned long)totalRxed,
+          (unsigned long)totalLost, (unsigned long)t->numberSlotReuses, (unsigned long)totalLate, t->timeout);
+  return NOERROR;
+}
+
+/***********************************************************
+* Function: void meshTableSetStats(meshTable *t, statsExport *e, double now)
+*
+* Explanation:  publishes the targets' stats in an export (record
+*               index:  the target, which must fit)
+*
+* inputs:
+*   statsExport *e : NULL: stop publishing
+*   double now : wall time
+*
+***********************************************************/
+void meshTableSetStats(meshTable *t, statsExport *e, double now)
+{
+  uint32_t target;
+
+  t->stats = e;
+  for (target = 0; (e != NULL) && (target < t->numberTargets); target++)
+    statsExportOpenRecord(e, target, target, STATS_KIND_TARGET, (t->names[target] != NULL) ? t->names[target] : "?", now);
+}
@@ -0,0 +1,116 @@
+/************************************************************************
+* File:  meshTable.h
+*
+* Purpose:
+*   This include file is for the meshTable module:  the targets of a
+*   mesh run (one client probing many servers from one socket) and
+*   their per target state and stats.  The table is a struct of
+*   arrays:  each field is one contiguous array indexed by the
+*   target, so a pass over one field (e.g., the report) streams
+*   through memory rather than hopping between records.
+*
+*   meshTable *createMeshTable(uint32_t maxTargets, int family, double timeout, double now);
+*   void freeMeshTable(meshTable *t);
+*   int meshTableAdd(meshTable *t, const char *host, const char *port, double rate, uint32_t msgSize);
+*   int readMeshTargets(meshTable *t, const char *fileName, double defaultRate, uint32_t defaultMsgSize);
+*   int meshTableLookup(meshTable *t, const struct sockaddr *addrPtr);
+*   void startMeshTable(meshTable *t, double startTime);
+*   timerEntry *meshTableDue(meshTable *t, double now);
+*   uint32_t meshProbeSent(meshTable *t, uint32_t target, double txTime);
+*   int meshProbeReply(meshTable *t, uint32_t target, uint32_t seq, uint32_t bytes,
+*                      double rxTime, double *RTTPtr);
+*   int meshTableExpire(meshTable *t, double now);
+*   double meshTableNextTimer(meshTable *t);
+*   int printMeshTable(meshTable *t, FILE *fileFID);
+*   void meshTableSetStats(meshTable *t, statsExport *e, double now);
+*
+* Notes:
+*   A target file has one target per line:
+*       host:port [rate (probes/sec)] [msgSize]
+*   ('#' lines are comments, an IPv6 host is in brackets:  [::1]:5000).
+*   Each name is resolved (getaddrinfo) once, when it is added.
+*   The send times and the loss deadlines are timers on two timer
+*   wheels (MESH_TIMER_TICK resolution).  The first sends are staggered
+*   over each target's interval so the probes (and the replies) are
+*   spread evenly rather than all leaving at once.
+*   Each target has MESH_PENDING probes in flight at most:  a probe
+*   still pending when its slot is reused (rate * timeout > MESH_PENDING)
+*   is counted lost.
+*   Replies are matched to the target by their source address (a hash
+*   of the addresses) and to the probe by seq number.
+*   With meshTableSetStats each target's stats are also published
+*   (record index:  the target) as they change.
+*   A table is not thread safe.
+*
+* Last update: 10/17/2026
+*
+*************************************************************************/
+#ifndef	__meshTable_h
+#define	__meshTable_h
+
+#include "common.h"
+#include "timerWheel.h"
+#include "statsExport.h"
+
+#define MESH_MAX_TARGETS 65536
+#define MESH_MAX_LINE 256
+//Probes in flight per target (a power of 2)
+#define MESH_PENDING 4
+//The send/loss timers resolution (seconds):  the probes due in a tick leave together
+#define MESH_TIMER_TICK 0.001
+
+typedef struct {
+  uint32_t numberTargets;
+  uint32_t maxTargets;
+  int family;                        //of the socket: AF_INET6 (IPv4 targets are v4-mapped) or AF_INET
+  double timeout;                    //seconds a probe waits for its reply
+
+  //Per target:  [target]
+  char **names;                      //host:port as read
+  struct sockaddr_storage *addrs;
+  socklen_t *addrLens;
+  uint32_t *msgSizes;
+  double *intervals;                 //seconds between probes
+  double *nextSendTimes;
+  uint32_t *nextSeqs;
+  timerEntry *sendTimers;            //id: the target
+  uint32_t *numberSent;
+  uint32_t *numberRxed;
+  uint32_t *numberLost;
+  uint32_t *numberLate;              //replies after the probe was lost, duplicates
+  double *RTTSums;
+  double *RTTMins;
+  double *RTTMaxs;
+  double *lastRTTs;
+
+  //Per probe in flight:  [target * MESH_PENDING + seq % MESH_PENDING]
+  uint32_t *pendingSeqs;             //0: free
+  double *pendingTxTimes;
+  timerEntry *lossTimers;            //id: the probe's index
+
+  //Source address -> target (open addressing, -1: empty)
+  int32_t *addrHash;
+  uint32_t addrHashMask;
+
+  timerWheel *sendWheel;
+  timerWheel *lossWheel;
+  uint64_t numberSlotReuses;         //probes lost because their slot was needed
+  statsExport *stats;                //NULL: not published
+} meshTable;
+
+meshTable *createMeshTable(uint32_t maxTargets, int family, double timeout, double now);
+void freeMeshTable(meshTable *t);
+int meshTableAdd(meshTable *t, const char *host, const char *port, double rate, uint32_t msgSize);
+int readMeshTargets(meshTable *t, const char *fileName, double defaultRate, uint32_t defaultMsgSize);
+int meshTableLookup(meshTable *t, const struct sockaddr *addrPtr);
+void startMeshTable(meshTable *t, double startTime);
+timerEntry *meshTableDue(meshTable *t, double now);
+uint32_t meshProbeSent(meshTable *t, uint32_t target, double txTime);
+int meshProbeReply(meshTable *t, uint32_t target, uint32_t seq, uint32_t bytes,
+                   double rxTime, double *RTTPtr);
+int meshTableExpire(meshTable *t, double now);
+double meshTableNextTimer(meshTable *t);
+int printMeshTable(meshTable *t, FILE *fileFID);
+void meshTableSetStats(meshTable *t, statsExport *e, double now);
+
+#endif
@@ -44,7 +44,11 @@
 *     commsMode:  Communications mode:   Specifies networking layer details:
 *                    The following choices assume IP
 *
-*  Last update: 1/17/2019
+*     The UDPPing probes (and replies) use the version 1 wire format
+*       (encodeProbe, decodeProbe, encodeProbeEcho, encodeProbeACK,
+*       decodeProbeReply):  fixed offsets, big endian, ns times.
+*
+*  Last update: 10/17/2026
 *
 *********************************************************/
 #include "./common.h"
@@ -183,6 +187,349 @@ void printDefaultMessageHeader(messageHeaderDefault  *myHdr)
 
 }
 
+/***********************************************************
+* Function: int probeHeaderSize(int format, uint32_t extensions)
+*
+* Explanation: returns the bytes of a probe header on the wire
+*
+* inputs:
+*      int format : PROBE_FORMAT_LEGACY, _FULL or _COMPACT
+*      uint32_t extensions : PROBE_EXT_* bits (full format only)
+*
+* outputs: the size or ERROR (unknown format)
+*
+***********************************************************/
+int probeHeaderSize(int format, uint32_t extensions)
+{
+  int size = ERROR;
+
+  switch (format) {
+    case PROBE_FORMAT_LEGACY:
+      size = sizeof(TGIFHeartbeat);
+      break;
+    case PROBE_FORMAT_FULL:
+      size = PROBE_FULL_SIZE;
+      if (extensions & PROBE_EXT_WIRELESS)
+        size += PROBE_TLV_HDR_SIZE + PROBE_TLV_WIRELESS_SIZE;
+      if (extensions & PROBE_EXT_GPS)
+        size += PROBE_TLV_HDR_SIZE + PROBE_TLV_GPS_SIZE;
+      break;
+    case PROBE_FORMAT_COMPACT:
+      size = PROBE_COMPACT_SIZE;
+      break;
+  }
+  return size;
+}
+
+/***********************************************************
+* Function: int encodeProbe(char *bufPtr, probeHeader *h)
+*
+* Explanation: writes the header of a probe in h's format at the
+*              front of bufPtr
+*
+* inputs:
+*      char *bufPtr : the msg (at least probeHeaderSize bytes)
+*      probeHeader *h : the probe (h->extensions:  the extensions to send)
+*
+* outputs: returns the bytes written
+*
+* notes:
+*    The fixed fields are straight line stores:  only the format and
+*    the extensions are tested, the same way for every probe of a run.
+*    A legacy probe is the TGIFHeartbeat (32 bit sec/nsec times, no
+*    clock offset).
+*
+***********************************************************/
+int encodeProbe(char *bufPtr, probeHeader *h)
+{
+  char *p = bufPtr + PROBE_FULL_SIZE;
+
+  if (h->format == PROBE_FORMAT_COMPACT) {
+    bufPtr[PROBE_OFF_TYPE] = PROBE_TYPE_BYTE(PROBE_FORMAT_COMPACT);
+    bufPtr[PROBE_OFF_MODE] = h->mode;
+    putWire16(bufPtr + PROBE_OFF_AUX, 0);
+    putWire32(bufPtr + PROBE_OFF_SEQ, h->seq);
+    putWire64(bufPtr + PROBE_OFF_TXTIME, h->txTime);
+    return PROBE_COMPACT_SIZE;
+  }
+
+  if (h->format == PROBE_FORMAT_LEGACY) {
+    TGIFHeartbeat *hb = (TGIFHeartbeat *)bufPtr;
+    memset(hb, 0, sizeof(TGIFHeartbeat));
+    hb->msgType = 3;
+    hb->code = h->mode;
+    hb->msgHdrsize = htons(sizeof(TGIFHeartbeat));
+    hb->nodeID = htonl(h->nodeID);
+    hb->sequenceNum = htonl(h->seq);
+    hb->ts_sec = htonl((uint32_t)(h->txTime / 1000000000ULL));
+    hb->ts_nsec = htonl((uint32_t)(h->txTime % 1000000000ULL));
+    hb->timeSource = h->timeSource;
+    hb->SignalQuality = htonl(h->SignalQuality);
+    hb->RSSI = htonl(h->RSSI);
+    return sizeof(TGIFHeartbeat);
+  }
+
+  if (h->extensions & PROBE_EXT_WIRELESS) {
+    p[0] = PROBE_TLV_WIRELESS;
+    p[1] = PROBE_TLV_WIRELESS_SIZE;
+    putWire32(p + 2, (uint32_t)h->RSSI);
+    putWire32(p + 6, (uint32_t)h->SignalQuality);
+    p += PROBE_TLV_HDR_SIZE + PROBE_TLV_WIRELESS_SIZE;
+  }
+  if (h->extensions & PROBE_EXT_GPS) {
+    p[0] = PROBE_TLV_GPS;
+    p[1] = PROBE_TLV_GPS_SIZE;
+    putWire32(p + 2, (uint32_t)h->latitude);
+    putWire32(p + 6, (uint32_t)h->longitude);
+    putWire32(p + 10, (uint32_t)h->elevation);
+    putWire32(p + 14, (uint32_t)h->velocity);
+    putWire32(p + 18, (uint32_t)h->latError);
+    putWire32(p + 22, (uint32_t)h->lonError);
+    p[26] = h->timeSource;
+    p += PROBE_TLV_HDR_SIZE + PROBE_TLV_GPS_SIZE;
+  }
+  h->hdrSize = (uint16_t)(p - bufPtr);
+  bufPtr[PROBE_OFF_TYPE] = PROBE_TYPE_BYTE(PROBE_FORMAT_FULL);
+  bufPtr[PROBE_OFF_MODE] = h->mode;
+  putWire16(bufPtr + PROBE_OFF_HDRSIZE, h->hdrSize);
+  putWire32(bufPtr + PROBE_OFF_SEQ, h->seq);
+  putWire64(bufPtr + PROBE_OFF_TXTIME, h->txTime);
+  putWire64(bufPtr + PROBE_OFF_SRVRX, 0);
+  putWire64(bufPtr + PROBE_OFF_SRVTX, 0);
+  putWire32(bufPtr + PROBE_OFF_NODEID, h->nodeID);
+  putWire32(bufPtr + PROBE_OFF_OFFSET, (uint32_t)h->clockOffset);
+  return h->hdrSize;
+}
+
+/***********************************************************
+* Function: int decodeProbe(char *bufPtr, int length, probeHeader *h)
+*
+* Explanation: decodes the header of a probe (or of a mode 0 echo)
+*
+* inputs:
+*      char *bufPtr : the msg
+*      int length : its size
+*      probeHeader *h : set to the header (the fields a format does not
+*                       carry are 0)
+*
+* outputs: returns the format or ERROR (not a probe, or shorter than
+*          its header)
+*
+* notes:
+*    The fixed offset fields are loaded without a test of their
+*    values.  The extensions are walked (unknown types skipped) up to
+*    the hdrSize.  A compact echo's server times are its arrival time
+*    and the arrival time plus the turnaround.  A TGIFHeartbeat has
+*    only its ts (txTime):  the server's time in an echo
+*    (decodeProbeReply).
+*
+***********************************************************/
+int decodeProbe(char *bufPtr, int length, probeHeader *h)
+{
+  uint8_t type;
+  char *p;
+  char *end;
+
+  if (length < PROBE_COMPACT_SIZE)
+    return ERROR;
+  memset(h, 0, sizeof(probeHeader));
+  type = (uint8_t)bufPtr[PROBE_OFF_TYPE];
+
+  if (type == PROBE_TYPE_BYTE(PROBE_FORMAT_COMPACT)) {
+    h->format = PROBE_FORMAT_COMPACT;
+    h->mode = (uint8_t)bufPtr[PROBE_OFF_MODE];
+    h->hdrSize = PROBE_COMPACT_SIZE;
+    h->seq = getWire32(bufPtr + PROBE_OFF_SEQ);
+    h->txTime = getWire64(bufPtr + PROBE_OFF_TXTIME);
+    h->srvRxTime = h->txTime;
+    h->srvTxTime = h->txTime + (uint64_t)getWire16(bufPtr + PROBE_OFF_AUX) * 1000ULL;
+    return PROBE_FORMAT_COMPACT;
+  }
+
+  if (type == PROBE_TYPE_BYTE(PROBE_FORMAT_FULL)) {
+    if (length < PROBE_FULL_SIZE)
+      return ERROR;
+    h->format = PROBE_FORMAT_FULL;
+    h->mode = (uint8_t)bufPtr[PROBE_OFF_MODE];
+    h->hdrSize = getWire16(bufPtr + PROBE_OFF_HDRSIZE);
+    h->seq = getWire32(bufPtr + PROBE_OFF_SEQ);
+    h->txTime = getWire64(bufPtr + PROBE_OFF_TXTIME);
+    h->srvRxTime = getWire64(bufPtr + PROBE_OFF_SRVRX);
+    h->srvTxTime = getWire64(bufPtr + PROBE_OFF_SRVTX);
+    h->nodeID = getWire32(bufPtr + PROBE_OFF_NODEID);
+    h->clockOffset = (int32_t)getWire32(bufPtr + PROBE_OFF_OFFSET);
+    if ((h->hdrSize < PROBE_FULL_SIZE) || (h->hdrSize > length))
+      return ERROR;
+    p = bufPtr + PROBE_FULL_SIZE;
+    end = bufPtr + h->hdrSize;
+    while (p + PROBE_TLV_HDR_SIZE <= end) {
+      uint8_t tlvType = (uint8_t)p[0];
+      uint8_t tlvLength = (uint8_t)p[1];
+      if (p + PROBE_TLV_HDR_SIZE + tlvLength > end)
+        break;
+      if ((tlvType == PROBE_TLV_WIRELESS) && (tlvLength >= PROBE_TLV_WIRELESS_SIZE)) {
+        h->RSSI = (int32_t)getWire32(p + 2);
+        h->SignalQuality = (int32_t)getWire32(p + 6);
+        h->extensions |= PROBE_EXT_WIRELESS;
+      }
+      else if ((tlvType == PROBE_TLV_GPS) && (tlvLength >= PROBE_TLV_GPS_SIZE)) {
+        h->latitude = (int32_t)getWire32(p + 2);
+        h->longitude = (int32_t)getWire32(p + 6);
+        h->elevation = (int32_t)getWire32(p + 10);
+        h->velocity = (int32_t)getWire32(p + 14);
+        h->latError = (int32_t)getWire32(p + 18);
+        h->lonError = (int32_t)getWire32(p + 22);
+        h->timeSource = (uint8_t)p[26];
+        h->extensions |= PROBE_EXT_GPS;
+      }
+      p += PROBE_TLV_HDR_SIZE + tlvLength;
+    }
+    return PROBE_FORMAT_FULL;
+  }
+
+  //version 0:  a TGIFHeartbeat
+  if ((type == 3) && (length >= (int)sizeof(TGIFHeartbeat))) {
+    TGIFHeartbeat *hb = (TGIFHeartbeat *)bufPtr;
+    h->format = PROBE_FORMAT_LEGACY;
+    h->mode = hb->code;
+    h->hdrSize = sizeof(TGIFHeartbeat);
+    h->seq = ntohl(hb->sequenceNum);
+    h->nodeID = ntohl(hb->nodeID);
+    h->txTime = (uint64_t)ntohl(hb->ts_sec) * 1000000000ULL + ntohl(hb->ts_nsec);
+    h->RSSI = (int32_t)ntohl(hb->RSSI);
+    h->SignalQuality = (int32_t)ntohl(hb->SignalQuality);
+    h->timeSource = (uint8_t)hb->timeSource;
+    h->extensions = PROBE_EXT_WIRELESS;
+    return PROBE_FORMAT_LEGACY;
+  }
+  return ERROR;
+}
+
+/***********************************************************
+* Function: void encodeProbeEcho(char *msgPtr, int format, uint64_t srvRxTime, uint64_t srvTxTime)
+*
+* Explanation: turns a probe into its mode 0 echo (in place):  adds
+*              the server's arrival and reply send times
+*
+* inputs:
+*      char *msgPtr : the probe (decoded as format)
+*      int format : its PROBE_FORMAT_*
+*      uint64_t srvRxTime, srvTxTime : ns since the epoch
+*
+* notes:
+*    A compact echo's send time is its arrival time plus the
+*    turnaround (usecs, at most 65535).  A TGIFHeartbeat echo has
+*    one server time (its ts, as older servers):  the arrival time.
+*
+***********************************************************/
+void encodeProbeEcho(char *msgPtr, int format, uint64_t srvRxTime, uint64_t srvTxTime)
+{
+  uint64_t turnaround;
+
+  if (format == PROBE_FORMAT_FULL) {
+    putWire64(msgPtr + PROBE_OFF_SRVRX, srvRxTime);
+    putWire64(msgPtr + PROBE_OFF_SRVTX, srvTxTime);
+  }
+  else if (format == PROBE_FORMAT_COMPACT) {
+    turnaround = (srvTxTime > srvRxTime) ? (srvTxTime - srvRxTime) / 1000ULL : 0;
+    putWire16(msgPtr + PROBE_OFF_AUX, (uint16_t)((turnaround < 65535) ? turnaround : 65535));
+    putWire64(msgPtr + PROBE_OFF_TXTIME, srvRxTime);
+  }
+  else {
+    TGIFHeartbeat *hb = (TGIFHeartbeat *)msgPtr;
+    hb->ts_sec = htonl((uint32_t)(srvRxTime / 1000000000ULL));
+    hb->ts_nsec = htonl((uint32_t)(srvRxTime % 1000000000ULL));
+  }
+}
+
+/***********************************************************
+* Function: int encodeProbeACK(probeACK *ackPtr, probeHeader *h, uint64_t srvRxTime, uint64_t srvTxTime)
+*
+* Explanation: builds the mode 1 reply to the probe h:  a TGIFACK (its
+*              ts the arrival time, as older servers) for a legacy
+*              probe, else a version 1 ACK
+*
+* inputs:
+*      probeACK *ackPtr : storage for the ACK
+*      probeHeader *h : the probe
+*      uint64_t srvRxTime, srvTxTime : ns since the epoch
+*
+* outputs: returns the ACK's size
+*
+***********************************************************/
+int encodeProbeACK(probeACK *ackPtr, probeHeader *h, uint64_t srvRxTime, uint64_t srvTxTime)
+{
+  char *p = (char *)ackPtr->bytes;
+
+  if (h->format == PROBE_FORMAT_LEGACY) {
+    ackPtr->legacy.sequenceNum = htonl(h->seq);
+    ackPtr->legacy.ts_sec = htonl((uint32_t)(srvRxTime / 1000000000ULL));
+    ackPtr->legacy.ts_nsec = htonl((uint32_t)(srvRxTime % 1000000000ULL));
+    return sizeof(TGIFACK);
+  }
+  p[PROBE_OFF_TYPE] = PROBE_TYPE_BYTE(PROBE_FORMAT_ACK);
+  p[PROBE_OFF_MODE] = h->mode;
+  putWire16(p + PROBE_OFF_AUX, 0);
+  putWire32(p + PROBE_OFF_SEQ, h->seq);
+  putWire64(p + PROBE_OFF_ACK_SRVRX, srvRxTime);
+  putWire64(p + PROBE_OFF_ACK_SRVTX, srvTxTime);
+  return PROBE_ACK_SIZE;
+}
+
+/***********************************************************
+* Function: int decodeProbeReply(char *bufPtr, int length, int mode, probeHeader *h)
+*
+* Explanation: decodes a reply:  the seq and the server's times
+*
+* inputs:
+*      char *bufPtr : the reply
+*      int length : its size
+*      int mode : 0 an echo, 1 an ACK
+*      probeHeader *h : set to the reply
+*
+* outputs: returns the format or ERROR (not a reply of the mode)
+*
+* notes:
+*    The ACKs are told apart by their size (a TGIFACK has no type byte).
+*    The legacy replies carry one server time:  it is both srvRxTime
+*    and srvTxTime.
+*
+***********************************************************/
+int decodeProbeReply(char *bufPtr, int length, int mode, probeHeader *h)
+{
+  int format;
+
+  if (mode == 0) {
+    format = decodeProbe(bufPtr, length, h);
+    //The echo's ts is the server's
+    if (format == PROBE_FORMAT_LEGACY) {
+      h->srvRxTime = h->txTime;
+      h->srvTxTime = h->txTime;
+      h->txTime = 0;
+    }
+    return format;
+  }
+
+  memset(h, 0, sizeof(probeHeader));
+  h->mode = mode;
+  if (length == (int)sizeof(TGIFACK)) {
+    TGIFACK *ack = (TGIFACK *)bufPtr;
+    h->format = PROBE_FORMAT_LEGACY;
+    h->seq = ntohl(ack->sequenceNum);
+    h->srvRxTime = (uint64_t)ntohl(ack->ts_sec) * 1000000000ULL + ntohl(ack->ts_nsec);
+    h->srvTxTime = h->srvRxTime;
+    return PROBE_FORMAT_LEGACY;
+  }
+  if ((length == PROBE_ACK_SIZE) && ((uint8_t)bufPtr[PROBE_OFF_TYPE] == PROBE_TYPE_BYTE(PROBE_FORMAT_ACK))) {
+    h->format = PROBE_FORMAT_ACK;
+    h->seq = getWire32(bufPtr + PROBE_OFF_SEQ);
+    h->srvRxTime = getWire64(bufPtr + PROBE_OFF_ACK_SRVRX);
+    h->srvTxTime = getWire64(bufPtr + PROBE_OFF_ACK_SRVTX);
+    return PROBE_FORMAT_ACK;
+  }
+  return ERROR;
+}
+
 
 
 #if 0
@@ -19,8 +19,16 @@
 *     GPSMsg:  same as BSMMsg
 *  TGIFHeader: no used
 *  TGIFHeartbeat:  same as a BMSMsg
+*  TGIFHeartbeat/TGIFACK keep their original layouts (older clients and
+*     servers):  a reply carries one server time (ts_sec/ts_nsec).
+*     The server's rx and tx times (the four timestamps of an NTP
+*     exchange, see clockSync.h) and the client's clock offset
+*     estimate are carried by the probe wire format below.
+*  Probe wire format (version 1):  the full, compact and ACK layouts
+*     serialized at fixed offsets (encodeProbe/decodeProbe...).  The
+*     client sends them (-wire) instead of a TGIFHeartbeat copy.
 *
-* Last update:  10/17/2019
+* Last update:  10/17/2026
 *
 ************************************************************************/
 #ifndef	__messages_h
@@ -204,6 +212,122 @@ typedef struct{
 } TGIFACK;
 
 
+/******************************************
+* PROBE WIRE FORMAT (version 1):  the probes and replies of
+*   UDPPingClient/UDPPingServer serialized field by field at fixed
+*   offsets, big endian, no padding.  The structs above are copied
+*   as is (their layout is the compiler's);  these are not.
+*
+*   The first byte is the version (high nibble) and the format (low
+*   nibble).  A TGIFHeartbeat starts with its msgType (3):  version 0,
+*   so a server takes either.
+*
+*   full (PROBE_FULL_SIZE bytes + extensions):
+*     0  uint8  version | format       1  uint8  mode (0 echo, 1 ACK, 2 stream)
+*     2  uint16 hdrSize (with the extensions)
+*     4  uint32 seq                    8  uint64 client send time (ns since the epoch)
+*    16  uint64 server arrival time   24  uint64 server reply send time  (echo: the server's)
+*    32  uint32 nodeID                36  int32  client's server - client clock estimate (usecs)
+*    40  extensions:  uint8 type, uint8 length, length bytes of value
+*
+*   compact (PROBE_COMPACT_SIZE bytes, for high rate / small probes):
+*     0  uint8  version | format       1  uint8  mode
+*     2  uint16 aux: 0 in a probe, the server's turnaround (usecs) in an echo
+*     4  uint32 seq                    8  uint64 client send time (echo: the server's arrival time)
+*
+*   ACK (PROBE_ACK_SIZE bytes, the mode 1 reply to a full or compact probe):
+*     0  uint8  version | format       1  uint8  mode
+*     2  uint16 0                      4  uint32 seq
+*     8  uint64 server arrival time   16  uint64 server reply send time
+*
+*   Receivers skip the extensions they do not know.
+********************************************/
+#define PROBE_WIRE_VERSION 1
+
+#define PROBE_FORMAT_LEGACY   0   //TGIFHeartbeat / TGIFACK
+#define PROBE_FORMAT_FULL     1
+#define PROBE_FORMAT_COMPACT  2
+#define PROBE_FORMAT_ACK      3
+
+#define PROBE_TYPE_BYTE(format) ((uint8_t)((PROBE_WIRE_VERSION << 4) | (format)))
+
+#define PROBE_OFF_TYPE       0
+#define PROBE_OFF_MODE       1
+#define PROBE_OFF_HDRSIZE    2
+#define PROBE_OFF_AUX        2
+#define PROBE_OFF_SEQ        4
+#define PROBE_OFF_TXTIME     8
+#define PROBE_OFF_SRVRX     16
+#define PROBE_OFF_SRVTX     24
+#define PROBE_OFF_NODEID    32
+#define PROBE_OFF_OFFSET    36
+#define PROBE_OFF_ACK_SRVRX  8
+#define PROBE_OFF_ACK_SRVTX 16
+
+#define PROBE_FULL_SIZE     40
+#define PROBE_COMPACT_SIZE  16
+#define PROBE_ACK_SIZE      24
+
+//Extensions (full format only)
+#define PROBE_TLV_HDR_SIZE       2
+#define PROBE_TLV_WIRELESS       1   //int32 RSSI, int32 SignalQuality
+#define PROBE_TLV_WIRELESS_SIZE  8
+#define PROBE_TLV_GPS            2   //int32 lat, lon, elevation, velocity, latError, lonError, uint8 timeSource
+#define PROBE_TLV_GPS_SIZE       25
+//probeHeader extensions bits
+#define PROBE_EXT_WIRELESS  (1 << PROBE_TLV_WIRELESS)
+#define PROBE_EXT_GPS       (1 << PROBE_TLV_GPS)
+
+//A probe (or reply) decoded:  host order, times in ns since the epoch
+typedef struct {
+  uint8_t  format;         //PROBE_FORMAT_*
+  uint8_t  mode;
+  uint16_t hdrSize;        //on the wire, with the extensions
+  uint32_t seq;
+  uint32_t nodeID;
+  int32_t  clockOffset;    //usecs, 0: none
+  uint64_t txTime;
+  uint64_t srvRxTime;
+  uint64_t srvTxTime;
+  uint32_t extensions;     //PROBE_EXT_* present (decode) or to send (encode)
+  int32_t  RSSI;
+  int32_t  SignalQuality;
+  int32_t  latitude;       //gps info (the TGIFHeartbeat's units)
+  int32_t  longitude;
+  int32_t  elevation;
+  int32_t  velocity;
+  int32_t  latError;
+  int32_t  lonError;
+  uint8_t  timeSource;     //0:localGPSD;1:remote GPSD; 2:Chrony;3:NTP;4:localClock
+} probeHeader;
+
+//Storage for a mode 1 reply of either format
+typedef union {
+  TGIFACK legacy;
+  uint8_t bytes[PROBE_ACK_SIZE];
+} probeACK;
+
+/***********************************************************
+* The fixed offset loads and stores:  unaligned, big endian, no branches
+***********************************************************/
+static inline void putWire16(char *p, uint16_t v) { v = htobe16(v); memcpy(p, &v, sizeof(v)); }
+static inline void putWire32(char *p, uint32_t v) { v = htobe32(v); memcpy(p, &v, sizeof(v)); }
+static inline void putWire64(char *p, uint64_t v) { v = htobe64(v); memcpy(p, &v, sizeof(v)); }
+static inline uint16_t getWire16(const char *p) { uint16_t v; memcpy(&v, p, sizeof(v)); return be16toh(v); }
+static inline uint32_t getWire32(const char *p) { uint32_t v; memcpy(&v, p, sizeof(v)); return be32toh(v); }
+static inline uint64_t getWire64(const char *p) { uint64_t v; memcpy(&v, p, sizeof(v)); return be64toh(v); }
+
+//ns since the epoch <-> timespec, double seconds (split so the double keeps the nsecs)
+static inline uint64_t timespecToWireNs(const struct timespec *ts)
+{
+  return (uint64_t)ts->tv_sec * 1000000000ULL + (uint64_t)ts->tv_nsec;
+}
+static inline double wireNsToD(uint64_t ns)
+{
+  return (double)(ns / 1000000000ULL) + (double)(ns % 1000000000ULL) / 1000000000.0;
+}
+
+
 /****************************************
 * These might be useful internally as msg's are created 
 **************************************/
@@ -451,6 +575,13 @@ int getMsgOverhead( uint16_t msgFormat);
 int packMsg(void *msgPtr, void *unpackedMsgPtr, int maxSize, int encodeType);
 int unPackMsg(void *msgPtr, void *unpackedMsgPtr, int maxSize, int encodeType);
 
+int probeHeaderSize(int format, uint32_t extensions);
+int encodeProbe(char *bufPtr, probeHeader *h);
+int decodeProbe(char *bufPtr, int length, probeHeader *h);
+void encodeProbeEcho(char *msgPtr, int format, uint64_t srvRxTime, uint64_t srvTxTime);
+int encodeProbeACK(probeACK *ackPtr, probeHeader *h, uint64_t srvRxTime, uint64_t srvTxTime);
+int decodeProbeReply(char *bufPtr, int length, int mode, probeHeader *h);
+
 //Should have these somewhere
 //int packMsgHdrToNetworkBuffer(struct MsgHdr *myMsgHdr, void *networkBufferPtr, uint32_t bufSize);
 //int packDataMSGToNetworkBuffer(struct DataMsg *myMsg, void  *networkBufferPtr, uint32_t bufSize);
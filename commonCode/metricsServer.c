@@ -0,0 +1,545 @@
+/*********************************************************
+*
+* Module Name: metrics server
+*
+* File Name:  metricsServer.c
+*
+* Summary:  An HTTP listener thread that serves the records of a
+*           statsExport in the OpenMetrics text format (GET /metrics).
+*
+*  The methods include:
+*   metricsServer *startMetricsServer(const char *service, statsExport *e, int cpu);
+*   void stopMetricsServer(metricsServer *m);
+*   char *formatOpenMetrics(statsExport *e, size_t *sizePtr);
+*   int printMetricsServer(metricsServer *m, FILE *fileFID);
+*
+* Notes:
+*   The families (the record's kind picks the label):
+*     udpping_messages_received/_sent/_lost/_late (counters),
+*     udpping_received_bytes/udpping_sent_bytes (counters),
+*     udpping_latency_seconds (histogram:  workers, targets),
+*     udpping_session_latency_seconds (summary:  sessions),
+*     udpping_latency_min_seconds/_max_seconds,
+*     udpping_last_update_timestamp_seconds (gauges),
+*     udpping_start_timestamp_seconds, udpping_records (gauges).
+*
+* Last update: 10/17/2026
+*
+*********************************************************/
+#define _GNU_SOURCE /* for accept4 */
+#include "common.h"
+#include "SocketHelper.h"
+#include "metricsServer.h"
+#include <stddef.h>
+
+//#define TRACEME 0
+
+//The listening socket's tag, a connection's is its index + 1
+#define METRICS_LISTEN_TAG 0
+
+//A growing text buffer
+typedef struct {
+  char *text;
+  size_t size;
+  size_t maxSize;
+} metricsText;
+
+//A counter family:  the statsRecord field it reads
+typedef struct {
+  const char *name;
+  const char *unit;                //NULL: none
+  const char *help;
+  size_t offset;
+} metricsCounter;
+
+static const metricsCounter counters[] = {
+  {"udpping_messages_received", NULL, "Msgs received (server: probes, client: replies)", offsetof(statsRecord, numberRxed)},
+  {"udpping_messages_sent", NULL, "Msgs sent (server: replies, client: probes)", offsetof(statsRecord, numberSent)},
+  {"udpping_messages_lost", NULL, "Msgs lost (server: seq gaps, client: timeouts)", offsetof(statsRecord, numberLost)},
+  {"udpping_messages_late", NULL, "Late msgs (server: out of order, client: late or unknown replies)", offsetof(statsRecord, numberLate)},
+  {"udpping_received_bytes", "bytes", "Bytes received", offsetof(statsRecord, bytesRxed)},
+  {"udpping_sent_bytes", "bytes", "Bytes sent", offsetof(statsRecord, bytesSent)},
+};
+
+static void *metricsLoop(void *arg);
+static void acceptConnections(metricsServer *m);
+static void serviceConnection(metricsServer *m, metricsConnection *c, uint32_t flags);
+static void buildResponse(metricsServer *m, metricsConnection *c);
+static void closeConnection(metricsServer *m, metricsConnection *c);
+static int appendText(metricsText *t, const char *format, ...);
+static void recordLabels(const statsRecord *r, char *labels, size_t size);
+
+/***********************************************************
+* Function: metricsServer *startMetricsServer(const char *service, statsExport *e, int cpu)
+*
+* Explanation:  listens on the TCP port and starts the thread that
+*               serves the scrapes.  The caller owns the server.
+*
+* inputs:
+*   const char *service : the TCP port (e.g. 9100)
+*   statsExport *e : the records to serve (not owned)
+*   int cpu : pin the thread to this CPU (-1: not pinned), e.g.
+*             one the echo path does not use
+*
+* outputs:
+*    returns the server or NULL on error
+*
+***********************************************************/
+metricsServer *startMetricsServer(const char *service, statsExport *e, int cpu)
+{
+  metricsServer *m = NULL;
+  int i;
+  int rc;
+
+  m = calloc(1, sizeof(metricsServer));
+  if (m == NULL)
+    return NULL;
+  m->stats = e;
+  m->cpu = cpu;
+  for (i = 0; i < METRICS_MAX_CONNECTIONS; i++)
+    m->connections[i].sock = -1;
+
+  m->listenSock = SetupTCPServerSocket(service);
+  if (m->listenSock < 0) {
+    printf("startMetricsServer: failed to listen on %s, errno:%d \n", service, errno);
+    free(m);
+    return NULL;
+  }
+  sockBlockingOff(m->listenSock);
+  m->events = createEventLoop();
+  if ((m->events == NULL) || (eventLoopAdd(m->events, m->listenSock, EPOLLIN, METRICS_LISTEN_TAG) == ERROR)) {
+    close(m->listenSock);
+    freeEventLoop(m->events);
+    free(m);
+    return NULL;
+  }
+
+  m->running = true;
+  rc = pthread_create(&m->thread, NULL, metricsLoop, m);
+  if (rc != 0) {
+    printf("startMetricsServer: pthread_create failed rc:%d \n", rc);
+    close(m->listenSock);
+    freeEventLoop(m->events);
+    free(m);
+    return NULL;
+  }
+  return m;
+}
+
+/***********************************************************
+* Function: void stopMetricsServer(metricsServer *m)
+*
+* Explanation:  stops the thread (within METRICS_WAIT_MSECS),
+*               closes the sockets and frees the server
+*
+***********************************************************/
+void stopMetricsServer(metricsServer *m)
+{
+  if (m == NULL)
+    return;
+  __atomic_store_n(&m->running, false, __ATOMIC_RELEASE);
+  pthread_join(m->thread, NULL);
+  close(m->listenSock);
+  freeEventLoop(m->events);
+  free(m);
+}
+
+/***********************************************************
+* Function: static void *metricsLoop(void *arg)
+*
+* Explanation:  The listener thread:  accepts the connections,
+*               reads their requests and writes the responses
+*               (non blocking) until the server is stopped
+*
+***********************************************************/
+static void *metricsLoop(void *arg)
+{
+  metricsServer *m = (metricsServer *)arg;
+  double curTime;
+  uint64_t tag;
+  int numberReady;
+  int i;
+
+  pinThreadToCPU(m->cpu);
+  while (__atomic_load_n(&m->running, __ATOMIC_ACQUIRE)) {
+    numberReady = eventLoopWait(m->events, METRICS_WAIT_MSECS);
+    if (numberReady == ERROR)
+      break;
+    for (i = 0; i < numberReady; i++) {
+      tag = eventTag(m->events, i);
+      if (tag == METRICS_LISTEN_TAG)
+        acceptConnections(m);
+      else if (m->connections[tag - 1].sock >= 0)
+        serviceConnection(m, &m->connections[tag - 1], eventFlags(m->events, i));
+    }
+    //A client that does not finish its request (or read the response) in time
+    curTime = getTimestampD();
+    for (i = 0; i < METRICS_MAX_CONNECTIONS; i++) {
+      if ((m->connections[i].sock >= 0) &&
+          (curTime - m->connections[i].startTime > METRICS_CONNECTION_TIMEOUT)) {
+        m->numberErrors++;
+        closeConnection(m, &m->connections[i]);
+      }
+    }
+  }
+  for (i = 0; i < METRICS_MAX_CONNECTIONS; i++)
+    if (m->connections[i].sock >= 0)
+      closeConnection(m, &m->connections[i]);
+  return NULL;
+}
+
+/***********************************************************
+* Function: static void acceptConnections(metricsServer *m)
+*
+* Explanation:  accepts every pending connection.  When all the
+*               connections are in use the new one is closed.
+*
+***********************************************************/
+static void acceptConnections(metricsServer *m)
+{
+  metricsConnection *c = NULL;
+  int sock;
+  int i;
+
+  while ((sock = accept4(m->listenSock, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+    for (i = 0; (i < METRICS_MAX_CONNECTIONS) && (m->connections[i].sock >= 0); i++)
+      ;
+    if ((i == METRICS_MAX_CONNECTIONS) || (eventLoopAdd(m->events, sock, EPOLLIN, i + 1) == ERROR)) {
+      m->numberErrors++;
+      close(sock);
+      continue;
+    }
+    c = &m->connections[i];
+    c->sock = sock;
+    c->startTime = getTimestampD();
+    c->requestSize = 0;
+    c->response = NULL;
+    c->responseSize = 0;
+    c->numberWritten = 0;
+  }
+}
+
+/***********************************************************
+* Function: static void serviceConnection(metricsServer *m, metricsConnection *c,
+*                                         uint32_t flags)
+*
+* Explanation:  reads the request (until its blank line) and then
+*               writes the response.  The connection is closed when
+*               the response is written, on an error or on EOF.
+*
+***********************************************************/
+static void serviceConnection(metricsServer *m, metricsConnection *c, uint32_t flags)
+{
+  ssize_t rc;
+
+  if (c->response == NULL) {
+    rc = read(c->sock, c->request + c->requestSize, METRICS_REQUEST_SIZE - 1 - c->requestSize);
+    if ((rc < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR)))
+      return;
+    if (rc <= 0) {
+      closeConnection(m, c);
+      return;
+    }
+    c->requestSize += (uint32_t)rc;
+    c->request[c->requestSize] = '\0';
+    if ((strstr(c->request, "\r\n\r\n") == NULL) && (strstr(c->request, "\n\n") == NULL) &&
+        (c->requestSize < METRICS_REQUEST_SIZE - 1))
+      return;
+    buildResponse(m, c);
+    if ((c->response == NULL) || (eventLoopModify(m->events, c->sock, EPOLLOUT, (uint64_t)(c - m->connections) + 1) == ERROR)) {
+      closeConnection(m, c);
+      return;
+    }
+  }
+  else if (flags & (EPOLLERR | EPOLLHUP)) {
+    closeConnection(m, c);
+    return;
+  }
+
+  while (c->numberWritten < c->responseSize) {
+    rc = write(c->sock, c->response + c->numberWritten, c->responseSize - c->numberWritten);
+    if ((rc < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)))
+      return;
+    if ((rc < 0) && (errno == EINTR))
+      continue;
+    if (rc <= 0)
+      break;
+    c->numberWritten += (size_t)rc;
+  }
+  closeConnection(m, c);
+}
+
+/***********************************************************
+* Function: static void buildResponse(metricsServer *m, metricsConnection *c)
+*
+* Explanation:  builds the response to the connection's request:
+*               the metrics for GET (or HEAD) / or /metrics, else
+*               an error status
+*
+***********************************************************/
+static void buildResponse(metricsServer *m, metricsConnection *c)
+{
+  metricsText response = {NULL, 0, 0};
+  char method[8] = "";
+  char path[256] = "";
+  char *body = NULL;
+  size_t bodySize = 0;
+  const char *status = "200 OK";
+  double startTime = 0.0;
+
+  if (sscanf(c->request, "%7s %255s", method, path) != 2)
+    status = "400 Bad Request";
+  else if ((strcmp(method, "GET") != 0) && (strcmp(method, "HEAD") != 0))
+    status = "405 Method Not Allowed";
+  else {
+    path[strcspn(path, "?")] = '\0';
+    if ((strcmp(path, "/metrics") != 0) && (strcmp(path, "/") != 0))
+      status = "404 Not Found";
+  }
+
+  if (strcmp(status, "200 OK") == 0) {
+    startTime = getTimestampD();
+    body = formatOpenMetrics(m->stats, &bodySize);
+    m->scrapeTimeSum += getTimestampD() - startTime;
+    m->numberScrapes++;
+    if (body == NULL)
+      status = "500 Internal Server Error";
+  }
+  else
+    m->numberErrors++;
+
+  if (body == NULL)
+    appendText(&response, "HTTP/1.1 %s\r\nContent-Type: text/plain\r\nContent-Length: %lu\r\n"
+               "Connection: close\r\n\r\n%s\n", status, (unsigned long)strlen(status) + 1, status);
+  else {
+    appendText(&response, "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %lu\r\n"
+               "Connection: close\r\n\r\n", status, METRICS_CONTENT_TYPE, (unsigned long)bodySize);
+    if (strcmp(method, "GET") == 0)
+      appendText(&response, "%s", body);
+    free(body);
+  }
+  c->response = response.text;
+  c->responseSize = response.size;
+  c->numberWritten = 0;
+}
+
+/***********************************************************
+* Function: static void closeConnection(metricsServer *m, metricsConnection *c)
+*
+* Explanation:  closes a connection and frees its slot
+*
+***********************************************************/
+static void closeConnection(metricsServer *m, metricsConnection *c)
+{
+  eventLoopRemove(m->events, c->sock);
+  close(c->sock);
+  c->sock = -1;
+  free(c->response);
+  c->response = NULL;
+}
+
+/***********************************************************
+* Function: static int appendText(metricsText *t, const char *format, ...)
+*
+* Explanation:  appends printf output to the text (grown as needed)
+*
+* outputs:
+*    returns ERROR (no memory, the text is unchanged) or NOERROR
+*
+***********************************************************/
+static int appendText(metricsText *t, const char *format, ...)
+{
+  va_list args;
+  char *text = NULL;
+  size_t maxSize;
+  int length;
+
+  va_start(args, format);
+  length = vsnprintf(NULL, 0, format, args);
+  va_end(args);
+  if (length < 0)
+    return ERROR;
+  if (t->size + (size_t)length + 1 > t->maxSize) {
+    maxSize = (t->maxSize > 0) ? t->maxSize : 4096;
+    while (t->size + (size_t)length + 1 > maxSize)
+      maxSize *= 2;
+    text = realloc(t->text, maxSize);
+    if (text == NULL)
+      return ERROR;
+    t->text = text;
+    t->maxSize = maxSize;
+  }
+  va_start(args, format);
+  vsnprintf(t->text + t->size, t->maxSize - t->size, format, args);
+  va_end(args);
+  t->size += (size_t)length;
+  return NOERROR;
+}
+
+/***********************************************************
+* Function: static void recordLabels(const statsRecord *r, char *labels, size_t size)
+*
+* Explanation:  the labels of a record's samples:  worker="id",
+*               client="name" (session) or target="name".  The
+*               name's quotes and backslashes are escaped.
+*
+***********************************************************/
+static void recordLabels(const statsRecord *r, char *labels, size_t size)
+{
+  char value[2 * STATS_NAME_SIZE];
+  size_t i;
+  size_t j = 0;
+
+  if (r->kind == STATS_KIND_WORKER) {
+    snprintf(labels, size, "worker=\"%u\"", r->id);
+    return;
+  }
+  for (i = 0; (i < STATS_NAME_SIZE) && (r->name[i] != '\0'); i++) {
+    if ((r->name[i] == '"') || (r->name[i] == '\\'))
+      value[j++] = '\\';
+    value[j++] = (r->name[i] == '\n') ? ' ' : r->name[i];
+  }
+  value[j] = '\0';
+  snprintf(labels, size, "%s=\"%s\"", (r->kind == STATS_KIND_SESSION) ? "client" : "target", value);
+}
+
+/***********************************************************
+* Function: char *formatOpenMetrics(statsExport *e, size_t *sizePtr)
+*
+* Explanation:  formats the export's active records in the
+*               OpenMetrics text format (ending with # EOF)
+*
+* inputs:
+*   statsExport *e : the records
+*   size_t *sizePtr : set to the text's size
+*
+* outputs:
+*    returns the text (the caller frees it) or NULL (no memory)
+*
+* notes:
+*   The records are copied (statsReadRecord) before any family is
+*   written.  A histogram bucket's le is its bin's upper edge.
+*
+***********************************************************/
+char *formatOpenMetrics(statsExport *e, size_t *sizePtr)
+{
+  metricsText t = {NULL, 0, 0};
+  statsRecord *records = NULL;
+  char labels[3 * STATS_NAME_SIZE];
+  uint32_t numberRecords;
+  uint32_t numberActive = 0;
+  uint32_t i;
+  uint32_t c;
+  uint64_t count;
+  int bin;
+  int rc = NOERROR;
+
+  numberRecords = __atomic_load_n(&e->header->numberRecords, __ATOMIC_ACQUIRE);
+  if (numberRecords > e->header->maxRecords)
+    numberRecords = e->header->maxRecords;
+  if (numberRecords > 0) {
+    records = aligned_alloc(CACHE_LINE_SIZE, (size_t)numberRecords * sizeof(statsRecord));
+    if (records == NULL)
+      return NULL;
+  }
+  for (i = 0; i < numberRecords; i++)
+    if (statsReadRecord(e, i, &records[numberActive]) == NOERROR)
+      numberActive++;
+
+  rc |= appendText(&t, "# TYPE udpping_start_timestamp_seconds gauge\n"
+                   "# HELP udpping_start_timestamp_seconds When the process started\n"
+                   "udpping_start_timestamp_seconds %.6f\n", e->header->startTime);
+  rc |= appendText(&t, "# TYPE udpping_records gauge\n"
+                   "# HELP udpping_records Active workers, sessions and targets\n"
+                   "udpping_records %u\n", numberActive);
+
+  for (c = 0; c < sizeof(counters) / sizeof(counters[0]); c++) {
+    rc |= appendText(&t, "# TYPE %s counter\n", counters[c].name);
+    if (counters[c].unit != NULL)
+      rc |= appendText(&t, "# UNIT %s %s\n", counters[c].name, counters[c].unit);
+    rc |= appendText(&t, "# HELP %s %s\n", counters[c].name, counters[c].help);
+    for (i = 0; i < numberActive; i++) {
+      recordLabels(&records[i], labels, sizeof(labels));
+      rc |= appendText(&t, "%s_total{%s} %lu\n", counters[c].name, labels,
+                       (unsigned long)*(uint64_t *)((char *)&records[i] + counters[c].offset));
+    }
+  }
+
+  //Workers and targets:  the bins.  Sessions:  the count and sum.
+  rc |= appendText(&t, "# TYPE udpping_latency_seconds histogram\n# UNIT udpping_latency_seconds seconds\n"
+                   "# HELP udpping_latency_seconds Latency (server: one way delay, client: RTT)\n");
+  for (i = 0; i < numberActive; i++) {
+    if (records[i].kind == STATS_KIND_SESSION)
+      continue;
+    recordLabels(&records[i], labels, sizeof(labels));
+    count = 0;
+    for (bin = 0; bin < STATS_LATENCY_BINS - 1; bin++) {
+      count += records[i].latencyBins[bin];
+      rc |= appendText(&t, "udpping_latency_seconds_bucket{%s,le=\"%.9g\"} %lu\n",
+                       labels, (double)(1ULL << bin) / 1000000.0, (unsigned long)count);
+    }
+    rc |= appendText(&t, "udpping_latency_seconds_bucket{%s,le=\"+Inf\"} %lu\n"
+                     "udpping_latency_seconds_count{%s} %lu\n"
+                     "udpping_latency_seconds_sum{%s} %.9f\n",
+                     labels, (unsigned long)records[i].latencyCount,
+                     labels, (unsigned long)records[i].latencyCount, labels, records[i].latencySum);
+  }
+  rc |= appendText(&t, "# TYPE udpping_session_latency_seconds summary\n# UNIT udpping_session_latency_seconds seconds\n"
+                   "# HELP udpping_session_latency_seconds One way delay of a client's msgs\n");
+  for (i = 0; i < numberActive; i++) {
+    if (records[i].kind != STATS_KIND_SESSION)
+      continue;
+    recordLabels(&records[i], labels, sizeof(labels));
+    rc |= appendText(&t, "udpping_session_latency_seconds_count{%s} %lu\n"
+                     "udpping_session_latency_seconds_sum{%s} %.9f\n",
+                     labels, (unsigned long)records[i].latencyCount, labels, records[i].latencySum);
+  }
+
+  rc |= appendText(&t, "# TYPE udpping_latency_min_seconds gauge\n# UNIT udpping_latency_min_seconds seconds\n"
+                   "# HELP udpping_latency_min_seconds Smallest latency\n");
+  for (i = 0; i < numberActive; i++) {
+    recordLabels(&records[i], labels, sizeof(labels));
+    rc |= appendText(&t, "udpping_latency_min_seconds{%s} %.9f\n", labels, records[i].latencyMin);
+  }
+  rc |= appendText(&t, "# TYPE udpping_latency_max_seconds gauge\n# UNIT udpping_latency_max_seconds seconds\n"
+                   "# HELP udpping_latency_max_seconds Largest latency\n");
+  for (i = 0; i < numberActive; i++) {
+    recordLabels(&records[i], labels, sizeof(labels));
+    rc |= appendText(&t, "udpping_latency_max_seconds{%s} %.9f\n", labels, records[i].latencyMax);
+  }
+  rc |= appendText(&t, "# TYPE udpping_last_update_timestamp_seconds gauge\n"
+                   "# UNIT udpping_last_update_timestamp_seconds seconds\n"
+                   "# HELP udpping_last_update_timestamp_seconds When the record was last updated\n");
+  for (i = 0; i < numberActive; i++) {
+    recordLabels(&records[i], labels, sizeof(labels));
+    rc |= appendText(&t, "udpping_last_update_timestamp_seconds{%s} %.6f\n", labels, records[i].updateTime);
+  }
+  rc |= appendText(&t, "# EOF\n");
+
+  free(records);
+  if (rc != NOERROR) {
+    free(t.text);
+    return NULL;
+  }
+  *sizePtr = t.size;
+  return t.text;
+}
+
+/***********************************************************
+* Function: int printMetricsServer(metricsServer *m, FILE *fileFID)
+*
+* Explanation:  displays the server's scrape counters
+*
+* outputs:
+*    returns ERROR or NOERROR
+*
+***********************************************************/
+int printMetricsServer(metricsServer *m, FILE *fileFID)
+{
+  if ((m == NULL) || (fileFID == NULL))
+    return ERROR;
+  fprintf(fileFID, "metrics: scrapes:%lu errors:%lu avg format time:%1.6f secs \n",
+          (unsigned long)m->numberScrapes, (unsigned long)m->numberErrors,
+          (m->numberScrapes > 0) ? m->scrapeTimeSum / (double)m->numberScrapes : 0.0);
+  return NOERROR;
+}
@@ -0,0 +1,74 @@
+/************************************************************************
+* File:  metricsServer.h
+*
+* Purpose:
+*   This include file is for the metricsServer module:  an embedded
+*   HTTP listener that serves the records of a statsExport (counters,
+*   latency histograms) in the OpenMetrics (Prometheus) text format
+*   so a running server can be scraped (GET /metrics).
+*
+*   metricsServer *startMetricsServer(const char *service, statsExport *e, int cpu);
+*   void stopMetricsServer(metricsServer *m);
+*   char *formatOpenMetrics(statsExport *e, size_t *sizePtr);
+*   int printMetricsServer(metricsServer *m, FILE *fileFID);
+*
+* Notes:
+*   The listener runs on its own thread with its own event loop
+*   (epoll, non blocking sockets).  It only reads the export's
+*   records (seqlock copies):  the threads that write them (e.g.,
+*   the echo path) never wait for a scrape.  A scrape copies the
+*   records first so the families of a response are one snapshot.
+*   Each connection serves one request (HTTP/1.0 style,
+*   Connection: close).  Start it with SIGINT blocked so the
+*   signal is handled by the main thread.
+*   The latency histograms (workers, targets) have one bucket per
+*   statsRecord bin (log2 usecs), a session's latency is a summary
+*   (count and sum).
+*
+* Last update: 10/17/2026
+*
+*************************************************************************/
+#ifndef	__metricsServer_h
+#define	__metricsServer_h
+
+#include "common.h"
+#include "statsExport.h"
+#include "eventLoop.h"
+
+#define METRICS_MAX_CONNECTIONS 16
+#define METRICS_REQUEST_SIZE 2048
+//The thread checks for a stop this often (msecs)
+#define METRICS_WAIT_MSECS 200
+//A connection is closed after this many seconds (e.g., an idle client)
+#define METRICS_CONNECTION_TIMEOUT 5.0
+#define METRICS_CONTENT_TYPE "application/openmetrics-text; version=1.0.0; charset=utf-8"
+
+typedef struct {
+  int sock;                        //-1: free
+  double startTime;                //when accepted (getTimestampD)
+  uint32_t requestSize;
+  char request[METRICS_REQUEST_SIZE];
+  char *response;                  //NULL: the request is still being read
+  size_t responseSize;
+  size_t numberWritten;
+} metricsConnection;
+
+typedef struct {
+  int listenSock;
+  int cpu;                         //of the thread, -1: not pinned
+  statsExport *stats;
+  eventLoop *events;
+  pthread_t thread;
+  bool running;
+  metricsConnection connections[METRICS_MAX_CONNECTIONS];
+  uint64_t numberScrapes;
+  uint64_t numberErrors;           //bad requests, refused connections
+  double scrapeTimeSum;            //seconds spent formatting the scrapes
+} metricsServer;
+
+metricsServer *startMetricsServer(const char *service, statsExport *e, int cpu);
+void stopMetricsServer(metricsServer *m);
+char *formatOpenMetrics(statsExport *e, size_t *sizePtr);
+int printMetricsServer(metricsServer *m, FILE *fileFID);
+
+#endif
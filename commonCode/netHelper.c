@@ -98,7 +98,7 @@ bool isWireless(const char* ifname, char* protocol)
     return rc;
   }
  
-  strncpy(pwrq.ifr_name, ifname, IFNAMSIZ);
+  strncpy(pwrq.ifr_name, ifname, IFNAMSIZ - 1);
 
   if ((sock = socket(AF_INET, SOCK_STREAM, 0)) == -1) {
     perror("isWireless:  ERROR socket call: ");
@@ -178,7 +178,8 @@ int getIFnames(char *arrayOfIFNames[])
         perror("malloc IFName ");
         return -1;
       }
-      strncpy(IFName, ifa->ifa_name, IFNAMSIZ);
+      strncpy(IFName, ifa->ifa_name, IFNAMSIZ - 1);
+      IFName[IFNAMSIZ - 1] = '\0';
       arrayOfIFNames[arrayIndex++] = IFName;
     }
   freeifaddrs(ifaddr);
@@ -307,7 +308,8 @@ int getIFInfo(struct IFInfoStruct  *arrayOfIFInfo[])
         perror("malloc IFName ");
         return -1;
       }
-      strncpy(IFName, ifa->ifa_name, IFNAMSIZ);
+      strncpy(IFName, ifa->ifa_name, IFNAMSIZ - 1);
+      IFName[IFNAMSIZ - 1] = '\0';
       arrayOfIFInfo[arrayIndex++] = myIFInfoStruct; 
       if (isWireless(ifa->ifa_name, protocol)) {
         myIFInfoStruct->isWireless = true;
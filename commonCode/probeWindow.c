@@ -0,0 +1,347 @@
+/*********************************************************
+*
+* Module Name: probe window
+*
+* File Name:  probeWindow.c
+*
+* Summary:  Tracks the set of probes that are in flight so a
+*           client can have N probes outstanding.  Replies are
+*           matched by sequenceNum using a ring indexed by
+*           seq % windowSize.  RTT, loss and reorder are computed
+*           as replies (or deadlines) arrive rather than in lock step
+*           with the sends.
+*
+*  The methods include:
+*   probeWindow *createProbeWindow(uint32_t windowSize);
+*   void freeProbeWindow(probeWindow *w);
+*   bool isProbeWindowFull(probeWindow *w, uint32_t nextSeq);
+*   int probeWindowSent(probeWindow *w, uint32_t seq, double txTime, double deadline);
+*   int probeWindowAcked(probeWindow *w, uint32_t seq, double *txTimePtr);
+*   int probeWindowTxTime(probeWindow *w, uint32_t seq, double txTime);
+*   int probeWindowExpire(probeWindow *w, double curTime);
+*   double probeWindowNextDeadline(probeWindow *w);
+*   void probeWindowSetTimeout(probeWindow *w, double rttMultiple, double minTimeout, double maxTimeout);
+*   void probeWindowRTTSample(probeWindow *w, double RTTSample);
+*   double probeWindowTimeout(probeWindow *w);
+*
+* Notes:
+*   Sequence numbers are compared with serial number arithmetic
+*   so the window keeps working when the 32 bit seq wraps.
+*   Each probe's deadline is a timer on a timer wheel (add on the
+*   send, cancel on the ACK, expire:  all O(1)) - the timeout may
+*   follow the RTT so the deadlines do not increase with seq.
+*
+* Last update: 10/17/2026
+*
+*********************************************************/
+#include "common.h"
+#include "timeHelper.h"
+#include "probeWindow.h"
+
+//#define TRACEME 0
+
+//true if seq a is before seq b
+#define SEQ_LT(a,b) ((int32_t)((uint32_t)(a) - (uint32_t)(b)) < 0)
+#define SEQ_LEQ(a,b) ((int32_t)((uint32_t)(a) - (uint32_t)(b)) <= 0)
+
+static inline probeEntry *getEntry(probeWindow *w, uint32_t seq)
+{
+  return &w->entries[seq % w->windowSize];
+}
+
+/***********************************************************
+* Function: static void advanceOldest(probeWindow *w)
+*
+* Explanation:  moves oldestSeq past all slots that are no
+*               longer in flight (ACKed or lost).
+*
+***********************************************************/
+static void advanceOldest(probeWindow *w)
+{
+  probeEntry *e = NULL;
+
+  while (SEQ_LEQ(w->oldestSeq, w->highestSeqSent)) {
+    e = getEntry(w, w->oldestSeq);
+    if ((e->state == PROBE_INFLIGHT) && (e->sequenceNum == w->oldestSeq))
+      break;
+    w->oldestSeq++;
+  }
+}
+
+/***********************************************************
+* Function: probeWindow *createProbeWindow(uint32_t windowSize)
+*
+* Explanation:  creates a window that allows windowSize probes
+*               to be in flight.  The caller owns the memory.
+*
+* inputs:
+*   uint32_t windowSize : 1 .. MAX_PROBE_WINDOW
+*
+* outputs:
+*    returns the window or NULL on error
+*
+***********************************************************/
+probeWindow *createProbeWindow(uint32_t windowSize)
+{
+  probeWindow *w = NULL;
+
+  if ((windowSize == 0) || (windowSize > MAX_PROBE_WINDOW)) {
+    printf("createProbeWindow: bad windowSize %d \n", windowSize);
+    return NULL;
+  }
+
+  w = malloc(sizeof(probeWindow));
+  if (w == NULL)
+    return NULL;
+  memset(w, 0, sizeof(probeWindow));
+
+  w->entries = calloc(windowSize, sizeof(probeEntry));
+  w->deadlines = createTimerWheel(PROBE_TIMER_TICK, getTimestampD());
+  if ((w->entries == NULL) || (w->deadlines == NULL)) {
+    freeProbeWindow(w);
+    return NULL;
+  }
+  w->windowSize = windowSize;
+  w->rttMultiple = 0.0;
+  w->minTimeout = PROBE_MIN_TIMEOUT;
+  w->maxTimeout = TIMEOUT;
+  w->oldestSeq = 1;
+  w->highestSeqSent = 0;
+  w->highestSeqAcked = 0;
+  return w;
+}
+
+/***********************************************************
+* Function: void freeProbeWindow(probeWindow *w)
+*
+* Explanation:  frees the window
+*
+***********************************************************/
+void freeProbeWindow(probeWindow *w)
+{
+  if (w != NULL) {
+    free(w->entries);
+    freeTimerWheel(w->deadlines);
+    free(w);
+  }
+}
+
+/***********************************************************
+* Function: bool isProbeWindowFull(probeWindow *w, uint32_t nextSeq)
+*
+* Explanation:  returns true if the slot that nextSeq maps to
+*               still holds a probe in flight.
+*
+***********************************************************/
+bool isProbeWindowFull(probeWindow *w, uint32_t nextSeq)
+{
+  return (getEntry(w, nextSeq)->state == PROBE_INFLIGHT);
+}
+
+/***********************************************************
+* Function: int probeWindowSent(probeWindow *w, uint32_t seq, double txTime, double deadline)
+*
+* Explanation:  records that probe seq was sent
+*
+* inputs:
+*   probeWindow *w
+*   uint32_t seq :  must be one more than the previous seq sent
+*   double txTime : the send time (echoed back in the RTT computation)
+*   double deadline : time at which the probe is declared lost
+*
+* outputs:
+*    returns ERROR (slot busy) or NOERROR
+*
+***********************************************************/
+int probeWindowSent(probeWindow *w, uint32_t seq, double txTime, double deadline)
+{
+  probeEntry *e = getEntry(w, seq);
+
+  if (e->state == PROBE_INFLIGHT)
+    return ERROR;
+
+  e->sequenceNum = seq;
+  e->state = PROBE_INFLIGHT;
+  e->txTime = txTime;
+  e->deadline = deadline;
+  initTimerEntry(&e->timer, seq);
+  timerWheelAdd(w->deadlines, &e->timer, deadline);
+  w->numberInFlight++;
+  w->highestSeqSent = seq;
+  return NOERROR;
+}
+
+/***********************************************************
+* Function: int probeWindowAcked(probeWindow *w, uint32_t seq, double *txTimePtr)
+*
+* Explanation:  matches a reply to the in flight probe
+*
+* inputs:
+*   probeWindow *w
+*   uint32_t seq : seq carried by the reply
+*   double *txTimePtr : set to the send time of the probe
+*
+* outputs:
+*    returns PROBE_ACKED, PROBE_REORDERED (ACKed, but after a higher seq)
+*    or PROBE_UNKNOWN (not in flight: late, duplicate or bogus)
+*
+***********************************************************/
+int probeWindowAcked(probeWindow *w, uint32_t seq, double *txTimePtr)
+{
+  int rc = PROBE_ACKED;
+  probeEntry *e = getEntry(w, seq);
+
+  if ((e->state != PROBE_INFLIGHT) || (e->sequenceNum != seq)) {
+    w->numberUnknown++;
+    return PROBE_UNKNOWN;
+  }
+
+  *txTimePtr = e->txTime;
+  timerWheelCancel(w->deadlines, &e->timer);
+  e->state = PROBE_FREE;
+  w->numberInFlight--;
+  w->numberAcked++;
+
+  if (SEQ_LT(seq, w->highestSeqAcked)) {
+    w->numberReordered++;
+    rc = PROBE_REORDERED;
+  } else
+    w->highestSeqAcked = seq;
+
+  if (seq == w->oldestSeq)
+    advanceOldest(w);
+
+  return rc;
+}
+
+/***********************************************************
+* Function: int probeWindowTxTime(probeWindow *w, uint32_t seq, double txTime)
+*
+* Explanation:  replaces the send time of an in flight probe
+*               (e.g., with the kernel tx timestamp that becomes
+*               available after the send)
+*
+* outputs:
+*    returns ERROR (seq not in flight) or NOERROR
+*
+***********************************************************/
+int probeWindowTxTime(probeWindow *w, uint32_t seq, double txTime)
+{
+  probeEntry *e = getEntry(w, seq);
+
+  if ((e->state != PROBE_INFLIGHT) || (e->sequenceNum != seq))
+    return ERROR;
+  e->txTime = txTime;
+  return NOERROR;
+}
+
+/***********************************************************
+* Function: int probeWindowExpire(probeWindow *w, double curTime)
+*
+* Explanation:  declares lost every in flight probe whose
+*               deadline is <= curTime
+*
+* outputs:
+*    returns the number of probes declared lost by this call
+*
+***********************************************************/
+int probeWindowExpire(probeWindow *w, double curTime)
+{
+  int numberExpired = 0;
+  probeEntry *e = NULL;
+  timerEntry *t = NULL;
+
+  t = timerWheelExpire(w->deadlines, curTime);
+  while (t != NULL) {
+    e = getEntry(w, (uint32_t)t->id);
+    t = t->next;
+    //The timer is the entry's own:  it was in flight
+    if (e->state != PROBE_INFLIGHT)
+      continue;
+#ifdef TRACEME
+    printf("probeWindowExpire: seq %d lost \n", e->sequenceNum);
+#endif
+    e->state = PROBE_FREE;
+    w->numberInFlight--;
+    w->numberLost++;
+    numberExpired++;
+  }
+  if (numberExpired > 0)
+    advanceOldest(w);
+  return numberExpired;
+}
+
+/***********************************************************
+* Function: double probeWindowNextDeadline(probeWindow *w)
+*
+* Explanation:  returns when probeWindowExpire should be called
+*               next (no later than the earliest deadline of the
+*               probes in flight), or -1.0 if nothing is in flight
+*
+***********************************************************/
+double probeWindowNextDeadline(probeWindow *w)
+{
+  if (w->numberInFlight == 0)
+    return DOUBLE_ERROR;
+  return timerWheelNextExpiry(w->deadlines);
+}
+
+/***********************************************************
+* Function: void probeWindowSetTimeout(probeWindow *w, double rttMultiple,
+*                                      double minTimeout, double maxTimeout)
+*
+* Explanation:  sets how the timeout (deadline - send time) is chosen
+*
+* inputs:
+*   double rttMultiple : the timeout is rttMultiple * the smoothed RTT
+*                        (0: always maxTimeout)
+*   double minTimeout, maxTimeout : its bounds (seconds).  maxTimeout
+*                        is also the timeout until the first RTT sample.
+*
+***********************************************************/
+void probeWindowSetTimeout(probeWindow *w, double rttMultiple, double minTimeout, double maxTimeout)
+{
+  w->rttMultiple = rttMultiple;
+  w->minTimeout = minTimeout;
+  w->maxTimeout = (maxTimeout > minTimeout) ? maxTimeout : minTimeout;
+}
+
+/***********************************************************
+* Function: void probeWindowRTTSample(probeWindow *w, double RTTSample)
+*
+* Explanation:  adds an RTT sample to the smoothed RTT and its
+*               mean deviation (gains 1/8 and 1/4, RFC 6298)
+*
+***********************************************************/
+void probeWindowRTTSample(probeWindow *w, double RTTSample)
+{
+  if (RTTSample <= 0.0)
+    return;
+  if (w->srtt == 0.0) {
+    w->srtt = RTTSample;
+    w->rttvar = RTTSample / 2.0;
+    return;
+  }
+  w->rttvar += (fabs(w->srtt - RTTSample) - w->rttvar) / 4.0;
+  w->srtt += (RTTSample - w->srtt) / 8.0;
+}
+
+/***********************************************************
+* Function: double probeWindowTimeout(probeWindow *w)
+*
+* Explanation:  returns the timeout of the next probe (seconds)
+*
+***********************************************************/
+double probeWindowTimeout(probeWindow *w)
+{
+  double timeout = w->maxTimeout;
+
+  if ((w->rttMultiple > 0.0) && (w->srtt > 0.0)) {
+    timeout = w->rttMultiple * w->srtt;
+    if (timeout < w->minTimeout)
+      timeout = w->minTimeout;
+    if (timeout > w->maxTimeout)
+      timeout = w->maxTimeout;
+  }
+  return timeout;
+}
@@ -0,0 +1,97 @@
+/************************************************************************
+* File:  probeWindow.h
+*
+* Purpose:
+*   This include file is for the probeWindow module.  A probe window
+*   tracks the probes that are in flight (sent, not yet ACKed or
+*   declared lost).  It is a ring indexed by sequenceNum % windowSize
+*   so all operations are O(1) (expiration is O(number expired)).
+*
+*   probeWindow *createProbeWindow(uint32_t windowSize);
+*   void freeProbeWindow(probeWindow *w);
+*   bool isProbeWindowFull(probeWindow *w, uint32_t nextSeq);
+*   int probeWindowSent(probeWindow *w, uint32_t seq, double txTime, double deadline);
+*   int probeWindowAcked(probeWindow *w, uint32_t seq, double *txTimePtr);
+*   int probeWindowTxTime(probeWindow *w, uint32_t seq, double txTime);
+*   int probeWindowExpire(probeWindow *w, double curTime);
+*   double probeWindowNextDeadline(probeWindow *w);
+*   void probeWindowSetTimeout(probeWindow *w, double rttMultiple, double minTimeout, double maxTimeout);
+*   void probeWindowRTTSample(probeWindow *w, double RTTSample);
+*   double probeWindowTimeout(probeWindow *w);
+*
+* Notes:
+*   Sequence numbers start at 1.  A probe is declared lost when its
+*   deadline passes.  A reply that arrives for a seq lower than the
+*   highest seq ACKed so far is counted as reordered.
+*   The deadlines are timers on a timer wheel (PROBE_TIMER_TICK
+*   resolution) so they need not follow the seq order:  the timeout
+*   may change from probe to probe (rttMultiple * the smoothed RTT).
+*   The times of the deadlines are timestamps (getTimestampD).
+*
+* Last update: 10/17/2026
+*
+*************************************************************************/
+#ifndef	__probeWindow_h
+#define	__probeWindow_h
+
+#include "common.h"
+#include "timerWheel.h"
+
+#define MAX_PROBE_WINDOW 65536
+
+//The deadline timers' resolution (seconds) and the smallest timeout
+#define PROBE_TIMER_TICK 0.00001
+#define PROBE_MIN_TIMEOUT 0.0001
+
+//Slot states
+#define PROBE_FREE      0
+#define PROBE_INFLIGHT  1
+
+//Return values of probeWindowAcked
+#define PROBE_ACKED      0
+#define PROBE_REORDERED  1
+#define PROBE_UNKNOWN    2   //late (already declared lost), duplicate or bogus seq
+
+typedef struct {
+  uint32_t sequenceNum;
+  uint32_t state;
+  double txTime;      //time the probe was sent (callers clock)
+  double deadline;    //the probe is lost if not ACKed by this time
+  timerEntry timer;   //its deadline (id: the seq)
+} probeEntry;
+
+typedef struct {
+  uint32_t windowSize;
+  uint32_t numberInFlight;
+  uint32_t oldestSeq;        //lowest seq that might still be in flight
+  uint32_t highestSeqSent;
+  uint32_t highestSeqAcked;
+  uint32_t numberAcked;
+  uint32_t numberLost;
+  uint32_t numberReordered;
+  uint32_t numberUnknown;
+  probeEntry *entries;
+  timerWheel *deadlines;
+  //The timeout:  rttMultiple * srtt within [minTimeout, maxTimeout]
+  //(maxTimeout until the first RTT sample or if rttMultiple is 0)
+  double rttMultiple;
+  double minTimeout;
+  double maxTimeout;
+  double srtt;               //smoothed RTT (RFC 6298 gains), 0: no sample yet
+  double rttvar;
+} probeWindow;
+
+probeWindow *createProbeWindow(uint32_t windowSize);
+void freeProbeWindow(probeWindow *w);
+bool isProbeWindowFull(probeWindow *w, uint32_t nextSeq);
+int probeWindowSent(probeWindow *w, uint32_t seq, double txTime, double deadline);
+int probeWindowAcked(probeWindow *w, uint32_t seq, double *txTimePtr);
+int probeWindowTxTime(probeWindow *w, uint32_t seq, double txTime);
+int probeWindowExpire(probeWindow *w, double curTime);
+double probeWindowNextDeadline(probeWindow *w);
+void probeWindowSetTimeout(probeWindow *w, double rttMultiple, double minTimeout, double maxTimeout);
+void probeWindowRTTSample(probeWindow *w, double RTTSample);
+double probeWindowTimeout(probeWindow *w);
+
+#endif
+
@@ -0,0 +1,276 @@
+/*********************************************************
+*
+* Module Name: send schedule
+*
+* File Name:  sendSchedule.c
+*
+* Summary:  Generates the send times (deadlines) of the probes:
+*           constant, exponential (Poisson), uniform jitter or
+*           replayed from a trace of departure times.
+*
+*  The methods include:
+*   sendSchedule *createSendSchedule(int type, double meanGap, double jitter,
+*                                    char *traceFileName, uint64_t seed);
+*   void freeSendSchedule(sendSchedule *s);
+*   void startSendSchedule(sendSchedule *s, double startTime);
+*   void fillSendSchedule(sendSchedule *s);
+*   int parseScheduleType(char *name);
+*
+* Notes:
+*   The random numbers are from xorshift64* (fast, and a seed
+*   repeats a schedule).
+*
+* Last update: 10/17/2026
+*
+*********************************************************/
+#include "common.h"
+#include "sendSchedule.h"
+
+//#define TRACEME 0
+
+/***********************************************************
+* Function: static double scheduleUniform(sendSchedule *s)
+*
+* Explanation:  returns a random number in [0, 1)
+*
+***********************************************************/
+static double scheduleUniform(sendSchedule *s)
+{
+  s->rngState ^= s->rngState >> 12;
+  s->rngState ^= s->rngState << 25;
+  s->rngState ^= s->rngState >> 27;
+  //The top 53 bits
+  return (double)((s->rngState * 2685821657736338717ULL) >> 11) / 9007199254740992.0;
+}
+
+/***********************************************************
+* Function: static int growTraceGaps(sendSchedule *s, uint32_t maxGaps)
+*
+* Explanation:  resizes the trace gaps to maxGaps entries.  On a
+*               failure the old gaps are freed (traceGaps NULL)
+*
+* outputs:
+*    returns ERROR or NOERROR
+*
+***********************************************************/
+static int growTraceGaps(sendSchedule *s, uint32_t maxGaps)
+{
+  double *newGaps = realloc(s->traceGaps, maxGaps * sizeof(double));
+
+  if (newGaps == NULL) {
+    free(s->traceGaps);
+    s->traceGaps = NULL;
+    s->numberTraceGaps = 0;
+    return ERROR;
+  }
+  s->traceGaps = newGaps;
+  return NOERROR;
+}
+
+/***********************************************************
+* Function: static int readTraceGaps(sendSchedule *s, char *traceFileName)
+*
+* Explanation:  reads the departure times of a trace file and
+*               keeps the gaps between them
+*
+* outputs:
+*    returns ERROR or NOERROR
+*
+***********************************************************/
+static int readTraceGaps(sendSchedule *s, char *traceFileName)
+{
+  FILE *traceFID = NULL;
+  char line[SCHEDULE_MAX_TRACE_LINE];
+  uint32_t maxGaps = 1024;
+  uint32_t numberTimes = 0;
+  double lastTime = 0.0;
+  double t = 0.0;
+  double sum = 0.0;
+
+  traceFID = fopen(traceFileName, "r");
+  if (traceFID == NULL) {
+    printf("readTraceGaps: failed to open %s, errno:%d \n", traceFileName, errno);
+    return ERROR;
+  }
+  s->traceGaps = malloc(maxGaps * sizeof(double));
+  while ((s->traceGaps != NULL) && (fgets(line, sizeof(line), traceFID) != NULL)) {
+    if ((line[0] == '#') || (sscanf(line, "%lf", &t) != 1))
+      continue;
+    if ((numberTimes > 0) && (t < lastTime)) {
+      printf("readTraceGaps: %s: departure times must ascend (%f after %f) \n", traceFileName, t, lastTime);
+      fclose(traceFID);
+      return ERROR;
+    }
+    if (numberTimes > 0) {
+      if (s->numberTraceGaps == maxGaps) {
+        maxGaps *= 2;
+        if (growTraceGaps(s, maxGaps) == ERROR)
+          break;
+      }
+      s->traceGaps[s->numberTraceGaps++] = t - lastTime;
+      sum += t - lastTime;
+    }
+    lastTime = t;
+    numberTimes++;
+  }
+  fclose(traceFID);
+  if (s->traceGaps == NULL) {
+    printf("readTraceGaps: malloc error \n");
+    return ERROR;
+  }
+  if (s->numberTraceGaps == 0) {
+    printf("readTraceGaps: %s has fewer than 2 departure times \n", traceFileName);
+    return ERROR;
+  }
+  //The gap from the last departure to the first of the next replay
+  s->meanGap = sum / s->numberTraceGaps;
+  if ((s->numberTraceGaps == maxGaps) && (growTraceGaps(s, maxGaps + 1) == ERROR)) {
+    printf("readTraceGaps: malloc error \n");
+    return ERROR;
+  }
+  s->traceGaps[s->numberTraceGaps++] = s->meanGap;
+  return NOERROR;
+}
+
+/***********************************************************
+* Function: sendSchedule *createSendSchedule(int type, double meanGap, double jitter,
+*                                           char *traceFileName, uint64_t seed)
+*
+* Explanation:  creates a schedule.  The caller owns the memory.
+*
+* inputs:
+*   int type : SCHEDULE_CONSTANT, _EXPONENTIAL, _UNIFORM or _TRACE
+*   double meanGap : seconds between sends (not used by a trace)
+*   double jitter : uniform: 0.0 .. 1.0
+*   char *traceFileName : trace: the departure times
+*   uint64_t seed : random numbers seed (0: one from the clock)
+*
+* outputs:
+*    returns the schedule or NULL on error
+*
+***********************************************************/
+sendSchedule *createSendSchedule(int type, double meanGap, double jitter,
+                                 char *traceFileName, uint64_t seed)
+{
+  sendSchedule *s = NULL;
+  struct timespec ts;
+
+  if ((type < SCHEDULE_CONSTANT) || (type > SCHEDULE_TRACE) ||
+      ((type == SCHEDULE_TRACE) && (traceFileName == NULL)) ||
+      ((type == SCHEDULE_UNIFORM) && ((jitter < 0.0) || (jitter > 1.0)))) {
+    printf("createSendSchedule: invalid schedule type:%d jitter:%f \n", type, jitter);
+    return NULL;
+  }
+  s = malloc(sizeof(sendSchedule));
+  if (s == NULL)
+    return NULL;
+  memset(s, 0, sizeof(sendSchedule));
+  s->type = type;
+  s->meanGap = meanGap;
+  s->jitter = jitter;
+  if (seed == 0) {
+    clock_gettime(CLOCK_REALTIME, &ts);
+    seed = ((uint64_t)ts.tv_sec << 32) ^ (uint64_t)ts.tv_nsec ^ (uint64_t)getpid();
+  }
+  //xorshift needs a non zero state
+  s->rngState = (seed != 0) ? seed : 88172645463325252ULL;
+
+  if ((type == SCHEDULE_TRACE) && (readTraceGaps(s, traceFileName) == ERROR)) {
+    freeSendSchedule(s);
+    return NULL;
+  }
+  return s;
+}
+
+/***********************************************************
+* Function: void freeSendSchedule(sendSchedule *s)
+*
+* Explanation:  frees the schedule
+*
+***********************************************************/
+void freeSendSchedule(sendSchedule *s)
+{
+  if (s == NULL)
+    return;
+  free(s->traceGaps);
+  free(s);
+}
+
+/***********************************************************
+* Function: void startSendSchedule(sendSchedule *s, double startTime)
+*
+* Explanation:  (re)starts the schedule.  startTime is the time
+*               of the first send; the deadlines are the sends
+*               after it.  Fills the ring.
+*
+***********************************************************/
+void startSendSchedule(sendSchedule *s, double startTime)
+{
+  s->startTime = startTime;
+  s->lastDeadline = startTime;
+  s->numberComputed = 0;
+  s->nextTraceGap = 0;
+  s->head = 0;
+  s->tail = 0;
+  fillSendSchedule(s);
+}
+
+/***********************************************************
+* Function: void fillSendSchedule(sendSchedule *s)
+*
+* Explanation:  computes deadlines until the ring is full.
+*               Does nothing while the ring is more than half
+*               full so the work is done in batches.
+*
+***********************************************************/
+void fillSendSchedule(sendSchedule *s)
+{
+  if ((s->tail - s->head) > (SCHEDULE_BUFFER_SIZE / 2))
+    return;
+
+  while ((s->tail - s->head) < SCHEDULE_BUFFER_SIZE) {
+    s->numberComputed++;
+    switch (s->type) {
+      case SCHEDULE_CONSTANT:
+        //No sum of gaps:  no rounding drift
+        s->lastDeadline = s->startTime + (double)s->numberComputed * s->meanGap;
+        break;
+      case SCHEDULE_EXPONENTIAL:
+        s->lastDeadline += -s->meanGap * log(1.0 - scheduleUniform(s));
+        break;
+      case SCHEDULE_UNIFORM:
+        s->lastDeadline += s->meanGap * (1.0 + s->jitter * (2.0 * scheduleUniform(s) - 1.0));
+        break;
+      case SCHEDULE_TRACE:
+        s->lastDeadline += s->traceGaps[s->nextTraceGap];
+        s->nextTraceGap = (s->nextTraceGap + 1) % s->numberTraceGaps;
+        break;
+    }
+    s->deadlines[(s->tail++) & (SCHEDULE_BUFFER_SIZE - 1)] = s->lastDeadline;
+  }
+}
+
+/***********************************************************
+* Function: int parseScheduleType(char *name)
+*
+* Explanation:  converts a schedule name to its type
+*
+* inputs:
+*    char *name : const, exp, uniform or trace
+*
+* outputs:
+*    returns the SCHEDULE_* type or ERROR
+*
+***********************************************************/
+int parseScheduleType(char *name)
+{
+  if (strcmp(name, "const") == 0)
+    return SCHEDULE_CONSTANT;
+  if (strcmp(name, "exp") == 0)
+    return SCHEDULE_EXPONENTIAL;
+  if (strcmp(name, "uniform") == 0)
+    return SCHEDULE_UNIFORM;
+  if (strcmp(name, "trace") == 0)
+    return SCHEDULE_TRACE;
+  return ERROR;
+}
@@ -0,0 +1,90 @@
+/************************************************************************
+* File:  sendSchedule.h
+*
+* Purpose:
+*   This include file is for the sendSchedule module.  A send schedule
+*   generates the absolute send times (deadlines) of the probes:
+*     constant:     start + n * meanGap
+*     exponential:  gaps drawn from an exponential distribution (Poisson
+*                   departures, so the probes see time averages - PASTA)
+*     uniform:      gaps uniform in meanGap * [1 - jitter, 1 + jitter]
+*     trace:        the departure times read from a file (replayed in a loop)
+*   The deadlines are computed ahead into a ring so taking the next one
+*   is a load:  no random numbers or math on the send path.
+*
+*   sendSchedule *createSendSchedule(int type, double meanGap, double jitter,
+*                                    char *traceFileName, uint64_t seed);
+*   void freeSendSchedule(sendSchedule *s);
+*   void startSendSchedule(sendSchedule *s, double startTime);
+*   void fillSendSchedule(sendSchedule *s);
+*   double nextSendDeadline(sendSchedule *s);
+*   int parseScheduleType(char *name);
+*
+* Notes:
+*   The caller takes deadlines with nextSendDeadline and refills the ring
+*   with fillSendSchedule when it has time (e.g., before it waits).
+*   startSendSchedule's time is the first send; the first deadline
+*   taken is the second send.
+*   A trace file has one departure time (seconds, ascending) per line,
+*   '#' lines are comments.  When the trace is replayed again the gap
+*   between the last and the next first departure is the trace's mean gap.
+*   A schedule is not thread safe.
+*
+* Last update: 10/17/2026
+*
+*************************************************************************/
+#ifndef	__sendSchedule_h
+#define	__sendSchedule_h
+
+#include "common.h"
+
+#define SCHEDULE_CONSTANT 0
+#define SCHEDULE_EXPONENTIAL 1
+#define SCHEDULE_UNIFORM 2
+#define SCHEDULE_TRACE 3
+
+//Deadlines computed ahead (a power of 2)
+#define SCHEDULE_BUFFER_SIZE 1024
+#define SCHEDULE_MAX_TRACE_LINE 128
+
+typedef struct {
+  int type;
+  double meanGap;          //seconds
+  double jitter;           //uniform: fraction of meanGap
+  uint64_t rngState;       //xorshift64*
+
+  double *traceGaps;       //trace: the gaps between the departures
+  uint32_t numberTraceGaps;
+  uint32_t nextTraceGap;
+
+  double startTime;
+  uint64_t numberComputed; //deadlines computed since the start
+  double lastDeadline;
+
+  double deadlines[SCHEDULE_BUFFER_SIZE];
+  uint64_t head;           //next to take
+  uint64_t tail;           //next to compute
+} sendSchedule;
+
+sendSchedule *createSendSchedule(int type, double meanGap, double jitter,
+                                 char *traceFileName, uint64_t seed);
+void freeSendSchedule(sendSchedule *s);
+void startSendSchedule(sendSchedule *s, double startTime);
+void fillSendSchedule(sendSchedule *s);
+int parseScheduleType(char *name);
+
+/***********************************************************
+* Function: static inline double nextSendDeadline(sendSchedule *s)
+*
+* Explanation:  returns the next send time (timestamp, seconds)
+*               and removes it from the ring
+*
+***********************************************************/
+static inline double nextSendDeadline(sendSchedule *s)
+{
+  if (s->head == s->tail)
+    fillSendSchedule(s);
+  return s->deadlines[(s->head++) & (SCHEDULE_BUFFER_SIZE - 1)];
+}
+
+#endif
@@ -1,52 +1,54 @@
 /*********************************************************
-* Module Name: session Manager 
+* Module Name: session Manager
 *
 * File Name:  session.c
 *
 * Summary:
-*  This file contains code to manage a list of UDP IP sessions. 
+*  This file contains code to manage a table of UDP IP sessions.
 *
 *  The methods include:
-*   int createSession(struct **sPtr);
-*  session *findActive(struct in_addr clientIP, uint16_t clientPort);
-*          NEW sessions are placed at the head of the list
-*  session *getActive(struct in_addr clientIP, uint16_t clientPort);
-*  void removeActive(struct in_addr clientIP, uint16_t clientPort);
-*  void updateSessionDuration(session *s);
-*  void printSessions();
-*  void freeAllSessions();
-*
-*  The session mgr maintains two lists of sessions
-*  Maintains two lists of sessions:
-*    ACTIVE LIST:   session *firstActive : the active session list
-*          NEW sessions are placed at the head of the list
-*    ARCHIVED LIST session *firstSession : the archived session list 
-*
-*  Caller uses getActive to either get an existing session handle of 
-*     for the client or to get a new session handle. 
-*     Only the active list is used...
-*
-*
-*  session *getActive(struct in_addr clientIP, uint16_t clientPort) {
-*
-*  Notes: 
+*  sessionTable *createSessionTable(uint32_t maxSessions);
+*  void freeSessionTable(sessionTable *t);
+*  session *findActive(sessionTable *t, struct in_addr clientIP, uint16_t clientPort);
+*  session *getActive(sessionTable *t, struct in_addr clientIP, uint16_t clientPort);
+*  int removeActive(sessionTable *t, struct in_addr clientIP, uint16_t clientPort);
+*  int archiveIdleSessions(sessionTable *t, double curTime, double idleTime);
+*  int updateSessionRx(session *s, uint32_t seq, uint32_t bytes, double arrivalTime, double OWDelay);
+*  double updateSessionDuration(session *s);
+*  int printAllSessions(sessionTable *t, double curTime, FILE *fileFID);
+*  uint32_t freeAllSessions(sessionTable *t);
+*
+*  A session table maintains two lists of sessions:
+*    ACTIVE LIST:   t->firstActive : the active session list
+*          ordered by use - the most recently used session is at the head
+*    ARCHIVED LIST  t->firstSession : the archived session list
+*          ordered by archive time - the oldest is at the head
+*
+*  Active sessions are also in an open addressing hash (linear
+*  probing) keyed by (clientIP, clientPort) so findActive/getActive
+*  and removeActive are O(1).  Sessions are not malloc'ed one at a
+*  time: all of them come from a slab that is allocated by
+*  createSessionTable.  When the slab is used up, the oldest archived
+*  session is reused.
+*
+*  Caller uses getActive to either get an existing session handle of
+*     for the client or to get a new session handle.
+*
+*  Notes:
 *     -socket address/port fields are stored in network byte order.
-*       When we display these fields in printfs, we convert to 
+*       When we display these fields in printfs, we convert to
 *        host byte order.
+*     -A table is not thread safe.
 *
-*  TODO:  fix the active / archive lists. A session should be moved 
-*         to the archive list after a SESSION_TIMEOUT such as 15 minutes).
-*         Further, we can have archive elements be smaller than active list
-*         elements. 
-*
-*  Last update: 4/30/2019
+*  Last update: 10/17/2026
 *
 ******************************************************************/
 #include "common.h"
 #include "session.h"
+#include "utils.h"
 
 
-#define BRIEF_OUTPUT 1 
+#define BRIEF_OUTPUT 1
 
 //Uncomment to turn on printf debug statements
 //#define  TRACEME 0
@@ -55,406 +57,612 @@
 #define  TRACE_ERRORS 0
 
 
-//There are two lists: ACTIVE AND ARCHIVED
-//In both, Elements are enqueued at the head....
-//   so the 'oldest' session is the last in the list
-
-//This is the head and tail of the archived list. 
-session *firstSession = NULL;
-session *lastSession = NULL;
+/***********************************************************
+* Function: static inline uint32_t homeSlot(sessionTable *t, uint32_t IP, uint16_t port)
+*
+* Explanation:  returns the slot a key hashes to.  ipflow_hash
+*               folds the key to IPFLOW_HASHBITS, so the key is
+*               mixed back in and spread over all slots with
+*               a multiplicative (Fibonacci) hash.
+*
+***********************************************************/
+static inline uint32_t homeSlot(sessionTable *t, uint32_t IP, uint16_t port)
+{
+  struct in_addr clientIP;
+  struct in_addr zeroIP;
+  uint32_t hash = 0;
+
+  clientIP.s_addr = IP;
+  zeroIP.s_addr = 0;
+  hash = ipflow_hash(clientIP, zeroIP, port, 0, IPPROTO_UDP);
+  hash = (hash ^ IP ^ ((uint32_t)port << 16)) * 2654435761u;
+  return hash >> t->slotShift;
+}
 
-//This is the head of the ACTIVE list
-//Any element on this list has not yet been placed on the ARCHIVED list
-session *firstActive = NULL;
+/***********************************************************
+* Function: static uint32_t findSlot(sessionTable *t, uint32_t IP, uint16_t port)
+*
+* Explanation:  linear probes for the key.
+*
+* outputs:
+*    returns the slot holding the key or the first empty slot.
+*    There is always an empty slot (at most half the slots are used).
+*
+***********************************************************/
+static uint32_t findSlot(sessionTable *t, uint32_t IP, uint16_t port)
+{
+  uint32_t mask = t->numberSlots - 1;
+  uint32_t i = homeSlot(t, IP, port);
+  sessionSlot *slot = NULL;
 
-//Sums all elements on either lists
-uint32_t sessionCount = 0;
+  while (1) {
+    slot = &t->slots[i];
+    if (slot->sessionIndex == 0)
+      break;
+    if ((slot->clientIP == IP) && (slot->clientPort == port))
+      break;
+    i = (i + 1) & mask;
+  }
+  return i;
+}
 
-//Number in active list
-uint32_t activeSessionCount = 0;
-//Number in archived list
-uint32_t archivedSessionCount = 0;
+/***********************************************************
+* Function: static void deleteSlot(sessionTable *t, uint32_t i)
+*
+* Explanation:  empties slot i.  Entries that follow in the probe
+*               run are shifted back (no tombstones), so lookups
+*               never slow down as sessions come and go.
+*
+***********************************************************/
+static void deleteSlot(sessionTable *t, uint32_t i)
+{
+  uint32_t mask = t->numberSlots - 1;
+  uint32_t j = i;
+  uint32_t home = 0;
+  sessionSlot *slot = NULL;
+
+  while (1) {
+    j = (j + 1) & mask;
+    slot = &t->slots[j];
+    if (slot->sessionIndex == 0)
+      break;
+    home = homeSlot(t, slot->clientIP, slot->clientPort);
+    //The entry at j can move to i only if its home is not in (i, j]
+    if (((j - home) & mask) >= ((j - i) & mask)) {
+      t->slots[i] = *slot;
+      i = j;
+    }
+  }
+  memset(&t->slots[i], 0, sizeof(sessionSlot));
+}
 
-static double wallTime = 0.0;
-static struct timespec wallTimeTS;
-static char wallTimeString[MAX_LINE_SIZE];
+static inline uint32_t slabIndex(sessionTable *t, session *s)
+{
+  return (uint32_t)(s - t->slab) + 1;
+}
 
-static uint32_t sessionNumber=0;
+/***********************************************************
+* Function: static void unlinkSession(session **firstPtr, session **lastPtr, session *s)
+*
+* Explanation:  removes s from the list (active or archived)
+*
+***********************************************************/
+static void unlinkSession(session **firstPtr, session **lastPtr, session *s)
+{
+  if (s->prev != NULL)
+    s->prev->next = s->next;
+  else
+    *firstPtr = s->next;
+  if (s->next != NULL)
+    s->next->prev = s->prev;
+  else
+    *lastPtr = s->prev;
+  s->next = NULL;
+  s->prev = NULL;
+}
 
 /***********************************************************
-* Function: void initSessions() 
+* Function: sessionTable *createSessionTable(uint32_t maxSessions)
 *
-* Explanation:  This inits the sessionManager. If there 
-*               are sessions in the list, they are freed.
+* Explanation:  creates a session table with a slab of
+*               maxSessions sessions.  The caller owns the memory.
 *
-* inputs: none
+* inputs:
+*   uint32_t maxSessions : 1 .. MAX_SESSIONS
 *
 * outputs:
+*    returns the table or NULL on error
 *
-* notes: 
+***********************************************************/
+sessionTable *createSessionTable(uint32_t maxSessions)
+{
+  sessionTable *t = NULL;
+  uint32_t bits = 1;
+
+  if ((maxSessions == 0) || (maxSessions > MAX_SESSIONS)) {
+    printf("createSessionTable: bad maxSessions %d \n", maxSessions);
+    return NULL;
+  }
+
+  t = malloc(sizeof(sessionTable));
+  if (t == NULL)
+    return NULL;
+  memset(t, 0, sizeof(sessionTable));
+
+  //At least twice as many slots as sessions keeps the probe runs short
+  while ((1u << bits) < 2 * maxSessions)
+    bits++;
+  t->maxSessions = maxSessions;
+  t->numberSlots = 1u << bits;
+  t->slotShift = 32 - bits;
+
+  t->slots = calloc(t->numberSlots, sizeof(sessionSlot));
+  t->slab = calloc(maxSessions, sizeof(session));
+  if ((t->slots == NULL) || (t->slab == NULL)) {
+    printf("createSessionTable: failed to allocate %d sessions \n", maxSessions);
+    freeSessionTable(t);
+    return NULL;
+  }
+  initSessions(t);
+  return t;
+}
+
+/***********************************************************
+* Function: void freeSessionTable(sessionTable *t)
+*
+* Explanation:  frees the table and all of its sessions
 *
 ***********************************************************/
-void initSessions() {
-
-  //If there are sessions, we delete them
-  if  (sessionCount > 0 )  {
-//#ifdef TRACE_ERRORS
-    printf("initSessions:  WARNING sessionCount NOT 0 :  %d  \n", sessionCount);
-//#endif 
-    while (firstSession != NULL) {
-      sessionCount--;
-      session *tofree = firstSession;
-      firstSession = tofree->next;
-      free(tofree);
-    }
+void freeSessionTable(sessionTable *t)
+{
+  if (t != NULL) {
+    free(t->slots);
+    free(t->slab);
+    free(t);
   }
-  //init state 
+}
+
+/***********************************************************
+* Function: void initSessions(sessionTable *t)
+*
+* Explanation:  This inits the session table. If there
+*               are sessions in the table, they are discarded.
+*
+* inputs:
+*   sessionTable *t
+*
+* outputs:
+*
+* notes:
+*
+***********************************************************/
+void initSessions(sessionTable *t)
+{
+#ifdef TRACE_ERRORS
+  if  (t->sessionCount > 0 )
+    printf("initSessions:  WARNING sessionCount NOT 0 :  %d  \n", t->sessionCount);
+#endif
+
+  memset(t->slots, 0, t->numberSlots * sizeof(sessionSlot));
+
+  //The slab is carved off as sessions are needed (the pages of a
+  //large slab are not touched until then)
+  t->freeList = NULL;
+  t->numberCarved = 0;
 
   //ARCHIVED LIST
-  firstSession = NULL;
-  lastSession = NULL;
-  archivedSessionCount = 0;
+  t->firstSession = NULL;
+  t->lastSession = NULL;
+  t->archivedSessionCount = 0;
 
   //ACTIVE LIST
-  firstActive = NULL;
-  activeSessionCount = 0;
+  t->firstActive = NULL;
+  t->lastActive = NULL;
+  t->activeSessionCount = 0;
 
   //Total number in both lists
-  sessionCount = 0;
+  t->sessionCount = 0;
 }
 
 /***********************************************************
-* Function: int getNumberActiveSessions() 
+* Function: int getNumberActiveSessions(sessionTable *t)
 *
-* Explanation:  This returns the number of Active sessions in the list.
+* Explanation:  This returns the number of Active sessions in the table.
 *
-* inputs: none
+* inputs:
+*   sessionTable *t
 *
 * outputs:
 *         returns the number of sessions.
 *
-* notes: 
-*
 ***********************************************************/
-int getNumberActiveSessions() {
-
-  return activeSessionCount;
+int getNumberActiveSessions(sessionTable *t)
+{
+  return t->activeSessionCount;
 }
 
-
 /***********************************************************
-* Function: int getNumberSessions() 
+* Function: int getNumberSessions(sessionTable *t)
 *
-* Explanation:  This returns the total  number of sessions in both lists
+* Explanation:  This returns the number of sessions (active and
+*               archived) in the table.
 *
-* inputs: none
+* inputs:
+*   sessionTable *t
 *
 * outputs:
 *         returns the number of sessions.
 *
-* notes: 
-*
 ***********************************************************/
-int getNumberSessions() {
-
-  return sessionCount;
+int getNumberSessions(sessionTable *t)
+{
+  return t->sessionCount;
 }
 
 /***********************************************************
-* Function: session *findActive(struct in_addr clientIP, uint16_t clientPort) 
+* Function: session *findActive(sessionTable *t, struct in_addr clientIP, uint16_t clientPort)
 *
-* Explanation:  This searches the active list of sessions for the client IP/port.
-*               It returns the session handle if found, else a NULL;
+* Explanation:  This looks up the client IP/port in the hash
+*               of active sessions.
 *
-* inputs: passed the IP and port of the client 
+* inputs: passed the table and the IP and port of the client
 *
 * outputs:
 *    Returns an address of the session struct entry.
-*    Or a NULL on error.
-*
-* notes: 
-*   session *firstActive : the active session list
-*   session *firstSession : the archived session list 
+*    Or a NULL if not found.
 *
 ***********************************************************/
-session *findActive(struct in_addr clientIP, uint16_t clientPort) {
-  session *s = firstActive;
-  while (s != NULL) {
-    if (s->clientIP.s_addr == clientIP.s_addr && s->clientPort == clientPort){
-      break;
-    }
-    s = s->next;
-  }
-
-#ifdef TRACEME
-  if (s == NULL)
-    printf("findActive: DID NOT FIND the session   \n");
-  else {
-    printf("findActive: FOUND session :    \n");
-  }
-#endif
+session *findActive(sessionTable *t, struct in_addr clientIP, uint16_t clientPort)
+{
+  sessionSlot *slot = &t->slots[findSlot(t, clientIP.s_addr, clientPort)];
 
-  return s;
+  if (slot->sessionIndex == 0)
+    return NULL;
+  return &t->slab[slot->sessionIndex - 1];
 }
 
 /***********************************************************
-* Function: session *findSession(struct in_addr clientIP, unsigned short clientPort) 
+* Function: session *findSession(sessionTable *t, struct in_addr clientIP, unsigned short clientPort)
 *
-* Explanation:  This searches the archived list of sessions for the client IP/port.
-*               It returns the session handle if found, else a NULL;
+* Explanation:  This searches the archived list for the most
+*               recently archived session of the client IP/port.
 *
-* inputs: passed the IP and port of the client 
+* inputs: passed the table and the IP and port of the client
 *
 * outputs:
 *    Returns an address of the session struct entry.
-*    Or a NULL on error.
+*    Or a NULL if not found.
 *
-* notes: 
-*   session *firstActive : the active session list
-*   session *firstSession : the archived session list 
+* notes:
+*   This walks the archive - it is O(n) and is not
+*   meant for the packet path.
 *
 ***********************************************************/
-session *findSession(struct in_addr clientIP, unsigned short clientPort) 
+session *findSession(sessionTable *t, struct in_addr clientIP, unsigned short clientPort)
 {
-  session *sPtr = firstSession;
+  session *s = t->lastSession;
 
-  while (sPtr != NULL) {
-    if (sPtr->clientIP.s_addr == clientIP.s_addr && sPtr->clientPort == clientPort) {
+  while (s != NULL) {
+    if ((s->clientIP.s_addr == clientIP.s_addr) && (s->clientPort == clientPort))
       break;
-    }
-    sPtr = sPtr->next;
+    s = s->prev;
   }
-
-#ifdef TRACEME
-  if (sPtr == NULL)
-    printf("findSession: DID NOT FIND the session   \n");
-  else {
-    printf("findSession: FOUND session :    \n");
-  }
-#endif
-
-  return sPtr;
-
+  return s;
 }
 
-
 /***********************************************************
-* Function: int createSession(session **sPtr);
+* Function: static int createSession(sessionTable *t, session **sPtr)
 *
-* Explanation:  This creates a new session structure, 
-*               fills the struct ptr in the caller's ptr.
-*               The caller owns the memory.
+* Explanation:  This takes a session from the slab.  If the slab
+*               is used up, the oldest archived session is reused.
 *
-* inputs: 
-*  struct **sPtr:  ptr to callers ptr to a session struct
+* inputs:
+*   sessionTable *t
+*   session **sPtr :  ptr to the callers session ptr
 *
 * outputs:
-*    The caller's struc is updated.
+*    The caller's ptr is updated.
 *    Returns ERROR or NOERROR
-*    Fails if:
-*           bad sPtr, sessionCount is MAX'ed out
-*           or malloc error.
-* notes: 
+*    Fails if every session in the slab is active.
 *
 ***********************************************************/
-int createSession(session  **sPtr)
+static int createSession(sessionTable *t, session **sPtr)
 {
-  int rc = NOERROR;
   session *s = NULL;
 
-  if (sPtr == NULL)
-    rc = ERROR;
-  else {  
-
-    if (sessionCount < MAX_SESSIONS) {
-      // ...add new session
-      s = malloc(1 * sizeof(session));
-      memset(s, 0, sizeof(session)); 
-
-      s->errorCount=0;  //tracks number of any type of error that might occur
-      s->sessionID = 0;   //uniquely id's this session 
-      s->currentArrayIndex=0;  //helps track stats logged as the array wraps
-      s->isActive = true;
-      s->clientPort = -1;
-//    Should be a wall clock time 
-      s->timeStartedD = getCurTime(&(s->timeStarted));  
-      s->firstArrivalTimeD= -1;
-      s->lastArrivalTimeD = -1;
-      s->interArrivalTimeSum=0;
-      s->interArrivalTimeCount=0;
-      s->lastSequenceNum = 0;
-      s->bytesReceived = 0;
-      s->bytesRxCountWrap =0;
-      s->messagesReceived = 0;
-      s->messagesLost = 0;
-      s->bytesSent = 0;
-      s->bytesTxCountWrap =0;
-      s->messagesSent = 0;
-      s->sequenceNumberWrap = 0;
-      s->largestSeqRecv = 0;
-      s->largestSeqSent = 0;
-      s->outOfOrderArrival = 0;
-      s->countPOWDelaySamples = 0;
-      s->countNOWDelaySamples = 0;
-      s->curOWDelay = 0;
-      s->OWDelaySum = 0;
-      s->delayChange = 0;
-      s->delayChangeSum = 0;
-      s->ArrivalsBeforeAck = 0;
-      s->duration = 0;
-      s->next = NULL;
-      s->prev = NULL;
-
-      //set caller's ptr var with a ptr to a session
-      *sPtr = s;
-    } else {
-      rc = ERROR;
-    }
+  if (t->freeList != NULL) {
+    s = t->freeList;
+    t->freeList = s->next;
+    t->sessionCount++;
+  } else if (t->numberCarved < t->maxSessions) {
+    s = &t->slab[t->numberCarved++];
+    t->sessionCount++;
+  } else if (t->firstSession != NULL) {
+    s = t->firstSession;
+    unlinkSession(&t->firstSession, &t->lastSession, s);
+    t->archivedSessionCount--;
+  } else {
+    return ERROR;
   }
-  return rc;
+
+  memset(s, 0, sizeof(session));
+  s->sessionID = ++t->sessionNumber;   //uniquely id's this session
+  s->isActive = true;
+//    Should be a wall clock time
+  s->timeStartedD = getCurTime(&(s->timeStarted));
+  s->firstArrivalTimeD= -1;
+  s->lastArrivalTimeD = -1;
+  initFlowMetrics(&s->flow);
+
+  //set caller's ptr var with a ptr to a session
+  *sPtr = s;
+  return NOERROR;
 }
 
 /***********************************************************
-* Function: session *getActive(struct in_addr clientIP, uint16_t clientPort) 
+* Function: session *getActive(sessionTable *t, struct in_addr clientIP, uint16_t clientPort)
 *
-* Explanation:  This searches the active list of known sessions for the client IP/port.
-*               It returns the session handle if found, 
+* Explanation:  This looks up the active session of the client IP/port.
+*               It returns the session handle if found,
 *               If the client session does not exist,
 *               a session is created and the session handle is returned.
-*               The new session is placed at the head of the list
-*                (pointed to by firstActive)
+*               Either way the session moves to the head of the active
+*               list (pointed to by firstActive)
 *
-* inputs: passed the IP and port of the client 
+* inputs: passed the table and the IP and port of the client
 *
 * outputs:
 *    Returns an address of the session struct entry.
 *    Or a NULL on error.
 *
-* notes: 
-*
 ***********************************************************/
-session *getActive(struct in_addr clientIP, uint16_t clientPort) 
+session *getActive(sessionTable *t, struct in_addr clientIP, uint16_t clientPort)
 {
-  int rc= NOERROR;
+  uint32_t i = findSlot(t, clientIP.s_addr, clientPort);
+  sessionSlot *slot = &t->slots[i];
   session *s = NULL;
 
-  // Try to find the client from the active list
-  s  = findActive(clientIP, clientPort);
-  if (s == NULL) {
-    //If not on the active list, create a new session on the active list
-    rc = createSession(&s);
-    if (rc == NOERROR) {
-      s->clientIP = clientIP;
-      s->clientPort = clientPort;
-      s->next = firstActive;
-      s->prev = NULL;
-      firstActive = s;
-      sessionCount++;
-      activeSessionCount++;
-    } else {
-      rc = ERROR;
-      s=NULL;
-      printf("session: getActive(): ERROR: No existing and failed \n");
+  if (slot->sessionIndex != 0) {
+    s = &t->slab[slot->sessionIndex - 1];
+    if (s == t->firstActive)
+      return s;
+    unlinkSession(&t->firstActive, &t->lastActive, s);
+  } else {
+    if (createSession(t, &s) == ERROR) {
+#ifdef TRACE_ERRORS
+      printf("session: getActive():  WARNING: Failed create a new session, current count:%d  \n",
+             t->sessionCount);
+#endif
+      return NULL;
     }
+    s->clientIP = clientIP;
+    s->clientPort = clientPort;
+    slot->clientIP = clientIP.s_addr;
+    slot->clientPort = clientPort;
+    slot->sessionIndex = slabIndex(t, s);
+    t->activeSessionCount++;
   }
 
-#ifdef TRACE_ERRORS
-  if (s == NULL)
-    printf("session: getActive():  WARNING: Failed create a new session, current count:%d  \n",
-             sessionCount);
-#endif
+  s->prev = NULL;
+  s->next = t->firstActive;
+  if (t->firstActive != NULL)
+    t->firstActive->prev = s;
+  else
+    t->lastActive = s;
+  t->firstActive = s;
   return s;
 }
 
 /***********************************************************
-* Function: void removeActive(struct in_addr clientIP, uint16_t clientPort) 
+* Function: static void archiveSession(sessionTable *t, session *s, uint32_t slotIndex)
+*
+* Explanation:  moves an active session to the tail of the archive
+*
+***********************************************************/
+static void archiveSession(sessionTable *t, session *s, uint32_t slotIndex)
+{
+  deleteSlot(t, slotIndex);
+  unlinkSession(&t->firstActive, &t->lastActive, s);
+  t->activeSessionCount--;
+  s->isActive = false;
+  getCurTimeTS(&s->sessionEnd);
+  updateSessionDuration(s);
+
+  // Add to end of the archive list:
+  s->prev = t->lastSession;
+  s->next = NULL;
+  if (t->lastSession != NULL)
+    t->lastSession->next = s;
+  else
+    t->firstSession = s;
+  t->lastSession = s;
+  t->archivedSessionCount++;
+}
+
+/***********************************************************
+* Function: int removeActive(sessionTable *t, struct in_addr clientIP, uint16_t clientPort)
 *
 * Explanation:  This removes the session from the active list
 *               placing it on the archived list.
-* TODO:  Have it compute the stats and change the archive list
-*        to more of a stat summary result
-*        Assume this list might get huge.
-* TODO:  What if there are duplicates?  It is possible. Might
-*        need to add a random number as a unique session ID.
-*        Or just a uint32_t session number.
 *
-* inputs: passed the IP and port of the client 
+* inputs: passed the table and the IP and port of the client
 *
 * outputs: returns ERROR or NOERROR. An error occurs
-*         if the active session was not found. 
-*
-* notes: 
+*         if the active session was not found.
 *
 ***********************************************************/
-int removeActive(struct in_addr clientIP, uint16_t clientPort) 
+int removeActive(sessionTable *t, struct in_addr clientIP, uint16_t clientPort)
 {
-  int rc = NOERROR;
-  session *s = findActive(clientIP, clientPort);
-  if (s != NULL) {
-#ifdef TRACEME 
-    printf("removeActiveSession(sessioncount:%d, numberActiveSessions:%d, archived:%d): BEFORE  found session   \n",
-                sessionCount, activeSessionCount, archivedSessionCount);
-#endif
-    activeSessionCount--;
-    s->isActive = false;
-    if (s->next != NULL)
-      s->next->prev = s->prev;
-    if (s->prev != NULL)
-      s->prev->next = s->next;
-    if (s == firstActive)
-      firstActive = (s->prev != NULL) ? s->prev : s->next;
-
-    // Add to end of the archive list:
-    archivedSessionCount++;
-    s->next = NULL;
-    if (firstSession == NULL) {
-      firstSession = s;
-      lastSession = s;
-      s->prev = NULL;
-    } else {
-      lastSession->next = s;
-      lastSession = s;
-    }
+  uint32_t i = findSlot(t, clientIP.s_addr, clientPort);
 
-#ifdef TRACEME 
-    printf("removeActiveSession(sessioncount:%d, numberActiveSessions:%d, archived:%d): AFTER  found session   \n",
-                sessionCount, activeSessionCount, archivedSessionCount);
+  if (t->slots[i].sessionIndex == 0)
+    return ERROR;
+
+#ifdef TRACEME
+  printf("removeActive(sessioncount:%d, numberActiveSessions:%d, archived:%d): BEFORE  found session   \n",
+                t->sessionCount, t->activeSessionCount, t->archivedSessionCount);
 #endif
+  archiveSession(t, &t->slab[t->slots[i].sessionIndex - 1], i);
+  return NOERROR;
+}
+
+/***********************************************************
+* Function: int archiveIdleSessions(sessionTable *t, double curTime, double idleTime)
+*
+* Explanation:  Archives every active session with no arrival in
+*               the last idleTime seconds.  The active list is in
+*               order of use so only the sessions archived (and
+*               the first one that is not) are visited.
+*
+* inputs:
+*   sessionTable *t
+*   double curTime : the current time (same clock as the arrival times)
+*   double idleTime : seconds
+*
+* outputs: returns the number of sessions archived
+*
+***********************************************************/
+int archiveIdleSessions(sessionTable *t, double curTime, double idleTime)
+{
+  int numberArchived = 0;
+  session *s = NULL;
+  double lastUsed = 0.0;
+
+  while ((s = t->lastActive) != NULL) {
+    lastUsed = (s->lastArrivalTimeD > 0) ? s->lastArrivalTimeD : s->timeStartedD;
+    if ((curTime - lastUsed) <= idleTime)
+      break;
+    archiveSession(t, s, findSlot(t, s->clientIP.s_addr, s->clientPort));
+    numberArchived++;
   }
+  return numberArchived;
+}
+
+/***********************************************************
+* Function: static void setSessionLossRuns(session *s, lossRunStats *l)
+*
+* Explanation:  sets the session's loss events and MBL bins
+*               (runs of 1 .. 11 lost msgs, MBL12:  larger)
+*               from the loss runs l
+*
+***********************************************************/
+static void setSessionLossRuns(session *s, lossRunStats *l)
+{
+  s->lossEventCount = l->numberRuns;
+  s->lossEventSizeCount = l->runSeqs;
+  s->MBL1 = l->runBins[0];
+  s->MBL2 = l->runBins[1];
+  s->MBL3 = l->runBins[2];
+  s->MBL4 = l->runBins[3];
+  s->MBL5 = l->runBins[4];
+  s->MBL6 = l->runBins[5];
+  s->MBL7 = l->runBins[6];
+  s->MBL8 = l->runBins[7];
+  s->MBL9 = l->runBins[8];
+  s->MBL10 = l->runBins[9];
+  s->MBL11 = l->runBins[10];
+  s->MBL12 = l->runBins[11];
+}
+
+/***********************************************************
+* Function: int updateSessionRx(session *s, uint32_t seq, uint32_t bytes,
+*                               double arrivalTime, double OWDelay)
+*
+* Explanation:  Updates the session stats with an arrival
+*
+* inputs:
+*   session *s
+*   uint32_t seq : the sequence number of the message
+*   uint32_t bytes : bytes received
+*   double arrivalTime : the arrival time
+*   double OWDelay : the one way delay of the message (arrival - send time)
+*
+* outputs:
+*   returns the arrival's class (flowMetricsRx):  FLOW_IN_ORDER,
+*   FLOW_REORDERED, FLOW_DUPLICATE or FLOW_TOO_OLD
+*
+* notes:
+*   A gap in the seq counts as lost.  A message that arrives below
+*   the largest seq seen is out of order and (if it was counted as
+*   lost) is taken back out of the loss count.
+*   A duplicate is only counted as one.
+*   The loss events (lossEventCount, MBL1 .. MBL12) are the flow's
+*   loss runs:  a run is counted when it leaves the flow's window.
+*
+***********************************************************/
+int updateSessionRx(session *s, uint32_t seq, uint32_t bytes, double arrivalTime, double OWDelay)
+{
+  uint32_t gap = 0;
+  int rxClass;
+
+  if (s->firstArrivalTimeD < 0)
+    s->firstArrivalTimeD = arrivalTime;
   else {
-   rc = ERROR;
+    s->thisInterArrivalTime = arrivalTime - s->lastArrivalTimeD;
+    s->interArrivalTimeSum += s->thisInterArrivalTime;
+    s->interArrivalTimeCount++;
   }
-  return rc;
+  s->lastArrivalTimeD = arrivalTime;
+
+  s->messagesReceived++;
+  s->bytesReceived += bytes;
+  s->lastSequenceNum = seq;
+
+  rxClass = flowMetricsRx(&s->flow, seq, OWDelay);
+  if (s->flow.loss.numberRuns != s->lossEventCount)
+    setSessionLossRuns(s, &s->flow.loss);
+  if (rxClass == FLOW_IN_ORDER) {
+    gap = s->flow.lastGap;
+    if (gap > 0)
+      s->messagesLost += gap;
+    s->largestSeqRecv = seq;
+  } else if (rxClass == FLOW_DUPLICATE)
+    s->duplicateArrival++;
+  else {
+    s->outOfOrderArrival++;
+    if (s->messagesLost > 0)
+      s->messagesLost--;
+  }
+
+  if (OWDelay >= 0)
+    s->countPOWDelaySamples++;
+  else
+    s->countNOWDelaySamples++;
+  if ((s->countPOWDelaySamples + s->countNOWDelaySamples) > 1) {
+    s->delayChange = OWDelay - s->curOWDelay;
+    s->delayChangeSum += s->delayChange;
+    s->jitterSum += fabs(s->delayChange);
+  }
+  s->curJitter = s->flow.jitter;
+  s->curOWDelay = OWDelay;
+  s->OWDelaySum += OWDelay;
+  return rxClass;
 }
 
 /***********************************************************
 * Function:  double updateSessionDuration(session *s) {
 *
-* Explanation: this function updates both the 
-*               ssession duration. 
-*               This is based on the previously set 
+* Explanation: this function updates both the
+*               ssession duration.
+*               This is based on the previously set
 *               first time and last time accessed times.
 *
-* inputs: 
+* inputs:
 *  session *s: ptr to session
 *
-* outputs : 
+* outputs :
 *    returns ERRORD or the accurate time of the session
 *       in seconds.nanoseconds
 *
-* notes: 
+* notes:
 *
 ***********************************************************/
-double updateSessionDuration(session *s) 
+double updateSessionDuration(session *s)
 {
- 
-  int rc = NOERROR;
-
-
   s->timeFromFirstToLast = s->lastArrivalTimeD - s->firstArrivalTimeD;
   s->duration= s->timeFromFirstToLast;
 
-#ifdef TRACEME 
+#ifdef TRACEME
     printf("updateSessionDuration: lastArrivalTimeD:%f firstAddrivalTimeD:%f \n",
       s->lastArrivalTimeD, s->firstArrivalTimeD);
 #endif
@@ -463,20 +671,27 @@ double updateSessionDuration(session *s)
 }
 
 /***********************************************************
-* Function: int printSession(double curTime, FILE *fileFID, session *toprint) 
+* Function: int printSession(double curTime, FILE *fileFID, session *toprint)
 *
-* Explanation:  Prints status of one particular session 
+* Explanation:  Prints status of one particular session:  the rates
+*               and losses, the flow metrics (printFlowMetrics) and
+*               the loss runs and their length bins (printLossRunStats),
+*               one line each
 *
-* inputs: 
+* inputs:
 *  double curTime : caller passes current wall clock time
 *  FILE *fileFID:  specifies output file descriptor
 *  status *s : ptr to the session struct
 *
-* outputs : 
+* outputs :
 *    returns ERROR or NOERROR
 *
+* notes:
+*   The loss events and MBL bins are set from a flushed copy of the
+*   flow:  they include the runs still in its window.
+*
 ***********************************************************/
-int printSession(double curTime, FILE *fileFID, session *toprint) 
+int printSession(double curTime, FILE *fileFID, session *toprint)
 {
   double durSecs = 0.0;
   double bps = 0;
@@ -488,11 +703,9 @@ int printSession(double curTime, FILE *fileFID, session *toprint)
   double avgJitter=0.0;
   double avgOWDelay=0.0;
   double avgMBL=0.0;  //avgMBL based on single count-size of each loss event
-  double avgMBLBINs=0.0; //avgMBL: weighted avg of bins
-  double MBLMetric=0.0;
   double avgIAT=0.0;
-  char activeChar[2];
-  double  MMNumerator= 0.0;
+  char cAddr[INET_ADDRSTRLEN];
+  flowMetrics flow;
 
   if (fileFID == NULL) {
     printf("printSession: HARD ERROR: bad fileFID \n");
@@ -502,25 +715,14 @@ int printSession(double curTime, FILE *fileFID, session *toprint)
     printf("printSession: HARD ERROR: bad sPtr  \n");
     return ERROR;
   }
-  if (sessionCount == 0) {
-    return NOERROR;
-  }
 
-  wallTime = getCurTime(&wallTimeTS);
-  rc = convertTimespecToString (wallTimeString,MAX_LINE_SIZE,&wallTimeTS);
-  if (rc == ERROR) {
-    printf("printSession: HARD ERROR: return from convertTimespectToString \n");
-    return ERROR;
-  } else 
-   rc = NOERROR;
-
-  char *cAddr = inet_ntoa(toprint->clientIP);
-  activeChar[0]=' ';
-  activeChar[1]='\n';
-  if (toprint->isActive)
-    activeChar[0]='a';
-  else
-    activeChar[0]='s';
+  inet_ntop(AF_INET, &toprint->clientIP, cAddr, sizeof(cAddr));
+
+  flow = toprint->flow;
+  flow.lossTotals = NULL;
+  flow.lossInterval = NULL;
+  flushFlowMetrics(&flow);
+  setSessionLossRuns(toprint, &flow.loss);
 
   durSecs = updateSessionDuration(toprint);
   if (durSecs > 0)
@@ -528,21 +730,21 @@ int printSession(double curTime, FILE *fileFID, session *toprint)
 
 #ifdef TRACEME
     printf("printSession(%d): session:client IP %s: , durSecs:%f  \n",
-        sessionCount, cAddr, durSecs);
+        toprint->sessionID, cAddr, durSecs);
 #endif
 
       //tmpVar = ((double)toprint->messagesLost) + ( (double) toprint->messagesReceived);
       tmpVar = (double)toprint->largestSeqRecv;
       //note: this is the loss rate not a percent
       lossRate = 0.0;
-      if (tmpVar > 0.0) 
+      if (tmpVar > 0.0)
         lossRate = ( (double) toprint->messagesLost) / tmpVar;
 
       lossEventRate=0.0;
-      if (tmpVar > 0.0) 
-        lossEventRate = toprint->lossEventSizeCount/tmpVar;
+      if (tmpVar > 0.0)
+        lossEventRate = toprint->lossEventCount/tmpVar;
 
-      totalNumberSamples = 
+      totalNumberSamples =
          (double)toprint->countPOWDelaySamples +
          (double)toprint->countNOWDelaySamples;
 
@@ -550,236 +752,156 @@ int printSession(double curTime, FILE *fileFID, session *toprint)
         avgOWDelay= ( (double) toprint->OWDelaySum) / totalNumberSamples;
       }
 
-      if (toprint->lossEventSizeCount>0)
-        avgMBL= toprint->messagesLost/(double)toprint->lossEventSizeCount;
+      if (toprint->lossEventCount>0)
+        avgMBL= toprint->lossEventSizeCount/(double)toprint->lossEventCount;
 
       if (toprint->interArrivalTimeCount>0) {
 
-        avgJitter = toprint->jitterSum / 
+        avgJitter = toprint->jitterSum /
                      (double)toprint->interArrivalTimeCount;
-        avgIAT = toprint->interArrivalTimeSum / 
+        avgIAT = toprint->interArrivalTimeSum /
                      (double)toprint->interArrivalTimeCount;
       }
 
-      MMNumerator= (toprint->MBL1 / toprint->messagesLost) + 
-                   (toprint->MBL2 / toprint->messagesLost) + 
-                   (toprint->MBL3 / toprint->messagesLost) + 
-                   (toprint->MBL4 / toprint->messagesLost) + 
-                   (toprint->MBL5 / toprint->messagesLost) + 
-                   (toprint->MBL6 / toprint->messagesLost) + 
-                   (toprint->MBL7 / toprint->messagesLost) + 
-                   (toprint->MBL8 / toprint->messagesLost) + 
-                   (toprint->MBL9 / toprint->messagesLost) + 
-                   (toprint->MBL10 / toprint->messagesLost) + 
-                   (toprint->MBL11 / toprint->messagesLost);
-
-      MBLMetric=0.0;
-
-  int tmpX = toprint->MBL1+ toprint->MBL2+ toprint->MBL3+ toprint->MBL4+ toprint->MBL5+ toprint->MBL6+ toprint->MBL7+ toprint->MBL8+ toprint->MBL9+ toprint->MBL10+ toprint->MBL11+ toprint->MBL12;
-
-  fprintf(fileFID,"%12.9f %s:%d %4.9f %d %d %d %12.0f bps %2.4f %2.4f %2.2f %2.9f %2.9f %2.9f \n", 
-          curTime, cAddr, toprint->clientPort, 
+  fprintf(fileFID,"%12.9f %s:%d %4.9f %d %d %d %12.0f bps %2.4f %2.4f %2.2f %2.9f %2.9f %2.9f \n",
+          curTime, cAddr, ntohs(toprint->clientPort),
           durSecs,
           toprint->messagesReceived, toprint->messagesLost,
           toprint->largestSeqRecv,
           bps, lossRate,lossEventRate, avgMBL, avgOWDelay, avgJitter, avgIAT);
 
-          fprintf(fileFID,"%d %d %d %d %d %d %d %d %d %d %d %d %d %d %d \n",
-          toprint->messagesLost,toprint->lossEventSizeCount,tmpX,
-          toprint->MBL1,
-          toprint->MBL2,
-          toprint->MBL3,
-          toprint->MBL4,
-          toprint->MBL5,
-          toprint->MBL6,
-          toprint->MBL7,
-          toprint->MBL8,
-          toprint->MBL9,
-          toprint->MBL10,
-          toprint->MBL11,
-          toprint->MBL12);
+  printFlowMetrics(&toprint->flow, fileFID);
+  printLossRunStats(&flow.loss, durSecs, fileFID);
 
   return rc;
 }
 
 /***********************************************************
-* Function: int printActiveSessions(double curTime, FILE *fileFID) 
+* Function: static int printSessionList(session *first, double curTime, FILE *fileFID)
 *
-* Explanation:  Prints summary stats of active sessions 
+* Explanation:  Prints each session of a list
 *
-* inputs: 
-*  double curTime : caller passes current wall clock time
-*  FILE *fileFID:  specifies output file descriptor
-*
-* outputs : 
-*    returns ERROR or >=0 representing the number of 
-*    sessions whose stats were placed in the output file.
-*    A 0 is not necessarily an error.
+* outputs :
+*    returns ERROR or the number of sessions printed
 *
 ***********************************************************/
-int printActiveSessions(double curTime, FILE *fileFID) 
+static int printSessionList(session *first, double curTime, FILE *fileFID)
 {
   int tmpSessionCount=0;
-  int rc = NOERROR;
+  session *toprint = first;
 
-  session *toprint = NULL;
   if (fileFID == NULL) {
-    printf("printActiveSessions: HARD ERROR: bad fileFID \n");
+    printf("printSessionList: HARD ERROR: bad fileFID \n");
     return(ERROR);
   }
-  if (activeSessionCount == 0) {
-    return 0;
-  }
-
-#ifdef TRACEME 
-    printf("printActiveSessions: sessionCount:%d  activeSessionCount:%d archivedSessionCount:%d   \n",
-       sessionCount, activeSessionCount, archivedSessionCount);
-    printf("printActiveSessions: cAddr clientPort duration bytesRxed MsgsRxed   bps lossrate \n");
-#endif
 
-
-  if ( (activeSessionCount > 0) && (firstActive == NULL) ) {
-    rc = ERROR;
-    printf("printSessions: ERROR: activeSession NULL AND activeSessionCount:%i \n", activeSessionCount);
-    fprintf(fileFID,"printActiveSessions: ERROR!!  sessionCount:%d  activeSessionCount:%d archivedSessionCount:%d   \n",
-        sessionCount, activeSessionCount, archivedSessionCount);
-  }  else  {
-    // So no error....
-    toprint = firstActive;
-
-    while (toprint != NULL) {
-      rc =  printSession(curTime,fileFID,toprint);
-      if (rc == NOERROR)
-        tmpSessionCount++;
-      else{
-        printf("printActiveSessions:  ERROR from printSessions, tmpSessionCount:%d \n",tmpSessionCount);
-        break;
-      }
-      toprint = toprint->next;
+  while (toprint != NULL) {
+    if (printSession(curTime,fileFID,toprint) == ERROR) {
+      printf("printSessionList:  ERROR from printSession, tmpSessionCount:%d \n",tmpSessionCount);
+      return ERROR;
     }
-
+    tmpSessionCount++;
+    toprint = toprint->next;
   }
-
-  if (rc == NOERROR)
-    rc = tmpSessionCount;
-  
-  return rc;
-
+  return tmpSessionCount;
 }
 
 /***********************************************************
-* Function: int printArchivedSessions(double curTime, FILE *fileFID) 
+* Function: int printActiveSessions(sessionTable *t, double curTime, FILE *fileFID)
 *
-* Explanation:  Prints summary stats of archived sessions 
+* Explanation:  Prints summary stats of active sessions
+*               (most recently used first)
 *
-* inputs: 
+* inputs:
+*  sessionTable *t
 *  double curTime : caller passes current wall clock time
 *  FILE *fileFID:  specifies output file descriptor
 *
-* outputs : 
-*    returns ERROR or >=0 representing the number of 
+* outputs :
+*    returns ERROR or >=0 representing the number of
 *    sessions whose stats were placed in the output file.
 *    A 0 is not necessarily an error.
 *
 ***********************************************************/
-int printArchivedSessions(double curTime, FILE *fileFID) 
+int printActiveSessions(sessionTable *t, double curTime, FILE *fileFID)
 {
+  return printSessionList(t->firstActive, curTime, fileFID);
+}
 
-  int tmpSessionCount=0;
-  session *toprint = NULL;
-  int rc = NOERROR;
-
-  if (fileFID == NULL) {
-    printf("printSessions: HARD ERROR: bad fileFID \n");
-    return(ERROR);
-  }
-  if (archivedSessionCount == 0) {
-    return 0;
-  }
-
-#ifdef TRACEME 
-    printf("printSessions: sessionCount:%d  activeSessionCount:%d archivedSessionCount:%d   \n",
-       sessionCount, activeSessionCount, archivedSessionCount);
-    printf("printSessions: cAddr clientPort duration bytesRxed MsgsRxed   bps lossrate \n");
-#endif
-  if ( (archivedSessionCount > 0) && (firstSession == NULL) ) {
-    rc = ERROR;
-    printf("printSessions: ERROR: firstSession NULL AND sessionCount:%i \n", sessionCount);
-    fprintf(fileFID,"printArchivedSessions: ERROR!!  sessionCount:%d  activeSessionCount:%d archivedSessionCount:%d   \n",
-        sessionCount, activeSessionCount, archivedSessionCount);
-  }  else  {
-    // So no error....
-    toprint = firstSession;
-
-    while (toprint != NULL) {
-      rc =  printSession(curTime,fileFID,toprint);
-      if (rc == NOERROR)
-        tmpSessionCount++;
-      else{
-        printf("printArchivedSessions: HARD ERROR!! printSessions, tmpSessionCount:%d \n",tmpSessionCount);
-        break;
-      }
-      toprint = toprint->next;
-    }
-
-  }
-
-  if (rc == NOERROR)
-    rc = tmpSessionCount;
-
-  return rc;
-
+/***********************************************************
+* Function: int printArchivedSessions(sessionTable *t, double curTime, FILE *fileFID)
+*
+* Explanation:  Prints summary stats of archived sessions
+*               (oldest first)
+*
+* inputs:
+*  sessionTable *t
+*  double curTime : caller passes current wall clock time
+*  FILE *fileFID:  specifies output file descriptor
+*
+* outputs :
+*    returns ERROR or >=0 representing the number of
+*    sessions whose stats were placed in the output file.
+*    A 0 is not necessarily an error.
+*
+***********************************************************/
+int printArchivedSessions(sessionTable *t, double curTime, FILE *fileFID)
+{
+  return printSessionList(t->firstSession, curTime, fileFID);
 }
 
 /***********************************************************
-* Function: int printAllSessions(double curTime, FILE *fileFID) 
+* Function: int printAllSessions(sessionTable *t, double curTime, FILE *fileFID)
 *
-* Explanation:  Prints summary stats of all sessions 
+* Explanation:  Prints summary stats of all sessions
 *
-* inputs: 
+* inputs:
+*  sessionTable *t
 *  double curTime : caller passes current wall clock time
 *  FILE *fileFID:  specifies output file descriptor
 *
-* outputs : 
-*    returns ERROR or >=0 representing the number of 
+* outputs :
+*    returns ERROR or >=0 representing the number of
 *    sessions whose stats were placed in the output file.
 *    A 0 is not necessarily an error.
 *
 ***********************************************************/
-int printAllSessions(double curTime, FILE *fileFID) 
+int printAllSessions(sessionTable *t, double curTime, FILE *fileFID)
 {
   int rc = NOERROR;
+  int rc2 = NOERROR;
 
-  rc = printActiveSessions(curTime, fileFID); 
-  rc = printArchivedSessions(curTime, fileFID); 
-  return rc;
-
+  rc = printActiveSessions(t, curTime, fileFID);
+  rc2 = printArchivedSessions(t, curTime, fileFID);
+  if ((rc == ERROR) || (rc2 == ERROR))
+    return ERROR;
+  return rc + rc2;
 }
 
 /***********************************************************
-* Function: void freeAllSessions() 
+* Function: uint32_t freeAllSessions(sessionTable *t)
 *
-* Explanation:  This frees all sessions in archived list.
-*               Used to free memory. 
+* Explanation:  This returns all archived sessions to the slab.
 *
-* inputs: none
+* inputs:
+*  sessionTable *t
 *
 * outputs: returns number freed.
 *
-* notes: 
-*
 ***********************************************************/
-uint32_t  freeAllSessions() 
+uint32_t  freeAllSessions(sessionTable *t)
 {
   uint32_t rc = 0;
-  while (firstSession != NULL) {
-    sessionCount--;
-    session *tofree = firstSession;
-    firstSession = tofree->next;
+  session *tofree = NULL;
+
+  while ((tofree = t->firstSession) != NULL) {
+    t->firstSession = tofree->next;
+    tofree->next = t->freeList;
+    t->freeList = tofree;
+    t->sessionCount--;
     rc++;
-    free(tofree);
   }
+  t->lastSession = NULL;
+  t->archivedSessionCount = 0;
   return rc;
 }
-
-
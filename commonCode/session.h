@@ -4,35 +4,55 @@
 * Purpose:
 *   This include file is for session includes/defines.
 *
-*  session *findActive(struct in_addr clientIP, uint16_t clientPort);
-*  session *getActive(struct in_addr clientIP, uint16_t clientPort);
-*  int removeActive(struct in_addr clientIP, uint16_t clientPort);
+*  sessionTable *createSessionTable(uint32_t maxSessions);
+*  void freeSessionTable(sessionTable *t);
+*  session *findActive(sessionTable *t, struct in_addr clientIP, uint16_t clientPort);
+*  session *getActive(sessionTable *t, struct in_addr clientIP, uint16_t clientPort);
+*  int removeActive(sessionTable *t, struct in_addr clientIP, uint16_t clientPort);
+*  int archiveIdleSessions(sessionTable *t, double curTime, double idleTime);
+*  int updateSessionRx(session *s, uint32_t seq, uint32_t bytes, double arrivalTime, double OWDelay);
 *  double updateSessionDuration(session *s);
-*  int  printSessions(FiLE *fileID);
-*  uint32_t freeAllSessions();
+*  int  printAllSessions(sessionTable *t, double curTime, FILE *fileFID);
+*  uint32_t freeAllSessions(sessionTable *t);
 *
 * Notes:
+*   Each session has the flowMetrics of its msgs (jitter, IPDV,
+*   reordering, duplicates, loss runs).
+*   A sessionTable is not thread safe.  A multi threaded program
+*   uses one table per thread.
+*
+* Last update: 10/17/2026
 *
 ************************************************************************/
 #ifndef	__session_h
 #define	__session_h
 
-#define MAX_SESSIONS 2048
+#include "common.h"
+#include "flowMetrics.h"
+
+//Upper limit on the sessions of one table (the slab is preallocated,
+//its entries are carved off as they are first needed)
+#define MAX_SESSIONS (1 << 22)
+#define DEFAULT_SESSIONS 4096
+
+//Active sessions with no arrival for this long are archived
+#define SESSION_IDLE_TIMEOUT 60.0
 
 
 //TODO:  byte counts should be uint64
 typedef struct session {
   uint32_t errorCount;  //tracks number of any type of error that might occur
   bool isActive;        //true if on the active list, false if on archived list
-  uint32_t sessionID;   //uniquely id's this session 
+  uint32_t sessionID;   //uniquely id's this session
   uint32_t currentArrayIndex;  //increments each time we wrap the session array
   struct in_addr clientIP;
   uint16_t clientPort;
   uint16_t mode;
-  struct timespec timeStarted;  
-  struct timespec sessionEnd;  
-  double timeStartedD;         //This should be a wall time 
+  struct timespec timeStarted;
+  struct timespec sessionEnd;
+  double timeStartedD;         //This should be a wall time
   double firstArrivalTimeD;    //this should be based on a high precision clock
+  //Loss runs (bursts) of 1 .. 11 lost msgs, MBL12:  larger
   uint32_t MBL1;
   uint32_t MBL2;
   uint32_t MBL3;
@@ -61,27 +81,66 @@ typedef struct session {
   uint32_t bytesTxCountWrap;
   uint32_t messagesSent;
   uint32_t messagesLost;
-  uint32_t lossEventCount;
-  uint32_t lossEventSizeCount;
+  uint32_t lossEventCount;      //loss runs (flow.loss)
+  uint32_t lossEventSizeCount;  //the lost msgs of the loss runs
   uint32_t lastSequenceNum;
   uint32_t sequenceNumberWrap;
   uint32_t largestSeqRecv;
   uint32_t largestSeqSent;
   uint32_t ArrivalsBeforeAck;
-  uint32_t outOfOrderArrival;
+  uint32_t outOfOrderArrival;  //reordered (or too old to tell)
   uint32_t duplicateArrival;
-  double   curJitter;   //Jitter based on sequential packet arrivals 
-  double   jitterSum;
+  double   curJitter;   //RFC 3550 interarrival jitter (flow.jitter)
+  double   jitterSum;   //of |delayChange|
   uint32_t countPOWDelaySamples; //Counts number of positive delays
   uint32_t countNOWDelaySamples; //Counts number of negative delays
   double   curOWDelay;
   double   OWDelaySum;
   double   delayChange;  //difference between this and the previous delay
   double   delayChangeSum;
+  flowMetrics flow;
+  //active: the recently used list (most recent first). archived: the archive (oldest first).
+  //free: the slab's free list (next only)
   struct session *prev;
   struct session *next;
 } session;
 
+//A hash slot.  The key is kept in the slot so a lookup touches
+//the session only on a match.  sessionIndex 0: empty, else slab index + 1
+typedef struct {
+  uint32_t clientIP;
+  uint16_t clientPort;
+  uint16_t unused;
+  uint32_t sessionIndex;
+} sessionSlot;
+
+//Active sessions are found with an open addressing (linear probe)
+//hash of (clientIP, clientPort).  All sessions come from a slab
+//allocated when the table is created.  The slab is used from the
+//start (numberCarved) so its pages are only touched by sessions in use.
+typedef struct {
+  uint32_t maxSessions;      //slab size
+  uint32_t numberCarved;     //slab entries handed out so far
+  uint32_t numberSlots;      //power of 2, at least twice maxSessions
+  uint32_t slotShift;        //32 - log2(numberSlots)
+  sessionSlot *slots;
+  session *slab;
+  session *freeList;         //returned sessions (freeAllSessions)
+
+  //Active list (most recently used at the head)
+  session *firstActive;
+  session *lastActive;
+  //Archived list (oldest at the head).  Archived sessions are
+  //reused (oldest first) when the slab runs out
+  session *firstSession;
+  session *lastSession;
+
+  uint32_t sessionCount;          //active + archived
+  uint32_t activeSessionCount;
+  uint32_t archivedSessionCount;
+  uint32_t sessionNumber;         //last sessionID handed out
+} sessionTable;
+
 
 //Not used ??
 #if 0
@@ -93,25 +152,28 @@ typedef struct {
 #endif
 
 
-void initSessions();
-int createSession(session  **sPtr);
-int getNumberActiveSessions();
-int getNumberSessions();
+sessionTable *createSessionTable(uint32_t maxSessions);
+void freeSessionTable(sessionTable *t);
+void initSessions(sessionTable *t);
+int getNumberActiveSessions(sessionTable *t);
+int getNumberSessions(sessionTable *t);
 
-session *findActive(struct in_addr clientIP, uint16_t clientPort);
-session *findSession(struct in_addr clientIP, unsigned short clientPort);
-session *getActive(struct in_addr clientIP, uint16_t clientPort);
+session *findActive(sessionTable *t, struct in_addr clientIP, uint16_t clientPort);
+session *findSession(sessionTable *t, struct in_addr clientIP, unsigned short clientPort);
+session *getActive(sessionTable *t, struct in_addr clientIP, uint16_t clientPort);
 
-int removeActive(struct in_addr clientIP, uint16_t clientPort);
+int removeActive(sessionTable *t, struct in_addr clientIP, uint16_t clientPort);
+int archiveIdleSessions(sessionTable *t, double curTime, double idleTime);
+int updateSessionRx(session *s, uint32_t seq, uint32_t bytes, double arrivalTime, double OWDelay);
 double updateSessionDuration(session *s);
 
 int printSession(double curTime, FILE *fileFID, session *sPtr);
-int printAllSessions(double curTime, FILE *fileFID);
+int printAllSessions(sessionTable *t, double curTime, FILE *fileFID);
 
-int printActiveSessions(double curTime, FILE *fileFID); 
+int printActiveSessions(sessionTable *t, double curTime, FILE *fileFID);
 
-int printArchivedSessions(double curTime, FILE *fileFID); 
-uint32_t freeAllSessions();
+int printArchivedSessions(sessionTable *t, double curTime, FILE *fileFID);
+uint32_t freeAllSessions(sessionTable *t);
 
 #endif
 
@@ -0,0 +1,334 @@
+/*********************************************************
+*
+* Module Name: stats export
+*
+* File Name:  statsExport.c
+*
+* Summary:  Publishes live counters and latency histograms in a
+*           shared memory segment (one seqlocked record per target
+*           or session) and reads them back (the collector side).
+*
+*  The methods include:
+*   statsExport *createStatsExport(const char *name, uint32_t role, uint32_t maxRecords);
+*   statsExport *openStatsExport(const char *name);
+*   void freeStatsExport(statsExport *e);
+*   statsRecord *statsExportOpenRecord(statsExport *e, uint32_t index, uint32_t id,
+*                                      uint32_t kind, const char *name, double now);
+*   int statsReadRecord(statsExport *e, uint32_t index, statsRecord *copyPtr);
+*   double statsRecordPercentile(const statsRecord *r, double percentile);
+*
+* Notes:
+*   The segment is sized for maxRecords but only the pages of the
+*   records that are used are touched (a sparse file in /dev/shm).
+*
+* Last update: 10/17/2026
+*
+*********************************************************/
+#include "common.h"
+#include "statsExport.h"
+#include <sys/mman.h>
+
+//#define TRACEME 0
+
+/***********************************************************
+* Function: static void segmentName(char *segment, const char *name)
+*
+* Explanation:  the shm_open name of a segment:  /name
+*
+***********************************************************/
+static void segmentName(char *segment, const char *name)
+{
+  snprintf(segment, NAME_MAX, "%s%s", (name[0] == '/') ? "" : "/", name);
+}
+
+static statsExport *initStatsExport(statsExport *e, void *map, uint32_t role, uint32_t maxRecords);
+
+/***********************************************************
+* Function: statsExport *createStatsExport(const char *name, uint32_t role,
+*                                          uint32_t maxRecords)
+*
+* Explanation:  creates (or replaces) the segment and maps it for
+*               writing.  The caller owns the export.
+*
+* inputs:
+*   const char *name : the segment (e.g. udpping:  /dev/shm/udpping).
+*                      NULL:  a private (anonymous) mapping
+*   uint32_t role : STATS_ROLE_CLIENT or STATS_ROLE_SERVER
+*   uint32_t maxRecords : 1 .. STATS_EXPORT_MAX_RECORDS
+*
+* outputs:
+*    returns the export or NULL on error
+*
+***********************************************************/
+statsExport *createStatsExport(const char *name, uint32_t role, uint32_t maxRecords)
+{
+  statsExport *e = NULL;
+  int fd = -1;
+  void *map = NULL;
+
+  if ((maxRecords == 0) || (maxRecords > STATS_EXPORT_MAX_RECORDS)) {
+    printf("createStatsExport: bad maxRecords %d \n", maxRecords);
+    return NULL;
+  }
+  e = calloc(1, sizeof(statsExport));
+  if (e == NULL)
+    return NULL;
+  e->size = sizeof(statsExportHeader) + (size_t)maxRecords * sizeof(statsRecord);
+  e->owner = true;
+
+  if (name == NULL) {
+    map = mmap(NULL, e->size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) {
+      printf("createStatsExport: mmap of %lu bytes failed, errno:%d \n", (unsigned long)e->size, errno);
+      free(e);
+      return NULL;
+    }
+    return initStatsExport(e, map, role, maxRecords);
+  }
+
+  segmentName(e->name, name);
+  fd = shm_open(e->name, O_CREAT | O_TRUNC | O_RDWR, 0644);
+  if (fd < 0) {
+    printf("createStatsExport: shm_open(%s) failed, errno:%d \n", e->name, errno);
+    free(e);
+    return NULL;
+  }
+  if (ftruncate(fd, (off_t)e->size) < 0) {
+    printf("createStatsExport: ftruncate(%s, %lu) failed, errno:%d \n", e->name, (unsigned long)e->size, errno);
+    close(fd);
+    shm_unlink(e->name);
+    free(e);
+    return NULL;
+  }
+  map = mmap(NULL, e->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    printf("createStatsExport: mmap(%s) failed, errno:%d \n", e->name, errno);
+    shm_unlink(e->name);
+    free(e);
+    return NULL;
+  }
+  return initStatsExport(e, map, role, maxRecords);
+}
+
+/***********************************************************
+* Function: static statsExport *initStatsExport(statsExport *e, void *map,
+*                                               uint32_t role, uint32_t maxRecords)
+*
+* Explanation:  initializes the header of a new (zeroed) mapping
+*
+* outputs:
+*    returns e
+*
+***********************************************************/
+static statsExport *initStatsExport(statsExport *e, void *map, uint32_t role, uint32_t maxRecords)
+{
+  e->header = (statsExportHeader *)map;
+  e->records = (statsRecord *)((char *)map + sizeof(statsExportHeader));
+  e->wallOffset = getCurTimeD() - getTimestampD();
+
+  e->header->version = STATS_EXPORT_VERSION;
+  e->header->headerSize = sizeof(statsExportHeader);
+  e->header->recordSize = sizeof(statsRecord);
+  e->header->maxRecords = maxRecords;
+  e->header->numberRecords = 0;
+  e->header->role = role;
+  e->header->pid = getpid();
+  e->header->startTime = getCurTimeD();
+  //Last:  the segment is valid once the magic is seen
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  memcpy(e->header->magic, STATS_EXPORT_MAGIC, sizeof(e->header->magic));
+  return e;
+}
+
+/***********************************************************
+* Function: statsExport *openStatsExport(const char *name)
+*
+* Explanation:  maps an existing segment (read only), e.g. in a
+*               collector.  The caller owns the export.
+*
+* outputs:
+*    returns the export or NULL (no segment, not (yet) initialized,
+*    or another version)
+*
+***********************************************************/
+statsExport *openStatsExport(const char *name)
+{
+  statsExport *e = NULL;
+  statsExportHeader header;
+  struct stat fileStat;
+  int fd = -1;
+  void *map = NULL;
+
+  e = calloc(1, sizeof(statsExport));
+  if (e == NULL)
+    return NULL;
+  segmentName(e->name, name);
+  fd = shm_open(e->name, O_RDONLY, 0);
+  if ((fd < 0) || (fstat(fd, &fileStat) < 0) || ((size_t)fileStat.st_size < sizeof(statsExportHeader))) {
+    printf("openStatsExport: no segment %s, errno:%d \n", e->name, errno);
+    if (fd >= 0)
+      close(fd);
+    free(e);
+    return NULL;
+  }
+  e->size = (size_t)fileStat.st_size;
+  map = mmap(NULL, e->size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    printf("openStatsExport: mmap(%s) failed, errno:%d \n", e->name, errno);
+    free(e);
+    return NULL;
+  }
+  e->header = (statsExportHeader *)map;
+  e->records = (statsRecord *)((char *)map + sizeof(statsExportHeader));
+
+  memcpy(&header, e->header, sizeof(header));
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  if (memcmp(header.magic, STATS_EXPORT_MAGIC, sizeof(header.magic)) != 0) {
+    printf("openStatsExport: %s is not (yet) a stats segment \n", e->name);
+    freeStatsExport(e);
+    return NULL;
+  }
+  if ((header.version != STATS_EXPORT_VERSION) || (header.headerSize != sizeof(statsExportHeader)) ||
+      (header.recordSize != sizeof(statsRecord)) ||
+      (e->size < sizeof(statsExportHeader) + (size_t)header.maxRecords * sizeof(statsRecord))) {
+    printf("openStatsExport: %s: unsupported version %d (header %d, record %d bytes) \n",
+           e->name, header.version, header.headerSize, header.recordSize);
+    freeStatsExport(e);
+    return NULL;
+  }
+  return e;
+}
+
+/***********************************************************
+* Function: void freeStatsExport(statsExport *e)
+*
+* Explanation:  unmaps the segment.  The writer also removes it.
+*
+***********************************************************/
+void freeStatsExport(statsExport *e)
+{
+  if (e == NULL)
+    return;
+  if (e->header != NULL)
+    munmap(e->header, e->size);
+  if (e->owner && (e->name[0] != '\0'))
+    shm_unlink(e->name);
+  free(e);
+}
+
+/***********************************************************
+* Function: statsRecord *statsExportOpenRecord(statsExport *e, uint32_t index,
+*                             uint32_t id, uint32_t kind, const char *name, double now)
+*
+* Explanation:  (re)starts a record:  its counters are cleared and
+*               it is named (e.g., a new client in a reused session)
+*
+* inputs:
+*   uint32_t index : the record
+*   uint32_t id : the writer's id of what the record counts
+*   uint32_t kind : STATS_KIND_TARGET, _SESSION or _WORKER
+*   const char *name : shown by the collector
+*   double now : wall time
+*
+* outputs:
+*    returns the record (NULL:  no export or a bad index)
+*
+* notes:
+*   Records of different indexes may be opened by different threads.
+*
+***********************************************************/
+statsRecord *statsExportOpenRecord(statsExport *e, uint32_t index, uint32_t id,
+                                   uint32_t kind, const char *name, double now)
+{
+  statsRecord *r = statsExportRecord(e, index);
+  uint32_t numberRecords;
+
+  if (r == NULL)
+    return NULL;
+  statsRecordBegin(r);
+  memset((char *)r + sizeof(r->seq), 0, sizeof(statsRecord) - sizeof(r->seq));
+  r->state = STATS_RECORD_ACTIVE;
+  r->id = id;
+  r->kind = kind;
+  strncpy(r->name, name, STATS_NAME_SIZE - 1);
+  r->startTime = now;
+  statsRecordEnd(r, now);
+
+  //The high water mark (the workers of a server open records concurrently)
+  numberRecords = __atomic_load_n(&e->header->numberRecords, __ATOMIC_RELAXED);
+  while ((numberRecords <= index) &&
+         !__atomic_compare_exchange_n(&e->header->numberRecords, &numberRecords, index + 1,
+                                      false, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+    ;
+  return r;
+}
+
+/***********************************************************
+* Function: int statsReadRecord(statsExport *e, uint32_t index, statsRecord *copyPtr)
+*
+* Explanation:  copies a consistent snapshot of a record (the reader
+*               side of the seqlock)
+*
+* outputs:
+*    returns NOERROR or ERROR (free, a bad index, or it stayed busy
+*    for STATS_READ_RETRIES tries)
+*
+***********************************************************/
+int statsReadRecord(statsExport *e, uint32_t index, statsRecord *copyPtr)
+{
+  statsRecord *r = statsExportRecord(e, index);
+  uint32_t seq1;
+  uint32_t seq2;
+  int i;
+
+  if (r == NULL)
+    return ERROR;
+  for (i = 0; i < STATS_READ_RETRIES; i++) {
+    seq1 = __atomic_load_n(&r->seq, __ATOMIC_ACQUIRE);
+    if (seq1 & 1)
+      continue;
+    memcpy(copyPtr, r, sizeof(statsRecord));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    seq2 = __atomic_load_n(&r->seq, __ATOMIC_RELAXED);
+    if (seq1 == seq2)
+      return (copyPtr->state == STATS_RECORD_ACTIVE) ? NOERROR : ERROR;
+  }
+  return ERROR;
+}
+
+/***********************************************************
+* Function: double statsRecordPercentile(const statsRecord *r, double percentile)
+*
+* Explanation:  estimates a latency percentile from the record's
+*               bins:  the upper edge of the bin that holds it
+*               (at most the max)
+*
+* inputs:
+*   double percentile : 0.0 .. 100.0
+*
+* outputs:
+*    returns seconds (0 if there are no samples)
+*
+***********************************************************/
+double statsRecordPercentile(const statsRecord *r, double percentile)
+{
+  uint64_t rank;
+  uint64_t count = 0;
+  double edge;
+  int bin;
+
+  if (r->latencyCount == 0)
+    return 0.0;
+  rank = (uint64_t)ceil((percentile / 100.0) * (double)r->latencyCount);
+  if (rank == 0)
+    rank = 1;
+  for (bin = 0; bin < STATS_LATENCY_BINS; bin++) {
+    count += r->latencyBins[bin];
+    if (count >= rank)
+      break;
+  }
+  edge = (double)(1ULL << ((bin < STATS_LATENCY_BINS) ? bin : STATS_LATENCY_BINS - 1)) / 1000000.0;
+  return (edge < r->latencyMax) ? edge : r->latencyMax;
+}
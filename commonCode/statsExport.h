@@ -0,0 +1,263 @@
+/************************************************************************
+* File:  statsExport.h
+*
+* Purpose:
+*   This include file is for the statsExport module:  live counters
+*   and latency histograms published in a POSIX shared memory segment
+*   (shm_open + mmap) so a collector (UDPPingStats) can sample a
+*   running client or server without a syscall, a signal or a lock
+*   in the process it reads.
+*
+*   statsExport *createStatsExport(const char *name, uint32_t role, uint32_t maxRecords);
+*   statsExport *openStatsExport(const char *name);
+*   void freeStatsExport(statsExport *e);
+*   statsRecord *statsExportOpenRecord(statsExport *e, uint32_t index, uint32_t id,
+*                                      uint32_t kind, const char *name, double now);
+*   int statsReadRecord(statsExport *e, uint32_t index, statsRecord *copyPtr);
+*   double statsRecordPercentile(const statsRecord *r, double percentile);
+*   static inline: statsExportRecord, statsExportWallTime, statsRecordBegin,
+*                  statsRecordEnd, statsRecordAddLatency, statsRecordSent,
+*                  statsRecordReply, statsRecordLost, statsRecordLate
+*
+* Notes:
+*   The segment is a statsExportHeader followed by maxRecords
+*   statsRecords (one per target, session ...), each on its own cache
+*   lines.  The header's magic is written last:  a reader that sees
+*   it sees an initialized segment.  A reader checks the version and
+*   the sizes.
+*   Each record has one writer and is protected by a seqlock:  the
+*   writer makes seq odd, updates the record and makes seq even; a
+*   reader copies the record and retries if seq was odd or changed.
+*   The writer never waits.
+*   Times in the records are wall times (getCurTimeD).  A writer that
+*   has a timestamp (getTimestampD) converts it with statsExportWallTime.
+*   The latency bins are powers of 2 of usecs:  bin 0 counts the
+*   samples below 1 usec (and the negative ones), bin i those in
+*   [2^(i-1), 2^i) usecs.  The client's latency is the RTT, the
+*   server's the one way delay.
+*   The segment's name is /name (e.g. /udpping) and it is in /dev/shm.
+*   The writer removes it when it frees the export.  An export created
+*   without a name is private to the process (e.g., only read by the
+*   metrics server's thread).
+*
+* Last update: 10/17/2026
+*
+*************************************************************************/
+#ifndef	__statsExport_h
+#define	__statsExport_h
+
+#include "common.h"
+
+#define STATS_EXPORT_MAGIC "UDPPSTAT"
+#define STATS_EXPORT_VERSION 1
+#define STATS_EXPORT_MAX_RECORDS (1 << 22)
+#define STATS_NAME_SIZE 48
+#define STATS_LATENCY_BINS 32
+//A reader gives up on a record that is rewritten this many times while it copies
+#define STATS_READ_RETRIES 1000
+
+//Segment roles
+#define STATS_ROLE_CLIENT 1
+#define STATS_ROLE_SERVER 2
+
+//Record states
+#define STATS_RECORD_FREE   0
+#define STATS_RECORD_ACTIVE 1
+
+//What a record counts
+#define STATS_KIND_TARGET  1       //a client's server or mesh target
+#define STATS_KIND_SESSION 2       //a server's client
+#define STATS_KIND_WORKER  3       //all the msgs of a server worker
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t headerSize;
+  uint32_t recordSize;
+  uint32_t maxRecords;
+  uint32_t numberRecords;          //records 0 .. numberRecords-1 may have been used
+  uint32_t role;
+  int32_t pid;
+  uint32_t unused;
+  double startTime;                //wall time
+} __attribute__((aligned(CACHE_LINE_SIZE))) statsExportHeader;
+
+typedef struct {
+  uint32_t seq;                    //seqlock:  odd while the writer updates the record
+  uint32_t state;
+  uint32_t id;                     //the writer's (e.g., the session ID)
+  uint32_t kind;                   //STATS_KIND_*
+  char name[STATS_NAME_SIZE];      //e.g., host:port
+  double startTime;                //wall time the record was opened
+  double updateTime;               //wall time of the last update
+  uint64_t numberSent;
+  uint64_t numberRxed;
+  uint64_t numberLost;
+  uint64_t numberLate;             //client: late/unknown replies, server: out of order
+  uint64_t bytesSent;
+  uint64_t bytesRxed;
+  uint64_t latencyCount;
+  double latencySum;
+  double latencyMin;
+  double latencyMax;
+  double lastLatency;
+  uint32_t latencyBins[STATS_LATENCY_BINS];
+} __attribute__((aligned(CACHE_LINE_SIZE))) statsRecord;
+
+typedef struct {
+  statsExportHeader *header;
+  statsRecord *records;
+  size_t size;                     //of the mapping
+  char name[NAME_MAX];             //empty:  private (not in /dev/shm)
+  bool owner;                      //true: the writer (unlinks the segment)
+  double wallOffset;               //wall time - timestamp (getTimestampD)
+} statsExport;
+
+statsExport *createStatsExport(const char *name, uint32_t role, uint32_t maxRecords);
+statsExport *openStatsExport(const char *name);
+void freeStatsExport(statsExport *e);
+statsRecord *statsExportOpenRecord(statsExport *e, uint32_t index, uint32_t id,
+                                   uint32_t kind, const char *name, double now);
+int statsReadRecord(statsExport *e, uint32_t index, statsRecord *copyPtr);
+double statsRecordPercentile(const statsRecord *r, double percentile);
+
+/***********************************************************
+* Function: static inline statsRecord *statsExportRecord(statsExport *e, uint32_t index)
+*
+* Explanation:  returns record index (NULL if there is no export)
+*
+***********************************************************/
+static inline statsRecord *statsExportRecord(statsExport *e, uint32_t index)
+{
+  if ((e == NULL) || (index >= e->header->maxRecords))
+    return NULL;
+  return &e->records[index];
+}
+
+/***********************************************************
+* Function: static inline double statsExportWallTime(statsExport *e, double timestamp)
+*
+* Explanation:  returns the wall time of a timestamp (getTimestampD)
+*               (0 if there is no export)
+*
+***********************************************************/
+static inline double statsExportWallTime(statsExport *e, double timestamp)
+{
+  return (e != NULL) ? timestamp + e->wallOffset : 0.0;
+}
+
+/***********************************************************
+* Function: static inline void statsRecordBegin(statsRecord *r)
+*
+* Explanation:  starts an update (seq odd).  The stores of the
+*               update can not move before it.
+*
+***********************************************************/
+static inline void statsRecordBegin(statsRecord *r)
+{
+  __atomic_store_n(&r->seq, r->seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/***********************************************************
+* Function: static inline void statsRecordEnd(statsRecord *r, double now)
+*
+* Explanation:  ends an update (seq even) at wall time now
+*
+***********************************************************/
+static inline void statsRecordEnd(statsRecord *r, double now)
+{
+  r->updateTime = now;
+  __atomic_store_n(&r->seq, r->seq + 1, __ATOMIC_RELEASE);
+}
+
+/***********************************************************
+* Function: static inline void statsRecordAddLatency(statsRecord *r, double latency)
+*
+* Explanation:  adds a latency sample (seconds).  Between a
+*               statsRecordBegin and a statsRecordEnd.
+*
+***********************************************************/
+static inline void statsRecordAddLatency(statsRecord *r, double latency)
+{
+  uint64_t usecs = (latency > 0.0) ? (uint64_t)(latency * 1000000.0) : 0;
+  int bin = (usecs == 0) ? 0 : 64 - __builtin_clzll(usecs);
+
+  if (bin >= STATS_LATENCY_BINS)
+    bin = STATS_LATENCY_BINS - 1;
+  r->latencyBins[bin]++;
+  if ((r->latencyCount == 0) || (latency < r->latencyMin))
+    r->latencyMin = latency;
+  if ((r->latencyCount == 0) || (latency > r->latencyMax))
+    r->latencyMax = latency;
+  r->latencyCount++;
+  r->latencySum += latency;
+  r->lastLatency = latency;
+}
+
+/***********************************************************
+* Function: static inline void statsRecordSent(statsRecord *r, uint32_t count,
+*                                              uint32_t bytes, double now)
+*
+* Explanation:  counts count msgs (bytes in all) sent.  r NULL:  no export.
+*
+***********************************************************/
+static inline void statsRecordSent(statsRecord *r, uint32_t count, uint32_t bytes, double now)
+{
+  if (r == NULL)
+    return;
+  statsRecordBegin(r);
+  r->numberSent += count;
+  r->bytesSent += bytes;
+  statsRecordEnd(r, now);
+}
+
+/***********************************************************
+* Function: static inline void statsRecordReply(statsRecord *r, uint32_t bytes,
+*                                               double latency, double now)
+*
+* Explanation:  counts a reply and its latency.  r NULL:  no export.
+*
+***********************************************************/
+static inline void statsRecordReply(statsRecord *r, uint32_t bytes, double latency, double now)
+{
+  if (r == NULL)
+    return;
+  statsRecordBegin(r);
+  r->numberRxed++;
+  r->bytesRxed += bytes;
+  statsRecordAddLatency(r, latency);
+  statsRecordEnd(r, now);
+}
+
+/***********************************************************
+* Function: static inline void statsRecordLost(statsRecord *r, uint32_t count, double now)
+*
+* Explanation:  counts count msgs lost.  r NULL:  no export.
+*
+***********************************************************/
+static inline void statsRecordLost(statsRecord *r, uint32_t count, double now)
+{
+  if ((r == NULL) || (count == 0))
+    return;
+  statsRecordBegin(r);
+  r->numberLost += count;
+  statsRecordEnd(r, now);
+}
+
+/***********************************************************
+* Function: static inline void statsRecordLate(statsRecord *r, double now)
+*
+* Explanation:  counts a late (or unknown) reply.  r NULL:  no export.
+*
+***********************************************************/
+static inline void statsRecordLate(statsRecord *r, double now)
+{
+  if (r == NULL)
+    return;
+  statsRecordBegin(r);
+  r->numberLate++;
+  statsRecordEnd(r, now);
+}
+
+#endif
@@ -41,7 +41,15 @@
 *  On DARWIN 
 *     uint64_t  clock_gettime_nsec_np(clockSource);
 *
-*  Last update: 4/17/2019
+*  TSC clock source (SET 9):  with an invariant TSC,
+*     setDefaultWallClockType(CLOCK_RDTSC) and
+*     setDefaultTimestampClockType(CLOCK_RDTSC) calibrate the TSC (once)
+*     and then have the wallclock and timestamp routines read the TSC
+*     rather than call clock_gettime.  getTime/getTimeD(CLOCK_RDTSC)
+*     always do (once calibrated).  startTSCRecalibration keeps the
+*     calibration current from a background thread.
+*
+*  Last update: 10/17/2026
 * 
 *********************************************************/
 #include <poll.h>
@@ -50,6 +58,9 @@
 #include "utils.h"
 #include "timeHelper.h"
 #include "delayHelper.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
 
 //#define TRACEME 0
 #define TRACE_ERRORS 0
@@ -206,6 +217,9 @@ double getCurTimeD()
   struct timespec ts;
   int rc = NOERROR;
 
+  if (defaultWallClockType == CLOCK_RDTSC)
+    return getTSCTimeD(CLOCK_REALTIME);
+
   //likely to use CLOCK_REALTIME 
   //rc = clock_gettime(wallClockType, &ts);
   //No reason to NOT use the REALTIME clock
@@ -294,7 +308,10 @@ double getCurTime(struct timespec *ts)
   int rc = NOERROR;
 
   //likely to use CLOCK_REALTIME 
-  rc = clock_gettime(CLOCK_REALTIME, ts);
+  if (defaultWallClockType == CLOCK_RDTSC)
+    rc = getTSCTime(CLOCK_REALTIME, ts);
+  else
+    rc = clock_gettime(CLOCK_REALTIME, ts);
 
   if (rc==NOERROR) { 
       timestamp = ( (double)ts->tv_sec +  (double) (((double)ts->tv_nsec)/1000000000) );
@@ -350,6 +367,8 @@ int getCurTimeTS(struct timespec *ts)
   double timestamp = -1.0;
   int rc = NOERROR;
 
+  if (defaultWallClockType == CLOCK_RDTSC)
+    return getTSCTime(CLOCK_REALTIME, ts);
   rc = clock_gettime(CLOCK_REALTIME, ts);
 
   if (rc==NOERROR) { 
@@ -456,6 +475,11 @@ double getTimestamp(struct timespec *ts)
   double timestamp = -1.0;
   int rc = NOERROR;
 
+  if (defaultTimestampClockType == CLOCK_RDTSC) {
+    getTSCTime(CLOCK_MONOTONIC, ts);
+    return (double)ts->tv_sec + ((double)ts->tv_nsec)/1000000000;
+  }
+
   //likely Use clock_gettime with clock CLOCK_MONOTONIC
   if (defaultTimestampClockSource != CLOCK_MONOTONIC) {
     printf("getTimestamp():  error, clocksource not CLOCK_MONOTONIC  (%d,%d)\n",
@@ -504,6 +528,9 @@ double getTimestampD()
   struct timespec ts;
   int rc = NOERROR;
 
+  if (defaultTimestampClockType == CLOCK_RDTSC)
+    return getTSCTimeD(CLOCK_MONOTONIC);
+
   //timestampType is a variable maintained by this module
   if (defaultTimestampClockSource != CLOCK_MONOTONIC) {
     printf("getTimestampD():  error, clocksource not CLOCK_MONOTONIC  (%d,%d)\n",
@@ -549,6 +576,9 @@ int getTimestampTS(struct timespec *ts)
   double timestamp = -1.0;
   int rc = NOERROR;
 
+  if (defaultTimestampClockType == CLOCK_RDTSC)
+    return getTSCTime(CLOCK_MONOTONIC, ts);
+
   //likely Use clock_gettime with clock CLOCK_MONOTONIC_RAW:
   if (defaultTimestampClockSource != CLOCK_MONOTONIC) {
     printf("getTimestampTS():  error, clocksource not CLOCK_MONOTONIC  (%d,%d)\n",
@@ -575,6 +605,7 @@ int getTimestampTS(struct timespec *ts)
 * Function: int getTime(clock_t clockSource, struct timespec *ts)
 *
 * Explanation:  maps directly to clock_gettime()
+*               (CLOCK_RDTSC: the TSC clock source, as CLOCK_MONOTONIC_RAW)
 *
 * inputs: 
 *   clock_t clockSource : desired clockSrc
@@ -590,6 +621,8 @@ int getTimestampTS(struct timespec *ts)
 int getTime(clock_t clockSource, struct timespec *ts)
 {
   int rc = NOERROR;
+  if (clockSource == CLOCK_RDTSC)
+    return getTSCTime(CLOCK_RDTSC, ts);
   rc = clock_gettime(clockSource,  ts);
   if (rc == -1) { 
     rc = ERROR;
@@ -603,6 +636,7 @@ int getTime(clock_t clockSource, struct timespec *ts)
 * Function: double getTimeD(clock_t clockSource)
 *
 * Explanation:  returns clock_gettime() as a double
+*               (CLOCK_RDTSC: the TSC clock source, as CLOCK_MONOTONIC_RAW)
 *
 * inputs: 
 *   clock_t clockSource : desired clockSrc
@@ -620,6 +654,8 @@ double getTimeD(clock_t clockSource)
   int rc = NOERROR;
   struct timespec ts;
 
+  if (clockSource == CLOCK_RDTSC)
+    return getTSCTimeD(CLOCK_RDTSC);
 //DARWIN 
 //  uint64_t  clock_gettime_nsec_np(clockSource);
   rc = clock_gettime(clockSource,  &ts);
@@ -1180,15 +1216,20 @@ int getClockInfo(char *bufPtr, int maxSize)
 * inputs: 
 *     clocktype_t wallClockType
 *
-* outputs:  Returns NOERROR 
+* outputs:  Returns NOERROR, ERROR if CLOCK_RDTSC and the TSC
+*           can not be calibrated
 *
 * notes: 
+*    CLOCK_RDTSC: the wallclock routines read the TSC (calibrated
+*    here the first time it is selected)
 *
 ***********************************************************/
 int setDefaultWallClockType(clocktype_t wallClockType)
 {
   int rc = NOERROR;
 
+  if ((wallClockType == CLOCK_RDTSC) && !isTSCCalibrated() && (calibrateTSC() == ERROR))
+    return ERROR;
   defaultWallClockType = wallClockType;
 
   return rc;
@@ -1224,14 +1265,19 @@ int setDefaultWallClockSource(clock_t wallClockSource)
 * inputs: 
 *    clock_t timestampClockSource
 *
-* outputs:  Returns NOERROR 
+* outputs:  Returns NOERROR, ERROR if CLOCK_RDTSC and the TSC
+*           can not be calibrated
 *
 * notes: 
+*    CLOCK_RDTSC: the timestamp routines read the TSC (calibrated
+*    here the first time it is selected)
 *
 ***********************************************************/
 int setDefaultTimestampClockType(clocktype_t timestampType)
 {
   int rc = NOERROR;
+  if ((timestampType == CLOCK_RDTSC) && !isTSCCalibrated() && (calibrateTSC() == ERROR))
+    return ERROR;
   defaultTimestampClockType = timestampType;
   return rc;
 }
@@ -1797,12 +1843,367 @@ uint32_t getMicroseconds(struct timeval *t)
 
 
 
+/******************************************************************
+*
+* SET 9: the TSC clock source (clockRDTSC / CLOCK_RDTSC)
+*
+*          bool isInvariantTSC()
+*          int calibrateTSC()
+*          int recalibrateTSC()
+*          int startTSCRecalibration()
+*          void stopTSCRecalibration()
+*          bool isTSCCalibrated()
+*          double getTSCFrequency()
+*          int getTSCTime(clock_t clockSource, struct timespec *ts)
+*          double getTSCTimeD(clock_t clockSource)
+*
+*  A TSC time is  base + (rdtsc() - tscBase) * mult >> TSC_SHIFT  ns.
+*  The rate (mult) is measured against CLOCK_MONOTONIC_RAW.  The bases
+*  of the three clocks a TSC time can stand in for (MONOTONIC_RAW,
+*  MONOTONIC and REALTIME) are sampled at each (re)calibration, so the
+*  MONOTONIC and REALTIME times follow any NTP slew with a lag of about
+*  TSC_RECALIBRATION_INTERVAL.
+*
+*  The TSC is calibrated only when CLOCK_RDTSC is selected.  The
+*  recalibration thread (startTSCRecalibration) redoes it every
+*  TSC_RECALIBRATION_INTERVAL, off the send/receive paths:  a reader
+*  only copies the calibration, which is protected by a sequence
+*  count (seqlock) so any thread may read.
+*
+*****************************************************************/
+
+typedef struct {
+  uint64_t tscBase;
+  int64_t  rawBase;        //ns:  CLOCK_MONOTONIC_RAW at tscBase
+  int64_t  monoOffset;     //ns:  CLOCK_MONOTONIC - CLOCK_MONOTONIC_RAW
+  int64_t  realOffset;     //ns:  CLOCK_REALTIME - CLOCK_MONOTONIC_RAW
+  uint64_t mult;           //ns = ticks * mult >> TSC_SHIFT
+} tscCalibration;
+
+static tscCalibration tscCal;
+static uint32_t tscSeq = 0;               //odd: an update is in progress
+static bool tscCalibrated = false;
+//The first calibration point: the rate is measured over the time since
+static uint64_t tscAnchor = 0;
+static int64_t rawAnchor = 0;
+static pthread_t tscRecalThread;
+static bool isTSCRecalRunning = false;
+
+/*************************************************************
+* Function: bool isInvariantTSC()
+*
+* Summary: returns true if the CPU has an invariant TSC
+*          (CPUID.80000007H:EDX[8]), one whose rate does not change
+*          with the CPU frequency or stop in deep C-states
+*
+**********************************************************/
+bool isInvariantTSC()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  uint32_t eax = 0, ebx = 0, ecx = 0, edx = 0;
+
+  if (__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) == 0)
+    return false;
+  if (eax < 0x80000007)
+    return false;
+  __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+  return ((edx & (1 << 8)) != 0);
+#else
+  return false;
+#endif
+}
+
+/*************************************************************
+* Function: static int64_t sampleTSCPair(clockid_t clockSource, uint64_t *tscPtr)
+*
+* Summary: reads a clock and the TSC at (nearly) the same instant.
+*          Of TSC_CALIBRATION_TRIES reads, the one that the two
+*          rdtsc's around it are closest keeps the least error.
+*
+* outputs: returns the clock (ns), sets *tscPtr to the matching TSC
+*
+**********************************************************/
+static int64_t sampleTSCPair(clockid_t clockSource, uint64_t *tscPtr)
+{
+  struct timespec ts;
+  uint64_t t0, t1;
+  uint64_t bestSpan = UINT64_MAX;
+  int64_t ns = 0;
+  int i;
+
+  for (i = 0; i < TSC_CALIBRATION_TRIES; i++) {
+    t0 = rdtsc();
+    clock_gettime(clockSource, &ts);
+    t1 = rdtsc();
+    if ((t1 - t0) < bestSpan) {
+      bestSpan = t1 - t0;
+      *tscPtr = t0 + (t1 - t0) / 2;
+      ns = (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+    }
+  }
+  return ns;
+}
+
+/*************************************************************
+* Function: static void sampleTSCCalibration(tscCalibration *c)
+*
+* Summary: samples the three clocks against the TSC and sets the
+*          bases of c.  c->mult must be set.
+*
+**********************************************************/
+static void sampleTSCCalibration(tscCalibration *c)
+{
+  uint64_t tscMono, tscReal;
+  int64_t mono, real;
+
+  c->rawBase = sampleTSCPair(CLOCK_MONOTONIC_RAW, &c->tscBase);
+  mono = sampleTSCPair(CLOCK_MONOTONIC, &tscMono);
+  real = sampleTSCPair(CLOCK_REALTIME, &tscReal);
+  //Each clock as if it was read at tscBase
+  c->monoOffset = mono - (int64_t)(((__int128)(tscMono - c->tscBase) * c->mult) >> TSC_SHIFT) - c->rawBase;
+  c->realOffset = real - (int64_t)(((__int128)(tscReal - c->tscBase) * c->mult) >> TSC_SHIFT) - c->rawBase;
+}
+
+/*************************************************************
+* Function: int calibrateTSC()
+*
+* Summary: measures the TSC rate against CLOCK_MONOTONIC_RAW over
+*          TSC_CALIBRATION_TIME seconds and enables the TSC clock
+*          source.  Called when CLOCK_RDTSC is first selected
+*          (setDefaultWallClockType, setDefaultTimestampClockType).
+*
+* outputs: returns ERROR (no invariant TSC) or NOERROR
+*
+**********************************************************/
+int calibrateTSC()
+{
+  struct timespec wait = {0, (long)(TSC_CALIBRATION_TIME * 1000000000)};
+  tscCalibration c;
+  uint64_t tsc1;
+  int64_t raw1;
+
+  if (!isInvariantTSC())
+    return ERROR;
+  rawAnchor = sampleTSCPair(CLOCK_MONOTONIC_RAW, &tscAnchor);
+  nanosleep(&wait, NULL);
+  raw1 = sampleTSCPair(CLOCK_MONOTONIC_RAW, &tsc1);
+  if ((tsc1 <= tscAnchor) || (raw1 <= rawAnchor))
+    return ERROR;
+
+  c.mult = (uint64_t)((((unsigned __int128)(raw1 - rawAnchor)) << TSC_SHIFT) / (tsc1 - tscAnchor));
+  sampleTSCCalibration(&c);
+  tscCal = c;
+  __atomic_store_n(&tscCalibrated, true, __ATOMIC_RELEASE);
+#ifdef TRACEME
+  printf("calibrateTSC: %f MHz \n", getTSCFrequency() / 1000000.0);
+#endif
+  return NOERROR;
+}
+
+/*************************************************************
+* Function: int recalibrateTSC()
+*
+* Summary: measures the rate again (over the whole time since the
+*          first calibration) and resamples the bases.  If another
+*          thread is already doing so, returns at once.
+*
+* outputs: returns ERROR (not calibrated) or NOERROR
+*
+**********************************************************/
+int recalibrateTSC()
+{
+  uint32_t seq = __atomic_load_n(&tscSeq, __ATOMIC_RELAXED);
+  tscCalibration c;
+  uint64_t tsc1;
+  int64_t raw1;
+
+  if (!isTSCCalibrated())
+    return ERROR;
+  if ((seq & 1) || !__atomic_compare_exchange_n(&tscSeq, &seq, seq + 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+    return NOERROR;
+  raw1 = sampleTSCPair(CLOCK_MONOTONIC_RAW, &tsc1);
+  c = tscCal;
+  if ((tsc1 > tscAnchor) && (raw1 > rawAnchor))
+    c.mult = (uint64_t)((((unsigned __int128)(raw1 - rawAnchor)) << TSC_SHIFT) / (tsc1 - tscAnchor));
+  sampleTSCCalibration(&c);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  tscCal = c;
+  __atomic_store_n(&tscSeq, seq + 2, __ATOMIC_RELEASE);
+  return NOERROR;
+}
+
+/*************************************************************
+* Function: static void *tscRecalLoop(void *arg)
+*
+* Summary: the recalibration thread.  Sleeps, recalibrates.  It is
+*          cancelled by stopTSCRecalibration while it sleeps
+*          (nanosleep is a cancellation point).
+*
+**********************************************************/
+static void *tscRecalLoop(void *arg)
+{
+  struct timespec interval;
+
+  interval.tv_sec = (time_t)TSC_RECALIBRATION_INTERVAL;
+  interval.tv_nsec = (long)((TSC_RECALIBRATION_INTERVAL - (double)interval.tv_sec) * 1000000000.0);
+  while (1) {
+    nanosleep(&interval, NULL);
+    recalibrateTSC();
+  }
+  return NULL;
+}
+
+/*************************************************************
+* Function: int startTSCRecalibration()
+*
+* Summary: starts the thread that recalibrates the TSC every
+*          TSC_RECALIBRATION_INTERVAL.  Does nothing if the TSC is
+*          not calibrated (CLOCK_RDTSC was not selected).
+*
+* outputs: returns ERROR or NOERROR
+*
+* notes:
+*   Like the other helper threads, the caller starts it with
+*   SIGINT blocked.
+*
+**********************************************************/
+int startTSCRecalibration()
+{
+  int rc = 0;
+
+  if (!isTSCCalibrated() || isTSCRecalRunning)
+    return NOERROR;
+  rc = pthread_create(&tscRecalThread, NULL, tscRecalLoop, NULL);
+  if (rc != 0) {
+    printf("startTSCRecalibration: pthread_create failed rc:%d \n", rc);
+    return ERROR;
+  }
+  isTSCRecalRunning = true;
+  return NOERROR;
+}
+
+/*************************************************************
+* Function: void stopTSCRecalibration()
+*
+* Summary: stops the recalibration thread (if running).  The
+*          TSC clock source remains usable.
+*
+**********************************************************/
+void stopTSCRecalibration()
+{
+  if (isTSCRecalRunning) {
+    pthread_cancel(tscRecalThread);
+    pthread_join(tscRecalThread, NULL);
+    isTSCRecalRunning = false;
+  }
+}
+
+/*************************************************************
+* Function: bool isTSCCalibrated()
+*
+* Summary: returns true if the TSC clock source can be used
+*
+**********************************************************/
+bool isTSCCalibrated()
+{
+  return __atomic_load_n(&tscCalibrated, __ATOMIC_ACQUIRE);
+}
+
+/*************************************************************
+* Function: double getTSCFrequency()
+*
+* Summary: returns the measured TSC rate (Hz), 0.0 if not calibrated
+*
+**********************************************************/
+double getTSCFrequency()
+{
+  if (!isTSCCalibrated() || (tscCal.mult == 0))
+    return 0.0;
+  return 1000000000.0 * (double)(1ULL << TSC_SHIFT) / (double)tscCal.mult;
+}
+
+/*************************************************************
+* Function: static inline int64_t getTSCNsec(clock_t clockSource)
+*
+* Summary: returns the TSC time (ns) of a clock
+*
+* Inputs:
+*   clock_t clockSource: CLOCK_MONOTONIC_RAW, CLOCK_MONOTONIC or CLOCK_REALTIME
+*
+**********************************************************/
+static inline int64_t getTSCNsec(clock_t clockSource)
+{
+  tscCalibration c;
+  uint32_t seq;
+  uint64_t now;
+  int64_t delta;
+
+  do {
+    seq = __atomic_load_n(&tscSeq, __ATOMIC_ACQUIRE);
+    c = tscCal;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  } while ((seq & 1) || (seq != __atomic_load_n(&tscSeq, __ATOMIC_RELAXED)));
+
+  now = rdtsc();
+  //(signed) a core's TSC can be a few ticks behind the base
+  delta = (int64_t)(now - c.tscBase);
+  delta = (int64_t)(((__int128)delta * (__int128)c.mult) >> TSC_SHIFT) + c.rawBase;
+  if (clockSource == CLOCK_MONOTONIC)
+    delta += c.monoOffset;
+  else if (clockSource == CLOCK_REALTIME)
+    delta += c.realOffset;
+  return delta;
+}
+
+/*************************************************************
+* Function: int getTSCTime(clock_t clockSource, struct timespec *ts)
+*
+* Summary: the TSC clock source's version of clock_gettime
+*
+* Inputs:
+*   clock_t clockSource: the clock the time stands in for:
+*         CLOCK_MONOTONIC_RAW (also CLOCK_RDTSC), CLOCK_MONOTONIC or CLOCK_REALTIME
+*   struct timespec *ts:  callers timespec to be filled in
+*
+* outputs:  returns ERROR (not calibrated) or NOERROR
+*
+**********************************************************/
+int getTSCTime(clock_t clockSource, struct timespec *ts)
+{
+  int64_t ns;
+
+  if (!isTSCCalibrated())
+    return ERROR;
+  ns = getTSCNsec(clockSource);
+  ts->tv_sec = ns / 1000000000;
+  ts->tv_nsec = ns % 1000000000;
+  return NOERROR;
+}
+
+/*************************************************************
+* Function: double getTSCTimeD(clock_t clockSource)
+*
+* Summary: as getTSCTime, returns the time as a double (secs)
+*          or -1.0 if not calibrated
+*
+**********************************************************/
+double getTSCTimeD(clock_t clockSource)
+{
+  int64_t ns;
+
+  if (!isTSCCalibrated())
+    return -1.0;
+  ns = getTSCNsec(clockSource);
+  return (double)(ns / 1000000000) + (double)(ns % 1000000000) / 1000000000;
+}
+
+
 /******************************************************************
 *
 * SET 10: functions that are experimental or not used (yet) 
 *
 *
-*          uint64_t rdtsc(void)
+*          uint64_t rdtsc(void)    (used by the TSC clock source)
 *          uint64_t tsc() 
 *          uint64_t glibc_nsec(uint64_t tsc, uint64_t freq) 
 *          uint64_t clockCycleCount()
@@ -1823,6 +2224,7 @@ uint32_t getMicroseconds(struct timeval *t)
 * Inputs:  
 *
 * outputs:returns the counter value - it is in units of 'CPU cycles'
+*         0 if the CPU is not x86 
 *
 * Notes:
 *   To convert to nanoseconds:
@@ -1862,17 +2264,15 @@ uint64_t rdtsc(void)
 {
     uint32_t low =0;
     uint32_t high =0;
-//    asm volatile("rdtsc":"=a"(low),"=d"(high));
+#if defined(__x86_64__) || defined(__i386__)
+    asm volatile("rdtsc":"=a"(low),"=d"(high));
+#endif
     return ((uint64_t)high << 32) | low;
 }
 
 uint64_t tsc() 
 {
-    uint32_t low =0;
-    uint32_t high =0;
-//  __asm__ __volatile__("rdtsc" : "=a" (low), "=d" (high));
-  uint64_t r=((uint64_t) high<<32) | low;
-  return r;
+  return rdtsc();
 }
 
 
@@ -1949,6 +2349,8 @@ double testGetTime(clock_t clockType)
 #endif
           rcTimestamp = -1.0;
         }
+        else if (isTSCCalibrated())
+          rcTimestamp = getTSCTimeD(CLOCK_RDTSC);
         else{
           rcTimestamp = (double) (((double) glibc_nsec(tmpX, freq)) / 1000000000); 
         }
@@ -24,7 +24,11 @@
 *       to be a time that in the best case is exactly equal to a 
 *       what human's believe to be true time (UTC time).  
 *
-* Last update: 6/5/2019
+*       With an invariant TSC, CLOCK_RDTSC is a clock type that
+*       reads the TSC (calibrated against CLOCK_MONOTONIC_RAW when
+*       it is selected) in place of clock_gettime.
+*
+* Last update: 10/17/2026
 *
 ************************************************************************/
 #ifndef	__timeHelper_h
@@ -202,6 +206,25 @@ uint32_t getTimeSpan(struct timeval *start_time, struct timeval *end_time);
 uint64_t getTimeSpanTS(struct timespec *start_time, struct timespec *end_time);
 uint32_t getMicroseconds(struct timeval *t);
 
+/********************************
+* Set 4: the TSC clock source
+***********************************/
+//TSC time = base + ((ticks * mult) >> TSC_SHIFT) ns
+#define TSC_SHIFT 32
+#define TSC_CALIBRATION_TIME 0.02         //seconds, when CLOCK_RDTSC is selected
+#define TSC_CALIBRATION_TRIES 8
+#define TSC_RECALIBRATION_INTERVAL 1.0    //seconds, by the recalibration thread
+
+bool isInvariantTSC();
+int calibrateTSC();
+int recalibrateTSC();
+int startTSCRecalibration();
+void stopTSCRecalibration();
+bool isTSCCalibrated();
+double getTSCFrequency();
+int getTSCTime(clock_t clockSource, struct timespec *ts);
+double getTSCTimeD(clock_t clockSource);
+
 /********************************
 * Set 5:Experimental or not used (yet) 
 ***********************************/
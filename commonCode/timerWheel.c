@@ -0,0 +1,434 @@
+/*********************************************************
+*
+* Module Name: timer wheel
+*
+* File Name:  timerWheel.c
+*
+* Summary:  A hierarchical timer wheel (Varghese and Lauck):
+*           O(1) add, cancel and expire of a large number of
+*           timers, e.g., the loss deadline of each probe in flight.
+*
+*  The methods include:
+*   timerWheel *createTimerWheel(double tickSize, double now);
+*   void freeTimerWheel(timerWheel *w);
+*   void initTimerEntry(timerEntry *t, uint64_t id);
+*   int timerWheelAdd(timerWheel *w, timerEntry *t, double expireTime);
+*   int timerWheelCancel(timerWheel *w, timerEntry *t);
+*   timerEntry *timerWheelExpire(timerWheel *w, double now);
+*   double timerWheelNextExpiry(timerWheel *w);
+*   int printTimerWheel(timerWheel *w, FILE *fileFID);
+*
+* Notes:
+*   A timer of tick E sits at the lowest level whose slots reach
+*   E from curTick:  level l slot (E >> (8 * l)) & 255.  The level
+*   l slots are cascaded (their timers re-added, so moved down) when
+*   curTick crosses a multiple of 256^l - the higher levels first.
+*
+* Last update: 10/17/2026
+*
+*********************************************************/
+#include "common.h"
+#include "timerWheel.h"
+
+//#define TRACEME 0
+
+/***********************************************************
+* Function: static inline timerEntry *getSlot(timerWheel *w, int level, uint32_t index)
+*
+* Explanation:  returns the sentinel of a slot
+*
+***********************************************************/
+static inline timerEntry *getSlot(timerWheel *w, int level, uint32_t index)
+{
+  return &w->slots[level][index];
+}
+
+/***********************************************************
+* Function: static inline uint32_t slotIndex(uint64_t tick, int level)
+*
+* Explanation:  returns the level's slot of a tick
+*
+***********************************************************/
+static inline uint32_t slotIndex(uint64_t tick, int level)
+{
+  return (uint32_t)(tick >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK;
+}
+
+/***********************************************************
+* Function: static int nextOccupied(timerWheel *w, int level, uint32_t from)
+*
+* Explanation:  returns the first non empty slot >= from of the
+*               level, -1 if there is none
+*
+***********************************************************/
+static int nextOccupied(timerWheel *w, int level, uint32_t from)
+{
+  uint32_t word;
+  uint64_t bits;
+
+  if (from >= TIMER_WHEEL_SLOTS)
+    return -1;
+  word = from / 64;
+  bits = w->occupied[level][word] & (~0ULL << (from % 64));
+  while (bits == 0) {
+    if (++word == TIMER_WHEEL_SLOTS / 64)
+      return -1;
+    bits = w->occupied[level][word];
+  }
+  return (int)(word * 64 + __builtin_ctzll(bits));
+}
+
+/***********************************************************
+* Function: static void linkTimer(timerWheel *w, timerEntry *t)
+*
+* Explanation:  puts a timer in the slot of its expireTick
+*               (clamped to the ticks the wheel reaches)
+*
+***********************************************************/
+static void linkTimer(timerWheel *w, timerEntry *t)
+{
+  uint64_t delta;
+  int level = 0;
+  uint32_t index;
+  timerEntry *head;
+
+  if (t->expireTick < w->curTick)
+    t->expireTick = w->curTick;
+  delta = t->expireTick - w->curTick;
+  while ((level < TIMER_WHEEL_LEVELS - 1) && (delta >= (1ULL << (TIMER_WHEEL_BITS * (level + 1)))))
+    level++;
+  if (delta >= (1ULL << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)))
+    t->expireTick = w->curTick + (1ULL << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) - 1;
+
+  index = slotIndex(t->expireTick, level);
+  head = getSlot(w, level, index);
+  t->next = head;
+  t->prev = head->prev;
+  head->prev->next = t;
+  head->prev = t;
+  w->occupied[level][index / 64] |= (1ULL << (index % 64));
+}
+
+/***********************************************************
+* Function: static void unlinkTimer(timerWheel *w, timerEntry *t)
+*
+* Explanation:  removes a timer from its slot
+*
+***********************************************************/
+static void unlinkTimer(timerWheel *w, timerEntry *t)
+{
+  timerEntry *next = t->next;
+
+  t->prev->next = next;
+  next->prev = t->prev;
+  t->next = NULL;
+  t->prev = NULL;
+  //Was it the last of its slot?  The sentinels are inside the slots array.
+  if ((next == next->next) && (next >= &w->slots[0][0]) &&
+      (next <= &w->slots[TIMER_WHEEL_LEVELS - 1][TIMER_WHEEL_MASK])) {
+    uint32_t position = (uint32_t)(next - &w->slots[0][0]);
+    w->occupied[position / TIMER_WHEEL_SLOTS][(position % TIMER_WHEEL_SLOTS) / 64] &=
+      ~(1ULL << ((position % TIMER_WHEEL_SLOTS) % 64));
+  }
+}
+
+/***********************************************************
+* Function: static void cascadeSlot(timerWheel *w, int level, uint32_t index)
+*
+* Explanation:  re-adds the timers of a slot (they move down)
+*
+***********************************************************/
+static void cascadeSlot(timerWheel *w, int level, uint32_t index)
+{
+  timerEntry *head = getSlot(w, level, index);
+  timerEntry *t;
+  timerEntry *list;
+
+  if (head->next == head)
+    return;
+  //Take the whole list off the slot first
+  list = head->next;
+  head->prev->next = NULL;
+  head->next = head;
+  head->prev = head;
+  w->occupied[level][index / 64] &= ~(1ULL << (index % 64));
+  while (list != NULL) {
+    t = list;
+    list = list->next;
+    linkTimer(w, t);
+    w->numberCascaded++;
+  }
+}
+
+/***********************************************************
+* Function: static void cascade(timerWheel *w)
+*
+* Explanation:  curTick starts a level 0 turn:  cascades the
+*               due slot of each level that also turns
+*               (the highest first so its timers can move down
+*               more than one level)
+*
+***********************************************************/
+static void cascade(timerWheel *w)
+{
+  int top = 1;
+  int level;
+
+  while ((top < TIMER_WHEEL_LEVELS - 1) && (slotIndex(w->curTick, top) == 0))
+    top++;
+  for (level = top; level >= 1; level--)
+    cascadeSlot(w, level, slotIndex(w->curTick, level));
+}
+
+/***********************************************************
+* Function: static void advanceTo(timerWheel *w, uint64_t tick)
+*
+* Explanation:  moves curTick.  The start of a level 0 turn is
+*               cascaded at once so the timers of the turn are
+*               on level 0 (timerWheelNextExpiry sees them).
+*
+***********************************************************/
+static void advanceTo(timerWheel *w, uint64_t tick)
+{
+  w->curTick = tick;
+  if ((tick & TIMER_WHEEL_MASK) == 0)
+    cascade(w);
+}
+
+/***********************************************************
+* Function: timerWheel *createTimerWheel(double tickSize, double now)
+*
+* Explanation:  creates an empty wheel.  The caller owns it.
+*
+* inputs:
+*   double tickSize : seconds per tick (the expiry resolution)
+*   double now : the current timestamp (tick 0)
+*
+* outputs:
+*    returns the wheel or NULL on error
+*
+***********************************************************/
+timerWheel *createTimerWheel(double tickSize, double now)
+{
+  timerWheel *w = NULL;
+  int level, index;
+
+  if (tickSize <= 0.0) {
+    printf("createTimerWheel: bad tickSize %f \n", tickSize);
+    return NULL;
+  }
+  w = calloc(1, sizeof(timerWheel));
+  if (w == NULL)
+    return NULL;
+  w->tickSize = tickSize;
+  w->origin = now;
+  for (level = 0; level < TIMER_WHEEL_LEVELS; level++)
+    for (index = 0; index < TIMER_WHEEL_SLOTS; index++) {
+      w->slots[level][index].next = &w->slots[level][index];
+      w->slots[level][index].prev = &w->slots[level][index];
+    }
+  return w;
+}
+
+/***********************************************************
+* Function: void freeTimerWheel(timerWheel *w)
+*
+* Explanation:  frees the wheel (not the timers it holds)
+*
+***********************************************************/
+void freeTimerWheel(timerWheel *w)
+{
+  free(w);
+}
+
+/***********************************************************
+* Function: void initTimerEntry(timerEntry *t, uint64_t id)
+*
+* Explanation:  inits a (not armed) timer
+*
+***********************************************************/
+void initTimerEntry(timerEntry *t, uint64_t id)
+{
+  memset(t, 0, sizeof(timerEntry));
+  t->id = id;
+}
+
+/***********************************************************
+* Function: int timerWheelAdd(timerWheel *w, timerEntry *t, double expireTime)
+*
+* Explanation:  arms a timer (re-arms it if it is armed)
+*
+* inputs:
+*   timerEntry *t : the caller's timer
+*   double expireTime : a timestamp (a time already past
+*                       expires at the next timerWheelExpire)
+*
+* outputs:
+*    returns ERROR or NOERROR
+*
+***********************************************************/
+int timerWheelAdd(timerWheel *w, timerEntry *t, double expireTime)
+{
+  double ticks = ceil((expireTime - w->origin) / w->tickSize);
+
+  if (t->armed)
+    timerWheelCancel(w, t);
+  t->expireTick = (ticks > 0.0) ? (uint64_t)ticks : 0;
+  t->armed = true;
+  linkTimer(w, t);
+  w->numberTimers++;
+  w->numberAdds++;
+  return NOERROR;
+}
+
+/***********************************************************
+* Function: int timerWheelCancel(timerWheel *w, timerEntry *t)
+*
+* Explanation:  disarms a timer
+*
+* outputs:
+*    returns ERROR (not armed) or NOERROR
+*
+***********************************************************/
+int timerWheelCancel(timerWheel *w, timerEntry *t)
+{
+  if (!t->armed)
+    return ERROR;
+  unlinkTimer(w, t);
+  t->armed = false;
+  w->numberTimers--;
+  w->numberCancels++;
+  return NOERROR;
+}
+
+/***********************************************************
+* Function: timerEntry *timerWheelExpire(timerWheel *w, double now)
+*
+* Explanation:  expires every timer whose tick is <= now's
+*
+* outputs:
+*    returns the expired timers (disarmed) as a list linked by
+*    next (NULL: none).  Read a timer's next before re-adding it.
+*
+* notes:
+*   The empty ticks are skipped with the level 0 bitmap:  the
+*   work is O(number expired + 256 tick turns passed).
+*
+***********************************************************/
+timerEntry *timerWheelExpire(timerWheel *w, double now)
+{
+  timerEntry *expired = NULL;
+  timerEntry *t;
+  timerEntry *head;
+  double ticks = floor((now - w->origin) / w->tickSize);
+  uint64_t targetTick = (ticks > 0.0) ? (uint64_t)ticks : 0;
+  uint64_t nextTick;
+  int index;
+
+  while (w->curTick <= targetTick) {
+    if (w->numberTimers == 0) {
+      w->curTick = targetTick + 1;
+      break;
+    }
+    //The next non empty level 0 slot of this turn
+    index = nextOccupied(w, 0, (uint32_t)(w->curTick & TIMER_WHEEL_MASK));
+    if (index < 0)
+      nextTick = (w->curTick | TIMER_WHEEL_MASK) + 1;
+    else
+      nextTick = (w->curTick & ~(uint64_t)TIMER_WHEEL_MASK) + (uint64_t)index;
+    if (nextTick > targetTick) {
+      advanceTo(w, targetTick + 1);
+      break;
+    }
+    if (index < 0) {
+      advanceTo(w, nextTick);
+      continue;
+    }
+    w->curTick = nextTick;
+
+    head = getSlot(w, 0, (uint32_t)index);
+    while (head->next != head) {
+      t = head->next;
+      unlinkTimer(w, t);
+      t->armed = false;
+      w->numberTimers--;
+      w->numberExpired++;
+      t->next = expired;
+      expired = t;
+    }
+    advanceTo(w, w->curTick + 1);
+  }
+  return expired;
+}
+
+/***********************************************************
+* Function: double timerWheelNextExpiry(timerWheel *w)
+*
+* Explanation:  returns when timerWheelExpire should be called
+*               next:  the time of the next timer of the level 0
+*               wheel or, if the timers are further out, the time
+*               their slot is cascaded down (no later than their
+*               expiry).  -1.0 if there are no timers.
+*
+***********************************************************/
+double timerWheelNextExpiry(timerWheel *w)
+{
+  uint64_t base = w->curTick & ~(uint64_t)TIMER_WHEEL_MASK;
+  uint64_t bestTick = UINT64_MAX;
+  uint64_t tick;
+  uint32_t current;
+  int level;
+  int index;
+
+  if (w->numberTimers == 0)
+    return DOUBLE_ERROR;
+
+  //Level 0:  the rest of this turn, then the start of the next one
+  current = (uint32_t)(w->curTick & TIMER_WHEEL_MASK);
+  index = nextOccupied(w, 0, current);
+  if (index >= 0)
+    return w->origin + (double)(base + (uint64_t)index) * w->tickSize;
+  index = nextOccupied(w, 0, 0);
+  if (index >= 0)
+    bestTick = base + TIMER_WHEEL_SLOTS + (uint64_t)index;
+
+  //Higher levels:  the next slot (after the current one) to be cascaded
+  for (level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+    uint64_t span = 1ULL << (TIMER_WHEEL_BITS * level);
+    uint64_t levelBase = (w->curTick >> (TIMER_WHEEL_BITS * level)) << (TIMER_WHEEL_BITS * level);
+    current = slotIndex(w->curTick, level);
+    index = nextOccupied(w, level, current + 1);
+    if (index >= 0)
+      tick = levelBase + (uint64_t)(index - (int)current) * span;
+    else {
+      index = nextOccupied(w, level, 0);
+      if (index < 0)
+        continue;
+      tick = levelBase + (uint64_t)(index + TIMER_WHEEL_SLOTS - (int)current) * span;
+    }
+    //The turn of this level is cascaded when the lower levels wrap
+    tick &= ~(span - 1);
+    if (tick < bestTick)
+      bestTick = tick;
+  }
+  return w->origin + (double)bestTick * w->tickSize;
+}
+
+/***********************************************************
+* Function: int printTimerWheel(timerWheel *w, FILE *fileFID)
+*
+* Explanation:  prints the wheel's counters (one line)
+*
+* outputs:
+*    returns ERROR or NOERROR
+*
+***********************************************************/
+int printTimerWheel(timerWheel *w, FILE *fileFID)
+{
+  if ((w == NULL) || (fileFID == NULL))
+    return ERROR;
+  fprintf(fileFID, "timer wheel: tick:%1.9f pending:%d adds:%lu cancels:%lu expired:%lu cascaded:%lu \n",
+          w->tickSize, w->numberTimers, (unsigned long)w->numberAdds, (unsigned long)w->numberCancels,
+          (unsigned long)w->numberExpired, (unsigned long)w->numberCascaded);
+  return NOERROR;
+}
@@ -0,0 +1,78 @@
+/************************************************************************
+* File:  timerWheel.h
+*
+* Purpose:
+*   This include file is for the timerWheel module:  a hierarchical
+*   timer wheel.  Adding, cancelling and expiring a timer are O(1)
+*   however many timers are pending (e.g., the loss deadlines of
+*   every probe in flight).
+*
+*   timerWheel *createTimerWheel(double tickSize, double now);
+*   void freeTimerWheel(timerWheel *w);
+*   void initTimerEntry(timerEntry *t, uint64_t id);
+*   int timerWheelAdd(timerWheel *w, timerEntry *t, double expireTime);
+*   int timerWheelCancel(timerWheel *w, timerEntry *t);
+*   timerEntry *timerWheelExpire(timerWheel *w, double now);
+*   double timerWheelNextExpiry(timerWheel *w);
+*   int printTimerWheel(timerWheel *w, FILE *fileFID);
+*
+* Notes:
+*   Times are timestamps (getTimestampD:  CLOCK_MONOTONIC or the TSC)
+*   cut into ticks of tickSize seconds.  A timer expires in the first
+*   timerWheelExpire at or after its tick (never early, at most a
+*   tick late).
+*   TIMER_WHEEL_LEVELS wheels of TIMER_WHEEL_SLOTS slots:  level 0 holds
+*   the timers of the next 256 ticks, level 1 those of the next 256^2
+*   ticks ...  When level 0 wraps, the level 1 slot that is due is moved
+*   (cascaded) down.  Timers further out than 256^4 ticks are clamped.
+*   Each level keeps a bitmap of its non empty slots so empty ticks
+*   are skipped.
+*   The timer entries belong to the caller (e.g., embedded in its
+*   records):  the wheel only links them.
+*   A wheel is not thread safe.
+*
+* Last update: 10/17/2026
+*
+*************************************************************************/
+#ifndef	__timerWheel_h
+#define	__timerWheel_h
+
+#include "common.h"
+
+#define TIMER_WHEEL_LEVELS 4
+#define TIMER_WHEEL_BITS 8
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SLOTS - 1)
+
+typedef struct timerEntry {
+  struct timerEntry *next;
+  struct timerEntry *prev;
+  uint64_t expireTick;
+  uint64_t id;                 //the caller's (e.g., a seq number)
+  bool armed;
+} timerEntry;
+
+typedef struct {
+  double tickSize;             //seconds
+  double origin;               //the time of tick 0 (when created)
+  uint64_t curTick;            //the ticks before it have been expired
+  uint32_t numberTimers;
+  //Each slot is a circular list headed by a sentinel
+  timerEntry slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+  uint64_t occupied[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS / 64];
+  uint64_t numberAdds;
+  uint64_t numberCancels;
+  uint64_t numberExpired;
+  uint64_t numberCascaded;
+} timerWheel;
+
+timerWheel *createTimerWheel(double tickSize, double now);
+void freeTimerWheel(timerWheel *w);
+void initTimerEntry(timerEntry *t, uint64_t id);
+int timerWheelAdd(timerWheel *w, timerEntry *t, double expireTime);
+int timerWheelCancel(timerWheel *w, timerEntry *t);
+timerEntry *timerWheelExpire(timerWheel *w, double now);
+double timerWheelNextExpiry(timerWheel *w);
+int printTimerWheel(timerWheel *w, FILE *fileFID);
+
+#endif
@@ -0,0 +1,284 @@
+/*********************************************************
+*
+* Module Name: binary trace logger
+*
+* File Name:  traceLogger.c
+*
+* Summary:  The per packet trace is written to a file by a
+*           background thread.  The programs log fixed size records
+*           into per producer SPSC rings (traceLog, an inline in
+*           traceLogger.h); the writer thread moves whatever the
+*           rings hold to the file with one writev per pass.
+*
+*       int startTraceLogger(const char *fileName, uint32_t numberProducers, uint32_t ringSize);
+*       void stopTraceLogger();
+*       uint64_t getTraceDrops();
+*
+* Notes:
+*   The records are written from the ring memory (no copy).  A
+*   ring's records leave the ring in order, records of different
+*   producers are interleaved in the order the writer visits them.
+*
+* Last update: 10/17/2026
+*
+*********************************************************/
+#include "common.h"
+#include "traceLogger.h"
+#include <sys/uio.h>
+
+//#define TRACEME 0
+
+//Writer sleeps this long when the rings are empty (1 ms)
+#define TRACE_WRITER_IDLE_NSECS 1000000
+
+traceRing *traceRings = NULL;
+uint32_t numberTraceRings = 0;
+
+static pthread_t writerThread;
+static int traceFD = -1;
+static _Atomic bool isWriterRunning = false;
+static uint64_t numberRecordsWritten = 0;
+
+/***********************************************************
+* Function: static int writeAll(struct iovec *iov, int iovcnt)
+*
+* Explanation:  writev that continues after a partial write
+*
+* outputs: returns ERROR or NOERROR
+*
+***********************************************************/
+static int writeAll(struct iovec *iov, int iovcnt)
+{
+  ssize_t n = 0;
+
+  while (iovcnt > 0) {
+    n = writev(traceFD, iov, iovcnt);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      perror("traceLogger: writev failed ");
+      return ERROR;
+    }
+    while ((iovcnt > 0) && ((size_t)n >= iov->iov_len)) {
+      n -= iov->iov_len;
+      iov++;
+      iovcnt--;
+    }
+    if (iovcnt > 0) {
+      iov->iov_base = (char *)iov->iov_base + n;
+      iov->iov_len -= n;
+    }
+  }
+  return NOERROR;
+}
+
+/***********************************************************
+* Function: static uint64_t drainRings()
+*
+* Explanation:  writes every record the rings hold (up to two
+*               iovecs per ring, the second when the ring wraps)
+*               and then releases the space to the producers.
+*
+* outputs: returns the number of records written
+*
+***********************************************************/
+static uint64_t drainRings()
+{
+  struct iovec iov[2 * MAX_TRACE_PRODUCERS];
+  uint64_t heads[MAX_TRACE_PRODUCERS];
+  uint64_t numberRecords = 0;
+  int iovcnt = 0;
+  uint32_t i;
+
+  for (i = 0; i < numberTraceRings; i++) {
+    traceRing *ring = &traceRings[i];
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    uint64_t first = tail & ring->mask;
+    uint64_t count = head - tail;
+    uint64_t toEnd = ring->mask + 1 - first;
+
+    heads[i] = head;
+    if (count == 0)
+      continue;
+    iov[iovcnt].iov_base = &ring->records[first];
+    iov[iovcnt].iov_len = ((count < toEnd) ? count : toEnd) * sizeof(traceRecord);
+    iovcnt++;
+    if (count > toEnd) {
+      iov[iovcnt].iov_base = &ring->records[0];
+      iov[iovcnt].iov_len = (count - toEnd) * sizeof(traceRecord);
+      iovcnt++;
+    }
+    numberRecords += count;
+  }
+
+  if (iovcnt == 0)
+    return 0;
+  writeAll(iov, iovcnt);
+  for (i = 0; i < numberTraceRings; i++)
+    atomic_store_explicit(&traceRings[i].tail, heads[i], memory_order_release);
+  numberRecordsWritten += numberRecords;
+  return numberRecords;
+}
+
+/***********************************************************
+* Function: static void *writerLoop(void *arg)
+*
+* Explanation:  the writer thread.  Drains the rings until
+*               stopTraceLogger clears isWriterRunning.
+*
+***********************************************************/
+static void *writerLoop(void *arg)
+{
+  struct timespec idleTS = {0, TRACE_WRITER_IDLE_NSECS};
+
+  while (atomic_load_explicit(&isWriterRunning, memory_order_acquire)) {
+    if (drainRings() == 0)
+      nanosleep(&idleTS, NULL);
+  }
+  return NULL;
+}
+
+/***********************************************************
+* Function: static void freeTraceRings(uint32_t numberAllocated)
+*
+* Explanation:  startTraceLogger error path: frees the rings
+*               and closes the file
+*
+***********************************************************/
+static void freeTraceRings(uint32_t numberAllocated)
+{
+  uint32_t i;
+
+  for (i = 0; i < numberAllocated; i++)
+    free(traceRings[i].records);
+  free(traceRings);
+  traceRings = NULL;
+  close(traceFD);
+  traceFD = -1;
+}
+
+/***********************************************************
+* Function: int startTraceLogger(const char *fileName, uint32_t numberProducers, uint32_t ringSize)
+*
+* Explanation:  creates the file, the rings and starts the
+*               writer thread.
+*
+* inputs:
+*   const char *fileName : the trace file (truncated)
+*   uint32_t numberProducers : 1 .. MAX_TRACE_PRODUCERS (e.g., server workers)
+*   uint32_t ringSize : records per ring, a power of 2
+*                       (0: TRACE_DEFAULT_RING_SIZE)
+*
+* outputs: returns ERROR or NOERROR
+*
+***********************************************************/
+int startTraceLogger(const char *fileName, uint32_t numberProducers, uint32_t ringSize)
+{
+  traceFileHeader header;
+  uint32_t i;
+  int rc = NOERROR;
+
+  if (ringSize == 0)
+    ringSize = TRACE_DEFAULT_RING_SIZE;
+  if ((fileName == NULL) || (traceRings != NULL) ||
+      (numberProducers == 0) || (numberProducers > MAX_TRACE_PRODUCERS) ||
+      ((ringSize & (ringSize - 1)) != 0)) {
+    printf("startTraceLogger: bad params producers:%d ringSize:%d \n", numberProducers, ringSize);
+    return ERROR;
+  }
+
+  traceFD = open(fileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (traceFD < 0) {
+    printf("startTraceLogger: failed to open %s, errno:%d \n", fileName, errno);
+    return ERROR;
+  }
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, TRACE_FILE_MAGIC, sizeof(header.magic));
+  header.version = TRACE_FILE_VERSION;
+  header.recordSize = sizeof(traceRecord);
+  header.startTime = getCurTimeD();
+  if (write(traceFD, &header, sizeof(header)) != sizeof(header)) {
+    printf("startTraceLogger: failed to write %s, errno:%d \n", fileName, errno);
+    close(traceFD);
+    traceFD = -1;
+    return ERROR;
+  }
+
+  traceRings = aligned_alloc(CACHE_LINE_SIZE, numberProducers * sizeof(traceRing));
+  if (traceRings == NULL) {
+    close(traceFD);
+    traceFD = -1;
+    return ERROR;
+  }
+  memset(traceRings, 0, numberProducers * sizeof(traceRing));
+  for (i = 0; i < numberProducers; i++) {
+    traceRings[i].mask = ringSize - 1;
+    traceRings[i].records = aligned_alloc(CACHE_LINE_SIZE, ringSize * sizeof(traceRecord));
+    if (traceRings[i].records == NULL) {
+      printf("startTraceLogger: failed to allocate %d records \n", ringSize);
+      freeTraceRings(i);
+      return ERROR;
+    }
+  }
+
+  atomic_store(&isWriterRunning, true);
+  rc = pthread_create(&writerThread, NULL, writerLoop, NULL);
+  if (rc != 0) {
+    printf("startTraceLogger: pthread_create failed rc:%d \n", rc);
+    atomic_store(&isWriterRunning, false);
+    freeTraceRings(numberProducers);
+    return ERROR;
+  }
+  //The producers see the rings only once they are ready
+  numberTraceRings = numberProducers;
+  return NOERROR;
+}
+
+/***********************************************************
+* Function: void stopTraceLogger()
+*
+* Explanation:  stops the writer, writes what remains in the
+*               rings and closes the file.
+*
+* notes:
+*   The rings are not freed: a producer that is still running
+*   (e.g., a server worker when the main thread handles the CNT-C)
+*   may keep logging until the process exits.  Its records stay
+*   in the ring (and are counted as drops once the ring is full).
+*
+***********************************************************/
+void stopTraceLogger()
+{
+  if (atomic_exchange(&isWriterRunning, false))
+    pthread_join(writerThread, NULL);
+  if ((traceFD != -1) && (traceRings != NULL))
+    drainRings();
+
+#ifdef TRACEME
+  printf("stopTraceLogger: %lu records written, %lu dropped \n",
+         (unsigned long)numberRecordsWritten, (unsigned long)getTraceDrops());
+#endif
+
+  if (traceFD != -1) {
+    close(traceFD);
+    traceFD = -1;
+  }
+}
+
+/***********************************************************
+* Function: uint64_t getTraceDrops()
+*
+* Explanation:  returns the number of records dropped because
+*               a ring was full
+*
+***********************************************************/
+uint64_t getTraceDrops()
+{
+  uint64_t drops = 0;
+  uint32_t i;
+
+  for (i = 0; i < numberTraceRings; i++)
+    drops += traceRings[i].drops;
+  return drops;
+}
@@ -0,0 +1,131 @@
+/************************************************************************
+* File:  traceLogger.h
+*
+* Purpose:
+*   This include file is for the traceLogger module.  The per packet
+*   trace (traceLevel 1) is logged as fixed size binary records.  Each
+*   producer (a thread that logs) has its own lock free single producer/
+*   single consumer ring.  A writer thread drains the rings to a file
+*   with large writes, so the send/receive path never does I/O.
+*
+*   int startTraceLogger(const char *fileName, uint32_t numberProducers, uint32_t ringSize);
+*   void stopTraceLogger();
+*   bool traceLog(uint32_t producer, const traceRecord *r);  (inline)
+*   uint64_t getTraceDrops();
+*
+* Notes:
+*   traceLog never blocks: if the ring is full the record is dropped
+*   (and counted).  The file is a traceFileHeader followed by records.
+*   traceToCSV converts a file to the CSV lines the programs print.
+*   The logger is started once per process.
+*
+* Last update: 10/17/2026
+*
+*************************************************************************/
+#ifndef	__traceLogger_h
+#define	__traceLogger_h
+
+#include "common.h"
+#include <stdatomic.h>
+
+#define TRACE_FILE_MAGIC "UDPPTRC1"
+#define TRACE_FILE_VERSION 1
+#define TRACE_DEFAULT_RING_SIZE 65536     //records per producer (power of 2)
+#define MAX_TRACE_PRODUCERS 256
+
+//recordType
+#define TRACE_CLIENT_RTT   1   //a reply matched to a probe (modes 0,1)
+#define TRACE_SERVER_RX    2   //a msg that arrived at the server
+
+//A 64 byte record.  Times are seconds (CLOCK_REALTIME or the
+//kernel/NIC stamp).  The CSV wallTime column is rxTime.
+typedef struct {
+  uint16_t recordType;
+  uint16_t source;        //producer: the server's worker ID, 0 for the client
+  uint32_t seq;
+  double   txTime;        //client: probe send time. server: the sender's header stamp
+  double   rxTime;        //arrival time of the reply (client) or msg (server)
+  uint32_t bytes;         //size of the reply/msg
+  int32_t  RSSI;
+  union {
+    struct {
+      double   OWD;             //reply arrival - the server's stamp
+      double   totalBytesSent;
+      uint32_t numberSent;
+      uint32_t numberPacketLoss;
+      int32_t  SignalQuality;
+      uint32_t unused;
+    } client;
+    struct {
+      double   totalBytesRxed;
+      uint32_t lastSeqNumber;
+      uint32_t numberMessages;
+      uint32_t outOfOrderArrivals;
+      uint32_t dropEstimate;
+      uint32_t numberIterations;
+      int32_t  SignalQuality;
+    } server;
+  } u;
+} traceRecord;
+
+_Static_assert(sizeof(traceRecord) == 64, "traceRecord must be 64 bytes");
+
+typedef struct {
+  char     magic[8];      //TRACE_FILE_MAGIC
+  uint32_t version;
+  uint32_t recordSize;
+  double   startTime;     //wall time the log was started
+  uint8_t  unused[40];
+} traceFileHeader;
+
+//One ring per producer.  The producer owns head, the writer thread owns
+//tail; each is on its own cache line.
+typedef struct {
+  _Atomic uint64_t head __attribute__((aligned(CACHE_LINE_SIZE)));
+  uint64_t cachedTail;   //producer's last view of tail
+  uint64_t drops;
+  _Atomic uint64_t tail __attribute__((aligned(CACHE_LINE_SIZE)));
+  uint64_t mask __attribute__((aligned(CACHE_LINE_SIZE)));
+  traceRecord *records;
+} traceRing;
+
+extern traceRing *traceRings;
+extern uint32_t numberTraceRings;
+
+int startTraceLogger(const char *fileName, uint32_t numberProducers, uint32_t ringSize);
+void stopTraceLogger();
+uint64_t getTraceDrops();
+
+/***********************************************************
+* Function: bool traceLog(uint32_t producer, const traceRecord *r)
+*
+* Explanation: copies the record into the producer's ring.  Only
+*              one thread may log as a given producer.  Lock free,
+*              never blocks.
+*
+* outputs: returns false if the logger was not started or the
+*          ring is full (the record is dropped)
+*
+***********************************************************/
+static inline bool traceLog(uint32_t producer, const traceRecord *r)
+{
+  traceRing *ring = NULL;
+  uint64_t head = 0;
+
+  if (producer >= numberTraceRings)
+    return false;
+  ring = &traceRings[producer];
+  head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  if (head - ring->cachedTail > ring->mask) {
+    ring->cachedTail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head - ring->cachedTail > ring->mask) {
+      ring->drops++;
+      return false;
+    }
+  }
+  ring->records[head & ring->mask] = *r;
+  atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+  return true;
+}
+
+#endif
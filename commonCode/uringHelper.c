@@ -0,0 +1,421 @@
+/*********************************************************
+*
+* Module Name: io_uring helper routines
+*
+* File Name:  uringHelper.c
+*
+* Summary:  An io_uring backend for the UDP datagram path:
+*           the ring setup, a pool of receive buffers the kernel
+*           picks from, multishot recvmsg and (linked) sendmsg.
+*           Made with the raw syscalls - no liburing.
+*
+*  The methods include:
+*   uringContext *createUring(uint32_t entries);
+*   void freeUring(uringContext *u);
+*   int uringRegisterBufferPool(uringContext *u, uint32_t numberBuffers, uint32_t bufferSize);
+*   int uringPrepRecvMsgMultishot(uringContext *u, int sock, struct msghdr *msgPtr, uint64_t userData);
+*   int uringPrepSendMsg(uringContext *u, int sock, struct msghdr *msgPtr, uint64_t userData, bool link);
+*   int uringPrepPoll(uringContext *u, int fd, uint32_t events, uint64_t userData);
+*   int uringSubmit(uringContext *u, uint32_t waitNumber);
+*   int uringSendBatch(uringContext *u, int sock, msgBatch *batchPtr, uint32_t numberMsgs);
+*   int printUring(uringContext *u, FILE *fileFID);
+*
+* Notes:
+*   Needs Linux 6.0 or later (multishot recvmsg, buffer rings).
+*   createUring returns NULL when io_uring is not available (an old
+*   kernel, io_uring_disabled, a seccomp filter):  the caller falls
+*   back to the socket calls.
+*
+* Last update: 10/17/2026
+*
+*********************************************************/
+#define _GNU_SOURCE
+#include "common.h"
+#include "uringHelper.h"
+#ifdef LINUX
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+//#define TRACEME 0
+
+#ifdef LINUX
+
+/***********************************************************
+* Function: uringContext *createUring(uint32_t entries)
+*
+* Explanation:  creates a ring and maps its queues.  The caller
+*               owns it.
+*
+* inputs:
+*   uint32_t entries : submission queue size (a power of 2)
+*
+* outputs:
+*    returns the ring or NULL (io_uring is not available)
+*
+***********************************************************/
+uringContext *createUring(uint32_t entries)
+{
+  uringContext *u = NULL;
+  struct io_uring_params p;
+  void *sqRingPtr = NULL;
+
+  u = calloc(1, sizeof(uringContext));
+  if (u == NULL)
+    return NULL;
+  u->ringFD = -1;
+
+  memset(&p, 0, sizeof(p));
+  //Completions are run when the ring is entered (no IPIs)
+  p.flags = IORING_SETUP_COOP_TASKRUN;
+  u->ringFD = (int)syscall(__NR_io_uring_setup, entries, &p);
+  if ((u->ringFD < 0) && (errno == EINVAL)) {
+    memset(&p, 0, sizeof(p));
+    u->ringFD = (int)syscall(__NR_io_uring_setup, entries, &p);
+  }
+  if (u->ringFD < 0) {
+    printf("createUring: io_uring_setup failed,  errno:%d \n", errno);
+    free(u);
+    return NULL;
+  }
+  u->features = p.features;
+
+  u->sqRingSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  u->cqRingSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {
+    if (u->cqRingSize > u->sqRingSize)
+      u->sqRingSize = u->cqRingSize;
+    u->cqRingSize = u->sqRingSize;
+  }
+  sqRingPtr = mmap(NULL, u->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   u->ringFD, IORING_OFF_SQ_RING);
+  if (sqRingPtr == MAP_FAILED) {
+    printf("createUring: mmap of the sq ring failed,  errno:%d \n", errno);
+    freeUring(u);
+    return NULL;
+  }
+  u->sqRingPtr = sqRingPtr;
+  if (p.features & IORING_FEAT_SINGLE_MMAP)
+    u->cqRingPtr = sqRingPtr;
+  else {
+    u->cqRingPtr = mmap(NULL, u->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        u->ringFD, IORING_OFF_CQ_RING);
+    if (u->cqRingPtr == MAP_FAILED) {
+      u->cqRingPtr = NULL;
+      printf("createUring: mmap of the cq ring failed,  errno:%d \n", errno);
+      freeUring(u);
+      return NULL;
+    }
+  }
+  u->sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+  u->sqes = mmap(NULL, u->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                 u->ringFD, IORING_OFF_SQES);
+  if (u->sqes == MAP_FAILED) {
+    u->sqes = NULL;
+    printf("createUring: mmap of the sqes failed,  errno:%d \n", errno);
+    freeUring(u);
+    return NULL;
+  }
+
+  u->sqHead = (unsigned *)((char *)u->sqRingPtr + p.sq_off.head);
+  u->sqTail = (unsigned *)((char *)u->sqRingPtr + p.sq_off.tail);
+  u->sqMask = *(unsigned *)((char *)u->sqRingPtr + p.sq_off.ring_mask);
+  u->sqEntries = *(unsigned *)((char *)u->sqRingPtr + p.sq_off.ring_entries);
+  u->sqArray = (unsigned *)((char *)u->sqRingPtr + p.sq_off.array);
+  u->sqLocalTail = *u->sqTail;
+  u->sqSubmittedTail = u->sqLocalTail;
+  u->cqHead = (unsigned *)((char *)u->cqRingPtr + p.cq_off.head);
+  u->cqTail = (unsigned *)((char *)u->cqRingPtr + p.cq_off.tail);
+  u->cqMask = *(unsigned *)((char *)u->cqRingPtr + p.cq_off.ring_mask);
+  u->cqes = (struct io_uring_cqe *)((char *)u->cqRingPtr + p.cq_off.cqes);
+  return u;
+}
+
+/***********************************************************
+* Function: void freeUring(uringContext *u)
+*
+* Explanation:  unmaps the queues, closes the ring and frees
+*               the buffer pool
+*
+***********************************************************/
+void freeUring(uringContext *u)
+{
+  if (u == NULL)
+    return;
+  if (u->sqes != NULL)
+    munmap(u->sqes, u->sqesSize);
+  if ((u->cqRingPtr != NULL) && (u->cqRingPtr != u->sqRingPtr))
+    munmap(u->cqRingPtr, u->cqRingSize);
+  if (u->sqRingPtr != NULL)
+    munmap(u->sqRingPtr, u->sqRingSize);
+  if (u->ringFD >= 0)
+    close(u->ringFD);
+  if (u->bufRing != NULL)
+    munmap(u->bufRing, u->bufRingSize);
+  free(u->buffers);
+  free(u);
+}
+
+/***********************************************************
+* Function: int uringRegisterBufferPool(uringContext *u, uint32_t numberBuffers,
+*                                       uint32_t bufferSize)
+*
+* Explanation:  allocates numberBuffers receive buffers and
+*               registers them as a provided buffer ring
+*               (group URING_BUFFER_GROUP).  All are given to
+*               the kernel.
+*
+* inputs:
+*   uint32_t numberBuffers : a power of 2, at most 32768
+*   uint32_t bufferSize : bytes per buffer
+*
+* outputs:
+*    returns ERROR or NOERROR
+*
+***********************************************************/
+int uringRegisterBufferPool(uringContext *u, uint32_t numberBuffers, uint32_t bufferSize)
+{
+  struct io_uring_buf_reg reg;
+  uint32_t i;
+
+  if ((numberBuffers == 0) || (numberBuffers > 32768) || ((numberBuffers & (numberBuffers - 1)) != 0)) {
+    printf("uringRegisterBufferPool: numberBuffers (%d) must be a power of 2 <= 32768 \n", numberBuffers);
+    return ERROR;
+  }
+  u->bufRingSize = numberBuffers * sizeof(struct io_uring_buf);
+  u->bufRing = mmap(NULL, u->bufRingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (u->bufRing == MAP_FAILED) {
+    u->bufRing = NULL;
+    return ERROR;
+  }
+  if (posix_memalign((void **)&u->buffers, CACHE_LINE_SIZE, (size_t)numberBuffers * bufferSize) != 0) {
+    u->buffers = NULL;
+    return ERROR;
+  }
+  u->numberBuffers = numberBuffers;
+  u->bufferSize = bufferSize;
+
+  memset(&reg, 0, sizeof(reg));
+  reg.ring_addr = (uint64_t)(uintptr_t)u->bufRing;
+  reg.ring_entries = numberBuffers;
+  reg.bgid = URING_BUFFER_GROUP;
+  if (syscall(__NR_io_uring_register, u->ringFD, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+    printf("uringRegisterBufferPool: IORING_REGISTER_PBUF_RING failed,  errno:%d \n", errno);
+    return ERROR;
+  }
+  u->bufTail = 0;
+  for (i = 0; i < numberBuffers; i++)
+    uringRecycleBuffer(u, i);
+  uringPublishBuffers(u);
+  return NOERROR;
+}
+
+/***********************************************************
+* Function: int uringPrepRecvMsgMultishot(uringContext *u, int sock,
+*                                         struct msghdr *msgPtr, uint64_t userData)
+*
+* Explanation:  queues a multishot recvmsg:  a completion per
+*               received msg, each in a pool buffer, until the
+*               completion without IORING_CQE_F_MORE (re-arm then)
+*
+* inputs:
+*   struct msghdr *msgPtr : only msg_namelen and msg_controllen are
+*                           used (the space reserved in each buffer).
+*                           Must stay valid while the recv is armed.
+*
+* outputs:
+*    returns ERROR (no free sqe) or NOERROR
+*
+***********************************************************/
+int uringPrepRecvMsgMultishot(uringContext *u, int sock, struct msghdr *msgPtr, uint64_t userData)
+{
+  struct io_uring_sqe *sqe = uringGetSQE(u);
+
+  if (sqe == NULL)
+    return ERROR;
+  sqe->opcode = IORING_OP_RECVMSG;
+  sqe->fd = sock;
+  sqe->addr = (uint64_t)(uintptr_t)msgPtr;
+  sqe->len = 1;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = URING_BUFFER_GROUP;
+  sqe->user_data = userData;
+  return NOERROR;
+}
+
+/***********************************************************
+* Function: int uringPrepSendMsg(uringContext *u, int sock, struct msghdr *msgPtr,
+*                                uint64_t userData, bool link)
+*
+* Explanation:  queues a sendmsg
+*
+* inputs:
+*   struct msghdr *msgPtr : must stay valid until its completion
+*   bool link : true: the next queued sqe starts after this one
+*               completes, even if this one fails (IOSQE_IO_HARDLINK)
+*
+* outputs:
+*    returns ERROR (no free sqe) or NOERROR
+*
+***********************************************************/
+int uringPrepSendMsg(uringContext *u, int sock, struct msghdr *msgPtr, uint64_t userData, bool link)
+{
+  struct io_uring_sqe *sqe = uringGetSQE(u);
+
+  if (sqe == NULL)
+    return ERROR;
+  sqe->opcode = IORING_OP_SENDMSG;
+  sqe->fd = sock;
+  sqe->addr = (uint64_t)(uintptr_t)msgPtr;
+  sqe->len = 1;
+  sqe->flags = link ? IOSQE_IO_HARDLINK : 0;
+  sqe->user_data = userData;
+  return NOERROR;
+}
+
+/***********************************************************
+* Function: int uringPrepPoll(uringContext *u, int fd, uint32_t events,
+*                             uint64_t userData)
+*
+* Explanation:  queues a (one shot) poll:  it completes when the fd
+*               has one of the events (POLLIN ...), e.g. a wake
+*               eventfd that ends a worker's wait
+*
+* outputs:
+*    returns ERROR (no free sqe) or NOERROR
+*
+***********************************************************/
+int uringPrepPoll(uringContext *u, int fd, uint32_t events, uint64_t userData)
+{
+  struct io_uring_sqe *sqe = uringGetSQE(u);
+
+  if (sqe == NULL)
+    return ERROR;
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = fd;
+  sqe->poll32_events = events;
+  sqe->user_data = userData;
+  return NOERROR;
+}
+
+/***********************************************************
+* Function: int uringSubmit(uringContext *u, uint32_t waitNumber)
+*
+* Explanation:  submits the queued sqes and waits until there are
+*               waitNumber completions (0: does not wait).  One
+*               io_uring_enter.
+*
+* outputs:
+*    returns ERROR or the number of sqes submitted
+*
+***********************************************************/
+int uringSubmit(uringContext *u, uint32_t waitNumber)
+{
+  unsigned toSubmit = u->sqLocalTail - u->sqSubmittedTail;
+  int rc = 0;
+
+  __atomic_store_n(u->sqTail, u->sqLocalTail, __ATOMIC_RELEASE);
+  rc = (int)syscall(__NR_io_uring_enter, u->ringFD, toSubmit, waitNumber,
+                    (waitNumber > 0) ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+  u->numberEnters++;
+  if (rc < 0) {
+    //A signal:  the sqes not consumed are submitted by the next call
+    if (errno == EINTR)
+      return 0;
+    printf("uringSubmit: io_uring_enter failed,  errno:%d \n", errno);
+    return ERROR;
+  }
+  u->sqSubmittedTail += (unsigned)rc;
+  return rc;
+}
+
+/***********************************************************
+* Function: int uringSendBatch(uringContext *u, int sock, msgBatch *batchPtr,
+*                              uint32_t numberMsgs)
+*
+* Explanation:  sends entries 0..numberMsgs-1 of the batch (as
+*               sendMsgBatch) with one io_uring_enter and waits
+*               for their completions
+*
+* outputs:
+*    returns ERROR or the number of msgs sent
+*
+***********************************************************/
+int uringSendBatch(uringContext *u, int sock, msgBatch *batchPtr, uint32_t numberMsgs)
+{
+  struct io_uring_cqe *cqe;
+  uint32_t i;
+  uint32_t numberDone = 0;
+  int numberSent = 0;
+
+  for (i = 0; i < numberMsgs; i++) {
+    if (uringPrepSendMsg(u, sock, &batchPtr->msgs[i].msg_hdr, i, false) == ERROR)
+      return ERROR;
+  }
+  if (uringSubmit(u, numberMsgs) == ERROR)
+    return ERROR;
+  while (numberDone < numberMsgs) {
+    cqe = uringPeekCQE(u);
+    if (cqe == NULL) {
+      if (uringSubmit(u, 1) == ERROR)
+        return ERROR;
+      continue;
+    }
+    if (cqe->res >= 0)
+      numberSent++;
+    else if (numberSent == 0)
+      errno = -cqe->res;
+    numberDone++;
+    uringCQESeen(u);
+  }
+  if (numberSent < (int)numberMsgs) {
+    printf("uringSendBatch:  sent %d of %d,  errno:%d \n", numberSent, numberMsgs, errno);
+    return ERROR;
+  }
+  return numberSent;
+}
+
+/***********************************************************
+* Function: int printUring(uringContext *u, FILE *fileFID)
+*
+* Explanation:  prints the ring's counters (one line)
+*
+* outputs :
+*    returns ERROR or NOERROR
+*
+***********************************************************/
+int printUring(uringContext *u, FILE *fileFID)
+{
+  if ((u == NULL) || (fileFID == NULL))
+    return ERROR;
+  fprintf(fileFID, "io_uring: enters:%lu completions:%lu (%3.1f per enter) buffers:%d x %d bytes, pool empty:%lu \n",
+          (unsigned long)u->numberEnters, (unsigned long)u->numberCompletions,
+          (u->numberEnters > 0) ? (double)u->numberCompletions / (double)u->numberEnters : 0.0,
+          u->numberBuffers, u->bufferSize, (unsigned long)u->numberNoBuffers);
+  return NOERROR;
+}
+
+#else
+
+uringContext *createUring(uint32_t entries)
+{
+  printf("createUring: io_uring is not supported on this platform \n");
+  return NULL;
+}
+
+void freeUring(uringContext *u)
+{
+}
+
+int uringSendBatch(uringContext *u, int sock, msgBatch *batchPtr, uint32_t numberMsgs)
+{
+  return ERROR;
+}
+
+int printUring(uringContext *u, FILE *fileFID)
+{
+  return ERROR;
+}
+
+#endif
@@ -0,0 +1,201 @@
+/************************************************************************
+* File:  uringHelper.h
+*
+* Purpose:
+*   This include file is for the uringHelper module:  an io_uring
+*   backend for the UDP datagram path made with the raw syscalls
+*   (io_uring_setup/enter/register, no liburing).
+*
+*   uringContext *createUring(uint32_t entries);
+*   void freeUring(uringContext *u);
+*   int uringRegisterBufferPool(uringContext *u, uint32_t numberBuffers, uint32_t bufferSize);
+*   int uringPrepRecvMsgMultishot(uringContext *u, int sock, struct msghdr *msgPtr, uint64_t userData);
+*   int uringPrepSendMsg(uringContext *u, int sock, struct msghdr *msgPtr, uint64_t userData, bool link);
+*   int uringPrepPoll(uringContext *u, int fd, uint32_t events, uint64_t userData);
+*   int uringSubmit(uringContext *u, uint32_t waitNumber);
+*   int uringSendBatch(uringContext *u, int sock, msgBatch *batchPtr, uint32_t numberMsgs);
+*   int printUring(uringContext *u, FILE *fileFID);
+*   static inline: uringGetSQE, uringPeekCQE, uringCQESeen,
+*                  uringGetBuffer, uringRecycleBuffer, uringPublishBuffers
+*
+* Notes:
+*   The receive buffers are a pool the kernel picks from (a provided
+*   buffer ring, IORING_REGISTER_PBUF_RING) so one multishot recvmsg
+*   keeps receiving without a new request per msg.  Each completion
+*   names the buffer it filled; the caller gives it back with
+*   uringRecycleBuffer once it is done with it (e.g., its echo was sent).
+*   A multishot buffer holds an io_uring_recvmsg_out, then the
+*   msg_namelen bytes of the source address, msg_controllen bytes of
+*   control data and the payload.
+*   A ring is not thread safe:  one per thread.
+*
+* Last update: 10/17/2026
+*
+*************************************************************************/
+#ifndef	__uringHelper_h
+#define	__uringHelper_h
+
+#include "common.h"
+#include "SocketHelper.h"
+
+#ifdef LINUX
+#include <linux/io_uring.h>
+#endif
+
+#define URING_DEFAULT_ENTRIES 4096
+#define URING_BUFFER_GROUP 1
+//The completion's buffer id
+#define URING_BUFFER_SHIFT 16
+
+#ifdef LINUX
+
+typedef struct {
+  int ringFD;
+  uint32_t features;
+
+  //Submission queue
+  unsigned *sqHead;
+  unsigned *sqTail;
+  unsigned sqMask;
+  unsigned sqEntries;
+  unsigned *sqArray;
+  struct io_uring_sqe *sqes;
+  unsigned sqLocalTail;        //prepared (not yet published)
+  unsigned sqSubmittedTail;    //published and entered
+
+  //Completion queue
+  unsigned *cqHead;
+  unsigned *cqTail;
+  unsigned cqMask;
+  struct io_uring_cqe *cqes;
+
+  void *sqRingPtr;
+  size_t sqRingSize;
+  void *cqRingPtr;
+  size_t cqRingSize;
+  size_t sqesSize;
+
+  //The provided buffer pool (receive buffers)
+  struct io_uring_buf_ring *bufRing;
+  size_t bufRingSize;
+  char *buffers;
+  uint32_t numberBuffers;      //power of 2
+  uint32_t bufferSize;
+  uint16_t bufTail;            //added (not yet published)
+
+  uint64_t numberEnters;
+  uint64_t numberCompletions;
+  uint64_t numberNoBuffers;    //the pool was empty (recv re-armed)
+} uringContext;
+
+uringContext *createUring(uint32_t entries);
+void freeUring(uringContext *u);
+int uringRegisterBufferPool(uringContext *u, uint32_t numberBuffers, uint32_t bufferSize);
+int uringPrepRecvMsgMultishot(uringContext *u, int sock, struct msghdr *msgPtr, uint64_t userData);
+int uringPrepSendMsg(uringContext *u, int sock, struct msghdr *msgPtr, uint64_t userData, bool link);
+int uringPrepPoll(uringContext *u, int fd, uint32_t events, uint64_t userData);
+int uringSubmit(uringContext *u, uint32_t waitNumber);
+int uringSendBatch(uringContext *u, int sock, msgBatch *batchPtr, uint32_t numberMsgs);
+int printUring(uringContext *u, FILE *fileFID);
+
+/***********************************************************
+* Function: static inline struct io_uring_sqe *uringGetSQE(uringContext *u)
+*
+* Explanation:  returns the next (zeroed) submission entry, NULL
+*               if the queue is full (call uringSubmit first)
+*
+***********************************************************/
+static inline struct io_uring_sqe *uringGetSQE(uringContext *u)
+{
+  struct io_uring_sqe *sqe;
+  unsigned index;
+
+  if ((u->sqLocalTail - __atomic_load_n(u->sqHead, __ATOMIC_ACQUIRE)) >= u->sqEntries)
+    return NULL;
+  index = u->sqLocalTail & u->sqMask;
+  sqe = &u->sqes[index];
+  u->sqArray[index] = index;
+  u->sqLocalTail++;
+  memset(sqe, 0, sizeof(*sqe));
+  return sqe;
+}
+
+/***********************************************************
+* Function: static inline struct io_uring_cqe *uringPeekCQE(uringContext *u)
+*
+* Explanation:  returns the oldest completion, NULL if there is none.
+*               The entry is valid until uringCQESeen.
+*
+***********************************************************/
+static inline struct io_uring_cqe *uringPeekCQE(uringContext *u)
+{
+  unsigned head = *u->cqHead;
+
+  if (head == __atomic_load_n(u->cqTail, __ATOMIC_ACQUIRE))
+    return NULL;
+  return &u->cqes[head & u->cqMask];
+}
+
+/***********************************************************
+* Function: static inline void uringCQESeen(uringContext *u)
+*
+* Explanation:  removes the completion returned by uringPeekCQE
+*
+***********************************************************/
+static inline void uringCQESeen(uringContext *u)
+{
+  u->numberCompletions++;
+  __atomic_store_n(u->cqHead, *u->cqHead + 1, __ATOMIC_RELEASE);
+}
+
+/***********************************************************
+* Function: static inline char *uringGetBuffer(uringContext *u, uint32_t bufferID)
+*
+* Explanation:  returns the pool buffer bufferID
+*
+***********************************************************/
+static inline char *uringGetBuffer(uringContext *u, uint32_t bufferID)
+{
+  return u->buffers + (size_t)bufferID * u->bufferSize;
+}
+
+/***********************************************************
+* Function: static inline void uringRecycleBuffer(uringContext *u, uint32_t bufferID)
+*
+* Explanation:  gives a pool buffer back to the kernel.  It is
+*               not seen until uringPublishBuffers.
+*
+***********************************************************/
+static inline void uringRecycleBuffer(uringContext *u, uint32_t bufferID)
+{
+  struct io_uring_buf *b = &u->bufRing->bufs[u->bufTail & (u->numberBuffers - 1)];
+
+  b->addr = (uint64_t)(uintptr_t)uringGetBuffer(u, bufferID);
+  b->len = u->bufferSize;
+  b->bid = (uint16_t)bufferID;
+  u->bufTail++;
+}
+
+/***********************************************************
+* Function: static inline void uringPublishBuffers(uringContext *u)
+*
+* Explanation:  makes the recycled buffers visible to the kernel
+*
+***********************************************************/
+static inline void uringPublishBuffers(uringContext *u)
+{
+  __atomic_store_n(&u->bufRing->tail, u->bufTail, __ATOMIC_RELEASE);
+}
+
+#else
+typedef struct {
+  int ringFD;
+} uringContext;
+
+uringContext *createUring(uint32_t entries);
+void freeUring(uringContext *u);
+int uringSendBatch(uringContext *u, int sock, msgBatch *batchPtr, uint32_t numberMsgs);
+int printUring(uringContext *u, FILE *fileFID);
+#endif
+
+#endif
@@ -22,8 +22,10 @@
 *   -question:  diff between X86 and AMD64
 *
 *********************************************************/
+#define _GNU_SOURCE /* for CPU_SET, pthread_setaffinity_np */
 #include "common.h"
 #include "utils.h"
+#include <sched.h>
 
 //char Version[] = "8.0";   
 char Version[MAX_LINE_SIZE] = "0.0";
@@ -722,8 +724,9 @@ unsigned int ipflow_hash(struct in_addr dst, struct in_addr src, unsigned short
 {
   unsigned int hash = ip_p;
   int idx;
+  //A shift by 32 is undefined - idx 0 uses the whole dst (what x86 did)
   for (idx = 0; idx < 32; idx += IPFLOW_HASHBITS)
-    hash += (dst.s_addr >> (32 - idx)) + (src.s_addr >> idx) + (sport >> idx) + (dport >> idx);
+    hash += ((idx == 0) ? dst.s_addr : (dst.s_addr >> (32 - idx))) + (src.s_addr >> idx) + (sport >> idx) + (dport >> idx);
   return hash & (IPFLOW_HASHSIZE-1);
 }
 
@@ -918,5 +921,104 @@ int writeFile(double curTime, void *dataPtr,char *outputFileName,uint32_t sizeDa
   return rc;
 }
 
+/***********************************************************
+* Function: int pinThreadToCPU(int cpu)
+*
+* Explanation:  pins the calling thread to a CPU
+*
+* inputs:
+*     int cpu :  0 .. number of CPUs - 1.  -1 does nothing.
+*
+* outputs:
+*     returns ERROR or NOERROR
+*
+**************************************************/
+int pinThreadToCPU(int cpu)
+{
+  int rc = NOERROR;
+#ifdef LINUX
+  cpu_set_t cpuSet;
+
+  if (cpu < 0)
+    return NOERROR;
+  CPU_ZERO(&cpuSet);
+  CPU_SET(cpu, &cpuSet);
+  rc = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+  if (rc != 0) {
+    printf("pinThreadToCPU: failed to pin to cpu %d, rc:%d \n", cpu, rc);
+    rc = ERROR;
+  }
+#endif
+  return rc;
+}
 
+/***********************************************************
+* Function: int getNumberCPUs()
+*
+* Explanation:  returns the number of online CPUs (at least 1)
+*
+**************************************************/
+int getNumberCPUs()
+{
+  long numberCPUs = sysconf(_SC_NPROCESSORS_ONLN);
 
+  return (numberCPUs > 0) ? (int)numberCPUs : 1;
+}
+
+/***********************************************************
+* Function: int setThreadFIFO(int priority)
+*
+* Explanation:  moves the calling thread to the SCHED_FIFO
+*               (real time) scheduling class
+*
+* inputs:
+*     int priority :  1 .. 99.  0 does nothing.
+*
+* outputs:
+*     returns ERROR (e.g., no CAP_SYS_NICE) or NOERROR
+*
+**************************************************/
+int setThreadFIFO(int priority)
+{
+  int rc = NOERROR;
+  struct sched_param param;
+
+  if (priority <= 0)
+    return NOERROR;
+  memset(&param, 0, sizeof(param));
+  param.sched_priority = priority;
+  rc = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+  if (rc != 0) {
+    printf("setThreadFIFO: failed to set SCHED_FIFO priority %d, rc:%d \n", priority, rc);
+    rc = ERROR;
+  }
+  return rc;
+}
+
+/***********************************************************
+* Function: double parseBitRate(char *rateString)
+*
+* Explanation:  converts a rate such as 250000, 1.5M or 10G
+*               (k, M, G: 1e3, 1e6, 1e9) to bits per second
+*
+* outputs:
+*     returns the rate or -1.0 (not a positive number)
+*
+**************************************************/
+double parseBitRate(char *rateString)
+{
+  char *endPtr = NULL;
+  double rate = strtod(rateString, &endPtr);
+
+  if (endPtr == rateString)
+    return -1.0;
+  if ((*endPtr == 'k') || (*endPtr == 'K'))
+    rate *= 1000.0;
+  else if (*endPtr == 'M')
+    rate *= 1000000.0;
+  else if (*endPtr == 'G')
+    rate *= 1000000000.0;
+  else if (*endPtr != '\0')
+    return -1.0;
+  return (rate > 0.0) ? rate : -1.0;
+}
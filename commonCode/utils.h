@@ -77,6 +77,12 @@ int writeLine(double curTime,char *dataPtr, FILE *outFD, uint32_t sizeData, int
 
 int writeFile(double curTime, void *dataPtr,char *outputFileName,uint32_t maxSize, int mode);
 
+int pinThreadToCPU(int cpu);
+int getNumberCPUs();
+int setThreadFIFO(int priority);
+//bits per second of e.g. 1.5M, -1.0 on error
+double parseBitRate(char *rateString);
+
 #endif
 
 
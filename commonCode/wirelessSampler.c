@@ -0,0 +1,222 @@
+/*********************************************************
+*
+* Module Name: wireless signal sampler
+*
+* File Name:  wirelessSampler.c
+*
+* Summary:  This runs a background thread that periodically
+*           obtains the link quality and signal level of a wireless
+*           IF using the SIOCGIWSTATS ioctl (the same info iwconfig shows).
+*           The latest sample is published through a single 64 bit
+*           atomic word so the send path of a program can read it
+*           without a lock, a fork, or any file I/O.
+*
+*       int startWirelessSampler(const char *IFName, double sampleInterval);
+*       void stopWirelessSampler();
+*       int sampleWirelessIF(const char *IFName, int32_t *RSSI, int32_t *SignalQuality);
+*       getWirelessSample() is an inline in wirelessSampler.h
+*
+* Notes:
+*   RSSI is the signal level in dBm.  SignalQuality is the driver's
+*   link quality value.  Both are -1 when not available.
+*
+* Last update: 10/17/2026
+*
+*********************************************************/
+#include "common.h"
+#include "netHelper.h"
+#include "wirelessSampler.h"
+
+//#define TRACEME 0
+
+_Atomic uint64_t wirelessSampleWord =
+   ((uint64_t)(uint32_t)WIRELESS_INVALID_SAMPLE << 32) | (uint32_t)WIRELESS_INVALID_SAMPLE;
+
+static pthread_t samplerThread;
+static bool isSamplerRunning = false;
+static int samplerSock = -1;
+static char samplerIFName[IFNAMSIZ];
+static struct timespec samplerIntervalTS;
+
+static void publishWirelessSample(int32_t RSSI, int32_t SignalQuality)
+{
+  uint64_t word = ((uint64_t)(uint32_t)SignalQuality << 32) | (uint32_t)RSSI;
+  atomic_store_explicit(&wirelessSampleWord, word, memory_order_relaxed);
+}
+
+/***********************************************************
+* Function: static int readIWStats(int sock, const char *IFName, int32_t *RSSI, int32_t *SignalQuality)
+*
+* Explanation:  issues the SIOCGIWSTATS ioctl on the socket
+*
+* outputs: returns ERROR or NOERROR.  On ERROR the
+*          callers values are set to WIRELESS_INVALID_SAMPLE
+*
+***********************************************************/
+static int readIWStats(int sock, const char *IFName, int32_t *RSSI, int32_t *SignalQuality)
+{
+  int rc = NOERROR;
+#ifdef LINUX
+  struct iwreq wrq;
+  struct iw_statistics stats;
+
+  memset(&wrq, 0, sizeof(wrq));
+  memset(&stats, 0, sizeof(stats));
+  strncpy(wrq.ifr_name, IFName, IFNAMSIZ-1);
+  wrq.u.data.pointer = &stats;
+  wrq.u.data.length = sizeof(stats);
+  wrq.u.data.flags = 1;   //clear the updated flags
+
+  if (ioctl(sock, SIOCGIWSTATS, &wrq) == -1) {
+    rc = ERROR;
+  } else {
+    *SignalQuality = (stats.qual.updated & IW_QUAL_QUAL_INVALID) ?
+                         WIRELESS_INVALID_SAMPLE : (int32_t)stats.qual.qual;
+    if (stats.qual.updated & IW_QUAL_LEVEL_INVALID)
+      *RSSI = WIRELESS_INVALID_SAMPLE;
+    else if (stats.qual.updated & IW_QUAL_DBM)
+      *RSSI = (int32_t)(int8_t)stats.qual.level;   //dBm are carried as a signed byte
+    else
+      *RSSI = (int32_t)stats.qual.level;
+  }
+#else
+  rc = ERROR;
+#endif
+
+  if (rc == ERROR) {
+    *RSSI = WIRELESS_INVALID_SAMPLE;
+    *SignalQuality = WIRELESS_INVALID_SAMPLE;
+  }
+  return rc;
+}
+
+/***********************************************************
+* Function: int sampleWirelessIF(const char *IFName, int32_t *RSSI, int32_t *SignalQuality)
+*
+* Explanation:  Takes a single sample (no thread).
+*
+* inputs:
+*   const char *IFName : the wireless IF
+*   int32_t *RSSI, int32_t *SignalQuality: callers vars to fill in
+*
+* outputs: returns ERROR or NOERROR
+*
+***********************************************************/
+int sampleWirelessIF(const char *IFName, int32_t *RSSI, int32_t *SignalQuality)
+{
+  int rc = NOERROR;
+  int sock = socket(AF_INET, SOCK_DGRAM, 0);
+
+  if (sock < 0) {
+    *RSSI = WIRELESS_INVALID_SAMPLE;
+    *SignalQuality = WIRELESS_INVALID_SAMPLE;
+    return ERROR;
+  }
+  rc = readIWStats(sock, IFName, RSSI, SignalQuality);
+  close(sock);
+  return rc;
+}
+
+/***********************************************************
+* Function: static void *samplerLoop(void *arg)
+*
+* Explanation:  the sampler thread. Samples, publishes, sleeps.
+*               The thread is cancelled by stopWirelessSampler
+*               while it sleeps (nanosleep is a cancellation point).
+*
+***********************************************************/
+static void *samplerLoop(void *arg)
+{
+  int32_t RSSI = WIRELESS_INVALID_SAMPLE;
+  int32_t SignalQuality = WIRELESS_INVALID_SAMPLE;
+
+  while (1) {
+    readIWStats(samplerSock, samplerIFName, &RSSI, &SignalQuality);
+    publishWirelessSample(RSSI, SignalQuality);
+#ifdef TRACEME
+    printf("samplerLoop: %s RSSI:%d Quality:%d \n", samplerIFName, RSSI, SignalQuality);
+#endif
+    nanosleep(&samplerIntervalTS, NULL);
+  }
+  return NULL;
+}
+
+/***********************************************************
+* Function: int startWirelessSampler(const char *IFName, double sampleInterval)
+*
+* Explanation:  starts the sampler thread.  The first sample is
+*               taken before returning so a caller never sees
+*               a stale value.
+*
+* inputs:
+*   const char *IFName : the wireless IF to sample (e.g., wlan0)
+*   double sampleInterval : seconds between samples
+*
+* outputs: returns ERROR or NOERROR.  If the IF is not
+*          wireless, the thread is not started, the published
+*          sample remains -1,-1 and NOERROR is returned.
+*
+***********************************************************/
+int startWirelessSampler(const char *IFName, double sampleInterval)
+{
+  int rc = NOERROR;
+  char protocol[IFNAMSIZ] = {0};
+  int32_t RSSI = WIRELESS_INVALID_SAMPLE;
+  int32_t SignalQuality = WIRELESS_INVALID_SAMPLE;
+
+  if ((IFName == NULL) || (sampleInterval <= 0.0) || isSamplerRunning)
+    return ERROR;
+
+  publishWirelessSample(WIRELESS_INVALID_SAMPLE, WIRELESS_INVALID_SAMPLE);
+  if (!isWireless(IFName, protocol)) {
+#ifdef TRACEME
+    printf("startWirelessSampler: %s is not wireless \n", IFName);
+#endif
+    return NOERROR;
+  }
+
+  strncpy(samplerIFName, IFName, IFNAMSIZ-1);
+  samplerIntervalTS.tv_sec = (time_t)sampleInterval;
+  samplerIntervalTS.tv_nsec = (long)((sampleInterval - (double)samplerIntervalTS.tv_sec) * BILLION);
+
+  samplerSock = socket(AF_INET, SOCK_DGRAM, 0);
+  if (samplerSock < 0) {
+    perror("startWirelessSampler: socket failed ");
+    return ERROR;
+  }
+
+  readIWStats(samplerSock, samplerIFName, &RSSI, &SignalQuality);
+  publishWirelessSample(RSSI, SignalQuality);
+
+  rc = pthread_create(&samplerThread, NULL, samplerLoop, NULL);
+  if (rc != 0) {
+    printf("startWirelessSampler: pthread_create failed rc:%d \n", rc);
+    close(samplerSock);
+    samplerSock = -1;
+    rc = ERROR;
+  } else {
+    isSamplerRunning = true;
+    rc = NOERROR;
+  }
+  return rc;
+}
+
+/***********************************************************
+* Function: void stopWirelessSampler()
+*
+* Explanation:  stops the sampler thread (if running)
+*
+***********************************************************/
+void stopWirelessSampler()
+{
+  if (isSamplerRunning) {
+    pthread_cancel(samplerThread);
+    pthread_join(samplerThread, NULL);
+    isSamplerRunning = false;
+  }
+  if (samplerSock != -1) {
+    close(samplerSock);
+    samplerSock = -1;
+  }
+}
+
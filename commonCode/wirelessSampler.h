@@ -0,0 +1,54 @@
+/************************************************************************
+* File:  wirelessSampler.h
+*
+* Purpose:
+*   This include file is for the wirelessSampler module.
+*   A background thread samples the link quality and signal level
+*   of a wireless IF (SIOCGIWSTATS) at a configurable interval and
+*   publishes the most recent sample.  Readers never block: the
+*   sample is packed into a single 64 bit atomic word.
+*
+*   int startWirelessSampler(const char *IFName, double sampleInterval);
+*   void stopWirelessSampler();
+*   void getWirelessSample(int32_t *RSSI, int32_t *SignalQuality);
+*
+* Notes:
+*   If the IF is not wireless (or the ioctl fails) the sample
+*   is -1,-1 (same convention as the old test.sh script).
+*
+* Last update: 10/17/2026
+*
+*************************************************************************/
+#ifndef	__wirelessSampler_h
+#define	__wirelessSampler_h
+
+#include "common.h"
+#include <stdatomic.h>
+
+#define WIRELESS_DEFAULT_IF  "wlan0"
+#define WIRELESS_DEFAULT_SAMPLE_INTERVAL  1.0
+#define WIRELESS_INVALID_SAMPLE  -1
+
+//The published sample:  upper 32 bits SignalQuality, lower 32 bits RSSI (dBm)
+extern _Atomic uint64_t wirelessSampleWord;
+
+int startWirelessSampler(const char *IFName, double sampleInterval);
+void stopWirelessSampler();
+int sampleWirelessIF(const char *IFName, int32_t *RSSI, int32_t *SignalQuality);
+
+/***********************************************************
+* Function: void getWirelessSample(int32_t *RSSI, int32_t *SignalQuality)
+*
+* Explanation: returns the latest published sample.  This is
+*              a single relaxed atomic load - safe to call per packet.
+*
+***********************************************************/
+static inline void getWirelessSample(int32_t *RSSI, int32_t *SignalQuality)
+{
+  uint64_t word = atomic_load_explicit(&wirelessSampleWord, memory_order_relaxed);
+  *RSSI = (int32_t)(uint32_t)(word & 0xffffffff);
+  *SignalQuality = (int32_t)(uint32_t)(word >> 32);
+}
+
+#endif
+